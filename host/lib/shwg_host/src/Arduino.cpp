@@ -0,0 +1,45 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <thread>
+
+static const auto kStartTime = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - kStartTime)
+      .count();
+}
+
+uint32_t micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - kStartTime)
+      .count();
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char* name,
+                       uint32_t stack_depth, void* parameters,
+                       unsigned int priority, TaskHandle_t* created_task) {
+  std::thread* thread = new std::thread(task_code, parameters);
+  thread->detach();
+  if (created_task != nullptr) {
+    *created_task = thread;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char* name,
+                                   uint32_t stack_depth, void* parameters,
+                                   unsigned int priority,
+                                   TaskHandle_t* created_task, int core_id) {
+  return xTaskCreate(task_code, name, stack_depth, parameters, priority,
+                     created_task);
+}
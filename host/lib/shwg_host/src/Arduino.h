@@ -0,0 +1,57 @@
+#ifndef SH_WG_HOST_ARDUINO_H_
+#define SH_WG_HOST_ARDUINO_H_
+
+// Minimal Arduino core replacement for building the gateway core on a
+// POSIX host. Only the parts used by the hardware-independent sources are
+// provided.
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+
+#include <sys/time.h>
+
+#include "WString.h"
+
+// GPIO pin numbers are referenced by config.h only
+
+typedef enum {
+  GPIO_NUM_2 = 2,
+  GPIO_NUM_4 = 4,
+  GPIO_NUM_5 = 5,
+  GPIO_NUM_18 = 18,
+  GPIO_NUM_25 = 25,
+  GPIO_NUM_26 = 26,
+  GPIO_NUM_27 = 27,
+} gpio_num_t;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// FreeRTOS task API, implemented with detached threads
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+constexpr BaseType_t pdPASS = 1;
+constexpr BaseType_t pdFAIL = 0;
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char* name,
+                       uint32_t stack_depth, void* parameters,
+                       unsigned int priority, TaskHandle_t* created_task);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char* name,
+                                   uint32_t stack_depth, void* parameters,
+                                   unsigned int priority,
+                                   TaskHandle_t* created_task, int core_id);
+
+#endif  // SH_WG_HOST_ARDUINO_H_
@@ -0,0 +1,124 @@
+#include "AsyncUDP.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "host_debug.h"
+
+IPAddress AsyncUDP::broadcast_address_ = IPAddress(255, 255, 255, 255);
+
+bool AsyncUDP::listen(uint16_t port) {
+  close();
+
+  fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  int flag = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  setsockopt(fd_, SOL_SOCKET, SO_BROADCAST, &flag, sizeof(flag));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    debugE("Unable to bind UDP port %u: %s", port, strerror(errno));
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  port_ = port;
+
+  running_ = true;
+  receive_thread_ = new std::thread([this]() { receive_loop(); });
+  return true;
+}
+
+bool AsyncUDP::listenMulticast(IPAddress address, uint16_t port,
+                               uint8_t ttl) {
+  if (!listen(port)) {
+    return false;
+  }
+  struct ip_mreq mreq = {};
+  mreq.imr_multiaddr.s_addr = (uint32_t)address;
+  mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) <
+      0) {
+    debugE("Unable to join multicast group %s: %s",
+           address.toString().c_str(), strerror(errno));
+    close();
+    return false;
+  }
+  int multicast_ttl = ttl;
+  setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &multicast_ttl,
+             sizeof(multicast_ttl));
+  return true;
+}
+
+void AsyncUDP::receive_loop() {
+  uint8_t buf[1500];
+  while (running_) {
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    // wake up periodically to notice close()
+    if (poll(&pfd, 1, 100) <= 0) {
+      continue;
+    }
+    struct sockaddr_in remote;
+    socklen_t remote_len = sizeof(remote);
+    ssize_t len = recvfrom(fd_, buf, sizeof(buf), 0,
+                           (struct sockaddr*)&remote, &remote_len);
+    if (len <= 0 || !handler_) {
+      continue;
+    }
+    // drop our own broadcasts looped back via the loopback interface;
+    // those sent via the local IP address are filtered by the caller
+    if (ntohs(remote.sin_port) == port_ &&
+        (ntohl(remote.sin_addr.s_addr) >> 24) == 127) {
+      continue;
+    }
+    AsyncUDPPacket packet(buf, len, IPAddress(remote.sin_addr.s_addr),
+                          ntohs(remote.sin_port));
+    handler_(packet);
+  }
+}
+
+size_t AsyncUDP::writeTo(const uint8_t* data, size_t len, IPAddress address,
+                         uint16_t port) {
+  if (fd_ < 0) {
+    return 0;
+  }
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = (uint32_t)address;
+  addr.sin_port = htons(port);
+  ssize_t retval =
+      sendto(fd_, data, len, 0, (struct sockaddr*)&addr, sizeof(addr));
+  return retval < 0 ? 0 : retval;
+}
+
+size_t AsyncUDP::broadcastTo(const uint8_t* data, size_t len,
+                             uint16_t port) {
+  return writeTo(data, len, broadcast_address_, port);
+}
+
+size_t AsyncUDP::broadcast(const char* data) {
+  return broadcastTo((const uint8_t*)data, strlen(data), port_);
+}
+
+void AsyncUDP::close() {
+  running_ = false;
+  if (receive_thread_ != nullptr) {
+    receive_thread_->join();
+    delete receive_thread_;
+    receive_thread_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef SH_WG_HOST_ASYNCUDP_H_
+#define SH_WG_HOST_ASYNCUDP_H_
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+class AsyncUDPPacket {
+ public:
+  AsyncUDPPacket(uint8_t* data, size_t length, IPAddress remote_ip,
+                 uint16_t remote_port)
+      : data_{data},
+        length_{length},
+        remote_ip_{remote_ip},
+        remote_port_{remote_port} {}
+
+  uint8_t* data() { return data_; }
+  size_t length() { return length_; }
+  IPAddress remoteIP() { return remote_ip_; }
+  uint16_t remotePort() { return remote_port_; }
+
+ protected:
+  uint8_t* data_;
+  size_t length_;
+  IPAddress remote_ip_;
+  uint16_t remote_port_;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+/**
+ * @brief UDP socket with the AsyncUDP API.
+ *
+ * As on the ESP32, packet handlers are called from a separate receive
+ * thread.
+ */
+class AsyncUDP {
+ public:
+  AsyncUDP() {}
+  ~AsyncUDP() { close(); }
+
+  bool listen(uint16_t port);
+  /**
+   * @brief Listen on a port and join a multicast group. Multicast packets
+   * sent by this socket are looped back, as they are on the ESP32.
+   */
+  bool listenMulticast(IPAddress address, uint16_t port, uint8_t ttl = 1);
+  void onPacket(AuPacketHandlerFunction handler) { handler_ = handler; }
+  size_t writeTo(const uint8_t* data, size_t len, IPAddress address,
+                 uint16_t port);
+  size_t broadcast(const char* data);
+  size_t broadcastTo(const uint8_t* data, size_t len, uint16_t port);
+  void close();
+
+  /**
+   * @brief Set the address broadcasts are sent to. Defaults to
+   * 255.255.255.255; on hosts with several interfaces, a directed broadcast
+   * address or 127.255.255.255 can be used instead.
+   */
+  static void set_broadcast_address(IPAddress address) {
+    broadcast_address_ = address;
+  }
+
+ protected:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  AuPacketHandlerFunction handler_;
+  std::thread* receive_thread_ = nullptr;
+  std::atomic<bool> running_{false};
+
+  static IPAddress broadcast_address_;
+
+  void receive_loop();
+};
+
+#endif  // SH_WG_HOST_ASYNCUDP_H_
@@ -0,0 +1,55 @@
+#include "ReactESP.h"
+
+namespace reactesp {
+
+ReactESP* ReactESP::app = nullptr;
+
+uint64_t ReactESP::now_us() {
+  // extend the 32-bit microsecond counter
+  uint32_t now = micros();
+  if (now < last_micros_) {
+    micros_high_ += 1ULL << 32;
+  }
+  last_micros_ = now;
+  return micros_high_ + now;
+}
+
+Reaction* ReactESP::add(Reaction* reaction) {
+  reaction->next_us_ = now_us() + reaction->interval_us_;
+  reactions_.push_back(reaction);
+  return reaction;
+}
+
+void ReactESP::tick() {
+  uint64_t now = now_us();
+  // reactions added during the tick are run on the next one
+  size_t num_reactions = reactions_.size();
+  for (size_t i = 0; i < num_reactions; i++) {
+    Reaction* reaction = reactions_[i];
+    if (reaction->removed_ || now < reaction->next_us_) {
+      continue;
+    }
+    if (reaction->repeat_) {
+      reaction->next_us_ += reaction->interval_us_;
+      if (reaction->next_us_ < now) {
+        // don't try to catch up with missed calls
+        reaction->next_us_ = now + reaction->interval_us_;
+      }
+    } else {
+      reaction->removed_ = true;
+    }
+    reaction->callback_();
+  }
+
+  // purge removed reactions
+  for (auto it = reactions_.begin(); it != reactions_.end();) {
+    if ((*it)->removed_) {
+      delete *it;
+      it = reactions_.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+}  // namespace reactesp
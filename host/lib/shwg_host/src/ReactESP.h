@@ -0,0 +1,93 @@
+#ifndef SH_WG_HOST_REACTESP_H_
+#define SH_WG_HOST_REACTESP_H_
+
+#include <functional>
+#include <vector>
+
+#include "Arduino.h"
+
+namespace reactesp {
+
+typedef std::function<void()> react_callback;
+
+class ReactESP;
+
+/**
+ * @brief Timed reaction, equivalent to ReactESP RepeatReaction and
+ * DelayReaction.
+ */
+class Reaction {
+ public:
+  Reaction(ReactESP* app, uint64_t interval_us, bool repeat,
+           react_callback callback)
+      : app_{app},
+        interval_us_{interval_us},
+        repeat_{repeat},
+        callback_{callback} {}
+
+  void remove();
+
+ protected:
+  ReactESP* app_;
+  uint64_t interval_us_;
+  uint64_t next_us_ = 0;
+  bool repeat_;
+  react_callback callback_;
+  bool removed_ = false;
+
+  friend class ReactESP;
+};
+
+typedef Reaction RepeatReaction;
+typedef Reaction DelayReaction;
+
+/**
+ * @brief Single-threaded event loop with the ReactESP timer API.
+ */
+class ReactESP {
+ public:
+  ReactESP(bool singleton = true) {
+    if (singleton) {
+      app = this;
+    }
+  }
+
+  RepeatReaction* onRepeat(uint32_t interval_ms, react_callback callback) {
+    return add(new Reaction(this, interval_ms * 1000ULL, true, callback));
+  }
+  RepeatReaction* onRepeatMicros(uint32_t interval_us,
+                                 react_callback callback) {
+    return add(new Reaction(this, interval_us, true, callback));
+  }
+  DelayReaction* onDelay(uint32_t delay_ms, react_callback callback) {
+    return add(new Reaction(this, delay_ms * 1000ULL, false, callback));
+  }
+  DelayReaction* onDelayMicros(uint32_t delay_us, react_callback callback) {
+    return add(new Reaction(this, delay_us, false, callback));
+  }
+
+  void remove(Reaction* reaction) { reaction->removed_ = true; }
+
+  /**
+   * @brief Run all reactions that are due.
+   */
+  void tick();
+
+  static ReactESP* app;
+
+ protected:
+  std::vector<Reaction*> reactions_;
+  uint64_t now_us();
+  uint64_t last_micros_ = 0;
+  uint64_t micros_high_ = 0;
+
+  Reaction* add(Reaction* reaction);
+};
+
+inline void Reaction::remove() { app_->remove(this); }
+
+}  // namespace reactesp
+
+using namespace reactesp;
+
+#endif  // SH_WG_HOST_REACTESP_H_
@@ -0,0 +1,131 @@
+#ifndef SH_WG_HOST_WSTRING_H_
+#define SH_WG_HOST_WSTRING_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief Arduino String replacement backed by std::string.
+ *
+ * Implements the subset of the Arduino String API used by the gateway core.
+ */
+class String {
+ public:
+  String() {}
+  String(const char* str) : str_{str == nullptr ? "" : str} {}
+  String(const std::string& str) : str_{str} {}
+  explicit String(char c) : str_(1, c) {}
+  explicit String(int value) : str_{std::to_string(value)} {}
+  explicit String(unsigned int value) : str_{std::to_string(value)} {}
+  explicit String(long value) : str_{std::to_string(value)} {}
+  explicit String(unsigned long value) : str_{std::to_string(value)} {}
+
+  unsigned int length() const { return str_.length(); }
+  const char* c_str() const { return str_.c_str(); }
+  bool reserve(unsigned int size) {
+    str_.reserve(size);
+    return true;
+  }
+
+  char operator[](unsigned int index) const {
+    return index < str_.length() ? str_[index] : '\0';
+  }
+  char& operator[](unsigned int index) { return str_[index]; }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    return to_index(str_.find(c, from));
+  }
+  int indexOf(const String& str, unsigned int from = 0) const {
+    return to_index(str_.find(str.str_, from));
+  }
+  int indexOf(const char* str, unsigned int from = 0) const {
+    return to_index(str_.find(str, from));
+  }
+
+  String substring(unsigned int begin) const {
+    return begin >= str_.length() ? String() : String(str_.substr(begin));
+  }
+  String substring(unsigned int begin, unsigned int end) const {
+    if (begin > end) {
+      std::swap(begin, end);
+    }
+    if (begin >= str_.length()) {
+      return String();
+    }
+    return String(str_.substr(begin, end - begin));
+  }
+
+  void trim() {
+    const char* whitespace = " \t\r\n\f\v";
+    size_t begin = str_.find_first_not_of(whitespace);
+    if (begin == std::string::npos) {
+      str_.clear();
+      return;
+    }
+    size_t end = str_.find_last_not_of(whitespace);
+    str_ = str_.substr(begin, end - begin + 1);
+  }
+
+  void replace(const String& find, const String& replace) {
+    if (find.str_.empty()) {
+      return;
+    }
+    size_t pos = 0;
+    while ((pos = str_.find(find.str_, pos)) != std::string::npos) {
+      str_.replace(pos, find.str_.length(), replace.str_);
+      pos += replace.str_.length();
+    }
+  }
+
+  bool startsWith(const String& prefix) const {
+    return str_.compare(0, prefix.str_.length(), prefix.str_) == 0;
+  }
+
+  long toInt() const { return strtol(str_.c_str(), nullptr, 10); }
+
+  String& operator+=(const String& rhs) {
+    str_ += rhs.str_;
+    return *this;
+  }
+  String& operator+=(const char* rhs) {
+    str_ += rhs;
+    return *this;
+  }
+  String& operator+=(char rhs) {
+    str_ += rhs;
+    return *this;
+  }
+  bool concat(const char* str, unsigned int len) {
+    str_.append(str, len);
+    return true;
+  }
+
+  friend String operator+(const String& lhs, const String& rhs) {
+    return String(lhs.str_ + rhs.str_);
+  }
+  friend String operator+(const String& lhs, const char* rhs) {
+    return String(lhs.str_ + rhs);
+  }
+  friend String operator+(const char* lhs, const String& rhs) {
+    return String(lhs + rhs.str_);
+  }
+  friend String operator+(const String& lhs, char rhs) {
+    return String(lhs.str_ + rhs);
+  }
+
+  bool operator==(const String& rhs) const { return str_ == rhs.str_; }
+  bool operator==(const char* rhs) const { return str_ == rhs; }
+  bool operator!=(const String& rhs) const { return str_ != rhs.str_; }
+  bool operator!=(const char* rhs) const { return str_ != rhs; }
+  bool operator<(const String& rhs) const { return str_ < rhs.str_; }
+
+ protected:
+  std::string str_;
+
+  static int to_index(size_t pos) {
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+};
+
+#endif  // SH_WG_HOST_WSTRING_H_
@@ -0,0 +1,217 @@
+#include "WiFi.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "host_debug.h"
+
+WiFiClass WiFi;
+
+IPAddress::IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  address_ = htonl(((uint32_t)a << 24) | ((uint32_t)b << 16) |
+                   ((uint32_t)c << 8) | d);
+}
+
+bool IPAddress::fromString(const char* address) {
+  struct in_addr addr;
+  if (inet_pton(AF_INET, address, &addr) != 1) {
+    return false;
+  }
+  address_ = addr.s_addr;
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[INET_ADDRSTRLEN];
+  struct in_addr addr;
+  addr.s_addr = address_;
+  inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+  return String(buf);
+}
+
+WiFiClientSocketHandle::~WiFiClientSocketHandle() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+WiFiClient::WiFiClient(int fd)
+    : socket_{std::make_shared<WiFiClientSocketHandle>(fd)} {
+  int flag = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  stop();
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result;
+  char port_str[6];
+  snprintf(port_str, sizeof(port_str), "%u", port);
+  if (getaddrinfo(host, port_str, &hints, &result) != 0) {
+    debugW("Unable to resolve %s", host);
+    return 0;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    freeaddrinfo(result);
+    return 0;
+  }
+  if (::connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+    freeaddrinfo(result);
+    close(fd);
+    return 0;
+  }
+  freeaddrinfo(result);
+
+  *this = WiFiClient(fd);
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+  if (fd() < 0) {
+    return 0;
+  }
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t retval = send(fd(), buf + sent, size - sent, MSG_NOSIGNAL);
+    if (retval < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      stop();
+      break;
+    }
+    sent += retval;
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  if (fd() < 0) {
+    return 0;
+  }
+  int count = 0;
+  if (ioctl(fd(), FIONREAD, &count) < 0) {
+    return 0;
+  }
+  return count;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  if (read(&c, 1) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+  if (fd() < 0) {
+    return -1;
+  }
+  ssize_t retval = recv(fd(), buf, size, MSG_DONTWAIT);
+  if (retval == 0 ||
+      (retval < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    stop();
+    return -1;
+  }
+  return retval;
+}
+
+void WiFiClient::stop() { socket_.reset(); }
+
+uint8_t WiFiClient::connected() {
+  if (fd() < 0) {
+    return 0;
+  }
+  // a zero-length peek indicates an orderly shutdown by the peer
+  uint8_t c;
+  ssize_t retval = recv(fd(), &c, 1, MSG_DONTWAIT | MSG_PEEK);
+  if (retval == 0 ||
+      (retval < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+IPAddress WiFiClient::remoteIP() const {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (fd() < 0 || getpeername(fd(), (struct sockaddr*)&addr, &len) < 0) {
+    return IPAddress();
+  }
+  return IPAddress(addr.sin_addr.s_addr);
+}
+
+void WiFiServer::begin() {
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    debugE("Unable to create a TCP socket");
+    return;
+  }
+  int flag = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port_);
+  if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(fd_, 4) < 0) {
+    debugE("Unable to listen on TCP port %u: %s", port_, strerror(errno));
+    end();
+    return;
+  }
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+}
+
+void WiFiServer::end() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+WiFiClient WiFiServer::available() {
+  if (fd_ < 0) {
+    return WiFiClient();
+  }
+  int client_fd = accept(fd_, nullptr, nullptr);
+  if (client_fd < 0) {
+    return WiFiClient();
+  }
+  return WiFiClient(client_fd);
+}
+
+IPAddress WiFiClass::localIP() {
+  // the address of the first non-loopback IPv4 interface
+  struct ifaddrs* ifaddrs;
+  IPAddress address;
+  if (getifaddrs(&ifaddrs) < 0) {
+    return address;
+  }
+  for (struct ifaddrs* ifa = ifaddrs; ifa != nullptr; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr == nullptr || ifa->ifa_addr->sa_family != AF_INET ||
+        (ifa->ifa_flags & IFF_LOOPBACK)) {
+      continue;
+    }
+    address = IPAddress(((struct sockaddr_in*)ifa->ifa_addr)->sin_addr.s_addr);
+    break;
+  }
+  freeifaddrs(ifaddrs);
+  return address;
+}
@@ -0,0 +1,109 @@
+#ifndef SH_WG_HOST_WIFI_H_
+#define SH_WG_HOST_WIFI_H_
+
+#include <memory>
+
+#include "Arduino.h"
+
+/**
+ * @brief IPv4 address, stored in network byte order.
+ */
+class IPAddress {
+ public:
+  IPAddress(uint32_t address = 0) : address_{address} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+
+  operator uint32_t() const { return address_; }
+  bool operator==(const IPAddress& rhs) const {
+    return address_ == rhs.address_;
+  }
+  bool operator!=(const IPAddress& rhs) const {
+    return address_ != rhs.address_;
+  }
+
+  uint8_t operator[](int index) const {
+    return ((const uint8_t*)&address_)[index];
+  }
+
+  bool fromString(const char* address);
+  bool fromString(const String& address) {
+    return fromString(address.c_str());
+  }
+  String toString() const;
+
+ protected:
+  uint32_t address_;
+};
+
+/**
+ * @brief Socket file descriptor shared between WiFiClient copies. The socket
+ * is closed when the last copy is destroyed, as in the ESP32 core.
+ */
+class WiFiClientSocketHandle {
+ public:
+  WiFiClientSocketHandle(int fd) : fd_{fd} {}
+  ~WiFiClientSocketHandle();
+  int fd() const { return fd_; }
+
+ protected:
+  int fd_;
+};
+
+/**
+ * @brief TCP client implemented with POSIX sockets.
+ */
+class WiFiClient {
+ public:
+  WiFiClient() {}
+  WiFiClient(int fd);
+
+  int connect(const char* host, uint16_t port);
+  size_t write(const uint8_t* buf, size_t size);
+  size_t write(const char* str) {
+    return write((const uint8_t*)str, strlen(str));
+  }
+  int available();
+  int read();
+  int read(uint8_t* buf, size_t size);
+  void flush() {}
+  void stop();
+  uint8_t connected();
+  IPAddress remoteIP() const;
+
+  operator bool() { return connected(); }
+
+  int fd() const { return socket_ ? socket_->fd() : -1; }
+
+ protected:
+  std::shared_ptr<WiFiClientSocketHandle> socket_;
+};
+
+/**
+ * @brief Listening TCP socket implemented with POSIX sockets.
+ */
+class WiFiServer {
+ public:
+  WiFiServer(uint16_t port) : port_{port} {}
+  ~WiFiServer() { end(); }
+
+  void begin();
+  void end();
+  WiFiClient available();
+
+ protected:
+  uint16_t port_;
+  int fd_ = -1;
+};
+
+/**
+ * @brief Subset of the WiFi object API. The host network is assumed to be up.
+ */
+class WiFiClass {
+ public:
+  IPAddress localIP();
+  bool isConnected() { return true; }
+};
+
+extern WiFiClass WiFi;
+
+#endif  // SH_WG_HOST_WIFI_H_
@@ -0,0 +1,34 @@
+#ifndef SH_WG_HOST_ELAPSEDMILLIS_H_
+#define SH_WG_HOST_ELAPSEDMILLIS_H_
+
+#include "Arduino.h"
+
+class elapsedMillis {
+ public:
+  elapsedMillis() : ms_{millis()} {}
+  elapsedMillis(uint32_t val) : ms_{millis() - val} {}
+  operator uint32_t() const { return millis() - ms_; }
+  elapsedMillis& operator=(uint32_t val) {
+    ms_ = millis() - val;
+    return *this;
+  }
+
+ private:
+  uint32_t ms_;
+};
+
+class elapsedMicros {
+ public:
+  elapsedMicros() : us_{micros()} {}
+  elapsedMicros(uint32_t val) : us_{micros() - val} {}
+  operator uint32_t() const { return micros() - us_; }
+  elapsedMicros& operator=(uint32_t val) {
+    us_ = micros() - val;
+    return *this;
+  }
+
+ private:
+  uint32_t us_;
+};
+
+#endif  // SH_WG_HOST_ELAPSEDMILLIS_H_
@@ -0,0 +1,25 @@
+#include "host_debug.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+
+#include "Arduino.h"
+
+HostDebugLevel host_debug_level = HostDebugLevel::kWarning;
+
+static std::mutex log_mutex;
+
+void HostDebugLog(HostDebugLevel level, const char* fmt, ...) {
+  static const char kLevelChars[] = {'V', 'D', 'I', 'W', 'E'};
+  if (level < host_debug_level) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(log_mutex);
+  fprintf(stderr, "(%c %u) ", kLevelChars[(int)level], millis());
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
@@ -0,0 +1,25 @@
+#ifndef SH_WG_HOST_HOST_DEBUG_H_
+#define SH_WG_HOST_HOST_DEBUG_H_
+
+/**
+ * @brief Debug output levels, in increasing order of severity.
+ */
+enum class HostDebugLevel { kVerbose, kDebug, kInfo, kWarning, kError };
+
+extern HostDebugLevel host_debug_level;
+
+void HostDebugLog(HostDebugLevel level, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#define debugV(fmt, ...) \
+  HostDebugLog(HostDebugLevel::kVerbose, fmt, ##__VA_ARGS__)
+#define debugD(fmt, ...) \
+  HostDebugLog(HostDebugLevel::kDebug, fmt, ##__VA_ARGS__)
+#define debugI(fmt, ...) \
+  HostDebugLog(HostDebugLevel::kInfo, fmt, ##__VA_ARGS__)
+#define debugW(fmt, ...) \
+  HostDebugLog(HostDebugLevel::kWarning, fmt, ##__VA_ARGS__)
+#define debugE(fmt, ...) \
+  HostDebugLog(HostDebugLevel::kError, fmt, ##__VA_ARGS__)
+
+#endif  // SH_WG_HOST_HOST_DEBUG_H_
@@ -0,0 +1,10 @@
+#ifndef SH_WG_HOST_SENSESP_H_
+#define SH_WG_HOST_SENSESP_H_
+
+#include "Arduino.h"
+#include "ReactESP.h"
+#include "host_debug.h"
+
+namespace sensesp {}
+
+#endif  // SH_WG_HOST_SENSESP_H_
@@ -0,0 +1,34 @@
+#ifndef SH_WG_HOST_SENSESP_NET_NETWORKING_H_
+#define SH_WG_HOST_SENSESP_NET_NETWORKING_H_
+
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/startable.h"
+
+namespace sensesp {
+
+enum class WiFiState {
+  kWifiNoAP = 0,
+  kWifiDisconnected,
+  kWifiConnectedToAP,
+  kWifiManagerActivated,
+  kWifiAPModeActivated
+};
+
+typedef WiFiState WifiState;
+
+/**
+ * @brief Network state producer. On the host, the network is always up:
+ * kWifiConnectedToAP is emitted once all Startables have been started.
+ */
+class Networking : public ObservableValue<WiFiState>, public Startable {
+ public:
+  Networking()
+      : ObservableValue<WiFiState>(WiFiState::kWifiNoAP), Startable(-100) {}
+
+  void start() override { this->emit(WiFiState::kWifiConnectedToAP); }
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_NET_NETWORKING_H_
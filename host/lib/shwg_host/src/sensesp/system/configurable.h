@@ -0,0 +1,27 @@
+#ifndef SH_WG_HOST_SENSESP_SYSTEM_CONFIGURABLE_H_
+#define SH_WG_HOST_SENSESP_SYSTEM_CONFIGURABLE_H_
+
+#include "Arduino.h"
+
+namespace sensesp {
+
+/**
+ * @brief Configurable stub. The host build has no persistent configuration.
+ */
+class Configurable {
+ public:
+  Configurable(String config_path = "", String description = "",
+               int sort_order = 1000)
+      : config_path_{config_path} {}
+  virtual ~Configurable() {}
+
+  void load_configuration() {}
+  void save_configuration() {}
+
+ protected:
+  String config_path_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_SYSTEM_CONFIGURABLE_H_
@@ -0,0 +1,25 @@
+#ifndef SH_WG_HOST_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
+#define SH_WG_HOST_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
+
+#include <functional>
+
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+template <typename T>
+class LambdaConsumer : public ValueConsumer<T> {
+ public:
+  LambdaConsumer(std::function<void(T)> function) : function_{function} {}
+
+  void set_input(T input, uint8_t input_channel = 0) override {
+    function_(input);
+  }
+
+ protected:
+  std::function<void(T)> function_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
@@ -0,0 +1,27 @@
+#ifndef SH_WG_HOST_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
+#define SH_WG_HOST_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
+
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+template <typename T>
+class ObservableValue : public ValueProducer<T> {
+ public:
+  ObservableValue() : ValueProducer<T>() {}
+  ObservableValue(const T& value) : ValueProducer<T>(value) {}
+
+  virtual bool set(const T& value) {
+    this->emit(value);
+    return true;
+  }
+
+  const T& operator=(const T& value) {
+    set(value);
+    return value;
+  }
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
@@ -0,0 +1,45 @@
+#ifndef SH_WG_HOST_SENSESP_SYSTEM_STARTABLE_H_
+#define SH_WG_HOST_SENSESP_SYSTEM_STARTABLE_H_
+
+#include <algorithm>
+#include <vector>
+
+namespace sensesp {
+
+/**
+ * @brief Objects that need to be started once the application is set up.
+ *
+ * Higher priority objects are started first.
+ */
+class Startable {
+ public:
+  Startable(int priority = 0) : priority_{priority} {
+    startables().push_back(this);
+  }
+  virtual ~Startable() {}
+
+  virtual void start() = 0;
+
+  static void start_all() {
+    std::vector<Startable*> sorted = startables();
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](Startable* a, Startable* b) {
+                       return a->priority_ > b->priority_;
+                     });
+    for (auto startable : sorted) {
+      startable->start();
+    }
+  }
+
+ protected:
+  int priority_;
+
+  static std::vector<Startable*>& startables() {
+    static std::vector<Startable*> startables_;
+    return startables_;
+  }
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_SYSTEM_STARTABLE_H_
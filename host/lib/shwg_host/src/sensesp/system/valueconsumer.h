@@ -0,0 +1,17 @@
+#ifndef SH_WG_HOST_SENSESP_SYSTEM_VALUECONSUMER_H_
+#define SH_WG_HOST_SENSESP_SYSTEM_VALUECONSUMER_H_
+
+#include <cstdint>
+
+namespace sensesp {
+
+template <typename T>
+class ValueConsumer {
+ public:
+  virtual ~ValueConsumer() {}
+  virtual void set_input(T new_value, uint8_t input_channel = 0) {}
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_SYSTEM_VALUECONSUMER_H_
@@ -0,0 +1,51 @@
+#ifndef SH_WG_HOST_SENSESP_SYSTEM_VALUEPRODUCER_H_
+#define SH_WG_HOST_SENSESP_SYSTEM_VALUEPRODUCER_H_
+
+#include <vector>
+
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+/**
+ * @brief Producer of values that are pushed to all connected consumers.
+ */
+template <typename T>
+class ValueProducer {
+ public:
+  ValueProducer() {}
+  ValueProducer(const T& initial_value) : output(initial_value) {}
+  virtual ~ValueProducer() {}
+
+  virtual const T& get() const { return output; }
+
+  template <typename C>
+  C* connect_to(C* consumer, uint8_t input_channel = 0) {
+    consumers_.push_back({consumer, input_channel});
+    return consumer;
+  }
+
+  void emit(const T& new_value) {
+    output = new_value;
+    notify();
+  }
+
+  void notify() {
+    for (auto& connection : consumers_) {
+      connection.consumer->set_input(output, connection.input_channel);
+    }
+  }
+
+ protected:
+  T output;
+
+  struct Connection {
+    ValueConsumer<T>* consumer;
+    uint8_t input_channel;
+  };
+  std::vector<Connection> consumers_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_SYSTEM_VALUEPRODUCER_H_
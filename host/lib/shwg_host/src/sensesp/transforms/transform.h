@@ -0,0 +1,34 @@
+#ifndef SH_WG_HOST_SENSESP_TRANSFORMS_TRANSFORM_H_
+#define SH_WG_HOST_SENSESP_TRANSFORMS_TRANSFORM_H_
+
+#include "sensesp.h"
+#include "sensesp/system/configurable.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/system/startable.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+class TransformBase : public Configurable {
+ public:
+  TransformBase(String config_path = "") : Configurable(config_path) {}
+};
+
+template <typename C, typename P>
+class Transform : public TransformBase,
+                  public ValueConsumer<C>,
+                  public ValueProducer<P> {
+ public:
+  Transform(String config_path = "") : TransformBase(config_path) {}
+};
+
+template <typename T>
+class SymmetricTransform : public Transform<T, T> {
+ public:
+  SymmetricTransform(String config_path = "") : Transform<T, T>(config_path) {}
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_TRANSFORMS_TRANSFORM_H_
@@ -0,0 +1,15 @@
+#ifndef SH_WG_HOST_SENSESP_MINIMAL_APP_H_
+#define SH_WG_HOST_SENSESP_MINIMAL_APP_H_
+
+#include "ReactESP.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+// The host build has no SensESP application object; the declaration is
+// needed by shwg.h only.
+class SensESPMinimalApp;
+
+}  // namespace sensesp
+
+#endif  // SH_WG_HOST_SENSESP_MINIMAL_APP_H_
@@ -16,7 +16,26 @@
 bool tNMEA2000_esp32_FH::CANGetFrame(unsigned long &id, unsigned char &len,
                                      unsigned char *buf) {
   bool hasFrame = false;
-  hasFrame = tNMEA2000_esp32::CANGetFrame(id, len, buf);
+  if (rx_ring_ != nullptr) {
+    RXFrame frame;
+    hasFrame = rx_ring_->pop(frame);
+    if (hasFrame) {
+      id = frame.id;
+      len = frame.len;
+      memcpy(buf, frame.buf, len);
+    }
+  } else {
+    hasFrame = tNMEA2000_esp32::CANGetFrame(id, len, buf);
+  }
+  if (!hasFrame && inject_ring_ != nullptr) {
+    RXFrame frame;
+    hasFrame = inject_ring_->pop(frame);
+    if (hasFrame) {
+      id = frame.id;
+      len = frame.len;
+      memcpy(buf, frame.buf, len);
+    }
+  }
 
   RunCANFrameHandlers(hasFrame, id, len, buf);
 
@@ -50,3 +69,68 @@ void tNMEA2000_esp32_FH::SetCANFrameHandler(
                           unsigned char &len, unsigned char *buf)) {
   CANFrameHandler = _FrameHandler;
 }
+
+void tNMEA2000_esp32_FH::EnableRXTask(size_t ring_size, BaseType_t core,
+                                      UBaseType_t priority) {
+  if (rx_ring_ == nullptr) {
+    rx_ring_ = new SPSCRing<RXFrame>(ring_size);
+  }
+  rx_task_core_ = core;
+  rx_task_priority_ = priority;
+}
+
+void tNMEA2000_esp32_FH::EnableFrameInjection(size_t ring_size) {
+  if (inject_ring_ == nullptr) {
+    inject_ring_ = new SPSCRing<RXFrame>(ring_size);
+  }
+}
+
+bool tNMEA2000_esp32_FH::InjectFrame(unsigned long id, unsigned char len,
+                                     const unsigned char *buf) {
+  // check for space first; a full ring is not an overflow here
+  if (inject_ring_ == nullptr ||
+      inject_ring_->size() >= inject_ring_->capacity()) {
+    return false;
+  }
+  RXFrame frame;
+  frame.id = id;
+  frame.len = len > 8 ? 8 : len;
+  memcpy(frame.buf, buf, frame.len);
+  return inject_ring_->push(frame);
+}
+
+void ExecuteCANRXTask(void *this_ptr) {
+  ((tNMEA2000_esp32_FH *)this_ptr)->ExecuteRXTask();
+}
+
+/**
+ * @brief Open the CAN driver and start the receive task, if enabled.
+ *
+ * The driver receive queue only exists once the driver has been opened.
+ */
+bool tNMEA2000_esp32_FH::CANOpen() {
+  bool result = tNMEA2000_esp32::CANOpen();
+  if (result && rx_ring_ != nullptr && rx_task_ == nullptr) {
+    xTaskCreatePinnedToCore(ExecuteCANRXTask, "can_rx_task", 2048, this,
+                            rx_task_priority_, &rx_task_, rx_task_core_);
+  }
+  return result;
+}
+
+/**
+ * @brief Move received frames from the driver queue to the ring.
+ *
+ * The driver queue holds frames read in the CAN interrupt handler. It is
+ * drained every tick; at 250 kbit/s, at most a few frames arrive per
+ * millisecond.
+ */
+void tNMEA2000_esp32_FH::ExecuteRXTask() {
+  RXFrame frame;
+  while (true) {
+    while (tNMEA2000_esp32::CANGetFrame(frame.id, frame.len, frame.buf)) {
+      // on overflow, the ring counts the dropped frame
+      rx_ring_->push(frame);
+    }
+    vTaskDelay(1);
+  }
+}
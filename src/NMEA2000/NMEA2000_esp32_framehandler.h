@@ -1,6 +1,7 @@
 #ifndef SH_WG_FIRMWARE_NMEA2000_NMEA2000_ESP32_FRAMEHANDLER_H_
 #define SH_WG_FIRMWARE_NMEA2000_NMEA2000_ESP32_FRAMEHANDLER_H_
 
+#include "../spsc_ring.h"
 #include "NMEA2000_esp32.h"
 
 /**
@@ -18,6 +19,53 @@ class tNMEA2000_esp32_FH : public tNMEA2000_esp32 {
                                                 unsigned char& len,
                                                 unsigned char* buf));
 
+  /**
+   * @brief Receive CAN frames in a dedicated task.
+   *
+   * The task moves frames from the driver receive queue to a lock-free ring
+   * as soon as they arrive. ParseMessages(), the frame handler and
+   * everything downstream still run in the calling task, so slow network
+   * output no longer lets the driver queue overflow. Must be called before
+   * Open().
+   *
+   * @param ring_size Number of frames buffered between the tasks
+   * @param core Core the receive task is pinned to
+   * @param priority FreeRTOS priority of the receive task
+   */
+  void EnableRXTask(size_t ring_size, BaseType_t core, UBaseType_t priority);
+
+  uint32_t GetRXRingOverflows() const {
+    return rx_ring_ != nullptr ? rx_ring_->get_overflows() : 0;
+  }
+  uint32_t GetRXRingHighWatermark() const {
+    return rx_ring_ != nullptr ? rx_ring_->get_high_watermark() : 0;
+  }
+  size_t GetRXRingSize() const {
+    return rx_ring_ != nullptr ? rx_ring_->capacity() : 0;
+  }
+  size_t GetRXRingFill() const {
+    return rx_ring_ != nullptr ? rx_ring_->size() : 0;
+  }
+  TaskHandle_t GetRXTaskHandle() const { return rx_task_; }
+
+  /**
+   * @brief Accept frames injected with InjectFrame().
+   *
+   * @param ring_size Number of injected frames buffered
+   */
+  void EnableFrameInjection(size_t ring_size);
+
+  /**
+   * @brief Inject a frame as if it had been received from the bus.
+   *
+   * Injected frames are processed by ParseMessages() after any frames
+   * received from the bus. Call from the task calling ParseMessages().
+   *
+   * @return false if the injection ring is full or not enabled
+   */
+  bool InjectFrame(unsigned long id, unsigned char len,
+                   const unsigned char* buf);
+
   // expose CANSendFrame to public
   bool CANSendFrame(unsigned long id, unsigned char len,
                     const unsigned char* buf, bool wait_sent = true) {
@@ -25,13 +73,34 @@ class tNMEA2000_esp32_FH : public tNMEA2000_esp32 {
     return tNMEA2000_esp32::CANSendFrame(id, len, buf, wait_sent);
   }
 
+  // expose IsFastPacketPGN to public
+  bool IsFastPacketPGN(unsigned long pgn) {
+    return tNMEA2000::IsFastPacketPGN(pgn);
+  }
+
  protected:
+  struct RXFrame {
+    unsigned long id;
+    unsigned char len;
+    unsigned char buf[8];
+  };
+
+  SPSCRing<RXFrame>* rx_ring_ = nullptr;
+  SPSCRing<RXFrame>* inject_ring_ = nullptr;
+  BaseType_t rx_task_core_;
+  UBaseType_t rx_task_priority_;
+  TaskHandle_t rx_task_ = nullptr;
+
+  bool CANOpen();
   bool CANGetFrame(unsigned long& id, unsigned char& len, unsigned char* buf);
+  void ExecuteRXTask();
 
   void (*CANFrameHandler)(bool& hasFrame, unsigned long& canId,
                           unsigned char& len, unsigned char* buf);
   void RunCANFrameHandlers(bool& hasFrame, unsigned long& canId,
                            unsigned char& len, unsigned char* buf);
+
+  friend void ExecuteCANRXTask(void* this_ptr);
 };
 
 #endif  // SH_WG_FIRMWARE_NMEA2000_NMEA2000_ESP32_FRAMEHANDLER_H_
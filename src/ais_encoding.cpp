@@ -0,0 +1,135 @@
+#include "ais_encoding.h"
+
+#include <cstdio>
+
+void AISPayloadEncoder::add_uint(uint32_t value, int num_bits) {
+  for (int i = num_bits - 1; i >= 0; i--) {
+    if (num_bits_ >= kMaxBits) {
+      return;
+    }
+    if ((value >> i) & 1) {
+      bits_[num_bits_ / 8] |= 0x80 >> (num_bits_ % 8);
+    }
+    num_bits_++;
+  }
+}
+
+void AISPayloadEncoder::add_text(const char* text, int num_chars) {
+  // AIS text fields use 6-bit ASCII and are padded with '@' (0)
+  bool end_reached = false;
+  for (int i = 0; i < num_chars; i++) {
+    char c = end_reached ? '\0' : text[i];
+    if (c == '\0') {
+      end_reached = true;
+      add_uint(0, 6);
+      continue;
+    }
+    if (c >= 'a' && c <= 'z') {
+      c -= 'a' - 'A';
+    }
+    uint8_t sixbit;
+    if (c >= 64 && c <= 95) {
+      sixbit = c - 64;
+    } else if (c >= 32 && c <= 63) {
+      sixbit = c;
+    } else {
+      sixbit = ' ';
+    }
+    add_uint(sixbit, 6);
+  }
+}
+
+bool AISPayloadEncoder::get_armored(char* buf, size_t size,
+                                    int& fill_bits) const {
+  int num_chars = (num_bits_ + 5) / 6;
+  if ((size_t)num_chars + 1 > size) {
+    return false;
+  }
+  for (int i = 0; i < num_chars; i++) {
+    uint8_t value = 0;
+    for (int j = 0; j < 6; j++) {
+      int bit = i * 6 + j;
+      value <<= 1;
+      if (bit < num_bits_ && (bits_[bit / 8] & (0x80 >> (bit % 8)))) {
+        value |= 1;
+      }
+    }
+    buf[i] = value < 40 ? value + 48 : value + 56;
+  }
+  buf[num_chars] = '\0';
+  fill_bits = num_chars * 6 - num_bits_;
+  return true;
+}
+
+/**
+ * @brief Wrap an encoded payload in a single-sentence !AIVDM message.
+ */
+static bool SetAIVDMSentence(tNMEA0183Msg& msg,
+                             const AISPayloadEncoder& encoder) {
+  char payload[(AISPayloadEncoder::kMaxBits + 5) / 6 + 1];
+  int fill_bits;
+  if (!encoder.get_armored(payload, sizeof(payload), fill_bits)) {
+    return false;
+  }
+  char fill_bits_str[2] = {(char)('0' + fill_bits), '\0'};
+
+  return msg.Init("VDM", "AI", '!') && msg.AddStrField("1") &&
+         msg.AddStrField("1") && msg.AddEmptyField() &&
+         msg.AddStrField("B") && msg.AddStrField(payload) &&
+         msg.AddStrField(fill_bits_str);
+}
+
+/**
+ * @brief Round a dimension in meters to the field range; unavailable and
+ * negative values become 0.
+ */
+static uint32_t AISDimension(double meters, uint32_t max) {
+  if (!(meters > 0)) {
+    return 0;
+  }
+  uint32_t value = meters + 0.5;
+  return value < max ? value : max;
+}
+
+bool SetAISMessage24PartA(tNMEA0183Msg& msg, uint8_t repeat, uint32_t mmsi,
+                          const char* name) {
+  AISPayloadEncoder encoder;
+  encoder.add_uint(24, 6);        // message type
+  encoder.add_uint(repeat, 2);    // repeat indicator
+  encoder.add_uint(mmsi, 30);     // MMSI
+  encoder.add_uint(0, 2);         // part number: A
+  encoder.add_text(name, 20);     // vessel name
+  return SetAIVDMSentence(msg, encoder);
+}
+
+bool SetAISMessage24PartB(tNMEA0183Msg& msg, uint8_t repeat, uint32_t mmsi,
+                          uint8_t vessel_type, const char* vendor,
+                          const char* callsign, double length, double beam,
+                          double pos_ref_stbd, double pos_ref_bow,
+                          uint32_t mothership_mmsi) {
+  AISPayloadEncoder encoder;
+  encoder.add_uint(24, 6);           // message type
+  encoder.add_uint(repeat, 2);       // repeat indicator
+  encoder.add_uint(mmsi, 30);        // MMSI
+  encoder.add_uint(1, 2);            // part number: B
+  encoder.add_uint(vessel_type, 8);  // ship type
+  encoder.add_text(vendor, 3);       // vendor id
+  encoder.add_uint(0, 4);            // unit model code
+  encoder.add_uint(0, 20);           // serial number
+  encoder.add_text(callsign, 7);     // call sign
+  if (mmsi / 10000000 == 98) {
+    encoder.add_uint(mothership_mmsi, 30);
+  } else {
+    // the reference point is given from the bow and the starboard side
+    double to_stern =
+        length >= 0 && pos_ref_bow >= 0 ? length - pos_ref_bow : 0;
+    double to_port = beam >= 0 && pos_ref_stbd >= 0 ? beam - pos_ref_stbd : 0;
+    encoder.add_uint(AISDimension(pos_ref_bow, 511), 9);   // to bow
+    encoder.add_uint(AISDimension(to_stern, 511), 9);      // to stern
+    encoder.add_uint(AISDimension(to_port, 63), 6);        // to port
+    encoder.add_uint(AISDimension(pos_ref_stbd, 63), 6);   // to starboard
+  }
+  encoder.add_uint(0, 4);  // position fixing device: undefined
+  encoder.add_uint(0, 2);  // spare
+  return SetAIVDMSentence(msg, encoder);
+}
@@ -0,0 +1,61 @@
+#ifndef SH_WG_FIRMWARE_AIS_ENCODING_H_
+#define SH_WG_FIRMWARE_AIS_ENCODING_H_
+
+#include <NMEA0183Msg.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bit packer for AIS message payloads.
+ *
+ * Fields are appended MSB first, as specified by ITU-R M.1371. The packed
+ * bits can then be armored into the 6-bit ASCII representation used in
+ * !AIVDM sentences.
+ */
+class AISPayloadEncoder {
+ public:
+  static constexpr int kMaxBits = 168;
+
+  void add_uint(uint32_t value, int num_bits);
+  void add_text(const char* text, int num_chars);
+
+  int get_num_bits() const { return num_bits_; }
+
+  /**
+   * @brief Write the armored payload to buf.
+   *
+   * @param buf Destination buffer, zero-terminated on success.
+   * @param size Size of the destination buffer.
+   * @param fill_bits Number of padding bits added to the last character.
+   * @return true The payload fit in the buffer.
+   */
+  bool get_armored(char* buf, size_t size, int& fill_bits) const;
+
+ protected:
+  uint8_t bits_[(kMaxBits + 7) / 8] = {};
+  int num_bits_ = 0;
+};
+
+/**
+ * @brief Build an AIS Message 24 Part A (Class B CS static data, vessel name)
+ * sentence.
+ */
+bool SetAISMessage24PartA(tNMEA0183Msg& msg, uint8_t repeat, uint32_t mmsi,
+                          const char* name);
+
+/**
+ * @brief Build an AIS Message 24 Part B (Class B CS static data, type,
+ * vendor, call sign and dimensions) sentence.
+ *
+ * Dimensions are in meters, as in NMEA 2000 PGN 129810; unavailable or
+ * negative values are encoded as 0. For auxiliary craft (MMSI 98XXXYYYY),
+ * the mothership MMSI is encoded in place of the dimensions.
+ */
+bool SetAISMessage24PartB(tNMEA0183Msg& msg, uint8_t repeat, uint32_t mmsi,
+                          uint8_t vessel_type, const char* vendor,
+                          const char* callsign, double length, double beam,
+                          double pos_ref_stbd, double pos_ref_bow,
+                          uint32_t mothership_mmsi);
+
+#endif  // SH_WG_FIRMWARE_AIS_ENCODING_H_
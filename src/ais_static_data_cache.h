@@ -0,0 +1,168 @@
+#ifndef SH_WG_FIRMWARE_AIS_STATIC_DATA_CACHE_H_
+#define SH_WG_FIRMWARE_AIS_STATIC_DATA_CACHE_H_
+
+#include <Arduino.h>
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Bounded cache for pairing AIS Class B "CS" static data reports.
+ *
+ * AIS Message 24 is sent in two parts: Part A (PGN 129809) carries the vessel
+ * name, Part B (PGN 129810) the rest of the static data. The parts arrive
+ * independently, so whichever one arrives first is stored here, keyed by
+ * MMSI, until its counterpart shows up.
+ *
+ * The cache has a fixed number of slots allocated at construction time.
+ * When it is full, the least recently used entry is evicted. Entries older
+ * than the maximum age are expired. Lookups are linear scans, which is
+ * faster than hashing at the capacities used here.
+ */
+class AISClassBStaticDataCache {
+ public:
+  static constexpr size_t kMaxNameSize = 21;
+  static constexpr size_t kMaxSentenceSize = 64;
+
+  struct Entry {
+    uint32_t mmsi;
+    uint32_t updated;    //< millis() of the latest update
+    uint32_t last_used;  //< LRU stamp
+    uint8_t repeat;
+    bool has_part_a;
+    bool has_part_b;
+    char name[kMaxNameSize];
+    char part_b[kMaxSentenceSize];  //< encoded Part B sentence
+  };
+
+  AISClassBStaticDataCache(size_t capacity, uint32_t max_age_ms)
+      : capacity_{capacity}, max_age_ms_{max_age_ms} {
+    entries_ = new Entry[capacity];
+    for (size_t i = 0; i < capacity_; i++) {
+      entries_[i].mmsi = 0;
+    }
+  }
+
+  ~AISClassBStaticDataCache() { delete[] entries_; }
+
+  /**
+   * @brief Find a live entry for the given MMSI.
+   *
+   * Counts a hit or a miss and refreshes the LRU stamp of the found entry.
+   *
+   * @return Entry* Entry pointer or nullptr if not found.
+   */
+  Entry* find(uint32_t mmsi) {
+    Entry* entry = lookup(mmsi);
+    if (entry == nullptr) {
+      misses_++;
+    } else {
+      hits_++;
+      entry->last_used = ++lru_clock_;
+    }
+    return entry;
+  }
+
+  /**
+   * @brief Get an entry for the given MMSI, creating one if necessary.
+   *
+   * If the cache is full, the least recently used entry is evicted.
+   */
+  Entry* get_or_create(uint32_t mmsi) {
+    Entry* entry = lookup(mmsi);
+    if (entry == nullptr) {
+      entry = get_free_slot();
+      entry->mmsi = mmsi;
+      entry->has_part_a = false;
+      entry->has_part_b = false;
+      entry->name[0] = '\0';
+      entry->part_b[0] = '\0';
+    }
+    entry->updated = millis();
+    entry->last_used = ++lru_clock_;
+    return entry;
+  }
+
+  void remove(Entry* entry) { entry->mmsi = 0; }
+
+  /**
+   * @brief Drop all entries older than the maximum age.
+   */
+  void expire() {
+    uint32_t now = millis();
+    for (size_t i = 0; i < capacity_; i++) {
+      if (entries_[i].mmsi != 0 && now - entries_[i].updated > max_age_ms_) {
+        entries_[i].mmsi = 0;
+        expirations_++;
+      }
+    }
+  }
+
+  size_t size() const {
+    size_t count = 0;
+    for (size_t i = 0; i < capacity_; i++) {
+      if (entries_[i].mmsi != 0) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  size_t get_capacity() const { return capacity_; }
+  size_t get_footprint() const {
+    return sizeof(*this) + capacity_ * sizeof(Entry);
+  }
+  uint32_t get_hits() const { return hits_; }
+  uint32_t get_misses() const { return misses_; }
+  uint32_t get_evictions() const { return evictions_; }
+  uint32_t get_expirations() const { return expirations_; }
+
+  /**
+   * @brief Ratio of successful lookups, in percent.
+   */
+  float get_hit_rate() const {
+    uint32_t total = hits_ + misses_;
+    return total == 0 ? 0 : 100.0 * hits_ / total;
+  }
+
+ protected:
+  Entry* entries_;
+  const size_t capacity_;
+  const uint32_t max_age_ms_;
+
+  uint32_t lru_clock_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t evictions_ = 0;
+  uint32_t expirations_ = 0;
+
+  Entry* lookup(uint32_t mmsi) {
+    for (size_t i = 0; i < capacity_; i++) {
+      if (entries_[i].mmsi == mmsi) {
+        if (millis() - entries_[i].updated > max_age_ms_) {
+          entries_[i].mmsi = 0;
+          expirations_++;
+          return nullptr;
+        }
+        return &entries_[i];
+      }
+    }
+    return nullptr;
+  }
+
+  Entry* get_free_slot() {
+    Entry* lru_entry = &entries_[0];
+    for (size_t i = 0; i < capacity_; i++) {
+      if (entries_[i].mmsi == 0) {
+        return &entries_[i];
+      }
+      if (entries_[i].last_used < lru_entry->last_used) {
+        lru_entry = &entries_[i];
+      }
+    }
+    evictions_++;
+    return lru_entry;
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_AIS_STATIC_DATA_CACHE_H_
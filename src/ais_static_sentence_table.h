@@ -0,0 +1,154 @@
+#ifndef SH_WG_FIRMWARE_AIS_STATIC_SENTENCE_TABLE_H_
+#define SH_WG_FIRMWARE_AIS_STATIC_SENTENCE_TABLE_H_
+
+#include <Arduino.h>
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Table of the most recently encoded AIS static data sentences.
+ *
+ * Static and voyage related data (AIS Message 5) and Class B static data
+ * (AIS Message 24) are transmitted only every few minutes. The encoded
+ * sentences are kept here, keyed by MMSI and message type, so that they can
+ * be re-emitted periodically and replayed to newly connected clients.
+ *
+ * Sentences are stored CRLF-terminated and back-to-back in a fixed-size
+ * buffer per entry. When the table is full, the least recently updated
+ * entry is replaced.
+ */
+class AISStaticSentenceTable {
+ public:
+  static constexpr size_t kMaxDataSize = 128;
+
+  struct Entry {
+    uint32_t mmsi;
+    uint32_t updated;  //< millis() of the latest update
+    uint8_t message_type;
+    uint8_t length;
+    char data[kMaxDataSize];  //< zero-terminated sentences
+  };
+
+  AISStaticSentenceTable(size_t capacity, uint32_t max_age_ms)
+      : capacity_{capacity}, max_age_ms_{max_age_ms} {
+    entries_ = new Entry[capacity];
+    for (size_t i = 0; i < capacity_; i++) {
+      entries_[i].mmsi = 0;
+    }
+  }
+
+  ~AISStaticSentenceTable() { delete[] entries_; }
+
+  /**
+   * @brief Clear the stored sentences for the given MMSI and message type.
+   *
+   * @return Entry* Entry to append the new sentences to.
+   */
+  Entry* begin(uint32_t mmsi, uint8_t message_type) {
+    Entry* entry = nullptr;
+    Entry* free_entry = nullptr;
+    Entry* oldest_entry = nullptr;
+    uint32_t now = millis();
+    for (size_t i = 0; i < capacity_; i++) {
+      Entry* e = &entries_[i];
+      if (e->mmsi == mmsi && e->message_type == message_type) {
+        entry = e;
+        break;
+      }
+      if (e->mmsi == 0) {
+        if (free_entry == nullptr) {
+          free_entry = e;
+        }
+      } else if (oldest_entry == nullptr ||
+                 now - e->updated > now - oldest_entry->updated) {
+        oldest_entry = e;
+      }
+    }
+    if (entry == nullptr) {
+      entry = free_entry != nullptr ? free_entry : oldest_entry;
+      entry->mmsi = mmsi;
+      entry->message_type = message_type;
+    }
+    entry->updated = now;
+    entry->length = 0;
+    entry->data[0] = '\0';
+    return entry;
+  }
+
+  /**
+   * @brief Append a sentence to an entry.
+   *
+   * @return false The sentence didn't fit and the entry was discarded.
+   */
+  bool append(Entry* entry, const char* sentence) {
+    size_t len = strlen(sentence);
+    if (entry->length + len + 3 > kMaxDataSize) {
+      entry->mmsi = 0;
+      return false;
+    }
+    memcpy(entry->data + entry->length, sentence, len);
+    entry->length += len;
+    entry->data[entry->length++] = '\r';
+    entry->data[entry->length++] = '\n';
+    entry->data[entry->length] = '\0';
+    return true;
+  }
+
+  /**
+   * @brief Advance the replay cursor by one slot.
+   *
+   * Calling this at a fixed rate visits every slot once per capacity calls,
+   * spreading the replayed sentences evenly over time.
+   *
+   * @return const Entry* Entry in the slot, or nullptr if the slot is empty.
+   */
+  const Entry* next() {
+    Entry* entry = &entries_[cursor_];
+    cursor_ = (cursor_ + 1) % capacity_;
+    if (entry->mmsi == 0) {
+      return nullptr;
+    }
+    if (millis() - entry->updated > max_age_ms_) {
+      entry->mmsi = 0;
+      return nullptr;
+    }
+    return entry;
+  }
+
+  /**
+   * @brief Call a function for each live entry.
+   */
+  template <typename F>
+  void for_each(F function) const {
+    uint32_t now = millis();
+    for (size_t i = 0; i < capacity_; i++) {
+      if (entries_[i].mmsi != 0 && now - entries_[i].updated <= max_age_ms_) {
+        function(entries_[i]);
+      }
+    }
+  }
+
+  size_t size() const {
+    size_t count = 0;
+    for (size_t i = 0; i < capacity_; i++) {
+      if (entries_[i].mmsi != 0) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  size_t get_capacity() const { return capacity_; }
+  size_t get_footprint() const {
+    return sizeof(*this) + capacity_ * sizeof(Entry);
+  }
+
+ protected:
+  Entry* entries_;
+  const size_t capacity_;
+  const uint32_t max_age_ms_;
+  size_t cursor_ = 0;
+};
+
+#endif  // SH_WG_FIRMWARE_AIS_STATIC_SENTENCE_TABLE_H_
@@ -0,0 +1,182 @@
+#ifndef SH_WG_FIRMWARE_AIS_TARGET_TABLE_H_
+#define SH_WG_FIRMWARE_AIS_TARGET_TABLE_H_
+
+#include <Arduino.h>
+#include <N2kMsg.h>
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief MMSI-indexed AIS target table used to throttle position reports.
+ *
+ * Reports from targets closer than the near range, and from targets that
+ * have changed course or speed since the last forwarded report, are always
+ * forwarded. Other targets are forwarded at most once per throttle period.
+ *
+ * The table has a fixed number of slots allocated at construction time.
+ * When it is full, the target that was seen least recently is evicted.
+ */
+class AISTargetTable {
+ public:
+  struct Target {
+    uint32_t mmsi;
+    uint32_t last_seen;       //< millis() of the latest report
+    uint32_t last_forwarded;  //< millis() of the latest forwarded report
+    float cog;                //< COG of the latest forwarded report, rad
+    float sog;                //< SOG of the latest forwarded report, m/s
+  };
+
+  AISTargetTable(size_t capacity, double near_range_nm,
+                 uint32_t throttle_period_ms, double cog_threshold_deg,
+                 double sog_threshold_kn)
+      : capacity_{capacity},
+        near_range_nm_{near_range_nm},
+        throttle_period_ms_{throttle_period_ms},
+        cog_threshold_{cog_threshold_deg * kPi / 180.0},
+        sog_threshold_{sog_threshold_kn * 1852.0 / 3600.0} {
+    targets_ = new Target[capacity];
+    for (size_t i = 0; i < capacity_; i++) {
+      targets_[i].mmsi = 0;
+    }
+  }
+
+  ~AISTargetTable() { delete[] targets_; }
+
+  /**
+   * @brief Update the target and decide whether its report should be
+   * forwarded.
+   *
+   * @param mmsi Target MMSI
+   * @param latitude Target latitude, degrees
+   * @param longitude Target longitude, degrees
+   * @param cog Target course over ground, rad
+   * @param sog Target speed over ground, m/s
+   * @param own_latitude Own latitude, degrees; may be N/A
+   * @param own_longitude Own longitude, degrees; may be N/A
+   * @return true The report should be forwarded.
+   */
+  bool update(uint32_t mmsi, double latitude, double longitude, double cog,
+              double sog, double own_latitude, double own_longitude) {
+    uint32_t now = millis();
+    Target* target = get_or_create(mmsi, now);
+    target->last_seen = now;
+
+    bool forward = target->last_forwarded == 0 ||
+                   now - target->last_forwarded >= throttle_period_ms_ ||
+                   has_changed(*target, cog, sog) ||
+                   is_near(latitude, longitude, own_latitude, own_longitude);
+
+    if (forward) {
+      target->last_forwarded = now == 0 ? 1 : now;
+      target->cog = N2kIsNA(cog) ? NAN : cog;
+      target->sog = N2kIsNA(sog) ? NAN : sog;
+      forwarded_++;
+    } else {
+      suppressed_++;
+    }
+    return forward;
+  }
+
+  size_t size() const {
+    size_t count = 0;
+    for (size_t i = 0; i < capacity_; i++) {
+      if (targets_[i].mmsi != 0) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  size_t get_capacity() const { return capacity_; }
+  size_t get_footprint() const {
+    return sizeof(*this) + capacity_ * sizeof(Target);
+  }
+  uint32_t get_forwarded() const { return forwarded_; }
+  uint32_t get_suppressed() const { return suppressed_; }
+  uint32_t get_evictions() const { return evictions_; }
+
+ protected:
+  static constexpr double kPi = 3.14159265358979323846;
+  static constexpr double kEarthRadiusNm = 3440.065;
+
+  Target* targets_;
+  const size_t capacity_;
+  const double near_range_nm_;
+  const uint32_t throttle_period_ms_;
+  const double cog_threshold_;
+  const double sog_threshold_;
+
+  uint32_t forwarded_ = 0;
+  uint32_t suppressed_ = 0;
+  uint32_t evictions_ = 0;
+
+  Target* get_or_create(uint32_t mmsi, uint32_t now) {
+    Target* free_target = nullptr;
+    Target* oldest_target = &targets_[0];
+    for (size_t i = 0; i < capacity_; i++) {
+      Target* target = &targets_[i];
+      if (target->mmsi == mmsi) {
+        return target;
+      }
+      if (target->mmsi == 0) {
+        if (free_target == nullptr) {
+          free_target = target;
+        }
+      } else if (now - target->last_seen > now - oldest_target->last_seen) {
+        oldest_target = target;
+      }
+    }
+    if (free_target == nullptr) {
+      free_target = oldest_target;
+      evictions_++;
+    }
+    free_target->mmsi = mmsi;
+    free_target->last_forwarded = 0;
+    return free_target;
+  }
+
+  bool has_changed(const Target& target, double cog, double sog) const {
+    if (N2kIsNA(cog) != std::isnan(target.cog) ||
+        N2kIsNA(sog) != std::isnan(target.sog)) {
+      return true;
+    }
+    if (!N2kIsNA(sog) && std::fabs(sog - target.sog) > sog_threshold_) {
+      return true;
+    }
+    if (!N2kIsNA(cog)) {
+      double diff = std::fabs(cog - target.cog);
+      if (diff > kPi) {
+        diff = 2 * kPi - diff;
+      }
+      if (diff > cog_threshold_) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool is_near(double latitude, double longitude, double own_latitude,
+               double own_longitude) const {
+    // without a position fix, all targets are considered near
+    if (N2kIsNA(latitude) || N2kIsNA(longitude) || N2kIsNA(own_latitude) ||
+        N2kIsNA(own_longitude)) {
+      return true;
+    }
+    // equirectangular approximation is accurate enough at AIS ranges
+    double lat1 = own_latitude * kPi / 180.0;
+    double lat2 = latitude * kPi / 180.0;
+    double dlon = (longitude - own_longitude) * kPi / 180.0;
+    if (dlon > kPi) {
+      dlon -= 2 * kPi;
+    } else if (dlon < -kPi) {
+      dlon += 2 * kPi;
+    }
+    double x = dlon * std::cos((lat1 + lat2) / 2);
+    double y = lat2 - lat1;
+    double distance_nm = std::sqrt(x * x + y * y) * kEarthRadiusNm;
+    return distance_nm <= near_range_nm_;
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_AIS_TARGET_TABLE_H_
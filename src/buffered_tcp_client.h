@@ -3,7 +3,13 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <errno.h>
+#include <sys/socket.h>
 
+#include <memory>
+
+#include "conflating_queue.h"
+#include "deferred_log.h"
 #include "origin_string.h"
 #include "shwg.h"
 
@@ -12,6 +18,9 @@ using namespace sensesp;
 using WiFiClientPtr = std::shared_ptr<WiFiClient>;
 
 constexpr size_t kRXBufferSize = 512;
+// Pending output of a client without a send queue, e.g. the initial data
+// sent on connect
+constexpr size_t kMaxTXPendingSize = 8 * 1024;
 
 /**
  * @brief TCP client connection container with RX buffer.
@@ -28,12 +37,25 @@ class BufferedTCPClient {
     rx_pos_ = 0;
   }
 
+  /**
+   * @brief Discard all buffered and queued data, for reuse with a new
+   * connection.
+   */
+  void reset() {
+    rx_pos_ = 0;
+    tx_lines_ = "";
+    tx_pos_ = 0;
+    if (tx_queue_ != nullptr) {
+      tx_queue_->clear();
+    }
+  }
+
   int read_line(String& line) {
     while (client_->available()) {
       char c = client_->read();
       rx_buf_[rx_pos_++] = c;
       if (rx_pos_ == kRXBufferSize - 1) {
-        debugW("RX buffer overflow");
+        deferredW("RX buffer overflow");
         rx_pos_ = 0;
       } else if (c == '\n') {
         // received a full line
@@ -47,9 +69,89 @@ class BufferedTCPClient {
     return 0;
   }
 
+  /**
+   * @brief Write as much of the data as fits in the socket send buffer.
+   *
+   * @return Number of bytes written, or -1 on error
+   */
+  int write_nonblocking(const char* data, size_t len) {
+    int sent = send(client_->fd(), data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    return sent;
+  }
+
+  /**
+   * @brief Check whether data is waiting for send_queued().
+   */
+  bool has_pending() const {
+    return tx_queue_ != nullptr || tx_pos_ < tx_lines_.length();
+  }
+
+  /**
+   * @brief Queue data for send_queued(), behind the data already queued.
+   *
+   * Without a tx_queue_, the data is appended to the pending output, up to
+   * kMaxTXPendingSize bytes.
+   *
+   * @return False if the data was dropped
+   */
+  bool queue(const char* data) {
+    if (tx_queue_ != nullptr) {
+      tx_queue_->push(data);
+      return true;
+    }
+    size_t len = strlen(data);
+    if (tx_pos_ == tx_lines_.length()) {
+      // keeps the capacity of the earlier output
+      tx_lines_ = "";
+      tx_pos_ = 0;
+    }
+    if (tx_lines_.length() - tx_pos_ + len > kMaxTXPendingSize) {
+      return false;
+    }
+    tx_lines_.concat(data, len);
+    return true;
+  }
+
+  /**
+   * @brief Send queued data without blocking.
+   *
+   * A partially sent message is completed on the next call before the
+   * next message is taken from the queue.
+   *
+   * @return Number of bytes sent
+   */
+  size_t send_queued() {
+    size_t total = 0;
+    while (true) {
+      if (tx_pos_ == tx_lines_.length()) {
+        if (tx_queue_ == nullptr || !tx_queue_->pop(tx_lines_)) {
+          return total;
+        }
+        tx_pos_ = 0;
+      }
+      int sent = write_nonblocking(tx_lines_.c_str() + tx_pos_,
+                                   tx_lines_.length() - tx_pos_);
+      if (sent <= 0) {
+        return total;
+      }
+      tx_pos_ += sent;
+      total += sent;
+    }
+  }
+
+  // send queue for clients that don't take the full stream; nullptr if
+  // the data is written directly
+  std::shared_ptr<ConflatingQueue> tx_queue_;
+
  protected:
   char rx_buf_[kRXBufferSize];
   int rx_pos_ = 0;
+
+  String tx_lines_ = "";  //< Message from tx_queue_ or pending output
+  size_t tx_pos_ = 0;
 };
 
 #endif  // SH_WG_FIRMWARE_BUFFERED_TCP_CLIENT_H_
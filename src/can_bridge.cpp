@@ -0,0 +1,217 @@
+#include "can_bridge.h"
+
+#include "deferred_log.h"
+#include "reaction_profiler.h"
+#include "shwg.h"
+
+CANBridge::CANBridge(IPAddress address, uint16_t port, uint16_t local_port,
+                     uint32_t batching_ms, uint32_t sender_id,
+                     Networking* networking, int rx_queue_size)
+    : Startable(50),
+      address_{address},
+      port_{port},
+      local_port_{local_port},
+      batching_ms_{batching_ms < kMaxCANBridgeBatchingMs
+                       ? batching_ms
+                       : kMaxCANBridgeBatchingMs},
+      sender_id_{sender_id},
+      networking_{networking},
+      writer_{sender_id} {
+  task_queue_producer_ = new TaskQueueProducer<CANFrame>(
+      CANFrame(), ReactESP::app, rx_queue_size, 490);
+}
+
+void CANBridge::start() {
+  started_ = true;
+  // follow the network state even while disabled, so that the bridge can be
+  // enabled at runtime
+  networking_->connect_to(
+      new LambdaConsumer<WifiState>([this](WifiState state) {
+        network_up_ = state == WiFiState::kWifiConnectedToAP ||
+                      state == WiFiState::kWifiAPModeActivated;
+        if (network_up_ && enabled_ && !connected_) {
+          begin_listening();
+        }
+      }));
+
+  task_queue_producer_->connect_to(
+      new LambdaConsumer<CANFrame>([this](CANFrame frame) {
+        rx_queue_stats_.dequeued++;
+        frames_received_++;
+        this->emit(frame);
+      }));
+
+  start_batching();
+}
+
+void CANBridge::begin_listening() {
+  bool listening;
+  if (is_multicast(address_)) {
+    debugI("Starting CAN bridge on multicast group %s port %d",
+           address_.toString().c_str(), port_);
+    listening = async_udp_.listenMulticast(address_, local_port_);
+  } else {
+    debugI("Starting CAN bridge to %s port %d", address_.toString().c_str(),
+           port_);
+    listening = async_udp_.listen(local_port_);
+  }
+  if (!listening) {
+    debugE("CAN bridge startup failed - port reserved?");
+    return;
+  }
+  connected_ = true;
+  async_udp_.onPacket(
+      [this](AsyncUDPPacket packet) { handle_packet(packet); });
+}
+
+/**
+ * @brief Close the socket and open it again with the current settings.
+ */
+void CANBridge::relisten() {
+  if (connected_) {
+    flush();
+    debugI("Stopping CAN bridge");
+    async_udp_.close();
+    connected_ = false;
+  }
+  if (enabled_ && network_up_) {
+    begin_listening();
+  }
+}
+
+void CANBridge::start_batching() {
+  if (batching_ms_ == 0 || batching_) {
+    return;
+  }
+  batching_ = true;
+  ProfiledOnRepeat(ReactESP::app, 1, "CAN bridge flush", [this]() {
+    if (writer_.get_num_frames() > 0 &&
+        millis() - writer_.get_base_ms() >= batching_ms_) {
+      flush();
+    }
+  });
+}
+
+void CANBridge::set_enabled(bool enabled) {
+  if (enabled == enabled_) {
+    return;
+  }
+  enabled_ = enabled;
+  relisten();
+}
+
+void CANBridge::set_peer(IPAddress address, uint16_t port,
+                         uint16_t local_port) {
+  if (address == address_ && port == port_ && local_port == local_port_) {
+    return;
+  }
+  // the pending frames go to the old peer
+  flush();
+  address_ = address;
+  port_ = port;
+  local_port_ = local_port;
+  relisten();
+}
+
+void CANBridge::set_batching(uint32_t batching_ms) {
+  batching_ms_ = batching_ms < kMaxCANBridgeBatchingMs
+                     ? batching_ms
+                     : kMaxCANBridgeBatchingMs;
+  if (batching_ms_ == 0) {
+    flush();
+  } else if (started_) {
+    start_batching();
+  }
+}
+
+void CANBridge::set_input(CANFrame frame, uint8_t input_channel) {
+  switch (frame.origin_type) {
+    case CANFrameOriginType::kLocal:
+    case CANFrameOriginType::kCAN:
+    case CANFrameOriginType::kApp:
+      break;
+    default:
+      // don't forward frames received from other gateways
+      return;
+  }
+  if (!connected_) {
+    return;
+  }
+
+  uint32_t now = millis();
+  if (!writer_.add(frame, now)) {
+    flush();
+    writer_.add(frame, now);
+  }
+  if (batching_ms_ == 0) {
+    flush();
+  }
+}
+
+void CANBridge::flush() {
+  int num_frames = writer_.get_num_frames();
+  if (num_frames == 0) {
+    return;
+  }
+  size_t len = writer_.finish();
+  if (async_udp_.writeTo(writer_.data(), len, address_, port_) != len) {
+    send_errors_++;
+    deferredW("CAN bridge datagram of %d frames not sent", num_frames);
+    return;
+  }
+  datagrams_sent_++;
+  frames_sent_ += num_frames;
+}
+
+/**
+ * @brief Get the sequence tracker of a sender, replacing the least
+ * recently heard sender if the table is full.
+ */
+CANBridgeSequenceTracker& CANBridge::get_tracker(uint32_t sender_id) {
+  uint32_t now = millis();
+  Sender* replaced = &senders_[0];
+  for (int i = 0; i < num_senders_; i++) {
+    if (senders_[i].id == sender_id) {
+      senders_[i].last_seen_ms = now;
+      return senders_[i].tracker;
+    }
+    if (now - senders_[i].last_seen_ms > now - replaced->last_seen_ms) {
+      replaced = &senders_[i];
+    }
+  }
+  if (num_senders_ < kMaxSenders) {
+    replaced = &senders_[num_senders_++];
+  }
+  replaced->id = sender_id;
+  replaced->last_seen_ms = now;
+  replaced->tracker = CANBridgeSequenceTracker();
+  return replaced->tracker;
+}
+
+void CANBridge::handle_packet(AsyncUDPPacket& packet) {
+  CANBridgeDatagramReader reader;
+  if (!reader.begin(packet.data(), packet.length())) {
+    rx_stats_.invalid++;
+    return;
+  }
+  if (reader.get_sender_id() == sender_id_) {
+    // our own multicast datagram
+    return;
+  }
+  if (!get_tracker(reader.get_sender_id())
+           .update(reader.get_sequence(), rx_stats_)) {
+    return;
+  }
+
+  CANFrame frame;
+  uint32_t time_ms;
+  frame.origin_id = origin_id(this);
+  while (reader.next(frame, time_ms)) {
+    // hand the frames over to the main task
+    if (task_queue_producer_->set(frame)) {
+      rx_queue_stats_.enqueued++;
+    } else {
+      rx_queue_stats_.dropped++;
+    }
+  }
+}
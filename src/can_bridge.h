@@ -0,0 +1,132 @@
+#ifndef SH_WG_FIRMWARE_CAN_BRIDGE_H_
+#define SH_WG_FIRMWARE_CAN_BRIDGE_H_
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <WiFi.h>
+
+#include "can_bridge_protocol.h"
+#include "can_frame.h"
+#include "queue_stats.h"
+#include "sensesp/net/networking.h"
+#include "sensesp/system/task_queue_producer.h"
+#include "sensesp/system/valueconsumer.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Bridge CAN frames to other gateways in binary datagrams.
+ *
+ * Frames from the local bus and from applications are batched for up to
+ * the batching latency and sent to a peer gateway or a multicast group.
+ * Frames received from other gateways are emitted with a remote origin
+ * type. Frames that were themselves received from other gateways are never
+ * forwarded, so that bridges between several gateways don't form loops.
+ *
+ * Datagrams from each sender are sequence-numbered; the receiver counts
+ * lost, reordered and duplicate datagrams.
+ *
+ * The peer and the batching latency can be changed at runtime.
+ */
+class CANBridge : public ValueProducer<CANFrame>,
+                  public ValueConsumer<CANFrame>,
+                  public Startable {
+ public:
+  /**
+   * @param address Peer gateway address, or a multicast group address
+   * @param port Port datagrams are sent to
+   * @param local_port Port datagrams are received on; normally the same as
+   * the peer port
+   * @param batching_ms Maximum time a frame is held back to fill a
+   * datagram, up to kMaxCANBridgeBatchingMs. 0 sends every frame in a
+   * datagram of its own.
+   * @param sender_id Random id distinguishing this gateway, and restarts of
+   * it, from the other senders
+   * @param rx_queue_size Number of received frames queued for the main task
+   */
+  CANBridge(IPAddress address, uint16_t port, uint16_t local_port,
+            uint32_t batching_ms, uint32_t sender_id, Networking* networking,
+            int rx_queue_size);
+
+  void set_input(CANFrame frame, uint8_t input_channel = 0) override;
+
+  /**
+   * @brief Start the bridge. Called by the application, or directly for a
+   * bridge created after the application has started.
+   */
+  void start() override;
+
+  /**
+   * @brief Send the pending frames.
+   */
+  void flush();
+
+  /**
+   * @brief Start or stop bridging.
+   */
+  void set_enabled(bool enabled);
+
+  /**
+   * @brief Bridge to another peer or multicast group. The socket is
+   * reopened if any of the addresses changed.
+   */
+  void set_peer(IPAddress address, uint16_t port, uint16_t local_port);
+
+  void set_batching(uint32_t batching_ms);
+
+  static bool is_multicast(IPAddress address) {
+    return (address[0] & 0xF0) == 0xE0;
+  }
+
+  uint32_t get_datagrams_sent() const { return datagrams_sent_; }
+  uint32_t get_frames_sent() const { return frames_sent_; }
+  uint32_t get_send_errors() const { return send_errors_; }
+  uint32_t get_frames_received() const { return frames_received_; }
+  const CANBridgeStats& get_rx_stats() const { return rx_stats_; }
+  const QueueStats& get_rx_queue_stats() const { return rx_queue_stats_; }
+
+  // senders tracked concurrently; the least recently heard one is replaced
+  static constexpr int kMaxSenders = 8;
+
+ protected:
+  IPAddress address_;
+  uint16_t port_;
+  uint16_t local_port_;
+  uint32_t batching_ms_;
+  const uint32_t sender_id_;
+  Networking* networking_;
+  AsyncUDP async_udp_;
+  bool connected_ = false;
+  bool enabled_ = true;
+  bool network_up_ = false;
+  bool started_ = false;
+  bool batching_ = false;  //< The batch flush reaction exists
+
+  // accessed from the main task only
+  CANBridgeDatagramWriter writer_;
+  uint32_t datagrams_sent_ = 0;
+  uint32_t frames_sent_ = 0;
+  uint32_t send_errors_ = 0;
+  uint32_t frames_received_ = 0;
+
+  // accessed from the UDP receive task only
+  struct Sender {
+    uint32_t id;
+    uint32_t last_seen_ms;
+    CANBridgeSequenceTracker tracker;
+  };
+  Sender senders_[kMaxSenders];
+  int num_senders_ = 0;
+  CANBridgeStats rx_stats_;
+
+  TaskQueueProducer<CANFrame>* task_queue_producer_;
+  QueueStats rx_queue_stats_;
+
+  void begin_listening();
+  void relisten();
+  void start_batching();
+  void handle_packet(AsyncUDPPacket& packet);
+  CANBridgeSequenceTracker& get_tracker(uint32_t sender_id);
+};
+
+#endif  // SH_WG_FIRMWARE_CAN_BRIDGE_H_
@@ -0,0 +1,142 @@
+#include "can_bridge_protocol.h"
+
+#include <cstring>
+
+static const uint8_t kMagic[2] = {'S', 'B'};
+
+constexpr uint8_t kLengthMask = 0x0F;
+constexpr uint8_t kTransmittedFlag = 0x40;
+
+static inline void PutLE32(uint8_t* pos, uint32_t value) {
+  pos[0] = value;
+  pos[1] = value >> 8;
+  pos[2] = value >> 16;
+  pos[3] = value >> 24;
+}
+
+static inline uint32_t GetLE32(const uint8_t* pos) {
+  return pos[0] | (pos[1] << 8) | (pos[2] << 16) | ((uint32_t)pos[3] << 24);
+}
+
+bool CANBridgeDatagramWriter::add(const CANFrame& frame, uint32_t time_ms) {
+  if (num_frames_ == 0) {
+    base_ms_ = time_ms;
+  }
+  uint32_t offset_ms = time_ms - base_ms_;
+  int len = frame.len > 8 ? 8 : frame.len;
+  if (num_frames_ > 0 &&
+      (len_ + 6 + len > kCANBridgeMaxDatagramSize || offset_ms > 0xFF ||
+       num_frames_ == 0xFF)) {
+    return false;
+  }
+
+  uint8_t* pos = buf_ + len_;
+  *pos = len;
+  if (frame.origin_type == CANFrameOriginType::kApp ||
+      frame.origin_type == CANFrameOriginType::kRemoteApp) {
+    *pos |= kTransmittedFlag;
+  }
+  pos[1] = offset_ms;
+  PutLE32(pos + 2, frame.id);
+  memcpy(pos + 6, frame.buf, len);
+  len_ += 6 + len;
+  num_frames_++;
+  return true;
+}
+
+size_t CANBridgeDatagramWriter::finish() {
+  memcpy(buf_, kMagic, sizeof(kMagic));
+  buf_[2] = kCANBridgeVersion;
+  buf_[3] = num_frames_;
+  PutLE32(buf_ + 4, sender_id_);
+  PutLE32(buf_ + 8, sequence_);
+  PutLE32(buf_ + 12, base_ms_);
+
+  size_t len = len_;
+  sequence_++;
+  num_frames_ = 0;
+  len_ = kCANBridgeHeaderSize;
+  return len;
+}
+
+bool CANBridgeDatagramReader::begin(const uint8_t* buf, size_t len) {
+  remaining_frames_ = 0;
+  if (len < kCANBridgeHeaderSize || memcmp(buf, kMagic, sizeof(kMagic)) != 0 ||
+      buf[2] != kCANBridgeVersion) {
+    return false;
+  }
+  num_frames_ = buf[3];
+  sender_id_ = GetLE32(buf + 4);
+  sequence_ = GetLE32(buf + 8);
+  base_ms_ = GetLE32(buf + 12);
+
+  // check the frame lengths up front so that next() can't fail midway
+  size_t pos = kCANBridgeHeaderSize;
+  for (int i = 0; i < num_frames_; i++) {
+    if (pos + 6 > len || (buf[pos] & kLengthMask) > 8) {
+      return false;
+    }
+    pos += 6 + (buf[pos] & kLengthMask);
+  }
+  if (pos != len) {
+    return false;
+  }
+
+  pos_ = buf + kCANBridgeHeaderSize;
+  remaining_frames_ = num_frames_;
+  return true;
+}
+
+bool CANBridgeDatagramReader::next(CANFrame& frame, uint32_t& time_ms) {
+  if (remaining_frames_ == 0) {
+    return false;
+  }
+  remaining_frames_--;
+
+  uint8_t flags = pos_[0];
+  frame.len = flags & kLengthMask;
+  frame.origin_type = (flags & kTransmittedFlag)
+                          ? CANFrameOriginType::kRemoteApp
+                          : CANFrameOriginType::kRemoteCAN;
+  time_ms = base_ms_ + pos_[1];
+  frame.id = GetLE32(pos_ + 2);
+  memcpy(frame.buf, pos_ + 6, frame.len);
+  pos_ += 6 + frame.len;
+  return true;
+}
+
+bool CANBridgeSequenceTracker::update(uint32_t sequence,
+                                      CANBridgeStats& stats) {
+  stats.received++;
+  if (!started_) {
+    started_ = true;
+    highest_ = sequence;
+    received_mask_ = 1;
+    return true;
+  }
+
+  int32_t ahead = (int32_t)(sequence - highest_);
+  if (ahead > 0) {
+    stats.lost += ahead - 1;
+    received_mask_ =
+        (ahead < (int32_t)kReorderWindow ? received_mask_ << ahead : 0) | 1;
+    highest_ = sequence;
+    return true;
+  }
+
+  uint32_t behind = -ahead;
+  if (behind >= kReorderWindow) {
+    // already counted as lost
+    stats.late++;
+    return false;
+  }
+  uint64_t bit = (uint64_t)1 << behind;
+  if (received_mask_ & bit) {
+    stats.duplicates++;
+    return false;
+  }
+  received_mask_ |= bit;
+  stats.lost--;
+  stats.reordered++;
+  return true;
+}
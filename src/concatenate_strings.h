@@ -2,7 +2,9 @@
 #define SH_WG_FIRMWARE_CONCATENATE_STRINGS_H_
 
 #include "elapsedMillis.h"
+#include "deferred_log.h"
 #include "origin_string.h"
+#include "reaction_profiler.h"
 #include "sensesp/transforms/transform.h"
 #include "shwg.h"
 
@@ -25,12 +27,14 @@ class ConcatenateStrings : public Transform<OriginString, OriginString> {
       : Transform<OriginString, OriginString>(),
         max_delay_{max_delay},
         max_length_{max_length} {
-    ReactESP::app->onRepeat(1, [this]() { this->check_timeout(); });
+    ProfiledOnRepeat(ReactESP::app, 1, "ConcatenateStrings timeout",
+                     [this]() { this->check_timeout(); });
   }
 
   void set_input(const OriginString new_value, uint8_t input_channel) override {
     if (new_value.data.length() > max_length_) {
-      debugW("Input string longer than max length: %s", new_value.data.c_str());
+      deferredW("Input string longer than max length: %s",
+                new_value.data.c_str());
       return;
     }
     if (output_.data.length() == 0) {
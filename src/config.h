@@ -26,6 +26,8 @@ constexpr uint16_t kDefaultYdwgRawTCPServerPort = 2223;
 constexpr uint16_t kDefaultNMEA0183UDPServerPort = 2000;
 constexpr uint16_t kDefaultYdwgRawUDPServerPort = 2002;
 
+constexpr uint16_t kDefaultCANBridgePort = 2012;
+
 // update the system time every hour
 constexpr unsigned long kTimeUpdatePeriodMs = 3600 * 1000;
 
@@ -39,6 +41,48 @@ static constexpr int kDelayBetweenFirmwareUpdateChecksMs =
 constexpr char kWiFiCaptivePortalPassword[] = "abcdabcd";
 
 constexpr size_t kMaxNMEA2000MessageSeasmartSize = 500;
+// SeaSmart.Net sentences are packed and emitted together at this interval,
+// or once a batch reaches this size in bytes
+constexpr unsigned int kSeasmartFlushIntervalMs = 100;
+constexpr size_t kSeasmartBatchSize = 1000;
 constexpr size_t kMaxNMEA0183MessageSize = 200;
 
+// Store-and-forward buffering for the TCP clients: RAM buffer and spill
+// file sizes per client. The spill files share the SPIFFS partition with
+// the configuration files.
+constexpr size_t kStoreAndForwardRAMSize = 16 * 1024;
+constexpr size_t kStoreAndForwardSpillSize = 40 * 1024;
+
+// CAN frames are received in a dedicated task on the protocol core and
+// handed over to the Arduino loop task on the application core
+constexpr size_t kCANRXRingSize = 256;
+constexpr BaseType_t kCANRXTaskCore = 0;
+// above the lwIP task (18), below the WiFi task (23)
+constexpr UBaseType_t kCANRXTaskPriority = 19;
+
+// Trip recordings are rotated at this size. The buffered frames are
+// written to flash at least this often.
+constexpr size_t kTripRecorderFileSize = 16 * 1024;
+constexpr unsigned int kTripRecorderFlushIntervalMs = 5000;
+
+// Replayed frames are queued for ParseMessages() in a ring of this size
+constexpr size_t kCANInjectRingSize = 64;
+
+// Frames originated by this gateway are remembered for this long to
+// recognize echoes from other gateways
+constexpr size_t kEchoFilterCapacity = 1024;
+constexpr uint32_t kEchoFilterWindowMs = 1000;
+
+// Messages queued per YDWG RAW TCP client with conflation enabled; about
+// the number of distinct PGN and source pairs on a busy bus
+constexpr size_t kConflationQueueSize = 256;
+
+// TCP server sessions in which nothing has been received or delivered for
+// this long are closed; 0 keeps them open. Off by default, as receive-only
+// clients of quiet outputs would otherwise be dropped.
+constexpr int kDefaultTCPSessionIdleTimeoutS = 0;
+
+// Frames received by the CAN bridge are queued for the main task
+constexpr int kCANBridgeRXQueueSize = 256;
+
 #endif // SH_WG_CONFIG_H_
@@ -0,0 +1,429 @@
+#ifndef SH_WG_FIRMWARE_CONFLATING_QUEUE_H_
+#define SH_WG_FIRMWARE_CONFLATING_QUEUE_H_
+
+#include <Arduino.h>
+
+#include <functional>
+#include <memory>
+#include <new>
+
+#include "ydwg_raw_line.h"
+
+/**
+ * @brief Send queue of YDWG RAW lines in which newer messages replace
+ * unsent older ones.
+ *
+ * Messages are keyed by their CAN id without the priority bits, i.e. by
+ * PGN and source address, plus the destination address for addressed
+ * PGNs. A message for a key that is still queued replaces the queued one
+ * in place, so a consumer that falls behind receives the latest value of
+ * each message in the original order of first arrival, instead of an
+ * ever-growing backlog.
+ *
+ * The frames of a fast-packet message are collected and queued as one
+ * unit once the message is complete, so they are never interleaved with
+ * the frames of a newer message. Incomplete fast-packet messages are
+ * discarded.
+ *
+ * AIS messages from one transceiver describe many different vessels, and
+ * lines that are not YDWG RAW frames can't be keyed; both are queued
+ * without conflation.
+ *
+ * The messages are kept in a ring of slots, their text in chains of
+ * fixed-size blocks from a pool, and queued keys are found through an
+ * open-addressed hash table. All of it is allocated with the first message
+ * and kept until the queue is destroyed, so neither queuing a line nor
+ * clearing the queue for a new session allocates. Messages that don't fit
+ * in the free blocks are dropped.
+ */
+class ConflatingQueue {
+ public:
+  /**
+   * @param capacity Maximum number of queued messages
+   * @param is_fast_packet_pgn Function telling whether a PGN is sent as
+   * fast packets
+   */
+  ConflatingQueue(size_t capacity,
+                  std::function<bool(uint32_t pgn)> is_fast_packet_pgn)
+      : capacity_{capacity < kNone ? capacity : kNone - 1},
+        num_blocks_{capacity_ * 3 / 2 < kNone ? capacity_ * 3 / 2
+                                              : kNone - 1},
+        is_fast_packet_pgn_{is_fast_packet_pgn} {
+    // twice the capacity keeps the probe sequences short
+    index_size_ = 1;
+    index_bits_ = 0;
+    while (index_size_ < 2 * capacity_) {
+      index_size_ <<= 1;
+      index_bits_++;
+    }
+    reset_assemblies();
+  }
+
+  void push(const char* line) {
+    if (slots_ == nullptr && !allocate()) {
+      dropped_++;
+      return;
+    }
+    uint32_t id;
+    uint8_t data[2];
+    int len = ParseYDWGRawLine(line, id, data);
+    if (len < 0) {
+      enqueue(kNoKey, line);
+      return;
+    }
+    uint32_t key = id & 0x03FFFFFF;
+    uint32_t conflation_key = is_ais_pgn(CANIdToPGN(id)) ? kNoKey : key;
+    if (len < 2 || !is_fast_packet_pgn_(CANIdToPGN(id))) {
+      enqueue(conflation_key, line);
+      return;
+    }
+
+    // fast packet: byte 0 holds the sequence and frame counters and the
+    // first frame's byte 1 the message length
+    uint8_t sequence = data[0] >> 5;
+    uint8_t frame = data[0] & 0x1F;
+    Assembly* assembly = find_assembly(key, frame == 0);
+    if (assembly == nullptr) {
+      return;
+    }
+    if (frame == 0) {
+      free_chain(assembly->chain);
+      assembly->sequence = sequence;
+      assembly->next_frame = 0;
+      // 6 data bytes in the first frame, 7 in the others
+      assembly->num_frames = (data[1] + 7) / 7;
+    } else if (assembly->next_frame < 0 || assembly->sequence != sequence ||
+               assembly->next_frame != frame) {
+      // a frame is missing
+      free_chain(assembly->chain);
+      assembly->next_frame = -1;
+      return;
+    }
+    if (!append(assembly->chain, line, strlen(line))) {
+      free_chain(assembly->chain);
+      assembly->next_frame = -1;
+      dropped_++;
+      return;
+    }
+    assembly->next_frame++;
+    if (assembly->next_frame == assembly->num_frames) {
+      enqueue(conflation_key, assembly->chain);
+      assembly->chain = Chain();
+      assembly->next_frame = -1;
+    }
+  }
+
+  /**
+   * @brief Remove the oldest message.
+   *
+   * @param lines Receives the message; its capacity is reused
+   * @return false if the queue is empty
+   */
+  bool pop(String& lines) {
+    if (size_ == 0) {
+      return false;
+    }
+    Slot& slot = slots_[head_];
+    lines = "";
+    size_t remaining = slot.chain.len;
+    for (uint16_t block = slot.chain.first; remaining > 0;
+         block = next_block_[block]) {
+      size_t len = remaining < kBlockSize ? remaining : kBlockSize;
+      lines.concat(&blocks_[block * kBlockSize], len);
+      remaining -= len;
+    }
+    free_chain(slot.chain);
+    if (slot.key != kNoKey) {
+      erase_index(find_index(slot.key));
+    }
+    head_ = (head_ + 1) % capacity_;
+    size_--;
+    return true;
+  }
+
+  /**
+   * @brief Discard all messages and reset the counters. The storage is
+   * kept for reuse.
+   */
+  void clear() {
+    if (slots_ != nullptr) {
+      reset_storage();
+    }
+    head_ = 0;
+    size_ = 0;
+    reset_assemblies();
+    replaced_ = 0;
+    dropped_ = 0;
+  }
+
+  /**
+   * @brief Time the oldest message has been waiting in the queue.
+   */
+  uint32_t get_lag_ms(uint32_t now) const {
+    return size_ == 0 ? 0 : now - slots_[head_].queued_ms;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  uint32_t get_replaced() const { return replaced_; }
+  uint32_t get_dropped() const {  //< On a full queue or block pool
+    return dropped_;
+  }
+
+ protected:
+  static constexpr uint32_t kNoKey = 0xFFFFFFFF;
+  static constexpr uint16_t kNone = 0xFFFF;
+  // a block holds one YDWG RAW line; fast-packet messages take several
+  static constexpr size_t kBlockSize = 64;
+  // fast-packet messages collected at the same time
+  static constexpr int kMaxAssemblies = 32;
+
+  struct Chain {
+    uint16_t first = kNone;
+    uint16_t last = kNone;
+    uint16_t len = 0;
+  };
+
+  struct Slot {
+    uint32_t key;
+    uint32_t queued_ms;  //< Kept when the message is replaced
+    Chain chain;
+  };
+
+  struct Assembly {
+    uint32_t key;
+    uint8_t sequence;
+    int8_t next_frame;  //< -1 if no message is being collected
+    int8_t num_frames;
+    Chain chain;
+  };
+
+  const size_t capacity_;
+  const size_t num_blocks_;
+  size_t index_size_;
+  int index_bits_;
+  std::function<bool(uint32_t pgn)> is_fast_packet_pgn_;
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+
+  std::unique_ptr<char[]> blocks_;
+  std::unique_ptr<uint16_t[]> next_block_;  //< Chain links and free list
+  uint16_t free_block_ = kNone;
+
+  std::unique_ptr<uint16_t[]> index_;  //< Slots of the queued keys
+
+  Assembly assemblies_[kMaxAssemblies];
+  int next_taken_assembly_ = 0;
+
+  uint32_t replaced_ = 0;
+  uint32_t dropped_ = 0;
+
+  bool allocate() {
+    slots_.reset(new (std::nothrow) Slot[capacity_]);
+    blocks_.reset(new (std::nothrow) char[num_blocks_ * kBlockSize]);
+    next_block_.reset(new (std::nothrow) uint16_t[num_blocks_]);
+    index_.reset(new (std::nothrow) uint16_t[index_size_]);
+    if (slots_ == nullptr || blocks_ == nullptr || next_block_ == nullptr ||
+        index_ == nullptr) {
+      slots_.reset();
+      blocks_.reset();
+      next_block_.reset();
+      index_.reset();
+      return false;
+    }
+    reset_storage();
+    return true;
+  }
+
+  /**
+   * @brief Return all blocks to the free list and empty the index.
+   */
+  void reset_storage() {
+    for (size_t i = 0; i < num_blocks_; i++) {
+      next_block_[i] = i + 1 < num_blocks_ ? i + 1 : kNone;
+    }
+    free_block_ = 0;
+    for (size_t i = 0; i < index_size_; i++) {
+      index_[i] = kNone;
+    }
+  }
+
+  void reset_assemblies() {
+    for (auto& assembly : assemblies_) {
+      assembly.key = kNoKey;
+      assembly.next_frame = -1;
+      assembly.chain = Chain();
+    }
+  }
+
+  /**
+   * @brief Append data to a chain, taking blocks from the free list.
+   *
+   * @return false if there are not enough free blocks
+   */
+  bool append(Chain& chain, const char* data, size_t len) {
+    if (chain.len + len >= kNone) {
+      return false;
+    }
+    while (len > 0) {
+      size_t used = chain.len % kBlockSize;
+      if (used == 0) {
+        if (free_block_ == kNone) {
+          return false;
+        }
+        uint16_t block = free_block_;
+        free_block_ = next_block_[block];
+        next_block_[block] = kNone;
+        if (chain.first == kNone) {
+          chain.first = block;
+        } else {
+          next_block_[chain.last] = block;
+        }
+        chain.last = block;
+      }
+      size_t n = kBlockSize - used < len ? kBlockSize - used : len;
+      memcpy(&blocks_[chain.last * kBlockSize + used], data, n);
+      chain.len += n;
+      data += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  void free_chain(Chain& chain) {
+    if (chain.first != kNone) {
+      next_block_[chain.last] = free_block_;
+      free_block_ = chain.first;
+    }
+    chain = Chain();
+  }
+
+  void enqueue(uint32_t key, const char* line) {
+    Chain chain;
+    if (!append(chain, line, strlen(line))) {
+      free_chain(chain);
+      dropped_++;
+      return;
+    }
+    enqueue(key, chain);
+  }
+
+  /**
+   * @brief Queue a message, taking over its chain.
+   */
+  void enqueue(uint32_t key, Chain& chain) {
+    if (key != kNoKey) {
+      size_t pos = find_index(key);
+      if (index_[pos] != kNone) {
+        Slot& slot = slots_[index_[pos]];
+        free_chain(slot.chain);
+        slot.chain = chain;
+        replaced_++;
+        return;
+      }
+    }
+    if (size_ >= capacity_) {
+      free_chain(chain);
+      dropped_++;
+      return;
+    }
+    size_t slot_number = (head_ + size_) % capacity_;
+    Slot& slot = slots_[slot_number];
+    slot.key = key;
+    slot.queued_ms = (uint32_t)millis();
+    slot.chain = chain;
+    size_++;
+    if (key != kNoKey) {
+      index_[find_index(key)] = slot_number;
+    }
+  }
+
+  size_t hash(uint32_t key) const {
+    return index_bits_ > 0 ? (key * 2654435761u) >> (32 - index_bits_) : 0;
+  }
+
+  /**
+   * @brief Find the index position of a key, or the empty position where
+   * it would be inserted.
+   */
+  size_t find_index(uint32_t key) const {
+    size_t mask = index_size_ - 1;
+    size_t pos = hash(key) & mask;
+    while (index_[pos] != kNone && slots_[index_[pos]].key != key) {
+      pos = (pos + 1) & mask;
+    }
+    return pos;
+  }
+
+  /**
+   * @brief Remove an index entry, moving later entries of the probe
+   * sequence back so that no gap interrupts it.
+   */
+  void erase_index(size_t pos) {
+    size_t mask = index_size_ - 1;
+    size_t next = (pos + 1) & mask;
+    while (index_[next] != kNone) {
+      size_t home = hash(slots_[index_[next]].key) & mask;
+      // the entry may move unless its home lies after the gap
+      if (((next - home) & mask) >= ((next - pos) & mask)) {
+        index_[pos] = index_[next];
+        pos = next;
+      }
+      next = (next + 1) & mask;
+    }
+    index_[pos] = kNone;
+  }
+
+  /**
+   * @brief Find the fast-packet assembly of a key.
+   *
+   * @param create Take over an unused assembly, or else the least recently
+   * taken one, if the key has none
+   */
+  Assembly* find_assembly(uint32_t key, bool create) {
+    Assembly* unused = nullptr;
+    for (auto& assembly : assemblies_) {
+      if (assembly.key == key) {
+        return &assembly;
+      }
+      if (unused == nullptr && assembly.next_frame < 0) {
+        unused = &assembly;
+      }
+    }
+    if (!create) {
+      return nullptr;
+    }
+    if (unused == nullptr) {
+      // messages that never complete must not block the others
+      unused = &assemblies_[next_taken_assembly_];
+      next_taken_assembly_ = (next_taken_assembly_ + 1) % kMaxAssemblies;
+      free_chain(unused->chain);
+      unused->next_frame = -1;
+    }
+    unused->key = key;
+    return unused;
+  }
+
+  static bool is_ais_pgn(uint32_t pgn) {
+    switch (pgn) {
+      case 129038:  // class A position report
+      case 129039:  // class B position report
+      case 129040:  // class B extended position report
+      case 129041:  // aids to navigation report
+      case 129793:  // UTC and date report
+      case 129794:  // class A static and voyage related data
+      case 129798:  // SAR aircraft position report
+      case 129801:  // addressed safety related message
+      case 129802:  // safety related broadcast message
+      case 129809:  // class B static data, part A
+      case 129810:  // class B static data, part B
+        return true;
+      default:
+        return false;
+    }
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_CONFLATING_QUEUE_H_
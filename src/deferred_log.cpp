@@ -0,0 +1,178 @@
+#include "deferred_log.h"
+
+#include "sensesp.h"
+
+namespace {
+
+// Bounded multi-producer ring. Each slot carries a sequence number telling
+// whether it is free for the producer claiming it or ready for the
+// consumer; producers claim slots with a compare-and-swap on the head.
+//
+// The sequence of slot i is stored minus i, so that the zero-initialized
+// ring is valid even if logging starts during static initialization.
+struct Slot {
+  std::atomic<uint32_t> sequence;
+  DeferredLogRecord record;
+};
+
+Slot slots[kDeferredLogRingSize];
+std::atomic<uint32_t> head{0};
+uint32_t tail = 0;  // only accessed by the draining task
+std::atomic<uint32_t> dropped{0};
+
+uint32_t LoadSequence(uint32_t pos) {
+  Slot& slot = slots[pos % kDeferredLogRingSize];
+  return slot.sequence.load(std::memory_order_acquire) +
+         pos % kDeferredLogRingSize;
+}
+
+void StoreSequence(uint32_t pos, uint32_t sequence) {
+  Slot& slot = slots[pos % kDeferredLogRingSize];
+  slot.sequence.store(sequence - pos % kDeferredLogRingSize,
+                      std::memory_order_release);
+}
+
+}  // namespace
+
+bool DeferredLogAdmit(DeferredLogSite& site, uint32_t& suppressed) {
+  uint32_t now = millis();
+  if (now - site.window_start_ms >= 1000) {
+    site.window_start_ms = now;
+    site.window_count = 0;
+  }
+  if (site.window_count >= kDeferredLogRateLimit) {
+    site.suppressed++;
+    return false;
+  }
+  site.window_count++;
+  suppressed = site.suppressed.exchange(0);
+  return true;
+}
+
+void DeferredLogPush(const DeferredLogRecord& record) {
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots[pos % kDeferredLogRingSize];
+    int32_t diff = (int32_t)(LoadSequence(pos) - pos);
+    if (diff == 0) {
+      if (head.compare_exchange_weak(pos, pos + 1,
+                                     std::memory_order_relaxed)) {
+        slot.record = record;
+        StoreSequence(pos, pos + 1);
+        return;
+      }
+    } else if (diff < 0) {
+      // the ring is full
+      dropped++;
+      return;
+    } else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Format a record one conversion at a time, passing each argument as the
+// type the conversion expects instead of relying on the argument types
+// matching the format.
+static void FormatRecord(const DeferredLogRecord& record, char* buf,
+                         size_t size) {
+  const char* p = record.site->format;
+  size_t len = 0;
+  int arg = 0;
+  while (*p != '\0' && len < size - 1) {
+    if (*p != '%' || p[1] == '%') {
+      buf[len++] = *p;
+      p += *p == '%' ? 2 : 1;
+      continue;
+    }
+    // copy the flags, width and precision, dropping the length modifiers
+    char spec[16];
+    size_t spec_len = 0;
+    spec[spec_len++] = *p++;
+    while (*p != '\0' && strchr("-+ #0123456789.hlLjzt", *p) != nullptr) {
+      if (strchr("hlLjzt", *p) == nullptr && spec_len < sizeof(spec) - 2) {
+        spec[spec_len++] = *p;
+      }
+      p++;
+    }
+    if (*p == '\0') {
+      break;
+    }
+    char conversion = *p++;
+    spec[spec_len++] = conversion;
+    spec[spec_len] = '\0';
+
+    int n;
+    bool is_string = arg < record.num_args &&
+                     record.arg_types[arg] == DeferredLogArgType::kString;
+    uint32_t value = arg < record.num_args ? record.args[arg] : 0;
+    if (arg >= record.num_args) {
+      n = snprintf(buf + len, size - len, "?");
+    } else if (conversion == 's') {
+      n = snprintf(buf + len, size - len, spec,
+                   is_string ? record.text : "?");
+    } else if (is_string) {
+      n = snprintf(buf + len, size - len, "?");
+    } else if (conversion == 'd' || conversion == 'i' || conversion == 'c') {
+      n = snprintf(buf + len, size - len, spec, (int)value);
+    } else if (strchr("uxXo", conversion) != nullptr) {
+      n = snprintf(buf + len, size - len, spec, (unsigned int)value);
+    } else {
+      n = snprintf(buf + len, size - len, "?");
+    }
+    arg++;
+    if (n < 0) {
+      break;
+    }
+    len += (size_t)n < size - len ? n : size - len - 1;
+  }
+  buf[len] = '\0';
+}
+
+static void OutputRecord(const DeferredLogRecord& record) {
+  char message[160];
+  FormatRecord(record, message, sizeof(message));
+
+  char suffix[40] = "";
+  if (record.suppressed > 0) {
+    snprintf(suffix, sizeof(suffix), " (%u similar suppressed)",
+             (unsigned)record.suppressed);
+  }
+
+  switch (record.site->level) {
+    case DeferredLogLevel::kDebug:
+      debugD("[%lu] %s%s", (unsigned long)record.timestamp_ms, message,
+             suffix);
+      break;
+    case DeferredLogLevel::kInfo:
+      debugI("[%lu] %s%s", (unsigned long)record.timestamp_ms, message,
+             suffix);
+      break;
+    case DeferredLogLevel::kWarning:
+      debugW("[%lu] %s%s", (unsigned long)record.timestamp_ms, message,
+             suffix);
+      break;
+    case DeferredLogLevel::kError:
+      debugE("[%lu] %s%s", (unsigned long)record.timestamp_ms, message,
+             suffix);
+      break;
+  }
+}
+
+size_t DeferredLogDrain(size_t max_records) {
+  size_t count = 0;
+  while (count < max_records) {
+    if (LoadSequence(tail) != tail + 1) {
+      break;
+    }
+    OutputRecord(slots[tail % kDeferredLogRingSize].record);
+    StoreSequence(tail, tail + kDeferredLogRingSize);
+    tail++;
+    count++;
+  }
+  return count;
+}
+
+uint32_t DeferredLogPending() { return head.load() - tail; }
+
+uint32_t DeferredLogDropped() { return dropped.load(); }
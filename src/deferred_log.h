@@ -0,0 +1,173 @@
+#ifndef SH_WG_FIRMWARE_DEFERRED_LOG_H_
+#define SH_WG_FIRMWARE_DEFERRED_LOG_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <type_traits>
+
+// Deferred logging for hot paths.
+//
+// deferredD/I/W/E record a pointer to a static call site descriptor and the
+// argument values with their types in a lock-free ring. Formatting and
+// output only happen when DeferredLogDrain() is called from the main loop.
+// Each call site is rate limited; suppressed messages are counted and
+// reported with the next message from the same call site.
+//
+// Arguments must be integers of at most 32 bits or C strings, which is
+// checked at compile time. Each conversion of the format is applied to its
+// argument separately, as an int or unsigned int for the integer
+// conversions (length modifiers are ignored) and as a string for %s. At
+// most one string argument is supported and it is truncated to
+// kDeferredLogMaxStringLength characters. Floating point values are not
+// supported.
+
+constexpr int kDeferredLogMaxArgs = 4;
+constexpr size_t kDeferredLogMaxStringLength = 31;
+constexpr size_t kDeferredLogRingSize = 64;
+// messages per call site per second
+constexpr uint32_t kDeferredLogRateLimit = 5;
+
+enum class DeferredLogLevel : uint8_t {
+  kDebug,
+  kInfo,
+  kWarning,
+  kError,
+};
+
+/**
+ * @brief Static descriptor of a deferred log call site.
+ */
+struct DeferredLogSite {
+  DeferredLogSite(DeferredLogLevel level, const char* format)
+      : level{level}, format{format} {}
+
+  const DeferredLogLevel level;
+  const char* const format;
+
+  // Rate limiting state. Races between tasks logging from the same call
+  // site only affect the accuracy of the limit.
+  uint32_t window_start_ms = 0;
+  uint32_t window_count = 0;
+  std::atomic<uint32_t> suppressed{0};
+};
+
+enum class DeferredLogArgType : uint8_t {
+  kInteger,
+  kString,  //< The value is in DeferredLogRecord::text
+};
+
+struct DeferredLogRecord {
+  DeferredLogSite* site;
+  uint32_t timestamp_ms;
+  uint32_t suppressed;  //< Messages suppressed before this one
+  uint8_t num_args;
+  DeferredLogArgType arg_types[kDeferredLogMaxArgs];
+  uint32_t args[kDeferredLogMaxArgs];  //< Integers, converted to 32 bits
+  char text[kDeferredLogMaxStringLength + 1];
+};
+
+/**
+ * @brief Apply the call site rate limit.
+ *
+ * @return true if the message should be recorded
+ */
+bool DeferredLogAdmit(DeferredLogSite& site, uint32_t& suppressed);
+
+/**
+ * @brief Add a record to the ring. Safe to call from any task.
+ */
+void DeferredLogPush(const DeferredLogRecord& record);
+
+/**
+ * @brief Format and output recorded messages.
+ *
+ * @param max_records Maximum number of records to output in one call
+ * @return Number of records output
+ */
+size_t DeferredLogDrain(size_t max_records = kDeferredLogRingSize);
+
+uint32_t DeferredLogPending();
+uint32_t DeferredLogDropped();  //< Records dropped on a full ring
+
+inline void DeferredLogEncodeArgs(DeferredLogRecord& record) {}
+
+template <typename T, typename... Rest>
+void DeferredLogEncodeArgs(DeferredLogRecord& record, T value,
+                           const Rest&... rest);
+
+inline void DeferredLogEncodeString(DeferredLogRecord& record,
+                                    const char* value) {
+  strncpy(record.text, value, kDeferredLogMaxStringLength);
+  record.text[kDeferredLogMaxStringLength] = '\0';
+  record.arg_types[record.num_args] = DeferredLogArgType::kString;
+  record.args[record.num_args++] = 0;
+}
+
+template <typename... Rest>
+void DeferredLogEncodeArgs(DeferredLogRecord& record, const char* value,
+                           const Rest&... rest) {
+  DeferredLogEncodeString(record, value);
+  DeferredLogEncodeArgs(record, rest...);
+}
+
+template <typename... Rest>
+void DeferredLogEncodeArgs(DeferredLogRecord& record, char* value,
+                           const Rest&... rest) {
+  DeferredLogEncodeString(record, value);
+  DeferredLogEncodeArgs(record, rest...);
+}
+
+template <typename T, typename... Rest>
+void DeferredLogEncodeArgs(DeferredLogRecord& record, T value,
+                           const Rest&... rest) {
+  static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                "Deferred log arguments must be integers or C strings");
+  static_assert(sizeof(T) <= sizeof(uint32_t),
+                "Deferred log integer arguments are limited to 32 bits");
+  record.arg_types[record.num_args] = DeferredLogArgType::kInteger;
+  record.args[record.num_args++] = (uint32_t)value;
+  DeferredLogEncodeArgs(record, rest...);
+}
+
+template <typename... Args>
+void DeferredLog(DeferredLogSite& site, const Args&... args) {
+  static_assert(sizeof...(Args) <= kDeferredLogMaxArgs,
+                "Too many deferred log arguments");
+  uint32_t suppressed;
+  if (!DeferredLogAdmit(site, suppressed)) {
+    return;
+  }
+  DeferredLogRecord record;
+  record.site = &site;
+  record.timestamp_ms = millis();
+  record.suppressed = suppressed;
+  record.num_args = 0;
+  DeferredLogEncodeArgs(record, args...);
+  DeferredLogPush(record);
+}
+
+// Never called; lets the compiler check the arguments against the format
+inline void DeferredLogCheckFormat(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+inline void DeferredLogCheckFormat(const char* format, ...) {}
+
+#define SH_WG_DEFERRED_LOG(level, format, ...)                 \
+  do {                                                         \
+    static DeferredLogSite deferred_log_site_(level, format); \
+    if (false) {                                               \
+      DeferredLogCheckFormat(format, ##__VA_ARGS__);           \
+    }                                                          \
+    DeferredLog(deferred_log_site_, ##__VA_ARGS__);           \
+  } while (0)
+
+#define deferredD(format, ...) \
+  SH_WG_DEFERRED_LOG(DeferredLogLevel::kDebug, format, ##__VA_ARGS__)
+#define deferredI(format, ...) \
+  SH_WG_DEFERRED_LOG(DeferredLogLevel::kInfo, format, ##__VA_ARGS__)
+#define deferredW(format, ...) \
+  SH_WG_DEFERRED_LOG(DeferredLogLevel::kWarning, format, ##__VA_ARGS__)
+#define deferredE(format, ...) \
+  SH_WG_DEFERRED_LOG(DeferredLogLevel::kError, format, ##__VA_ARGS__)
+
+#endif  // SH_WG_FIRMWARE_DEFERRED_LOG_H_
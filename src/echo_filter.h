@@ -0,0 +1,174 @@
+#ifndef SH_WG_FIRMWARE_ECHO_FILTER_H_
+#define SH_WG_FIRMWARE_ECHO_FILTER_H_
+
+#include <Arduino.h>
+
+#include <memory>
+
+#include "can_frame.h"
+#include "sensesp/transforms/transform.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Time-windowed set of recently seen CAN frames.
+ *
+ * Frames are identified by a 32-bit hash of their id and data. Lookups and
+ * insertions probe a bounded number of slots, so both take constant time.
+ * When all probed slots are in use, the oldest entry is replaced; under a
+ * load exceeding the capacity within the window, the effective window
+ * shrinks.
+ */
+class RecentFrameSet {
+ public:
+  /**
+   * @param capacity Number of entries, rounded up to a power of two
+   * @param window_ms How long a frame is remembered
+   */
+  RecentFrameSet(size_t capacity, uint32_t window_ms) : window_ms_{window_ms} {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    entries_ = new Entry[size]();
+  }
+
+  ~RecentFrameSet() { delete[] entries_; }
+
+  RecentFrameSet(const RecentFrameSet&) = delete;
+  RecentFrameSet& operator=(const RecentFrameSet&) = delete;
+
+  void insert(const CANFrame& frame, uint32_t now_ms) {
+    uint32_t hash = hash_frame(frame);
+    Entry* replaced = nullptr;
+    for (uint32_t i = 0; i < kMaxProbes; i++) {
+      Entry& entry = entries_[(hash + i) & mask_];
+      if (entry.hash == hash || !is_live(entry, now_ms)) {
+        replaced = &entry;
+        break;
+      }
+      if (replaced == nullptr || now_ms - entry.timestamp_ms >
+                                     now_ms - replaced->timestamp_ms) {
+        // the oldest entry so far
+        replaced = &entry;
+      }
+    }
+    replaced->hash = hash;
+    replaced->timestamp_ms = now_ms;
+  }
+
+  bool contains(const CANFrame& frame, uint32_t now_ms) const {
+    uint32_t hash = hash_frame(frame);
+    for (uint32_t i = 0; i < kMaxProbes; i++) {
+      const Entry& entry = entries_[(hash + i) & mask_];
+      if (entry.hash == hash && is_live(entry, now_ms)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static constexpr uint32_t kMaxProbes = 8;
+
+ protected:
+  struct Entry {
+    uint32_t hash;  //< 0 marks an unused entry
+    uint32_t timestamp_ms;
+  };
+
+  Entry* entries_;
+  uint32_t mask_;
+  const uint32_t window_ms_;
+
+  bool is_live(const Entry& entry, uint32_t now_ms) const {
+    return entry.hash != 0 && now_ms - entry.timestamp_ms <= window_ms_;
+  }
+
+  static uint32_t hash_frame(const CANFrame& frame) {
+    // FNV-1a over the id, length and data
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](uint8_t byte) {
+      hash ^= byte;
+      hash *= 16777619u;
+    };
+    for (int shift = 0; shift < 32; shift += 8) {
+      add(frame.id >> shift);
+    }
+    int len = frame.len > 8 ? 8 : frame.len;
+    add(len);
+    for (int i = 0; i < len; i++) {
+      add(frame.buf[i]);
+    }
+    // final avalanche so that the low bits select the slot well
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash != 0 ? hash : 1;
+  }
+};
+
+/**
+ * @brief Drop frames that other gateways echo back to this one.
+ *
+ * Origin ids are only meaningful within one device, so they can't prevent
+ * loops between gateways bridging YDWG RAW over the network. Instead, the
+ * filter remembers the frames this gateway originates (received from its
+ * own bus or from applications) and drops frames received from the network
+ * that match one of them within the time window.
+ *
+ * Frames from other gateways are never remembered, so repeated identical
+ * frames from a remote bus are not mistaken for echoes.
+ */
+class EchoFilter : public Transform<CANFrame, CANFrame> {
+ public:
+  EchoFilter(size_t capacity, uint32_t window_ms)
+      : Transform<CANFrame, CANFrame>(),
+        capacity_{capacity},
+        window_ms_{window_ms} {
+    set_enabled(true);
+  }
+
+  void set_input(CANFrame frame, uint8_t input_channel = 0) override {
+    if (!recent_frames_) {
+      emit(frame);
+      return;
+    }
+    uint32_t now = millis();
+    switch (frame.origin_type) {
+      case CANFrameOriginType::kRemoteCAN:
+      case CANFrameOriginType::kRemoteApp:
+        if (recent_frames_->contains(frame, now)) {
+          suppressed_++;
+          return;
+        }
+        break;
+      default:
+        recent_frames_->insert(frame, now);
+        break;
+    }
+    emit(frame);
+  }
+
+  /**
+   * @brief Enable or disable the filter. A disabled filter passes all
+   * frames and frees its frame set.
+   */
+  void set_enabled(bool enabled) {
+    if (!enabled) {
+      recent_frames_.reset();
+    } else if (!recent_frames_) {
+      recent_frames_.reset(new RecentFrameSet(capacity_, window_ms_));
+    }
+  }
+
+  uint32_t get_suppressed() const { return suppressed_; }
+
+ protected:
+  const size_t capacity_;
+  const uint32_t window_ms_;
+  std::unique_ptr<RecentFrameSet> recent_frames_;  //< Null while disabled
+  uint32_t suppressed_ = 0;
+};
+
+#endif  // SH_WG_FIRMWARE_ECHO_FILTER_H_
@@ -0,0 +1,143 @@
+#include "NMEA2000_socketcan_framehandler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sensesp.h"
+
+// how long to wait for TX buffer space when wait_sent is set
+static constexpr int kSendTimeoutMs = 10;
+
+/**
+ * @brief Open a raw CAN socket bound to the configured interface.
+ *
+ * @return true The socket was opened
+ * @return false The interface could not be opened
+ */
+bool tNMEA2000_SocketCAN_FH::CANOpen() {
+  socket_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (socket_ < 0) {
+    debugE("Unable to create a CAN socket: %s", strerror(errno));
+    return false;
+  }
+
+  struct ifreq ifr = {};
+  strncpy(ifr.ifr_name, interface_.c_str(), IFNAMSIZ - 1);
+  if (ioctl(socket_, SIOCGIFINDEX, &ifr) < 0) {
+    debugE("CAN interface %s not found", interface_.c_str());
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  struct sockaddr_can addr = {};
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    debugE("Unable to bind to %s: %s", interface_.c_str(), strerror(errno));
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK);
+  debugI("Opened CAN interface %s", interface_.c_str());
+  return true;
+}
+
+bool tNMEA2000_SocketCAN_FH::CANSendFrame(unsigned long id, unsigned char len,
+                                          const unsigned char* buf,
+                                          bool wait_sent) {
+  if (socket_ < 0) {
+    return false;
+  }
+
+  struct can_frame frame = {};
+  // NMEA 2000 uses 29-bit extended identifiers only
+  frame.can_id = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+  frame.can_dlc = len > 8 ? 8 : len;
+  memcpy(frame.data, buf, frame.can_dlc);
+
+  while (true) {
+    if (write(socket_, &frame, sizeof(frame)) == sizeof(frame)) {
+      return true;
+    }
+    if (!wait_sent || (errno != EAGAIN && errno != ENOBUFS)) {
+      return false;
+    }
+    struct pollfd pfd = {socket_, POLLOUT, 0};
+    if (poll(&pfd, 1, kSendTimeoutMs) <= 0) {
+      return false;
+    }
+  }
+}
+
+/**
+ * @brief Get a CAN frame from the CAN bus and pass it to the frame handler.
+ *
+ * Standard frames, remote requests and error frames are ignored.
+ *
+ * @param id
+ * @param len
+ * @param buf
+ * @return true A frame is available for further processing
+ * @return false No frame was acquired
+ */
+bool tNMEA2000_SocketCAN_FH::CANGetFrame(unsigned long& id,
+                                         unsigned char& len,
+                                         unsigned char* buf) {
+  bool hasFrame = false;
+  struct can_frame frame;
+
+  while (socket_ >= 0 && read(socket_, &frame, sizeof(frame)) ==
+                             sizeof(frame)) {
+    if ((frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) !=
+        CAN_EFF_FLAG) {
+      continue;
+    }
+    id = frame.can_id & CAN_EFF_MASK;
+    len = frame.can_dlc;
+    memcpy(buf, frame.data, len);
+    hasFrame = true;
+    break;
+  }
+
+  RunCANFrameHandlers(hasFrame, id, len, buf);
+
+  return hasFrame;
+}
+
+/**
+ * @brief Run the frame handlers, possibly modifying the CAN frame.
+ *
+ * @param hasFrame
+ * @param canId
+ * @param len
+ * @param buf
+ */
+void tNMEA2000_SocketCAN_FH::RunCANFrameHandlers(bool& hasFrame,
+                                                 unsigned long& canId,
+                                                 unsigned char& len,
+                                                 unsigned char* buf) {
+  if (CANFrameHandler != NULL) {
+    CANFrameHandler(hasFrame, canId, len, buf);
+  }
+}
+
+/**
+ * @brief Set the frame handler.
+ *
+ * @param _FrameHandler
+ */
+void tNMEA2000_SocketCAN_FH::SetCANFrameHandler(
+    void (*_FrameHandler)(bool& hasFrame, unsigned long& canId,
+                          unsigned char& len, unsigned char* buf)) {
+  CANFrameHandler = _FrameHandler;
+}
@@ -0,0 +1,47 @@
+#ifndef SH_WG_FIRMWARE_HOST_NMEA2000_SOCKETCAN_FRAMEHANDLER_H_
+#define SH_WG_FIRMWARE_HOST_NMEA2000_SOCKETCAN_FRAMEHANDLER_H_
+
+#include <NMEA2000.h>
+
+#include "Arduino.h"
+
+/**
+ * @brief Linux SocketCAN NMEA 2000 driver with frame handler callback
+ * support.
+ *
+ * Host counterpart of tNMEA2000_esp32_FH. Works with both physical CAN
+ * interfaces and virtual vcan interfaces.
+ */
+class tNMEA2000_SocketCAN_FH : public tNMEA2000 {
+ public:
+  tNMEA2000_SocketCAN_FH(const char* interface = "vcan0")
+      : tNMEA2000(), interface_{interface} {}
+
+  void SetCANFrameHandler(void (*_FrameHandler)(bool& hasFrame,
+                                                unsigned long& canId,
+                                                unsigned char& len,
+                                                unsigned char* buf));
+
+  bool CANSendFrame(unsigned long id, unsigned char len,
+                    const unsigned char* buf, bool wait_sent = true) override;
+
+  // expose IsFastPacketPGN to public
+  bool IsFastPacketPGN(unsigned long pgn) {
+    return tNMEA2000::IsFastPacketPGN(pgn);
+  }
+
+ protected:
+  String interface_;
+  int socket_ = -1;
+
+  bool CANOpen() override;
+  bool CANGetFrame(unsigned long& id, unsigned char& len,
+                   unsigned char* buf) override;
+
+  void (*CANFrameHandler)(bool& hasFrame, unsigned long& canId,
+                          unsigned char& len, unsigned char* buf) = nullptr;
+  void RunCANFrameHandlers(bool& hasFrame, unsigned long& canId,
+                           unsigned char& len, unsigned char* buf);
+};
+
+#endif  // SH_WG_FIRMWARE_HOST_NMEA2000_SOCKETCAN_FRAMEHANDLER_H_
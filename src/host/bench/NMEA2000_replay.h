@@ -0,0 +1,62 @@
+#ifndef SH_WG_FIRMWARE_HOST_BENCH_NMEA2000_REPLAY_H_
+#define SH_WG_FIRMWARE_HOST_BENCH_NMEA2000_REPLAY_H_
+
+#include <NMEA2000.h>
+
+#include <functional>
+#include <vector>
+
+#include "can_frame.h"
+
+/**
+ * @brief NMEA 2000 device that receives a fixed list of CAN frames.
+ *
+ * Used for feeding recorded traffic through the library's message
+ * reassembly. Transmitted frames are discarded.
+ */
+class tNMEA2000_Replay : public tNMEA2000 {
+ public:
+  tNMEA2000_Replay(const std::vector<CANFrame>& frames)
+      : tNMEA2000(), frames_{frames} {}
+
+  void rewind() { pos_ = 0; }
+  bool done() const { return pos_ >= frames_.size(); }
+  size_t get_position() const { return pos_; }
+
+  /**
+   * @brief Set a function to be called for every received frame, as the
+   * frame handler of tNMEA2000_esp32_FH is.
+   */
+  void set_frame_callback(std::function<void(const CANFrame&)> callback) {
+    frame_callback_ = callback;
+  }
+
+  bool CANSendFrame(unsigned long id, unsigned char len,
+                    const unsigned char* buf, bool wait_sent = true) override {
+    return true;
+  }
+
+ protected:
+  const std::vector<CANFrame>& frames_;
+  size_t pos_ = 0;
+  std::function<void(const CANFrame&)> frame_callback_;
+
+  bool CANOpen() override { return true; }
+
+  bool CANGetFrame(unsigned long& id, unsigned char& len,
+                   unsigned char* buf) override {
+    if (done()) {
+      return false;
+    }
+    const CANFrame& frame = frames_[pos_++];
+    id = frame.id;
+    len = frame.len;
+    memcpy(buf, frame.buf, len);
+    if (frame_callback_) {
+      frame_callback_(frame);
+    }
+    return true;
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_HOST_BENCH_NMEA2000_REPLAY_H_
@@ -0,0 +1,51 @@
+#include "alloc_counter.h"
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+
+static uint64_t allocations = 0;
+static size_t live_bytes = 0;
+static size_t reset_bytes = 0;
+static size_t peak_bytes = 0;
+
+void AllocCounter::reset() {
+  allocations = 0;
+  reset_bytes = live_bytes;
+  peak_bytes = live_bytes;
+}
+
+uint64_t AllocCounter::get_allocations() { return allocations; }
+
+size_t AllocCounter::get_live_bytes() { return live_bytes; }
+
+size_t AllocCounter::get_peak_bytes() { return peak_bytes - reset_bytes; }
+
+static void* CountedAlloc(size_t size) {
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  allocations++;
+  live_bytes += malloc_usable_size(ptr);
+  if (live_bytes > peak_bytes) {
+    peak_bytes = live_bytes;
+  }
+  return ptr;
+}
+
+static void CountedFree(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  live_bytes -= malloc_usable_size(ptr);
+  free(ptr);
+}
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, size_t size) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, size_t size) noexcept { CountedFree(ptr); }
@@ -0,0 +1,28 @@
+#ifndef SH_WG_FIRMWARE_HOST_BENCH_ALLOC_COUNTER_H_
+#define SH_WG_FIRMWARE_HOST_BENCH_ALLOC_COUNTER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Heap usage counters maintained by the replacement global operator
+ * new and delete.
+ *
+ * Only C++ allocations are counted. Note that the host String is backed by
+ * std::string, which stores short strings inline; the Arduino String always
+ * allocates, so the counts are a lower bound for the firmware.
+ */
+class AllocCounter {
+ public:
+  /**
+   * @brief Reset the allocation count and the peak to the current usage.
+   */
+  static void reset();
+
+  static uint64_t get_allocations();
+  static size_t get_live_bytes();
+  /// Peak usage above the usage at the time of the last reset
+  static size_t get_peak_bytes();
+};
+
+#endif  // SH_WG_FIRMWARE_HOST_BENCH_ALLOC_COUNTER_H_
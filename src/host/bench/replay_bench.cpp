@@ -0,0 +1,667 @@
+// Replay-driven throughput benchmark for the gateway core.
+//
+// Replays a YDWG RAW recording through each pipeline stage in isolation and
+// end-to-end, and reports throughput, time per item, heap allocations per
+// item and peak heap usage for each stage. The results can be compared
+// against a stored baseline to catch regressions:
+//
+//   .pio/build/native_bench/program -w bench_baseline.txt
+//   .pio/build/native_bench/program -b bench_baseline.txt
+
+#include <getopt.h>
+#include <sys/time.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "NMEA2000_replay.h"
+#include "alloc_counter.h"
+#include "can_bridge_protocol.h"
+#include "can_frame.h"
+#include "concatenate_strings.h"
+#include "config.h"
+#include "echo_filter.h"
+#include "n2k_nmea0183_transform.h"
+#include "origin_string.h"
+#include "router.h"
+#include "routing_table.h"
+#include "seasmart_transform.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/transforms/lambda_transform.h"
+#include "shwg.h"
+#include "static_can_pipeline.h"
+#include "stringtokenizer_transform.h"
+#include "trip_recording.h"
+#include "ydwg_raw_output.h"
+#include "ydwg_raw_parser.h"
+
+using namespace sensesp;
+
+reactesp::ReactESP app;
+
+SensESPMinimalApp *sensesp_app = nullptr;
+
+// maximum length of the concatenated input blocks, as in SetupConnections()
+constexpr size_t kBlockSize = 1000;
+
+struct StageResult {
+  String name;
+  const char *unit;
+  uint64_t items;
+  double seconds;
+  double ns_per_item;
+  double allocations_per_item;
+  size_t peak_heap_bytes;
+};
+
+struct BaselineEntry {
+  double ns_per_item;
+  double allocations_per_item;
+  size_t peak_heap_bytes;
+};
+
+struct BenchConfig {
+  const char *recording = "data/ydwg_recording_1.txt";
+  int iterations = 10;
+  const char *stage_filter = nullptr;
+  const char *baseline_file = nullptr;
+  const char *write_baseline_file = nullptr;
+  double tolerance_percent = 20;
+};
+
+BenchConfig config;
+
+std::vector<StageResult> results;
+
+/**
+ * @brief Run a stage and record its results.
+ *
+ * @param name Stage name
+ * @param unit Unit of the items processed by the stage
+ * @param run_once Function that processes the complete input once and
+ * returns the number of items processed. It is called once before the
+ * measurement to warm up caches and lookup tables.
+ */
+template <typename F>
+static void RunStage(const char *name, const char *unit, F run_once) {
+  if (config.stage_filter != nullptr &&
+      strstr(name, config.stage_filter) == nullptr) {
+    return;
+  }
+
+  run_once();
+
+  AllocCounter::reset();
+  uint64_t items = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < config.iterations; i++) {
+    items += run_once();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  StageResult result;
+  result.name = name;
+  result.unit = unit;
+  result.items = items;
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  result.ns_per_item = items > 0 ? result.seconds * 1e9 / items : 0;
+  result.allocations_per_item =
+      items > 0 ? (double)AllocCounter::get_allocations() / items : 0;
+  result.peak_heap_bytes = AllocCounter::get_peak_bytes();
+  results.push_back(result);
+}
+
+static bool LoadRecording(const char *path,
+                          std::vector<OriginString> &lines) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Unable to open %s\n", path);
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.length() > 0) {
+      lines.push_back({0, String(line.c_str())});
+    }
+  }
+  return true;
+}
+
+static void PrintResults() {
+  printf("%-20s %-7s %12s %10s %12s %14s\n", "stage", "unit", "items/s",
+         "ns/item", "allocs/item", "peak heap (B)");
+  for (auto &result : results) {
+    printf("%-20s %-7s %12.0f %10.1f %12.2f %14zu\n", result.name.c_str(),
+           result.unit, result.items / result.seconds, result.ns_per_item,
+           result.allocations_per_item, result.peak_heap_bytes);
+  }
+}
+
+static bool WriteBaseline(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Unable to write %s\n", path);
+    return false;
+  }
+  fprintf(file, "# stage ns/item allocs/item peak_heap_bytes\n");
+  for (auto &result : results) {
+    fprintf(file, "%s %.1f %.3f %zu\n", result.name.c_str(),
+            result.ns_per_item, result.allocations_per_item,
+            result.peak_heap_bytes);
+  }
+  fclose(file);
+  return true;
+}
+
+/**
+ * @brief Compare the results against a baseline.
+ *
+ * Time per item and peak heap may exceed the baseline by the configured
+ * tolerance. Allocation counts are deterministic and may not grow at all.
+ *
+ * @return true No regressions were found
+ */
+static bool CompareBaseline(const char *path) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Unable to open baseline %s\n", path);
+    return false;
+  }
+  std::map<std::string, BaselineEntry> baseline;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    char name[64];
+    BaselineEntry entry;
+    if (sscanf(line.c_str(), "%63s %lf %lf %zu", name, &entry.ns_per_item,
+               &entry.allocations_per_item, &entry.peak_heap_bytes) == 4) {
+      baseline[name] = entry;
+    }
+  }
+
+  double factor = 1 + config.tolerance_percent / 100;
+  bool ok = true;
+  printf("\nComparison against %s (tolerance %.0f%%):\n", path,
+         config.tolerance_percent);
+  for (auto &result : results) {
+    auto it = baseline.find(result.name.c_str());
+    if (it == baseline.end()) {
+      printf("%-20s not in baseline\n", result.name.c_str());
+      continue;
+    }
+    const BaselineEntry &entry = it->second;
+    bool time_ok = result.ns_per_item <= entry.ns_per_item * factor;
+    bool alloc_ok =
+        result.allocations_per_item <= entry.allocations_per_item + 0.005;
+    bool heap_ok = result.peak_heap_bytes <= entry.peak_heap_bytes * factor;
+    printf("%-20s %+6.1f%% time, %+.2f allocs/item, %+ld B peak heap%s\n",
+           result.name.c_str(),
+           100 * (result.ns_per_item / entry.ns_per_item - 1),
+           result.allocations_per_item - entry.allocations_per_item,
+           (long)result.peak_heap_bytes - (long)entry.peak_heap_bytes,
+           time_ok && alloc_ok && heap_ok ? "" : "  REGRESSION");
+    ok = ok && time_ok && alloc_ok && heap_ok;
+  }
+  return ok;
+}
+
+static void PrintUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -f FILE     YDWG RAW recording (default: "
+          "data/ydwg_recording_1.txt)\n"
+          "  -n COUNT    Measured passes over the recording (default: 10)\n"
+          "  -s STAGE    Only run stages whose name contains STAGE\n"
+          "  -b FILE     Compare the results against a baseline file\n"
+          "  -w FILE     Write the results as a baseline file\n"
+          "  -t PERCENT  Allowed time and peak heap increase (default: 20)\n",
+          program);
+}
+
+static bool ParseArguments(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "f:n:s:b:w:t:h")) != -1) {
+    switch (opt) {
+      case 'f':
+        config.recording = optarg;
+        break;
+      case 'n':
+        config.iterations = atoi(optarg);
+        break;
+      case 's':
+        config.stage_filter = optarg;
+        break;
+      case 'b':
+        config.baseline_file = optarg;
+        break;
+      case 'w':
+        config.write_baseline_file = optarg;
+        break;
+      case 't':
+        config.tolerance_percent = atof(optarg);
+        break;
+      default:
+        PrintUsage(argv[0]);
+        return false;
+    }
+  }
+  return config.iterations > 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (!ParseArguments(argc, argv)) {
+    return 1;
+  }
+
+  //////
+  // Prepare the inputs of each stage
+
+  std::vector<OriginString> lines;
+  if (!LoadRecording(config.recording, lines)) {
+    return 1;
+  }
+
+  std::vector<CANFrame> frames;
+  for (auto &line : lines) {
+    CANFrame frame;
+    struct timeval timestamp;
+    if (YDWGRawToCANFrame(frame, timestamp, line)) {
+      frames.push_back(frame);
+    }
+  }
+
+  tNMEA2000_Replay nmea2000(frames);
+  nmea2000.SetMode(tNMEA2000::N2km_ListenOnly);
+  nmea2000.EnableForward(false);
+  // the message handler is a plain function pointer
+  static std::vector<tN2kMsg> n2k_msgs;
+  nmea2000.SetMsgHandler(
+      [](const tN2kMsg &msg) { n2k_msgs.push_back(msg); });
+  nmea2000.Open();
+  auto reassemble = [&nmea2000]() {
+    nmea2000.rewind();
+    uint32_t start = millis();
+    while (!nmea2000.done() && millis() - start < 10000) {
+      nmea2000.ParseMessages();
+    }
+    return nmea2000.get_position();
+  };
+  reassemble();
+
+  std::vector<OriginString> ydwg_strings;
+  for (auto &frame : frames) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    ydwg_strings.push_back(CANFrameToYDWGRaw(frame, tv));
+  }
+
+  std::vector<OriginString> blocks;
+  uint64_t block_lines = 0;
+  OriginString block = {0, ""};
+  for (auto &line : lines) {
+    if (block.data.length() + line.data.length() + 2 > kBlockSize) {
+      blocks.push_back(block);
+      block.data = "";
+    }
+    block.data += line.data + "\r\n";
+    block_lines++;
+  }
+  blocks.push_back(block);
+
+  printf("%zu lines, %zu CAN frames, %zu NMEA 2000 messages, %d passes\n\n",
+         lines.size(), frames.size(), n2k_msgs.size(), config.iterations);
+
+  //////
+  // Sinks and pipeline objects, created before measurement
+
+  uint64_t sink_count = 0;
+  auto string_sink = new LambdaConsumer<OriginString>(
+      [&sink_count](OriginString str) { sink_count++; });
+
+  // the CAN frame sender of SetupConnections(), minus the transmission
+  auto send_can_frame = [&](CANFrame frame) {
+    if (frame.origin_id == origin_id(&nmea2000) ||
+        frame.origin_type == CANFrameOriginType::kRemoteApp) {
+      return;
+    }
+    if (frame.origin_type == CANFrameOriginType::kApp) {
+      frame.id = (frame.id & ~0xFF) | 0x0E;
+    }
+    nmea2000.CANSendFrame(frame.id, frame.len, frame.buf);
+  };
+  auto can_frame_sender = new LambdaConsumer<CANFrame>(send_can_frame);
+  auto can_frame_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
+      [](const CANFrame &frame) { return frame; });
+  can_frame_clearinghouse->connect_to(can_frame_sender);
+
+  auto can_to_ydwg_transform =
+      new LambdaTransform<CANFrame, OriginString>([](CANFrame frame) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return CANFrameToYDWGRaw(frame, tv);
+      });
+
+  //////
+  // Isolated stages
+
+  RunStage("parse", "lines", [&]() {
+    CANFrame frame;
+    struct timeval timestamp;
+    for (auto &line : lines) {
+      YDWGRawToCANFrame(frame, timestamp, line);
+    }
+    return lines.size();
+  });
+
+  RunStage("route", "frames", [&]() {
+    for (auto &frame : frames) {
+      can_frame_clearinghouse->set_input(frame);
+    }
+    return frames.size();
+  });
+
+  // every other frame as if from the own bus, the rest as network echoes
+  auto echo_filter = new EchoFilter(kEchoFilterCapacity, kEchoFilterWindowMs);
+  echo_filter->connect_to(can_frame_sender);
+  std::vector<CANFrame> echo_frames = frames;
+  for (size_t i = 0; i < echo_frames.size(); i++) {
+    echo_frames[i].origin_type = i % 2 == 0 ? CANFrameOriginType::kLocal
+                                            : CANFrameOriginType::kRemoteCAN;
+  }
+  RunStage("echo_filter", "frames", [&]() {
+    for (auto &frame : echo_frames) {
+      echo_filter->set_input(frame);
+    }
+    return echo_frames.size();
+  });
+
+  RunStage("ydwg_encode", "frames", [&]() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    for (auto &frame : frames) {
+      OriginString str = CANFrameToYDWGRaw(frame, tv);
+    }
+    return frames.size();
+  });
+
+  // the encoding work of the trip recorder, without the flash writes
+  static TripRecordingEncoder trip_encoder;
+  static uint8_t trip_buffer[4096];
+  RunStage("trip_encode", "frames", [&]() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t time_ms = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    size_t fill = trip_encoder.begin(time_ms, trip_buffer);
+    for (auto &frame : frames) {
+      if (fill + kMaxTripRecordSize > sizeof(trip_buffer)) {
+        fill = 0;
+      }
+      fill += trip_encoder.encode(frame, time_ms++, trip_buffer + fill);
+    }
+    return frames.size();
+  });
+
+  // packing frames into CAN bridge datagrams, without the sends
+  static CANBridgeDatagramWriter bridge_writer(1);
+  RunStage("bridge_encode", "frames", [&]() {
+    uint32_t time_ms = millis();
+    for (auto &frame : frames) {
+      if (!bridge_writer.add(frame, time_ms)) {
+        bridge_writer.finish();
+        bridge_writer.add(frame, time_ms);
+      }
+    }
+    bridge_writer.finish();
+    return frames.size();
+  });
+
+  // CAN frame routing and YDWG RAW output to a per-frame (TCP) and a
+  // batched (UDP) sink, wired dynamically as in SetupConnections()
+  auto dyn_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
+      [](const CANFrame &frame) { return frame; });
+  auto dyn_can_to_ydwg =
+      new LambdaTransform<CANFrame, OriginString>([](CANFrame frame) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return CANFrameToYDWGRaw(frame, tv);
+      });
+  auto dyn_concatenate = new ConcatenateStrings(100, kBlockSize);
+  dyn_clearinghouse->connect_to(can_frame_sender);
+  dyn_clearinghouse->connect_to(dyn_can_to_ydwg);
+  dyn_can_to_ydwg->connect_to(string_sink);
+  dyn_can_to_ydwg->connect_to(dyn_concatenate);
+  dyn_concatenate->connect_to(string_sink);
+  RunStage("route_ydwg", "frames", [&]() {
+    for (auto &frame : frames) {
+      dyn_clearinghouse->set_input(frame);
+    }
+    return frames.size();
+  });
+
+  // lazy YDWG RAW encoding in the router, for each combination of the
+  // YDWG RAW outputs in SetupConnections(): TCP server with clients (S),
+  // TCP client (C) and UDP (U); a route to a disabled output takes nothing
+  bool lazy_tcp_server = false;
+  bool lazy_tcp_client = false;
+  bool lazy_udp = false;
+  auto lazy_router = new Router(
+      [&nmea2000](uint32_t pgn) { return nmea2000.IsFastPacketPGN(pgn); });
+  auto lazy_concatenate = new ConcatenateStrings(100, kBlockSize);
+  lazy_concatenate->connect_to(string_sink);
+  lazy_router->set_sink(RouteEndpoint::kYDWGRawTCP, string_sink,
+                        [&lazy_tcp_server]() { return lazy_tcp_server; });
+  lazy_router->set_sink(RouteEndpoint::kYDWGRawClient, string_sink,
+                        [&lazy_tcp_client]() { return lazy_tcp_client; });
+  lazy_router->set_sink(RouteEndpoint::kYDWGRawUDP, lazy_concatenate,
+                        [&lazy_udp]() { return lazy_udp; });
+  std::vector<Route> lazy_routes;
+  String lazy_routes_error;
+  ParseRoutingTable(
+      "can > ydwg > ydwg-tcp; can > ydwg > ydwg-client; can > ydwg > ydwg-udp",
+      lazy_routes, lazy_routes_error);
+  lazy_router->set_routes(lazy_routes);
+  auto lazy_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
+      [](const CANFrame &frame) { return frame; });
+  lazy_clearinghouse->connect_to(can_frame_sender);
+  lazy_clearinghouse->connect_to(lazy_router->get_frame_input());
+  for (int outputs = 0; outputs < 8; outputs++) {
+    lazy_tcp_server = outputs & 1;
+    lazy_tcp_client = outputs & 2;
+    lazy_udp = outputs & 4;
+    String name = String("lazy_ydwg_") + (lazy_tcp_server ? "S" : "-") +
+                  (lazy_tcp_client ? "C" : "-") + (lazy_udp ? "U" : "-");
+    RunStage(name.c_str(), "frames", [&]() {
+      for (auto &frame : frames) {
+        lazy_clearinghouse->set_input(frame);
+      }
+      return frames.size();
+    });
+  }
+
+  // YDWG RAW output through the router as in SetupConnections(), to a
+  // per-frame (TCP) and a batched (UDP) sink, and to a filtered route
+  auto ydwg_router = new Router(
+      [&nmea2000](uint32_t pgn) { return nmea2000.IsFastPacketPGN(pgn); });
+  auto router_concatenate = new ConcatenateStrings(100, kBlockSize);
+  router_concatenate->connect_to(string_sink);
+  ydwg_router->set_sink(RouteEndpoint::kYDWGRawTCP, string_sink);
+  ydwg_router->set_sink(RouteEndpoint::kYDWGRawUDP, router_concatenate);
+  ydwg_router->set_sink(RouteEndpoint::kYDWGRawClient, string_sink);
+  auto router_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
+      [](const CANFrame &frame) { return frame; });
+  router_clearinghouse->connect_to(can_frame_sender);
+  router_clearinghouse->connect_to(ydwg_router->get_frame_input());
+  const char *router_tables[][2] = {
+      {"router_ydwg", "can > ydwg > ydwg-tcp; can > ydwg > ydwg-udp"},
+      {"router_ydwg_filtered",
+       "can > ydwg > ydwg-client [129025 129026 127250/100]"},
+  };
+  for (auto &table : router_tables) {
+    std::vector<Route> routes;
+    String error;
+    ParseRoutingTable(table[1], routes, error);
+    ydwg_router->set_routes(routes);
+    RunStage(table[0], "frames", [&]() {
+      for (auto &frame : frames) {
+        router_clearinghouse->set_input(frame);
+      }
+      return frames.size();
+    });
+  }
+
+  // the same graph wired at compile time
+  auto count_string = [&sink_count](const char *data, size_t len,
+                                    uint32_t origin_id) { sink_count++; };
+  auto static_pipeline = NewStaticCANPipeline(MakeFanout(
+      MakeFunctionSink(send_can_frame),
+      MakeYDWGRawEncoder(MakeFanout(
+          MakeFunctionSink(count_string),
+          MakeStringBatcher(MakeFunctionSink(count_string), kBlockSize,
+                            100)))));
+  RunStage("static_route_ydwg", "frames", [&]() {
+    for (auto &frame : frames) {
+      static_pipeline->set_input(frame);
+    }
+    return frames.size();
+  });
+
+  nmea2000.SetMsgHandler([](const tN2kMsg &msg) {});
+  RunStage("n2k_reassemble", "frames", reassemble);
+
+  static char seasmart_buf[kMaxNMEA2000MessageSeasmartSize + 3];
+  RunStage("seasmart", "msgs", [&]() {
+    for (auto &msg : n2k_msgs) {
+      AppendSeaSmartString(msg, seasmart_buf, sizeof(seasmart_buf));
+    }
+    return n2k_msgs.size();
+  });
+
+  // SeaSmart.Net sentences batched by the router, as for the UDP output
+  auto seasmart_router = new Router(
+      [&nmea2000](uint32_t pgn) { return nmea2000.IsFastPacketPGN(pgn); });
+  seasmart_router->set_seasmart_encoder(AppendSeaSmartString);
+  seasmart_router->set_sink(RouteEndpoint::kNMEA0183UDP, string_sink);
+  std::vector<Route> seasmart_routes;
+  String seasmart_routes_error;
+  ParseRoutingTable("can > seasmart > 0183-udp", seasmart_routes,
+                    seasmart_routes_error);
+  seasmart_router->set_routes(seasmart_routes);
+  RunStage("seasmart_batched", "msgs", [&]() {
+    for (auto &msg : n2k_msgs) {
+      seasmart_router->get_message_input()->set_input(msg);
+    }
+    return n2k_msgs.size();
+  });
+
+  auto n2k_to_0183 = new N2KTo0183Transform(&nmea2000);
+  n2k_to_0183->connect_to(string_sink);
+  RunStage("nmea0183", "msgs", [&]() {
+    for (auto &msg : n2k_msgs) {
+      n2k_to_0183->set_input(msg);
+    }
+    return n2k_msgs.size();
+  });
+
+  // NMEA 0183 and batched SeaSmart.Net output through the router
+  auto message_router = new Router(
+      [&nmea2000](uint32_t pgn) { return nmea2000.IsFastPacketPGN(pgn); });
+  message_router->set_nmea0183_encoder(new N2KTo0183Transform(&nmea2000));
+  message_router->set_seasmart_encoder(AppendSeaSmartString);
+  message_router->set_sink(RouteEndpoint::kNMEA0183TCP, string_sink);
+  message_router->set_sink(RouteEndpoint::kNMEA0183UDP, string_sink);
+  std::vector<Route> message_routes;
+  String message_routes_error;
+  ParseRoutingTable("can > 0183 > 0183-tcp; can > seasmart > 0183-udp",
+                    message_routes, message_routes_error);
+  message_router->set_routes(message_routes);
+  RunStage("router_messages", "msgs", [&]() {
+    for (auto &msg : n2k_msgs) {
+      message_router->get_message_input()->set_input(msg);
+    }
+    return n2k_msgs.size();
+  });
+
+  auto concatenate = new ConcatenateStrings(100, kBlockSize);
+  concatenate->connect_to(string_sink);
+  RunStage("concatenate", "strings", [&]() {
+    for (auto &str : ydwg_strings) {
+      concatenate->set_input(str, 0);
+    }
+    return ydwg_strings.size();
+  });
+
+  auto tokenizer = new StringTokenizer("\r\n");
+  tokenizer->connect_to(string_sink);
+  RunStage("tokenize", "lines", [&]() {
+    for (auto &block : blocks) {
+      tokenizer->set_input(block, 0);
+    }
+    return block_lines;
+  });
+
+  //////
+  // End-to-end pipelines
+
+  // YDWG RAW received from the network, transmitted to the bus and echoed
+  // back to the network
+  auto net_tokenizer = new StringTokenizer("\r\n");
+  auto net_ydwg_to_can = new YDWGRawToCANFrameTransform();
+  auto net_concatenate = new ConcatenateStrings(100, kBlockSize);
+  net_tokenizer->connect_to(net_ydwg_to_can);
+  net_ydwg_to_can->connect_to(can_frame_clearinghouse);
+  can_frame_clearinghouse->connect_to(can_to_ydwg_transform);
+  can_to_ydwg_transform->connect_to(net_concatenate);
+  net_concatenate->connect_to(string_sink);
+  RunStage("e2e_network_rx", "lines", [&]() {
+    for (auto &block : blocks) {
+      net_tokenizer->set_input(block, 0);
+    }
+    return block_lines;
+  });
+
+  // CAN frames received from the bus, output as YDWG RAW, NMEA 0183 and
+  // SeaSmart.Net; the messages are routed as in SetupConnections()
+  auto n0183_concatenate = new ConcatenateStrings(100, kBlockSize);
+  n0183_concatenate->connect_to(string_sink);
+  auto e2e_router = new Router(
+      [&nmea2000](uint32_t pgn) { return nmea2000.IsFastPacketPGN(pgn); });
+  e2e_router->set_nmea0183_encoder(new N2KTo0183Transform(&nmea2000));
+  e2e_router->set_seasmart_encoder(AppendSeaSmartString);
+  e2e_router->set_sink(RouteEndpoint::kNMEA0183UDP, n0183_concatenate);
+  std::vector<Route> e2e_routes;
+  String e2e_routes_error;
+  ParseRoutingTable("can > 0183 > 0183-udp; can > seasmart > 0183-udp",
+                    e2e_routes, e2e_routes_error);
+  e2e_router->set_routes(e2e_routes);
+  static ObservableValue<tN2kMsg> n2k_msg_input;
+  static ObservableValue<CANFrame> can_frame_input;
+  n2k_msg_input.connect_to(e2e_router->get_message_input());
+  can_frame_input.connect_to(can_frame_clearinghouse);
+  static uint32_t nmea2000_origin_id = origin_id(&nmea2000);
+  nmea2000.set_frame_callback([](const CANFrame &received) {
+    CANFrame frame = received;
+    frame.origin_type = CANFrameOriginType::kLocal;
+    frame.origin_id = nmea2000_origin_id;
+    can_frame_input.set(frame);
+  });
+  nmea2000.SetMsgHandler(
+      [](const tN2kMsg &n2k_msg) { n2k_msg_input.set(n2k_msg); });
+  RunStage("e2e_can_rx", "frames", reassemble);
+
+  PrintResults();
+
+  if (config.write_baseline_file != nullptr &&
+      !WriteBaseline(config.write_baseline_file)) {
+    return 1;
+  }
+  if (config.baseline_file != nullptr &&
+      !CompareBaseline(config.baseline_file)) {
+    return 2;
+  }
+  return 0;
+}
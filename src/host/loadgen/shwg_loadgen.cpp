@@ -0,0 +1,749 @@
+// Traffic generator and latency probe for the gateway.
+//
+// Sends synthesized or recorded CAN frames to a gateway at a fixed rate,
+// either as YDWG RAW application messages over TCP or UDP, or as raw frames
+// on a SocketCAN interface. The YDWG RAW output of the gateway is monitored
+// for the echoed frames to measure the round-trip latency and loss.
+//
+// Examples, against the host-native build:
+//
+//   # YDWG RAW over TCP at 2000 frames/s for 10 s
+//   shwg_loadgen -t tcp -R 2000
+//   # CAN frames on vcan0, sweeping from 1000 to 10000 frames/s
+//   shwg_loadgen -t can -i vcan0 -s 1000:10000:1000
+//   # replay a recording at 5x speed
+//   shwg_loadgen -t tcp -f data/ydwg_recording_1.txt -x 5
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <linux/can.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class Transport { kTCP, kUDP, kCAN };
+
+struct Frame {
+  uint32_t id;
+  uint8_t len;
+  uint8_t buf[8];
+  int64_t offset_ns;  //< Send time relative to the start of a replay
+};
+
+struct PGNWeight {
+  uint32_t pgn;
+  int weight;
+};
+
+struct LoadgenConfig {
+  Transport tx_transport = Transport::kTCP;
+  Transport rx_transport = Transport::kTCP;
+  const char* host = "127.0.0.1";
+  int tcp_port = 2223;
+  int udp_port = 2002;
+  const char* can_interface = "vcan0";
+  double rate = 1000;
+  double duration_s = 10;
+  double drain_s = 1;
+  const char* recording = nullptr;
+  double speed = 1;
+  double sweep_start = 0;
+  double sweep_stop = 0;
+  double sweep_step = 0;
+  // a typical mix of navigation data, weighted by relative frequency
+  std::vector<PGNWeight> pgn_mix = {
+      {127250, 10},  // Heading
+      {127257, 10},  // Attitude
+      {128259, 1},   // Boat speed
+      {128267, 1},   // Depth
+      {129025, 10},  // Position, rapid update
+      {129026, 4},   // COG and SOG, rapid update
+      {130306, 4},   // Wind
+  };
+};
+
+LoadgenConfig config;
+
+struct RunResult {
+  double offered_rate;
+  uint64_t sent;
+  uint64_t received;
+  double tx_seconds;
+  std::vector<int64_t> latencies_ns;
+};
+
+static int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief Send times of frames in flight, keyed by frame contents.
+ */
+class InFlightTable {
+ public:
+  void add(const std::string& key, int64_t time_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    table_[key].push_back(time_ns);
+  }
+
+  /**
+   * @brief Remove the oldest matching entry and return its send time, or -1.
+   */
+  int64_t match(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = table_.find(key);
+    if (it == table_.end()) {
+      return -1;
+    }
+    int64_t time_ns = it->second.front();
+    it->second.pop_front();
+    if (it->second.empty()) {
+      table_.erase(it);
+    }
+    return time_ns;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    table_.clear();
+  }
+
+ protected:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::deque<int64_t>> table_;
+};
+
+static std::string FrameKey(uint32_t id, uint8_t len, const uint8_t* buf) {
+  char key[32];
+  int pos = snprintf(key, sizeof(key), "%08X", id);
+  for (int i = 0; i < len; i++) {
+    pos += snprintf(key + pos, sizeof(key) - pos, "%02X", buf[i]);
+  }
+  return std::string(key, pos);
+}
+
+/**
+ * @brief Parse a YDWG RAW device message ("hh:mm:ss.mmm D ID data...").
+ *
+ * Application messages without a timestamp are rejected: on UDP, those are
+ * our own broadcasts.
+ */
+static bool ParseEchoedLine(const char* line, std::string& key) {
+  unsigned int h, m;
+  float s;
+  char direction;
+  int pos = 0;
+  if (sscanf(line, "%u:%u:%f %c %n", &h, &m, &s, &direction, &pos) != 4 ||
+      pos == 0) {
+    return false;
+  }
+  uint32_t id;
+  int n;
+  if (sscanf(line + pos, "%x%n", &id, &n) != 1) {
+    return false;
+  }
+  pos += n;
+  uint8_t buf[8];
+  uint8_t len = 0;
+  unsigned int byte;
+  while (len < 8 && sscanf(line + pos, "%x%n", &byte, &n) == 1) {
+    buf[len++] = byte;
+    pos += n;
+  }
+  key = FrameKey(id, len, buf);
+  return true;
+}
+
+static int FormatAppMessage(const Frame& frame, char* out, size_t size) {
+  int pos = snprintf(out, size, "%08X", frame.id);
+  for (int i = 0; i < frame.len; i++) {
+    pos += snprintf(out + pos, size - pos, " %02X", frame.buf[i]);
+  }
+  pos += snprintf(out + pos, size - pos, "\r\n");
+  return pos;
+}
+
+//////
+// Frame sources
+
+/**
+ * @brief Synthesize frames for the configured PGN mix. The first four data
+ * bytes hold a sequence number to make every frame unique.
+ */
+class SyntheticSource {
+ public:
+  SyntheticSource(const std::vector<PGNWeight>& mix) {
+    for (auto& entry : mix) {
+      for (int i = 0; i < entry.weight; i++) {
+        schedule_.push_back(entry.pgn);
+      }
+    }
+  }
+
+  Frame next() {
+    uint32_t pgn = schedule_[sequence_ % schedule_.size()];
+    if (((pgn >> 8) & 0xFF) < 240) {
+      // PDU1: broadcast to all devices
+      pgn = (pgn & 0x3FF00) | 0xFF;
+    }
+    Frame frame;
+    frame.id = (2 << 26) | (pgn << 8) | kSourceAddress;
+    frame.len = 8;
+    memcpy(frame.buf, &sequence_, 4);
+    memset(frame.buf + 4, 0xFF, 4);
+    sequence_++;
+    return frame;
+  }
+
+ protected:
+  static constexpr uint8_t kSourceAddress = 0x42;
+  std::vector<uint32_t> schedule_;
+  uint32_t sequence_ = 0;
+};
+
+static bool LoadRecording(const char* path, std::vector<Frame>& frames) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Unable to open %s\n", path);
+    return false;
+  }
+  std::string line;
+  int64_t first_ms = -1;
+  while (std::getline(file, line)) {
+    unsigned int h, m;
+    float s;
+    char direction;
+    int pos = 0;
+    if (sscanf(line.c_str(), "%u:%u:%f %c %n", &h, &m, &s, &direction,
+               &pos) != 4) {
+      continue;
+    }
+    Frame frame;
+    int n;
+    if (sscanf(line.c_str() + pos, "%x%n", &frame.id, &n) != 1) {
+      continue;
+    }
+    pos += n;
+    unsigned int byte;
+    frame.len = 0;
+    while (frame.len < 8 &&
+           sscanf(line.c_str() + pos, "%x%n", &byte, &n) == 1) {
+      frame.buf[frame.len++] = byte;
+      pos += n;
+    }
+    int64_t ms = (h * 3600 + m * 60) * 1000 + (int64_t)(s * 1000);
+    if (first_ms < 0) {
+      first_ms = ms;
+    }
+    if (ms < first_ms) {
+      // midnight rollover
+      ms += 24 * 3600 * 1000;
+    }
+    frame.offset_ns = (ms - first_ms) * 1000000;
+    frames.push_back(frame);
+  }
+  return !frames.empty();
+}
+
+//////
+// Transports
+
+static int ConnectTCP(const char* host, int port) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result;
+  char port_str[8];
+  snprintf(port_str, sizeof(port_str), "%d", port);
+  if (getaddrinfo(host, port_str, &hints, &result) != 0) {
+    fprintf(stderr, "Unable to resolve %s\n", host);
+    return -1;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+    fprintf(stderr, "Unable to connect to %s:%d: %s\n", host, port,
+            strerror(errno));
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+  if (fd >= 0) {
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+  return fd;
+}
+
+static int OpenUDP(int port, struct sockaddr_in& destination) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int flag = 1;
+  // the gateway may be bound to the same port on this host
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &flag, sizeof(flag));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "Unable to bind UDP port %d: %s\n", port,
+            strerror(errno));
+    close(fd);
+    return -1;
+  }
+  destination = {};
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(port);
+  inet_pton(AF_INET, config.host, &destination.sin_addr);
+  return fd;
+}
+
+static int OpenCAN(const char* interface) {
+  int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (fd < 0) {
+    fprintf(stderr, "Unable to create a CAN socket: %s\n", strerror(errno));
+    return -1;
+  }
+  struct ifreq ifr = {};
+  strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+  struct sockaddr_can addr = {};
+  addr.can_family = AF_CAN;
+  if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0 ||
+      (addr.can_ifindex = ifr.ifr_ifindex,
+       bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)) {
+    fprintf(stderr, "Unable to open CAN interface %s\n", interface);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Sender for the configured TX transport.
+ */
+class FrameSender {
+ public:
+  bool open(int tcp_fd, int udp_fd, const struct sockaddr_in& udp_dest) {
+    tcp_fd_ = tcp_fd;
+    udp_fd_ = udp_fd;
+    udp_dest_ = udp_dest;
+    if (config.tx_transport == Transport::kCAN) {
+      can_fd_ = OpenCAN(config.can_interface);
+      return can_fd_ >= 0;
+    }
+    return true;
+  }
+
+  bool send(const Frame& frame) {
+    char line[64];
+    int len;
+    switch (config.tx_transport) {
+      case Transport::kTCP:
+        len = FormatAppMessage(frame, line, sizeof(line));
+        return write_all(tcp_fd_, line, len);
+      case Transport::kUDP:
+        len = FormatAppMessage(frame, line, sizeof(line));
+        return sendto(udp_fd_, line, len, 0, (struct sockaddr*)&udp_dest_,
+                      sizeof(udp_dest_)) == len;
+      case Transport::kCAN: {
+        struct can_frame can_frame = {};
+        can_frame.can_id = frame.id | CAN_EFF_FLAG;
+        can_frame.can_dlc = frame.len;
+        memcpy(can_frame.data, frame.buf, frame.len);
+        while (write(can_fd_, &can_frame, sizeof(can_frame)) < 0) {
+          if (errno != ENOBUFS) {
+            return false;
+          }
+          // TX queue full; back off briefly
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+ protected:
+  int tcp_fd_ = -1;
+  int udp_fd_ = -1;
+  int can_fd_ = -1;
+  struct sockaddr_in udp_dest_;
+
+  static bool write_all(int fd, const char* buf, int len) {
+    while (len > 0) {
+      ssize_t written = write(fd, buf, len);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      buf += written;
+      len -= written;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Read echoed YDWG RAW lines and match them against sent frames.
+ */
+static void ReceiveLoop(int fd, bool is_udp, InFlightTable& in_flight,
+                        std::atomic<bool>& running, std::mutex& result_mutex,
+                        RunResult*& result) {
+  char buf[4096];
+  std::string pending;
+  while (running) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 50) <= 0) {
+      continue;
+    }
+    ssize_t len = recv(fd, buf, sizeof(buf), 0);
+    if (len <= 0) {
+      if (!is_udp) {
+        fprintf(stderr, "Connection closed by the gateway\n");
+        return;
+      }
+      continue;
+    }
+    int64_t now = NowNs();
+    pending.append(buf, len);
+    size_t start = 0;
+    size_t end;
+    while ((end = pending.find('\n', start)) != std::string::npos) {
+      pending[end] = '\0';
+      std::string key;
+      if (ParseEchoedLine(pending.c_str() + start, key)) {
+        int64_t sent = in_flight.match(key);
+        if (sent >= 0) {
+          std::lock_guard<std::mutex> lock(result_mutex);
+          if (result != nullptr) {
+            result->received++;
+            result->latencies_ns.push_back(now - sent);
+          }
+        }
+      }
+      start = end + 1;
+    }
+    pending.erase(0, start);
+  }
+}
+
+/**
+ * @brief Send frames for one measurement period.
+ *
+ * Synthetic frames are sent at the given rate. Recorded frames are sent at
+ * their recorded times, scaled by the speed factor.
+ */
+static void SendLoop(FrameSender& sender, InFlightTable& in_flight,
+                     double rate, const std::vector<Frame>* recording,
+                     RunResult& result) {
+  SyntheticSource synthetic(config.pgn_mix);
+  int64_t start = NowNs();
+  int64_t end = start + (int64_t)(config.duration_s * 1e9);
+  size_t replay_pos = 0;
+  while (true) {
+    int64_t now = NowNs();
+    if (now >= end) {
+      break;
+    }
+    // send all frames that are due, then sleep until the next one
+    int64_t next_due;
+    while (true) {
+      Frame frame;
+      if (recording != nullptr) {
+        if (replay_pos >= recording->size()) {
+          // loop the recording
+          replay_pos = 0;
+          start = now;
+        }
+        frame = (*recording)[replay_pos];
+        next_due = start + (int64_t)(frame.offset_ns / config.speed);
+      } else {
+        next_due = start + (int64_t)(result.sent * 1e9 / rate);
+      }
+      if (next_due > now) {
+        break;
+      }
+      if (recording == nullptr) {
+        frame = synthetic.next();
+      } else {
+        replay_pos++;
+      }
+      in_flight.add(FrameKey(frame.id, frame.len, frame.buf), NowNs());
+      if (!sender.send(frame)) {
+        fprintf(stderr, "Send failed: %s\n", strerror(errno));
+        result.tx_seconds = (NowNs() - start) / 1e9;
+        return;
+      }
+      result.sent++;
+    }
+    int64_t sleep_ns = std::min<int64_t>(next_due, end) - NowNs();
+    if (sleep_ns > 50000) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns - 20000));
+    }
+  }
+  result.tx_seconds = config.duration_s;
+}
+
+static int64_t Percentile(std::vector<int64_t>& values, double percentile) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t index = (size_t)(percentile / 100 * (values.size() - 1));
+  return values[index];
+}
+
+static void PrintHeader() {
+  printf("%10s %10s %10s %8s %10s %10s %10s %10s\n", "offered/s", "sent/s",
+         "echoed/s", "loss%", "p50 us", "p99 us", "p99.9 us", "max us");
+}
+
+static void PrintResult(RunResult& result) {
+  std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+  double loss = result.sent > 0
+                    ? 100.0 * (result.sent - result.received) / result.sent
+                    : 0;
+  printf("%10.0f %10.0f %10.0f %8.2f %10.1f %10.1f %10.1f %10.1f\n",
+         result.offered_rate, result.sent / result.tx_seconds,
+         result.received / result.tx_seconds, loss,
+         Percentile(result.latencies_ns, 50) / 1e3,
+         Percentile(result.latencies_ns, 99) / 1e3,
+         Percentile(result.latencies_ns, 99.9) / 1e3,
+         result.latencies_ns.empty() ? 0 : result.latencies_ns.back() / 1e3);
+  fflush(stdout);
+}
+
+//////
+// Command line
+
+static bool ParseTransport(const char* str, Transport& transport) {
+  if (strcmp(str, "tcp") == 0) {
+    transport = Transport::kTCP;
+  } else if (strcmp(str, "udp") == 0) {
+    transport = Transport::kUDP;
+  } else if (strcmp(str, "can") == 0) {
+    transport = Transport::kCAN;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool ParsePGNMix(const char* str, std::vector<PGNWeight>& mix) {
+  mix.clear();
+  std::string spec = str;
+  size_t start = 0;
+  while (start < spec.length()) {
+    size_t end = spec.find(',', start);
+    if (end == std::string::npos) {
+      end = spec.length();
+    }
+    PGNWeight entry = {0, 1};
+    if (sscanf(spec.substr(start, end - start).c_str(), "%u:%d", &entry.pgn,
+               &entry.weight) < 1 ||
+        entry.weight < 1) {
+      return false;
+    }
+    mix.push_back(entry);
+    start = end + 1;
+  }
+  return !mix.empty();
+}
+
+static void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -t tcp|udp|can  Transmit transport (default: tcp)\n"
+          "  -e tcp|udp      Echo receive transport (default: tcp, or udp if\n"
+          "                  transmitting over udp)\n"
+          "  -H HOST         Gateway address or UDP broadcast address\n"
+          "                  (default: 127.0.0.1)\n"
+          "  -p PORT         YDWG RAW TCP port (default: 2223)\n"
+          "  -u PORT         YDWG RAW UDP port (default: 2002)\n"
+          "  -i IFACE        SocketCAN interface for -t can (default: vcan0)\n"
+          "  -R RATE         Frames per second (default: 1000)\n"
+          "  -d SECONDS      Duration of each run (default: 10)\n"
+          "  -w SECONDS      Time to wait for echoes after a run "
+          "(default: 1)\n"
+          "  -m PGN:W,...    PGN mix with relative weights\n"
+          "  -f FILE         Replay a YDWG RAW recording instead\n"
+          "  -x SPEED        Replay speed factor (default: 1)\n"
+          "  -s A:B:STEP     Sweep the rate from A to B frames per second\n",
+          program);
+}
+
+static bool ParseArguments(int argc, char* argv[]) {
+  int opt;
+  bool rx_transport_set = false;
+  while ((opt = getopt(argc, argv, "t:e:H:p:u:i:R:d:w:m:f:x:s:h")) != -1) {
+    switch (opt) {
+      case 't':
+        if (!ParseTransport(optarg, config.tx_transport)) {
+          return false;
+        }
+        break;
+      case 'e':
+        if (!ParseTransport(optarg, config.rx_transport) ||
+            config.rx_transport == Transport::kCAN) {
+          return false;
+        }
+        rx_transport_set = true;
+        break;
+      case 'H':
+        config.host = optarg;
+        break;
+      case 'p':
+        config.tcp_port = atoi(optarg);
+        break;
+      case 'u':
+        config.udp_port = atoi(optarg);
+        break;
+      case 'i':
+        config.can_interface = optarg;
+        break;
+      case 'R':
+        config.rate = atof(optarg);
+        break;
+      case 'd':
+        config.duration_s = atof(optarg);
+        break;
+      case 'w':
+        config.drain_s = atof(optarg);
+        break;
+      case 'm':
+        if (!ParsePGNMix(optarg, config.pgn_mix)) {
+          fprintf(stderr, "Invalid PGN mix: %s\n", optarg);
+          return false;
+        }
+        break;
+      case 'f':
+        config.recording = optarg;
+        break;
+      case 'x':
+        config.speed = atof(optarg);
+        break;
+      case 's':
+        if (sscanf(optarg, "%lf:%lf:%lf", &config.sweep_start,
+                   &config.sweep_stop, &config.sweep_step) != 3 ||
+            config.sweep_step <= 0) {
+          fprintf(stderr, "Invalid sweep: %s\n", optarg);
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  if (!rx_transport_set && config.tx_transport == Transport::kUDP) {
+    config.rx_transport = Transport::kUDP;
+  }
+  return config.rate > 0 && config.speed > 0 && config.duration_s > 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (!ParseArguments(argc, argv)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<Frame> recording;
+  if (config.recording != nullptr &&
+      !LoadRecording(config.recording, recording)) {
+    return 1;
+  }
+
+  int tcp_fd = -1;
+  if (config.tx_transport == Transport::kTCP ||
+      config.rx_transport == Transport::kTCP) {
+    tcp_fd = ConnectTCP(config.host, config.tcp_port);
+    if (tcp_fd < 0) {
+      return 1;
+    }
+  }
+  int udp_fd = -1;
+  struct sockaddr_in udp_dest = {};
+  if (config.tx_transport == Transport::kUDP ||
+      config.rx_transport == Transport::kUDP) {
+    udp_fd = OpenUDP(config.udp_port, udp_dest);
+    if (udp_fd < 0) {
+      return 1;
+    }
+  }
+
+  FrameSender sender;
+  if (!sender.open(tcp_fd, udp_fd, udp_dest)) {
+    return 1;
+  }
+
+  InFlightTable in_flight;
+  std::atomic<bool> running{true};
+  std::mutex result_mutex;
+  RunResult* current_result = nullptr;
+  bool rx_udp = config.rx_transport == Transport::kUDP;
+  std::thread receiver(ReceiveLoop, rx_udp ? udp_fd : tcp_fd, rx_udp,
+                       std::ref(in_flight), std::ref(running),
+                       std::ref(result_mutex), std::ref(current_result));
+
+  std::vector<double> rates;
+  if (config.sweep_step > 0 && config.recording == nullptr) {
+    for (double rate = config.sweep_start; rate <= config.sweep_stop;
+         rate += config.sweep_step) {
+      rates.push_back(rate);
+    }
+  } else {
+    rates.push_back(config.recording != nullptr ? 0 : config.rate);
+  }
+
+  PrintHeader();
+  for (double rate : rates) {
+    RunResult result = {};
+    result.offered_rate = rate;
+    in_flight.clear();
+    {
+      std::lock_guard<std::mutex> lock(result_mutex);
+      current_result = &result;
+    }
+    SendLoop(sender, in_flight, rate,
+             config.recording != nullptr ? &recording : nullptr, result);
+    if (rate == 0) {
+      result.offered_rate = result.sent / result.tx_seconds;
+    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds((int)(config.drain_s * 1000)));
+    {
+      std::lock_guard<std::mutex> lock(result_mutex);
+      current_result = nullptr;
+    }
+    PrintResult(result);
+  }
+
+  running = false;
+  receiver.join();
+  return 0;
+}
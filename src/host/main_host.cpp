@@ -0,0 +1,511 @@
+// Host-native entry point for the gateway core.
+//
+// Runs the hardware-independent gateway pipeline as a Linux executable,
+// with a SocketCAN interface in place of the ESP32 CAN controller and POSIX
+// sockets in place of the WiFi stack. Intended for profiling and load
+// testing on a workstation:
+//
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+//   .pio/build/native/program -i vcan0
+//
+// Two instances on different CAN interfaces can be linked with the binary
+// CAN bridge over loopback:
+//
+//   .pio/build/native/program -i vcan0 -B 127.0.0.1:2013 -L 2012
+//   .pio/build/native/program -i vcan1 -B 127.0.0.1:2012 -L 2013 -t 2323 \
+//       -u 2102 -T 2322 -U 2100
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include <random>
+#include <vector>
+
+#include "AsyncUDP.h"
+#include "N2kMessages.h"
+#include "NMEA2000_socketcan_framehandler.h"
+#include "can_bridge.h"
+#include "can_frame.h"
+#include "concatenate_strings.h"
+#include "config.h"
+#include "deferred_log.h"
+#include "n2k_nmea0183_transform.h"
+#include "nmea0183_n2k_transform.h"
+#include "origin_string.h"
+#include "router.h"
+#include "routing_table.h"
+#include "seasmart_transform.h"
+#include "sensesp/net/networking.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/transforms/lambda_transform.h"
+#include "shwg.h"
+#include "streaming_tcp_client.h"
+#include "streaming_tcp_server.h"
+#include "streaming_udp_server.h"
+#include "stringtokenizer_transform.h"
+#include "ydwg_raw_output.h"
+#include "ydwg_raw_parser.h"
+
+using namespace sensesp;
+
+const unsigned long kTransmitMessages[] = {
+    127250L,   // Heading
+    128267UL,  // Depth
+    129025UL,  // Position
+    129026L,   // COG and SOG
+    129029L,   // GNSS
+    130306L,   // Wind
+    0};
+
+/**
+ * @brief Gateway settings. The defaults match the firmware defaults.
+ */
+struct HostConfig {
+  const char* can_interface = "vcan0";
+  uint16_t ydwg_raw_tcp_port = kDefaultYdwgRawTCPServerPort;
+  uint16_t ydwg_raw_udp_port = kDefaultYdwgRawUDPServerPort;
+  uint16_t nmea0183_tcp_port = kDefaultNMEA0183TCPServerPort;
+  uint16_t nmea0183_udp_port = kDefaultNMEA0183UDPServerPort;
+  bool ydwg_raw_rx = false;        //< Receive YDWG RAW from the network
+  bool ydwg_raw_tcp_conflation = false;
+  uint32_t tcp_session_idle_timeout_ms = kDefaultTCPSessionIdleTimeoutS * 1000;
+  String ydwg_raw_udp_multicast_group = "";
+  String ydwg_raw_udp_peers = "";  //< Unicast instead of broadcast if set
+  bool translate_to_nmea0183 = true;
+  bool translate_to_seasmart = false;
+  bool translate_from_nmea0183 = false;
+  uint32_t ais_static_data_replay_period_ms = 60000;
+  String ydwg_raw_tcp_client_host = "";  //< Empty disables the client
+  uint16_t ydwg_raw_tcp_client_port = kDefaultYdwgRawTCPServerPort;
+  String can_bridge_address = "";  //< Empty disables the CAN bridge
+  uint16_t can_bridge_port = kDefaultCANBridgePort;
+  uint16_t can_bridge_local_port = 0;  //< 0 uses the peer port
+  uint32_t can_bridge_batching_ms = 10;
+  String routing_table = "";  //< Empty derives the routes from the options
+};
+
+HostConfig config;
+
+tNMEA2000_SocketCAN_FH *nmea2000;
+
+reactesp::ReactESP app;
+
+SensESPMinimalApp *sensesp_app = nullptr;
+
+Networking *networking;
+
+ObservableValue<tN2kMsg> n2k_msg_input;
+ObservableValue<CANFrame> can_frame_input;
+
+LambdaTransform<CANFrame, CANFrame> *can_frame_clearinghouse;
+LambdaConsumer<CANFrame> *can_frame_sender;
+
+CANBridge *can_bridge = nullptr;
+
+uint32_t can_frame_rx_counter = 0;
+uint32_t can_frame_tx_counter = 0;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void HandleSignal(int signal) { stop_requested = 1; }
+
+static void PrintUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -i IFACE      SocketCAN interface (default: vcan0)\n"
+          "  -t PORT       YDWG RAW TCP server port (default: %u)\n"
+          "  -u PORT       YDWG RAW UDP port (default: %u)\n"
+          "  -T PORT       NMEA 0183 TCP server port (default: %u)\n"
+          "  -U PORT       NMEA 0183 UDP port (default: %u)\n"
+          "  -b ADDRESS    UDP broadcast address (default: 255.255.255.255)\n"
+          "  -m GROUP      Send YDWG RAW UDP to a multicast group\n"
+          "  -p PEERS      Send YDWG RAW UDP to unicast peers, as a list of\n"
+          "                ADDRESS[:PORT][/PACING_MS] entries\n"
+          "  -c HOST:PORT  Connect to a YDWG RAW TCP server\n"
+          "  -R            Receive YDWG RAW from the network\n"
+          "  -C            Conflate YDWG RAW TCP output for slow clients\n"
+          "  -I SECONDS    TCP session idle timeout, 0 to disable\n"
+          "                (default: %d)\n"
+          "  -B ADDRESS[:PORT]\n"
+          "                Bridge CAN frames to a peer or multicast group\n"
+          "                (default port: %u)\n"
+          "  -L PORT       Local CAN bridge port (default: the peer port)\n"
+          "  -D MS         CAN bridge batching latency (default: 10)\n"
+          "  -N            Disable NMEA 2000 to NMEA 0183 translation\n"
+          "  -S            Enable NMEA 2000 to SeaSmart.Net translation\n"
+          "  -F            Enable NMEA 0183 to NMEA 2000 translation\n"
+          "  -r ROUTES     Routing table, e.g. \"can > ydwg > ydwg-tcp;\n"
+          "                0183-udp > 0183 > can\"; replaces the routes of\n"
+          "                -R, -c, -N, -S and -F\n"
+          "  -v            Increase debug output verbosity\n",
+          program, kDefaultYdwgRawTCPServerPort, kDefaultYdwgRawUDPServerPort,
+          kDefaultNMEA0183TCPServerPort, kDefaultNMEA0183UDPServerPort,
+          kDefaultTCPSessionIdleTimeoutS, kDefaultCANBridgePort);
+}
+
+static bool ParseArguments(int argc, char *argv[]) {
+  int opt;
+  int verbosity = 0;
+  while ((opt = getopt(argc, argv, "i:t:u:T:U:b:m:p:c:RCI:B:L:D:NSFr:vh")) !=
+         -1) {
+    switch (opt) {
+      case 'i':
+        config.can_interface = optarg;
+        break;
+      case 't':
+        config.ydwg_raw_tcp_port = atoi(optarg);
+        break;
+      case 'u':
+        config.ydwg_raw_udp_port = atoi(optarg);
+        break;
+      case 'T':
+        config.nmea0183_tcp_port = atoi(optarg);
+        break;
+      case 'U':
+        config.nmea0183_udp_port = atoi(optarg);
+        break;
+      case 'b': {
+        unsigned int a, b, c, d;
+        if (sscanf(optarg, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) {
+          fprintf(stderr, "Invalid broadcast address: %s\n", optarg);
+          return false;
+        }
+        AsyncUDP::set_broadcast_address(IPAddress(a, b, c, d));
+        break;
+      }
+      case 'm':
+        config.ydwg_raw_udp_multicast_group = optarg;
+        break;
+      case 'p':
+        config.ydwg_raw_udp_peers = optarg;
+        break;
+      case 'c': {
+        String host_port = optarg;
+        int colon = host_port.indexOf(':');
+        if (colon == -1) {
+          config.ydwg_raw_tcp_client_host = host_port;
+        } else {
+          config.ydwg_raw_tcp_client_host = host_port.substring(0, colon);
+          config.ydwg_raw_tcp_client_port =
+              host_port.substring(colon + 1).toInt();
+        }
+        break;
+      }
+      case 'R':
+        config.ydwg_raw_rx = true;
+        break;
+      case 'C':
+        config.ydwg_raw_tcp_conflation = true;
+        break;
+      case 'I':
+        config.tcp_session_idle_timeout_ms = atoi(optarg) * 1000;
+        break;
+      case 'B': {
+        String address_port = optarg;
+        int colon = address_port.indexOf(':');
+        if (colon == -1) {
+          config.can_bridge_address = address_port;
+        } else {
+          config.can_bridge_address = address_port.substring(0, colon);
+          config.can_bridge_port = address_port.substring(colon + 1).toInt();
+        }
+        break;
+      }
+      case 'L':
+        config.can_bridge_local_port = atoi(optarg);
+        break;
+      case 'D':
+        config.can_bridge_batching_ms = atoi(optarg);
+        break;
+      case 'N':
+        config.translate_to_nmea0183 = false;
+        break;
+      case 'S':
+        config.translate_to_seasmart = true;
+        break;
+      case 'F':
+        config.translate_from_nmea0183 = true;
+        break;
+      case 'r':
+        config.routing_table = optarg;
+        break;
+      case 'v':
+        verbosity++;
+        break;
+      default:
+        PrintUsage(argv[0]);
+        return false;
+    }
+  }
+  int level = (int)HostDebugLevel::kWarning - verbosity;
+  host_debug_level = (HostDebugLevel)(level < 0 ? 0 : level);
+  return true;
+}
+
+static void InitNMEA2000() {
+  nmea2000->SetN2kCANMsgBufSize(8);
+  nmea2000->SetN2kCANReceiveFrameBufSize(100);
+
+  nmea2000->SetProductInformation(
+      "0",           // Manufacturer's Model serial code
+      130,           // Manufacturer's product code
+      "SH-wg host",  // Manufacturer's Model ID
+      "host",        // Manufacturer's Software version code
+      "1.0.0"        // Manufacturer's Model version
+  );
+  nmea2000->SetDeviceInformation(
+      1,    // Unique number
+      130,  // Device function=PC Gateway
+      25,   // Device class=Inter/Intranetwork Device
+      2046  // Manufacturer code
+  );
+
+  nmea2000->SetMode(tNMEA2000::N2km_ListenAndNode, 32);
+  nmea2000->EnableForward(false);
+  nmea2000->ExtendTransmitMessages(kTransmitMessages);
+
+  nmea2000->SetCANFrameHandler([](bool &has_frame, unsigned long &can_id,
+                                  unsigned char &len, unsigned char *buf) {
+    struct CANFrame frame;
+    if (has_frame) {
+      frame.id = can_id;
+      frame.len = len;
+      memcpy(frame.buf, buf, len);
+      frame.origin_type = CANFrameOriginType::kLocal;
+      frame.origin_id = origin_id(nmea2000);
+      can_frame_input.set(frame);
+    }
+  });
+  nmea2000->SetMsgHandler(
+      [](const tN2kMsg &n2k_msg) { n2k_msg_input.set(n2k_msg); });
+
+  can_frame_input.connect_to(new LambdaConsumer<CANFrame>(
+      [](CANFrame frame) { can_frame_rx_counter++; }));
+
+  nmea2000->Open();
+}
+
+/**
+ * @brief Derive the routing table from the options, as the firmware does
+ * from its port settings.
+ */
+static String DefaultRoutingTable() {
+  String table = "can > ydwg > ydwg-tcp; can > ydwg > ydwg-udp";
+  if (config.ydwg_raw_tcp_client_host.length() > 0) {
+    table += "; can > ydwg > ydwg-client; ydwg-client > ydwg > can";
+  }
+  if (config.ydwg_raw_rx) {
+    table += "; ydwg-tcp > ydwg > can; ydwg-udp > ydwg > can";
+  }
+  if (config.translate_to_nmea0183) {
+    table += "; can > 0183 > 0183-tcp; can > 0183 > 0183-udp";
+  }
+  if (config.translate_to_seasmart) {
+    table += "; can > seasmart > 0183-tcp; can > seasmart > 0183-udp";
+  }
+  if (config.translate_from_nmea0183) {
+    table += "; 0183-tcp > 0183 > can; 0183-udp > 0183 > can";
+  }
+  return table;
+}
+
+/**
+ * @brief Wire up the pipeline as SetupConnections() does in the firmware.
+ */
+static bool SetupConnections() {
+  String table = config.routing_table.length() > 0 ? config.routing_table
+                                                   : DefaultRoutingTable();
+  std::vector<Route> routes;
+  String error;
+  if (!ParseRoutingTable(table, routes, error)) {
+    fprintf(stderr, "Invalid routing table: %s\n", error.c_str());
+    return false;
+  }
+
+  can_frame_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
+      [](const CANFrame &frame) { return frame; });
+
+  auto router = new Router(
+      [](uint32_t pgn) { return nmea2000->IsFastPacketPGN(pgn); });
+
+  can_frame_sender = new LambdaConsumer<CANFrame>([](CANFrame frame) {
+    if (frame.origin_id == origin_id(nmea2000)) {
+      // ignore frames that we just received
+      return;
+    }
+    if (frame.origin_type == CANFrameOriginType::kRemoteApp) {
+      // Ignore YDWG RAW messages with 'T' direction
+      return;
+    }
+    can_frame_tx_counter++;
+    if (frame.origin_type == CANFrameOriginType::kApp) {
+      // replace the source address with our own
+      frame.id = (frame.id & ~0xFF) | nmea2000->GetN2kSource(0);
+    }
+    nmea2000->CANSendFrame(frame.id, frame.len, frame.buf);
+  });
+
+  auto concatenate_ydwg_strings = new ConcatenateStrings(100, 1000);
+  auto concatenate_n0183_strings = new ConcatenateStrings(100, 1000);
+
+  auto n2k_to_0183_transform = new N2KTo0183Transform(
+      nmea2000, config.ais_static_data_replay_period_ms);
+  auto nmea0183_to_n2k_transform = new NMEA0183ToN2KTransform();
+
+  router->set_nmea0183_encoder(n2k_to_0183_transform);
+  router->set_seasmart_encoder(AppendSeaSmartString);
+  router->set_nmea0183_decoder(nmea0183_to_n2k_transform);
+  n2k_msg_input.connect_to(router->get_message_input());
+
+  can_frame_input.connect_to(can_frame_clearinghouse);
+  can_frame_clearinghouse->connect_to(can_frame_sender);
+  can_frame_clearinghouse->connect_to(router->get_frame_input());
+  router->connect_to(can_frame_clearinghouse);
+
+  auto ydwg_raw_tcp_server =
+      new StreamingTCPServer(config.ydwg_raw_tcp_port, networking);
+  if (config.ydwg_raw_tcp_conflation) {
+    ydwg_raw_tcp_server->set_conflation(
+        kConflationQueueSize,
+        [](uint32_t pgn) { return nmea2000->IsFastPacketPGN(pgn); });
+  }
+  ydwg_raw_tcp_server->set_idle_timeout(config.tcp_session_idle_timeout_ms);
+  ydwg_raw_tcp_server->set_subscriptions(
+      [](uint32_t pgn) { return nmea2000->IsFastPacketPGN(pgn); });
+  ydwg_raw_tcp_server->connect_to(
+      router->get_input(RouteEndpoint::kYDWGRawTCP));
+  router->set_sink(RouteEndpoint::kYDWGRawTCP, ydwg_raw_tcp_server,
+                   [ydwg_raw_tcp_server]() {
+                     return ydwg_raw_tcp_server->get_num_sessions() > 0;
+                   });
+
+  auto ydwg_raw_udp_server =
+      new StreamingUDPServer(config.ydwg_raw_udp_port, networking);
+  if (config.ydwg_raw_udp_multicast_group.length() > 0) {
+    IPAddress group;
+    if (group.fromString(config.ydwg_raw_udp_multicast_group)) {
+      ydwg_raw_udp_server->set_multicast_group(group);
+    }
+  } else if (config.ydwg_raw_udp_peers.length() > 0) {
+    ydwg_raw_udp_server->set_unicast_peers(config.ydwg_raw_udp_peers);
+  }
+  auto ydwg_raw_udp_tokenizer = new StringTokenizer("\r\n");
+  ydwg_raw_udp_server->connect_to(ydwg_raw_udp_tokenizer);
+  ydwg_raw_udp_tokenizer->connect_to(
+      router->get_input(RouteEndpoint::kYDWGRawUDP));
+  router->set_sink(RouteEndpoint::kYDWGRawUDP, concatenate_ydwg_strings);
+  concatenate_ydwg_strings->connect_to(ydwg_raw_udp_server);
+
+  auto nmea0183_tcp_server =
+      new StreamingTCPServer(config.nmea0183_tcp_port, networking);
+  nmea0183_tcp_server->set_idle_timeout(config.tcp_session_idle_timeout_ms);
+  nmea0183_tcp_server->connect_to(
+      router->get_input(RouteEndpoint::kNMEA0183TCP));
+  router->set_sink(RouteEndpoint::kNMEA0183TCP, nmea0183_tcp_server,
+                   [nmea0183_tcp_server]() {
+                     return nmea0183_tcp_server->get_num_sessions() > 0;
+                   });
+  nmea0183_tcp_server->set_client_connected_callback(
+      [router, n2k_to_0183_transform](TCPSession &session) {
+        if (router->has_route(RouteFormat::kNMEA0183,
+                              RouteEndpoint::kNMEA0183TCP)) {
+          n2k_to_0183_transform->replay_static_data(
+              [&session](const char *data) { session.queue_line(data); });
+        }
+      });
+
+  auto nmea0183_udp_server =
+      new StreamingUDPServer(config.nmea0183_udp_port, networking);
+  nmea0183_udp_server->connect_to(
+      router->get_input(RouteEndpoint::kNMEA0183UDP));
+  router->set_sink(RouteEndpoint::kNMEA0183UDP, concatenate_n0183_strings);
+  concatenate_n0183_strings->connect_to(nmea0183_udp_server);
+
+  if (config.ydwg_raw_tcp_client_host.length() > 0) {
+    auto ydwg_raw_tcp_client =
+        new StreamingTCPClient(config.ydwg_raw_tcp_client_host,
+                               config.ydwg_raw_tcp_client_port, networking);
+    auto ydwg_raw_tcp_client_tokenizer = new StringTokenizer("\r\n");
+    ydwg_raw_tcp_client->connect_to(ydwg_raw_tcp_client_tokenizer);
+    ydwg_raw_tcp_client_tokenizer->connect_to(
+        router->get_input(RouteEndpoint::kYDWGRawClient));
+    router->set_sink(RouteEndpoint::kYDWGRawClient, ydwg_raw_tcp_client);
+  }
+
+  router->set_routes(routes);
+
+  if (config.can_bridge_address.length() > 0) {
+    IPAddress address;
+    if (!address.fromString(config.can_bridge_address)) {
+      debugE("Invalid CAN bridge address: %s",
+             config.can_bridge_address.c_str());
+      return true;
+    }
+    uint16_t local_port = config.can_bridge_local_port != 0
+                              ? config.can_bridge_local_port
+                              : config.can_bridge_port;
+    std::random_device random;
+    can_bridge = new CANBridge(address, config.can_bridge_port, local_port,
+                               config.can_bridge_batching_ms, random(),
+                               networking, kCANBridgeRXQueueSize);
+    can_frame_input.connect_to(can_bridge);
+    router->connect_to(can_bridge);
+    can_bridge->connect_to(can_frame_clearinghouse);
+  }
+  return true;
+}
+
+// the native unit tests in test/ link the gateway core with their own main()
+#ifndef PIO_UNIT_TESTING
+int main(int argc, char *argv[]) {
+  if (!ParseArguments(argc, argv)) {
+    return 1;
+  }
+
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+
+  networking = new Networking();
+
+  nmea2000 = new tNMEA2000_SocketCAN_FH(config.can_interface);
+  InitNMEA2000();
+
+  if (!SetupConnections()) {
+    return 1;
+  }
+
+  app.onRepeat(1000, []() {
+    debugD("Uptime: %u, CAN RX: %u CAN TX: %u", millis() / 1000,
+           can_frame_rx_counter, can_frame_tx_counter);
+  });
+
+  // Output messages logged on hot paths
+  app.onRepeat(100, []() { DeferredLogDrain(16); });
+
+  // Handle incoming NMEA 2000 messages
+  app.onRepeatMicros(50, []() { nmea2000->ParseMessages(); });
+
+  Startable::start_all();
+
+  while (!stop_requested) {
+    app.tick();
+    // yield the CPU between ticks; the shortest reaction period is 50 us
+    delayMicroseconds(20);
+  }
+
+  fprintf(stderr, "CAN RX: %u CAN TX: %u\n", can_frame_rx_counter,
+          can_frame_tx_counter);
+  if (can_bridge != nullptr) {
+    const CANBridgeStats &stats = can_bridge->get_rx_stats();
+    fprintf(stderr,
+            "CAN bridge: %u frames sent in %u datagrams, %u frames received "
+            "in %u datagrams, %u lost, %u reordered, %u duplicates, "
+            "%u late\n",
+            can_bridge->get_frames_sent(), can_bridge->get_datagrams_sent(),
+            can_bridge->get_frames_received(), stats.received, stats.lost,
+            stats.reordered, stats.duplicates, stats.late);
+  }
+  return 0;
+}
+#endif  // PIO_UNIT_TESTING
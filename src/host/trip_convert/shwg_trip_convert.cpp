@@ -0,0 +1,192 @@
+// Converter between trip recordings and YDWG RAW text.
+//
+// Trip recordings are downloaded from the gateway at /trips. By default,
+// a recording is converted to YDWG RAW text with one message per line:
+//
+//   shwg_trip_convert trip_00003.bin > trip_00003.txt
+//
+// With -e, YDWG RAW text is converted to a trip recording. YDWG RAW
+// timestamps only contain the time of day; the recording starts on
+// 1970-01-01.
+//
+//   shwg_trip_convert -e data/ydwg_recording_1.txt recording.bin
+
+#include <getopt.h>
+#include <sys/time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "can_frame.h"
+#include "trip_recording.h"
+#include "ydwg_raw_output.h"
+
+constexpr uint64_t kMillisecondsPerDay = 86400000;
+
+static bool ReadFile(FILE* file, std::vector<uint8_t>& contents) {
+  uint8_t buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), file)) > 0) {
+    contents.insert(contents.end(), buf, buf + len);
+  }
+  return !ferror(file);
+}
+
+static int RecordingToYDWGRaw(FILE* input, FILE* output) {
+  std::vector<uint8_t> recording;
+  if (!ReadFile(input, recording)) {
+    perror("Error reading the recording");
+    return 1;
+  }
+
+  TripRecordingDecoder decoder;
+  size_t pos = decoder.begin(recording.data(), recording.size());
+  if (pos == 0) {
+    fprintf(stderr, "Not a trip recording\n");
+    return 1;
+  }
+
+  CANFrame frame;
+  uint64_t time_ms;
+  char line[kMaxYDWGRawMessageSize];
+  while (pos < recording.size()) {
+    int consumed = decoder.decode(recording.data() + pos,
+                                  recording.size() - pos, frame, time_ms);
+    if (consumed == 0) {
+      // a recording may end with a partially written record
+      fprintf(stderr, "Recording truncated at offset %zu\n", pos);
+      break;
+    }
+    if (consumed < 0) {
+      fprintf(stderr, "Invalid record at offset %zu\n", pos);
+      return 1;
+    }
+    pos += consumed;
+
+    struct timeval tv;
+    tv.tv_sec = time_ms / 1000;
+    tv.tv_usec = time_ms % 1000 * 1000;
+    size_t len = CANFrameToYDWGRaw(frame, tv, line, sizeof(line));
+    // YDWG RAW recordings are stored with Unix line endings
+    line[len - 2] = '\n';
+    line[len - 1] = '\0';
+    fputs(line, output);
+  }
+  return 0;
+}
+
+/**
+ * @brief Parse a YDWG RAW message.
+ *
+ * @return false if the line is not a valid message
+ */
+static bool ParseYDWGRaw(const char* line, CANFrame& frame,
+                         uint64_t& ms_of_day) {
+  unsigned int hours, minutes, seconds, ms;
+  char direction;
+  unsigned int id;
+  int pos;
+  if (sscanf(line, "%2u:%2u:%2u.%3u %c %x%n", &hours, &minutes, &seconds,
+             &ms, &direction, &id, &pos) != 6) {
+    return false;
+  }
+  ms_of_day = ((hours * 60 + minutes) * 60 + seconds) * 1000ULL + ms;
+
+  frame.id = id;
+  frame.len = 0;
+  frame.origin_id = 0;
+  frame.origin_type =
+      direction == 'T' ? CANFrameOriginType::kApp : CANFrameOriginType::kCAN;
+  unsigned int byte;
+  int byte_len;
+  while (frame.len < 8 &&
+         sscanf(line + pos, " %2x%n", &byte, &byte_len) == 1) {
+    frame.buf[frame.len++] = byte;
+    pos += byte_len;
+  }
+  return true;
+}
+
+static int YDWGRawToRecording(FILE* input, FILE* output) {
+  TripRecordingEncoder encoder;
+  uint8_t buf[kMaxTripRecordSize];
+  uint64_t day_ms = 0;
+  uint64_t previous_ms_of_day = 0;
+  bool started = false;
+  size_t frames = 0;
+  size_t bytes = 0;
+
+  char line[256];
+  while (fgets(line, sizeof(line), input) != nullptr) {
+    CANFrame frame;
+    uint64_t ms_of_day;
+    if (!ParseYDWGRaw(line, frame, ms_of_day)) {
+      continue;
+    }
+    if (!started) {
+      bytes += fwrite(buf, 1, encoder.begin(ms_of_day, buf), output);
+      started = true;
+    } else if (ms_of_day < previous_ms_of_day) {
+      // past midnight
+      day_ms += kMillisecondsPerDay;
+    }
+    previous_ms_of_day = ms_of_day;
+    bytes += fwrite(buf, 1, encoder.encode(frame, day_ms + ms_of_day, buf),
+                    output);
+    frames++;
+  }
+
+  if (frames > 0) {
+    fprintf(stderr, "%zu frames, %zu bytes, %.2f bytes/frame\n", frames, bytes,
+            (double)bytes / frames);
+  }
+  return ferror(output) ? 1 : 0;
+}
+
+static void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [-e] [INPUT [OUTPUT]]\n"
+          "  Convert a trip recording to YDWG RAW text. INPUT and OUTPUT\n"
+          "  default to the standard input and output.\n"
+          "  -e  Convert YDWG RAW text to a trip recording instead\n",
+          program);
+}
+
+int main(int argc, char* argv[]) {
+  bool encode = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "eh")) != -1) {
+    switch (opt) {
+      case 'e':
+        encode = true;
+        break;
+      default:
+        PrintUsage(argv[0]);
+        return 1;
+    }
+  }
+
+  FILE* input = stdin;
+  FILE* output = stdout;
+  if (optind < argc) {
+    input = fopen(argv[optind], encode ? "r" : "rb");
+    if (input == nullptr) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+  if (optind + 1 < argc) {
+    output = fopen(argv[optind + 1], encode ? "wb" : "w");
+    if (output == nullptr) {
+      perror(argv[optind + 1]);
+      return 1;
+    }
+  }
+
+  int result = encode ? YDWGRawToRecording(input, output)
+                      : RecordingToYDWGRaw(input, output);
+  fclose(output);
+  return result;
+}
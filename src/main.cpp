@@ -8,23 +8,34 @@
 // Remove the parts that are not relevant to you, and add your own code
 // for external hardware libraries.
 
+#include <ArduinoJson.h>
+#include <SPIFFS.h>
 #include <WiFi.h>
 #include <sys/time.h>
 
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "N2kMessages.h"
 #include "NMEA2000/NMEA2000_esp32_framehandler.h"
 #include "NMEA2000_CAN.h"
+#include "can_bridge.h"
 #include "can_frame.h"
 #include "concatenate_strings.h"
+#include "deferred_log.h"
+#include "echo_filter.h"
 #include "config.h"
 #include "filter_transform.h"
 #include "firmware_info.h"
 #include "n2k_nmea0183_transform.h"
+#include "nmea0183_n2k_transform.h"
 #include "origin_string.h"
 #include "ota_update_task.h"
+#include "reaction_profiler.h"
+#include "router.h"
+#include "routing_table.h"
+#include "runtime_telemetry.h"
 #include "seasmart_transform.h"
 #include "sensesp/net/discovery.h"
 #include "sensesp/net/http_server.h"
@@ -37,19 +48,31 @@
 #include "shwg.h"
 #include "shwg_button.h"
 #include "shwg_factory_test.h"
+#include "static_can_pipeline.h"
+#include "store_and_forward_buffer.h"
 #include "streaming_tcp_client.h"
 #include "streaming_tcp_server.h"
 #include "streaming_udp_server.h"
 #include "stringtokenizer_transform.h"
 #include "time_string.h"
+#include "trip_recorder.h"
 #include "ui_controls.h"
+#include "ydwg_raw_line.h"
 #include "ydwg_raw_output.h"
 #include "ydwg_raw_parser.h"
+#include "ydwg_raw_replay.h"
 
 using namespace sensesp;
 
 // Set the information for other bus devices, which messages we support
-const unsigned long kTransmitMessages[] = {0};
+const unsigned long kTransmitMessages[] = {
+    127250L,   // Heading
+    128267UL,  // Depth
+    129025UL,  // Position
+    129026L,   // COG and SOG
+    129029L,   // GNSS
+    130306L,   // Wind
+    0};
 const unsigned long ReceiveMessages[] = {
     /*126992L,*/  // System time
     127250L,      // Heading
@@ -78,6 +101,8 @@ StreamingUDPServer *ydwg_raw_udp_server;
 StreamingTCPClient *ydwg_raw_tcp_client;
 StreamingTCPClient *nmea0183_tcp_client;
 
+N2KTo0183Transform *n2k_to_0183_transform;
+
 // time elapsed since last system time update
 elapsedMillis elapsed_since_last_system_time_update = kTimeUpdatePeriodMs;
 
@@ -89,13 +114,27 @@ Networking *networking;
 
 CheckboxConfig *checkbox_config_enable_firmware_updates;
 BiDiPortConfig *port_config_ydwg_raw_tcp;
+CheckboxConfig *checkbox_config_ydwg_raw_tcp_conflation;
+IntegerConfig *integer_config_tcp_session_idle_timeout;
 HostPortConfig *port_config_ydwg_raw_tcp_client;
 BiDiPortConfig *port_config_ydwg_raw_udp;
+CheckboxConfig *checkbox_config_echo_suppression;
+HostPortConfig *port_config_can_bridge;
+IntegerConfig *integer_config_can_bridge_batching;
 CheckboxConfig *checkbox_config_translate_to_seasmart;
 CheckboxConfig *checkbox_config_translate_to_nmea0183;
+CheckboxConfig *checkbox_config_translate_from_nmea0183;
+IntegerConfig *integer_config_ais_static_data_replay_period;
 PortConfig *port_config_nmea0183_tcp_tx;
 HostPortConfig *port_config_nmea0183_tcp_client;
 PortConfig *port_config_nmea0183_udp_tx;
+IntegerConfig *integer_config_store_and_forward_max_age;
+IntegerConfig *integer_config_store_and_forward_replay_rate;
+RoutingTableConfig *routing_table_config;
+IntegerConfig *integer_config_trip_recorder_size;
+StringConfig *string_config_replay_file;
+IntegerConfig *integer_config_replay_speed;
+CheckboxConfig *checkbox_config_replay_loop;
 
 UIOutput<String> ui_output_firmware_name("Firmware name", kFirmwareName,
                                          "Firmware", 100);
@@ -117,6 +156,8 @@ UILambdaOutput<int8_t> ui_output_wifi_rssi = UILambdaOutput<int8_t>(
 
 uint32_t can_frame_rx_counter = 0;
 uint32_t can_frame_tx_counter = 0;
+// CPU cycles spent processing received CAN frames
+uint64_t can_frame_rx_cycles = 0;
 
 UILambdaOutput<uint32_t> ui_output_can_frame_rx_counter(
     "CAN frame RX counter", []() { return can_frame_rx_counter; }, "NMEA 2000",
@@ -126,12 +167,255 @@ UILambdaOutput<uint32_t> ui_output_can_frame_tx_counter(
     "CAN frame TX counter", []() { return can_frame_tx_counter; }, "NMEA 2000",
     310);
 
+UILambdaOutput<uint32_t> ui_output_can_frame_rx_cycles(
+    "CAN frame RX processing (CPU cycles/frame)",
+    []() {
+      return can_frame_rx_counter > 0
+                 ? (uint32_t)(can_frame_rx_cycles / can_frame_rx_counter)
+                 : 0;
+    },
+    "NMEA 2000", 320);
+
+UILambdaOutput<uint32_t> ui_output_can_rx_ring_overflows(
+    "CAN RX ring overflows",
+    []() { return nmea2000->GetRXRingOverflows(); }, "NMEA 2000", 330);
+
+UILambdaOutput<String> ui_output_can_rx_ring_high_watermark(
+    "CAN RX ring peak fill",
+    []() {
+      return String(nmea2000->GetRXRingHighWatermark()) + " / " +
+             String(nmea2000->GetRXRingSize());
+    },
+    "NMEA 2000", 331);
+
+EchoFilter *echo_filter = nullptr;
+
+UILambdaOutput<uint32_t> ui_output_echo_suppressed(
+    "Echoed frames suppressed",
+    []() {
+      return echo_filter != nullptr ? echo_filter->get_suppressed() : 0;
+    },
+    "NMEA 2000", 340);
+
+UILambdaOutput<uint32_t> ui_output_ydwg_raw_tcp_conflated(
+    "YDWG RAW TCP messages conflated",
+    []() { return ydwg_raw_tcp_server->get_conflated(); }, "NMEA 2000", 345);
+
+Router *router = nullptr;
+
+UILambdaOutput<String> ui_output_ydwg_raw_encoding(
+    "YDWG RAW frames encoded / skipped",
+    []() {
+      return String(router->get_frames_encoded()) + " / " +
+             String(router->get_frames_skipped());
+    },
+    "NMEA 2000", 346);
+
+UILambdaOutput<String> ui_output_routes(
+    "Routes (lines or frames passed)",
+    []() { return router->get_summary(); }, "Routing", 380);
+
+CANBridge *can_bridge = nullptr;
+
+UILambdaOutput<String> ui_output_can_bridge_sent(
+    "Frames / datagrams sent",
+    []() {
+      if (can_bridge == nullptr) {
+        return String("-");
+      }
+      return String(can_bridge->get_frames_sent()) + " / " +
+             String(can_bridge->get_datagrams_sent());
+    },
+    "CAN Bridge", 350);
+
+UILambdaOutput<String> ui_output_can_bridge_received(
+    "Frames / datagrams received",
+    []() {
+      if (can_bridge == nullptr) {
+        return String("-");
+      }
+      return String(can_bridge->get_frames_received()) + " / " +
+             String(can_bridge->get_rx_stats().received);
+    },
+    "CAN Bridge", 351);
+
+UILambdaOutput<uint32_t> ui_output_can_bridge_lost(
+    "Datagrams lost",
+    []() {
+      return can_bridge != nullptr ? can_bridge->get_rx_stats().lost : 0;
+    },
+    "CAN Bridge", 352);
+
+UILambdaOutput<uint32_t> ui_output_can_bridge_reordered(
+    "Datagrams reordered",
+    []() {
+      return can_bridge != nullptr ? can_bridge->get_rx_stats().reordered
+                                   : 0;
+    },
+    "CAN Bridge", 353);
+
+UILambdaOutput<String> ui_output_can_bridge_discarded(
+    "Duplicate / late / invalid datagrams",
+    []() {
+      if (can_bridge == nullptr) {
+        return String("-");
+      }
+      const CANBridgeStats &stats = can_bridge->get_rx_stats();
+      return String(stats.duplicates) + " / " + String(stats.late) + " / " +
+             String(stats.invalid);
+    },
+    "CAN Bridge", 354);
+
+UILambdaOutput<int> ui_output_ais_static_cache_entries(
+    "Class B static data cache entries",
+    []() { return n2k_to_0183_transform->get_class_b_static_cache().size(); },
+    "AIS", 350);
+
+UILambdaOutput<int> ui_output_ais_static_cache_footprint(
+    "Class B static data cache size (bytes)",
+    []() {
+      return n2k_to_0183_transform->get_class_b_static_cache().get_footprint();
+    },
+    "AIS", 351);
+
+UILambdaOutput<float> ui_output_ais_static_cache_hit_rate(
+    "Class B static data cache hit rate (%)",
+    []() {
+      return n2k_to_0183_transform->get_class_b_static_cache().get_hit_rate();
+    },
+    "AIS", 352);
+
+UILambdaOutput<int> ui_output_ais_targets(
+    "AIS targets tracked",
+    []() { return n2k_to_0183_transform->get_ais_target_table().size(); },
+    "AIS", 360);
+
+UILambdaOutput<uint32_t> ui_output_ais_forwarded(
+    "AIS position reports forwarded",
+    []() {
+      return n2k_to_0183_transform->get_ais_target_table().get_forwarded();
+    },
+    "AIS", 361);
+
+UILambdaOutput<uint32_t> ui_output_ais_suppressed(
+    "AIS position reports suppressed",
+    []() {
+      return n2k_to_0183_transform->get_ais_target_table().get_suppressed();
+    },
+    "AIS", 362);
+
 UILambdaOutput<int> ui_output_uptime(
     "Uptime", []() { return millis() / 1000; }, "Runtime", 400);
 
 UILambdaOutput<int> ui_output_free_heap(
     "Free memory", []() { return ESP.getFreeHeap(); }, "Runtime", 410);
 
+RuntimeTelemetry *runtime_telemetry;
+TaskHandle_t main_task_handle = nullptr;
+TaskHandle_t ota_update_task_handle = nullptr;
+
+UILambdaOutput<uint32_t> ui_output_min_free_heap(
+    "Lowest free memory",
+    []() { return runtime_telemetry->get_min_free_heap(); }, "Runtime", 411);
+
+UILambdaOutput<uint32_t> ui_output_largest_free_block(
+    "Largest free memory block",
+    []() { return runtime_telemetry->get_largest_free_block(); }, "Runtime",
+    412);
+
+UILambdaOutput<float> ui_output_heap_fragmentation(
+    "Memory fragmentation (%)",
+    []() { return runtime_telemetry->get_fragmentation(); }, "Runtime", 413);
+
+UILambdaOutput<uint32_t> ui_output_loops_per_second(
+    "Main loop iterations per second",
+    []() { return runtime_telemetry->get_loops_per_second(); }, "Runtime",
+    414);
+
+UILambdaOutput<uint32_t> ui_output_loop_time_max(
+    "Longest main loop iteration (us)",
+    []() { return runtime_telemetry->get_loop_time_max_us(); }, "Runtime", 415);
+
+UILambdaOutput<String> ui_output_task_stacks(
+    "Free task stack (bytes)",
+    []() { return runtime_telemetry->get_task_summary(); }, "Runtime", 420);
+
+UILambdaOutput<String> ui_output_queue_depths(
+    "Queue depths", []() { return runtime_telemetry->get_queue_summary(); },
+    "Runtime", 421);
+
+UILambdaOutput<String> ui_output_ydwg_raw_tcp_sessions(
+    "YDWG RAW TCP sessions",
+    []() { return ydwg_raw_tcp_server->get_session_summary(); },
+    "TCP Sessions", 370);
+
+UILambdaOutput<String> ui_output_nmea0183_tcp_sessions(
+    "NMEA 0183 TCP sessions",
+    []() { return nmea0183_tcp_server->get_session_summary(); },
+    "TCP Sessions", 371);
+
+UILambdaOutput<uint32_t> ui_output_tcp_sessions_refused(
+    "Connections refused (all sessions in use)",
+    []() {
+      return ydwg_raw_tcp_server->get_refused() +
+             nmea0183_tcp_server->get_refused();
+    },
+    "TCP Sessions", 372);
+
+UILambdaOutput<uint32_t> ui_output_tcp_sessions_evicted(
+    "Idle sessions closed",
+    []() {
+      return ydwg_raw_tcp_server->get_evicted() +
+             nmea0183_tcp_server->get_evicted();
+    },
+    "TCP Sessions", 373);
+
+TripRecorder *trip_recorder = nullptr;
+
+UILambdaOutput<uint32_t> ui_output_trip_recorder_frames(
+    "Recorded frames",
+    []() { return trip_recorder != nullptr ? trip_recorder->get_frames() : 0; },
+    "Trip Recorder", 430);
+
+UILambdaOutput<uint32_t> ui_output_trip_recorder_dropped(
+    "Dropped frames",
+    []() {
+      return trip_recorder != nullptr ? trip_recorder->get_dropped() : 0;
+    },
+    "Trip Recorder", 431);
+
+UILambdaOutput<uint32_t> ui_output_trip_recorder_cycles(
+    "Recording (CPU cycles/frame)",
+    []() {
+      return trip_recorder != nullptr ? trip_recorder->get_cycles_per_frame()
+                                      : 0;
+    },
+    "Trip Recorder", 432);
+
+UILambdaOutput<uint32_t> ui_output_trip_recorder_budget_overruns(
+    "Frames over the CPU budget",
+    []() {
+      return trip_recorder != nullptr ? trip_recorder->get_budget_overruns()
+                                      : 0;
+    },
+    "Trip Recorder", 433);
+
+YDWGRawReplay *ydwg_raw_replay = nullptr;
+
+UILambdaOutput<uint32_t> ui_output_replay_frames(
+    "Replayed frames",
+    []() {
+      return ydwg_raw_replay != nullptr ? ydwg_raw_replay->get_frames() : 0;
+    },
+    "Replay", 440);
+
+UILambdaOutput<uint32_t> ui_output_replay_passes(
+    "Completed replay passes",
+    []() {
+      return ydwg_raw_replay != nullptr ? ydwg_raw_replay->get_passes() : 0;
+    },
+    "Replay", 441);
+
 int led_state = -1;
 
 uint64_t GetBoardSerialNumber() {
@@ -178,9 +462,17 @@ ObservableValue<CANFrame> can_frame_input;
 // All CAN frame producers and consumers connect to the clearinghouse
 LambdaTransform<CANFrame, CANFrame> *can_frame_clearinghouse;
 
+#ifdef SH_WG_STATIC_CAN_PIPELINE
+// Statically wired replacement for the clearinghouse and its consumers
+ValueConsumer<CANFrame> *static_can_pipeline;
+#endif
+
 // Consumer that will send CAN frames to the NMEA 2000 bus
 LambdaConsumer<CANFrame> *can_frame_sender;
 
+// Entry of the CAN frame routing, after the echo filter
+ValueConsumer<CANFrame> *can_frame_router;
+
 void InitNMEA2000() {
   nmea2000->SetN2kCANMsgBufSize(8);
   nmea2000->SetN2kCANReceiveFrameBufSize(100);
@@ -229,7 +521,9 @@ void InitNMEA2000() {
       memcpy(frame.buf, buf, len);
       frame.origin_type = CANFrameOriginType::kLocal;
       frame.origin_id = origin_id(nmea2000);
+      uint32_t start_cycles = ESP.getCycleCount();
       can_frame_input.set(frame);
+      can_frame_rx_cycles += ESP.getCycleCount() - start_cycles;
     }
   });
   nmea2000->SetMsgHandler(
@@ -238,6 +532,9 @@ void InitNMEA2000() {
   can_frame_input.connect_to(new LambdaConsumer<CANFrame>(
       [](CANFrame frame) { can_frame_rx_counter++; }));
 
+  nmea2000->EnableRXTask(kCANRXRingSize, kCANRXTaskCore, kCANRXTaskPriority);
+  nmea2000->EnableFrameInjection(kCANInjectRingSize);
+
   nmea2000->Open();
 }
 
@@ -275,194 +572,641 @@ static void SetupBlueLEDBlinker() {
   networking->connect_to(wifi_state_consumer);
 }
 
-static void SetupYellowLEDBlinker(
-    ValueProducer<OriginString> *string_producer) {
+static ValueConsumer<OriginString> *NewYellowLEDBlinker() {
   static int solid_on_pattern[] = {1000, 0, PATTERN_END};
   auto blinker = new PatternBlinker(kYellowLedPin, solid_on_pattern);
 
-  string_producer->connect_to(
-      new LambdaConsumer<OriginString>([blinker](const OriginString &str) {
+  return new LambdaConsumer<OriginString>(
+      [blinker](const OriginString &str) {
         if (WiFi.isConnected()) {
           blinker->blip(5);
         }
-      }));
+      });
 }
 
-static void SetupConnections() {
-  can_frame_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
-      [](const CANFrame &frame) { return frame; });
+/**
+ * @brief Send a CAN frame to the NMEA 2000 bus, unless it came from there.
+ */
+static void SendCANFrame(CANFrame frame) {
+  // debugD("Sending CAN Frame with ID %d and length %d", frame.id,
+  // frame.len);
 
-  auto can_to_ydwg_transform =
-      new LambdaTransform<CANFrame, OriginString>([](CANFrame frame) {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        OriginString origin_string = CANFrameToYDWGRaw(frame, tv);
-        return origin_string;
-      });
+  if (frame.origin_id == origin_id(nmea2000)) {
+    // ignore frames that we just received
+    return;
+  }
 
-  can_frame_sender = new LambdaConsumer<CANFrame>([](CANFrame frame) {
-    // debugD("Sending CAN Frame with ID %d and length %d", frame.id,
-    // frame.len);
+  if (frame.origin_type == CANFrameOriginType::kRemoteApp) {
+    // Ignore YDWG RAW messages with 'T' direction
+    return;
+  }
+  can_frame_tx_counter++;
+  if (frame.origin_type == CANFrameOriginType::kApp) {
+    // Application format messages need to have their source address
+    // replaced with our own source address.
+
+    unsigned char our_source = nmea2000->GetN2kSource(0);
+    uint32_t frame_id = frame.id;
+    // clear existing source address
+    frame_id &= ~0xFF;
+    // set new source address
+    frame_id |= our_source;
+
+    frame.id = frame_id;
+  }
+  nmea2000->CANSendFrame(frame.id, frame.len, frame.buf);
+}
 
-    if (frame.origin_id == origin_id(nmea2000)) {
-      // ignore frames that we just received
-      return;
-    }
+#ifdef SH_WG_STATIC_CAN_PIPELINE
+/**
+ * @brief Wire the CAN frame routing at compile time.
+ *
+ * Equivalent to the clearinghouse routing in SetupConnections(): frames are
+ * sent to the bus and encoded once as YDWG RAW for the TCP server, the TCP
+ * client and the batched UDP broadcasts. Each output is enabled while a
+ * "can > ydwg" route leads to it, so the port settings and the routing
+ * table apply without a restart; route filters don't apply.
+ */
+static ValueConsumer<CANFrame> *SetupStaticCANPipeline() {
+  static int solid_on_pattern[] = {1000, 0, PATTERN_END};
+  PatternBlinker *blinker = new PatternBlinker(kYellowLedPin, solid_on_pattern);
+
+  auto tcp_server_route = []() {
+    return router->has_route(RouteFormat::kYDWGRaw, RouteEndpoint::kYDWGRawTCP);
+  };
+  auto tcp_client_route = []() {
+    return router->has_route(RouteFormat::kYDWGRaw,
+                             RouteEndpoint::kYDWGRawClient) &&
+           ydwg_raw_tcp_client->is_enabled();
+  };
+  auto udp_route = []() {
+    return router->has_route(RouteFormat::kYDWGRaw, RouteEndpoint::kYDWGRawUDP);
+  };
+
+  auto ydwg_raw_output = MakeFanout(
+      MakeGate(tcp_server_route, TCPServerSink(ydwg_raw_tcp_server)),
+      MakeGate(tcp_client_route, OriginStringConsumerSink(ydwg_raw_tcp_client)),
+      MakeGate(udp_route,
+               MakeStringBatcher(UDPServerSink(ydwg_raw_udp_server), 1000,
+                                 100)),
+      MakeGate(udp_route,
+               MakeFunctionSink([blinker](const char *data, size_t len,
+                                          uint32_t origin_id) {
+                 if (WiFi.isConnected()) {
+                   blinker->blip(5);
+                 }
+               })));
+
+  return NewStaticCANPipeline(
+      MakeFanout(MakeFunctionSink(SendCANFrame),
+                 MakeYDWGRawEncoder(ydwg_raw_output)));
+}
+#endif
+
+static void SetupStoreAndForward(StreamingTCPClient *client,
+                                 const char *spill_path) {
+  int max_age_min = integer_config_store_and_forward_max_age->get_value();
+  if (max_age_min <= 0) {
+    return;
+  }
+  auto buffer =
+      new StoreAndForwardBuffer(kStoreAndForwardRAMSize, spill_path,
+                                kStoreAndForwardSpillSize, max_age_min * 60000);
+  client->set_store_and_forward(
+      buffer, integer_config_store_and_forward_replay_rate->get_value());
+}
+
+/**
+ * @brief Create the trip recorder if it is enabled.
+ */
+static void SetupTripRecorder() {
+  int size_kb = integer_config_trip_recorder_size->get_value();
+  if (size_kb <= 0) {
+    return;
+  }
+  trip_recorder = new TripRecorder("/spiffs", kTripRecorderFileSize,
+                                   (size_t)size_kb * 1024);
+  ProfiledOnRepeat(&app, kTripRecorderFlushIntervalMs, "Trip recorder flush",
+                   []() { trip_recorder->flush(); });
+}
 
-    if (frame.origin_type == CANFrameOriginType::kRemoteApp) {
-      // Ignore YDWG RAW messages with 'T' direction
+/**
+ * @brief Check whether a PGN is network management traffic the NMEA 2000
+ * library acts on: ISO requests, address claims, commanded addresses and
+ * group functions.
+ */
+static bool IsNetworkManagementPGN(uint32_t pgn) {
+  return pgn == 59904 || pgn == 60928 || pgn == 65240 || pgn == 126208;
+}
+
+/**
+ * @brief Replay a recording from flash, if one is configured.
+ *
+ * The frames are injected into the NMEA 2000 library as if they had been
+ * received from the bus, so that they reach all outputs. Network
+ * management frames are skipped: the library would answer recorded
+ * requests on the live bus, and a recorded claim of its address would make
+ * it give up or change its address.
+ */
+static void SetupReplay() {
+  String file_name = string_config_replay_file->get_value();
+  file_name.trim();
+  if (file_name.length() == 0) {
+    return;
+  }
+  if (!file_name.startsWith("/")) {
+    file_name = String("/") + file_name;
+  }
+  ydwg_raw_replay = new YDWGRawReplay(
+      String("/spiffs") + file_name, integer_config_replay_speed->get_value(),
+      checkbox_config_replay_loop->get_value(), [](const CANFrame &frame) {
+        if (IsNetworkManagementPGN(CANIdToPGN(frame.id))) {
+          return true;
+        }
+        return nmea2000->InjectFrame(frame.id, frame.len, frame.buf);
+      });
+}
+
+/**
+ * @brief Apply the configured output mode to a UDP server.
+ */
+static void ConfigureUDPOutput(StreamingUDPServer *server,
+                               const UDPOutputConfig &config) {
+  if (config.mode == "Multicast") {
+    IPAddress group;
+    if (!group.fromString(config.multicast_group) ||
+        (group[0] & 0xF0) != 0xE0) {
+      debugE("Invalid multicast group %s; broadcasting instead",
+             config.multicast_group.c_str());
+      server->set_broadcast();
       return;
     }
-    can_frame_tx_counter++;
-    if (frame.origin_type == CANFrameOriginType::kApp) {
-      // Application format messages need to have their source address
-      // replaced with our own source address.
-
-      unsigned char our_source = nmea2000->GetN2kSource(0);
-      uint32_t frame_id = frame.id;
-      // clear existing source address
-      frame_id &= ~0xFF;
-      // set new source address
-      frame_id |= our_source;
-
-      frame.id = frame_id;
-    }
-    nmea2000->CANSendFrame(frame.id, frame.len, frame.buf);
-  });
+    server->set_multicast_group(group);
+  } else if (config.mode == "Unicast") {
+    server->set_unicast_peers(config.peers);
+  } else {
+    server->set_broadcast();
+  }
+}
 
-  auto concatenate_ydwg_strings = new ConcatenateStrings(100, 1000);
-  auto concatenate_n0183_strings = new ConcatenateStrings(100, 1000);
+// The Configure functions below apply the settings of one output. They are
+// called at startup and again whenever one of its settings is saved; the
+// outputs only restart what the change affects.
+
+static void ConfigureYDWGRawTCPServer() {
+  ydwg_raw_tcp_server->set_port(port_config_ydwg_raw_tcp->get_port());
+  ydwg_raw_tcp_server->set_enabled(
+      port_config_ydwg_raw_tcp->get_tx_enabled() ||
+      port_config_ydwg_raw_tcp->get_rx_enabled());
+  // Only YDWG RAW has a per-message key. NMEA 0183 sentences of one talker
+  // and type may carry different data (MWV, XDR, GSV), the UDP servers
+  // don't queue and the TCP clients replay their backlog in full.
+  ydwg_raw_tcp_server->set_conflation(
+      checkbox_config_ydwg_raw_tcp_conflation->get_value()
+          ? kConflationQueueSize
+          : 0,
+      [](uint32_t pgn) { return nmea2000->IsFastPacketPGN(pgn); });
+}
 
-  auto string_tokenizer = new StringTokenizer("\r\n");
+static void ConfigureYDWGRawUDPServer() {
+  ydwg_raw_udp_server->set_port(port_config_ydwg_raw_udp->get_port());
+  ConfigureUDPOutput(ydwg_raw_udp_server,
+                     port_config_ydwg_raw_udp->get_udp_output());
+  ydwg_raw_udp_server->set_enabled(
+      port_config_ydwg_raw_udp->get_tx_enabled() ||
+      port_config_ydwg_raw_udp->get_rx_enabled());
+}
 
-  auto n2k_to_0183_transform = new N2KTo0183Transform(nmea2000);
-  auto n2k_to_seasmart_transform = new SeasmartTransform(nmea2000);
-  auto ydwg_raw_to_can_transform = new YDWGRawToCANFrameTransform();
+static void ConfigureNMEA0183TCPServer() {
+  nmea0183_tcp_server->set_port(port_config_nmea0183_tcp_tx->get_port());
+  nmea0183_tcp_server->set_enabled(port_config_nmea0183_tcp_tx->get_enabled());
+}
 
-  can_to_ydwg_transform->connect_to(concatenate_ydwg_strings);
-  string_tokenizer->connect_to(ydwg_raw_to_can_transform);
+static void ConfigureNMEA0183UDPServer() {
+  nmea0183_udp_server->set_port(port_config_nmea0183_udp_tx->get_port());
+  ConfigureUDPOutput(nmea0183_udp_server,
+                     port_config_nmea0183_udp_tx->get_udp_output());
+  nmea0183_udp_server->set_enabled(port_config_nmea0183_udp_tx->get_enabled());
+}
 
-  //////
-  // N2K message routing
+static void ConfigureTCPSessionIdleTimeout() {
+  int timeout_s = integer_config_tcp_session_idle_timeout->get_value();
+  uint32_t timeout_ms = timeout_s > 0 ? timeout_s * 1000 : 0;
+  ydwg_raw_tcp_server->set_idle_timeout(timeout_ms);
+  nmea0183_tcp_server->set_idle_timeout(timeout_ms);
+}
 
-  // if configured, connect the N2K input to NMEA 0183 transform
+/**
+ * @brief Apply the settings of a TCP client.
+ *
+ * The store-and-forward buffer is set up when the client is first enabled.
+ */
+static void ConfigureTCPClient(StreamingTCPClient *client,
+                               HostPortConfig *config, const char *spill_path) {
+  bool enabled = config->get_enabled();
+  if (enabled && client->get_task_handle() == nullptr &&
+      client->get_store_and_forward() == nullptr) {
+    SetupStoreAndForward(client, spill_path);
+  }
+  client->set_target(config->get_host(), config->get_port());
+  client->set_enabled(enabled);
+}
 
-  if (checkbox_config_translate_to_nmea0183->get_value()) {
-    // the message handler called within this consumer will write its output
-    // to nmea0183_msg_observable
-    debugD("Connecting N2K to NMEA 0183");
-    n2k_msg_input.connect_to(n2k_to_0183_transform);
+/**
+ * @brief Apply the CAN bridge settings. The bridge is created when it is
+ * first enabled.
+ *
+ * @param start Start a newly created bridge; false during setup, when the
+ * application starts it
+ */
+static void ConfigureCANBridge(bool start) {
+  bool enabled = port_config_can_bridge->get_enabled();
+  IPAddress address;
+  if (enabled && !address.fromString(port_config_can_bridge->get_host())) {
+    debugE("Invalid CAN bridge address: %s",
+           port_config_can_bridge->get_host().c_str());
+    enabled = false;
   }
+  int port = port_config_can_bridge->get_port();
+  int batching_ms = integer_config_can_bridge_batching->get_value();
 
-  // if configured, connect the N2K input to Seasmart transform
+  if (can_bridge != nullptr) {
+    if (enabled) {
+      can_bridge->set_peer(address, port, port);
+      can_bridge->set_batching(batching_ms);
+    }
+    can_bridge->set_enabled(enabled);
+    return;
+  }
+  if (!enabled) {
+    return;
+  }
 
-  if (checkbox_config_translate_to_seasmart->get_value()) {
-    debugD("Connecting N2K to Seasmart");
-    n2k_msg_input.connect_to(n2k_to_seasmart_transform);
+  debugD("Connecting CAN frames to the CAN bridge");
+  can_bridge = new CANBridge(address, port, port, batching_ms, esp_random(),
+                             networking, kCANBridgeRXQueueSize);
+  can_frame_input.connect_to(can_bridge);
+  router->connect_to(can_bridge);
+  can_bridge->connect_to(can_frame_router);
+  if (trip_recorder != nullptr) {
+    can_bridge->connect_to(trip_recorder);
   }
+  if (start) {
+    can_bridge->start();
+  }
+}
+
+/**
+ * @brief Derive the routing table from the port and translation settings.
+ *
+ * Used while no routing table is configured.
+ */
+static String DefaultRoutingTable() {
+  bool translate_to_nmea0183 =
+      checkbox_config_translate_to_nmea0183->get_value();
+  bool translate_to_seasmart =
+      checkbox_config_translate_to_seasmart->get_value();
+  bool translate_from_nmea0183 =
+      checkbox_config_translate_from_nmea0183->get_value();
+  bool nmea0183_tcp = port_config_nmea0183_tcp_tx->get_enabled();
+  bool nmea0183_udp = port_config_nmea0183_udp_tx->get_enabled();
+  bool nmea0183_client = port_config_nmea0183_tcp_client->get_enabled();
+
+  String table = "";
+  auto add = [&table](bool enabled, const char *route) {
+    if (enabled) {
+      table += table.length() > 0 ? "; " : "";
+      table += route;
+    }
+  };
+  add(port_config_ydwg_raw_tcp->get_tx_enabled(), "can > ydwg > ydwg-tcp");
+  add(port_config_ydwg_raw_tcp->get_rx_enabled(), "ydwg-tcp > ydwg > can");
+  add(port_config_ydwg_raw_udp->get_tx_enabled(), "can > ydwg > ydwg-udp");
+  add(port_config_ydwg_raw_udp->get_rx_enabled(), "ydwg-udp > ydwg > can");
+  add(port_config_ydwg_raw_tcp_client->get_enabled(),
+      "can > ydwg > ydwg-client; ydwg-client > ydwg > can");
+  add(translate_to_nmea0183 && nmea0183_tcp, "can > 0183 > 0183-tcp");
+  add(translate_to_nmea0183 && nmea0183_udp, "can > 0183 > 0183-udp");
+  add(translate_to_nmea0183 && nmea0183_client, "can > 0183 > 0183-client");
+  add(translate_to_seasmart && nmea0183_tcp, "can > seasmart > 0183-tcp");
+  add(translate_to_seasmart && nmea0183_udp, "can > seasmart > 0183-udp");
+  add(translate_from_nmea0183 && nmea0183_tcp, "0183-tcp > 0183 > can");
+  add(translate_from_nmea0183 && nmea0183_udp, "0183-udp > 0183 > can");
+  add(translate_from_nmea0183 && nmea0183_client, "0183-client > 0183 > can");
+  return table;
+}
+
+/**
+ * @brief Compile a routing table into the router.
+ *
+ * An empty table is derived from the port settings. The router is left
+ * alone if the resulting table hasn't changed, so that the routes keep
+ * their counters and filter state.
+ */
+static void ApplyRoutingTable(const String &configured_table) {
+  static String applied_table = "";
+
+  String table = configured_table;
+  table.trim();
+  if (table.length() == 0) {
+    table = DefaultRoutingTable();
+  }
+  std::vector<Route> routes;
+  String error;
+  if (!ParseRoutingTable(table, routes, error)) {
+    debugE("Invalid routing table (%s); routing by the port settings",
+           error.c_str());
+    table = DefaultRoutingTable();
+    ParseRoutingTable(table, routes, error);
+  }
+  if (table == applied_table) {
+    return;
+  }
+  applied_table = table;
+  router->set_routes(routes);
+}
+
+/**
+ * @brief Apply a configuration saved in the web UI, without a restart.
+ */
+static void ApplyConfigChange(Configurable *config) {
+  if (config == port_config_ydwg_raw_tcp ||
+      config == checkbox_config_ydwg_raw_tcp_conflation) {
+    ConfigureYDWGRawTCPServer();
+  } else if (config == port_config_ydwg_raw_udp) {
+    ConfigureYDWGRawUDPServer();
+  } else if (config == port_config_nmea0183_tcp_tx) {
+    ConfigureNMEA0183TCPServer();
+  } else if (config == port_config_nmea0183_udp_tx) {
+    ConfigureNMEA0183UDPServer();
+  } else if (config == integer_config_tcp_session_idle_timeout) {
+    ConfigureTCPSessionIdleTimeout();
+  } else if (config == port_config_ydwg_raw_tcp_client) {
+    ConfigureTCPClient(ydwg_raw_tcp_client, port_config_ydwg_raw_tcp_client,
+                       "/spiffs/ydwg_raw_client.buf");
+  } else if (config == port_config_nmea0183_tcp_client) {
+    ConfigureTCPClient(nmea0183_tcp_client, port_config_nmea0183_tcp_client,
+                       "/spiffs/nmea0183_client.buf");
+  } else if (config == port_config_can_bridge ||
+             config == integer_config_can_bridge_batching) {
+    ConfigureCANBridge(true);
+  } else if (config == checkbox_config_echo_suppression) {
+    echo_filter->set_enabled(checkbox_config_echo_suppression->get_value());
+  } else if (config != routing_table_config &&
+             config != checkbox_config_translate_to_seasmart &&
+             config != checkbox_config_translate_to_nmea0183 &&
+             config != checkbox_config_translate_from_nmea0183) {
+    debugI("The configuration change takes effect after a restart");
+    return;
+  }
+
+  // the default routes follow the port and translation settings
+  ApplyRoutingTable(routing_table_config->get_value());
+}
+
+static void SetupConnections() {
+  can_frame_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
+      [](const CANFrame &frame) { return frame; });
+
+  router = new Router(
+      [](uint32_t pgn) { return nmea2000->IsFastPacketPGN(pgn); });
+
+  can_frame_sender = new LambdaConsumer<CANFrame>(SendCANFrame);
+
+  auto concatenate_ydwg_strings = new ConcatenateStrings(100, 1000);
+  auto concatenate_n0183_strings = new ConcatenateStrings(100, 1000);
+
+  uint32_t ais_static_data_replay_period_ms =
+      integer_config_ais_static_data_replay_period->get_value() * 1000;
+  n2k_to_0183_transform =
+      new N2KTo0183Transform(nmea2000, ais_static_data_replay_period_ms);
+  auto nmea0183_to_n2k_transform = new NMEA0183ToN2KTransform();
 
   //////
-  // CAN frame routing
+  // Formats
 
-  can_frame_input.connect_to(can_frame_clearinghouse);
-  can_frame_clearinghouse->connect_to(can_frame_sender);
-  ydwg_raw_to_can_transform->connect_to(can_frame_clearinghouse);
+  // the router encodes the N2K messages only for the routes taking them
+  router->set_nmea0183_encoder(n2k_to_0183_transform);
+  router->set_seasmart_encoder(AppendSeaSmartString);
+  router->set_nmea0183_decoder(nmea0183_to_n2k_transform);
+  n2k_msg_input.connect_to(router->get_message_input());
 
   // set up the YDWG RAW TCP server
 
   debugD("Setting up YDWG RAW TCP server");
   int ydwg_raw_tcp_port = port_config_ydwg_raw_tcp->get_port();
   ydwg_raw_tcp_server = new StreamingTCPServer(ydwg_raw_tcp_port, networking);
-  if (!port_config_ydwg_raw_tcp->get_tx_enabled() &&
-      !port_config_ydwg_raw_tcp->get_rx_enabled()) {
-    ydwg_raw_tcp_server->set_enabled(false);
-  }
+  ConfigureYDWGRawTCPServer();
+  ydwg_raw_tcp_server->set_subscriptions(
+      [](uint32_t pgn) { return nmea2000->IsFastPacketPGN(pgn); });
+  ydwg_raw_tcp_server->connect_to(
+      router->get_input(RouteEndpoint::kYDWGRawTCP));
+  router->set_sink(RouteEndpoint::kYDWGRawTCP, ydwg_raw_tcp_server, []() {
+    return ydwg_raw_tcp_server->get_num_sessions() > 0;
+  });
 
   // set up the YDWG RAW UDP server
 
   debugD("Setting up YDWG RAW UDP server");
   int ydwg_raw_udp_port = port_config_ydwg_raw_udp->get_port();
   ydwg_raw_udp_server = new StreamingUDPServer(ydwg_raw_udp_port, networking);
-  if (!port_config_ydwg_raw_udp->get_tx_enabled() &&
-      !port_config_ydwg_raw_udp->get_rx_enabled()) {
-    ydwg_raw_udp_server->set_enabled(false);
-  }
+  ConfigureYDWGRawUDPServer();
+  // datagrams hold several lines
+  auto ydwg_raw_udp_tokenizer = new StringTokenizer("\r\n");
+  ydwg_raw_udp_server->connect_to(ydwg_raw_udp_tokenizer);
+  ydwg_raw_udp_tokenizer->connect_to(
+      router->get_input(RouteEndpoint::kYDWGRawUDP));
+  auto yellow_led_blinker = NewYellowLEDBlinker();
+  router->set_sink(
+      RouteEndpoint::kYDWGRawUDP,
+      new LambdaConsumer<OriginString>(
+          [yellow_led_blinker, concatenate_ydwg_strings](OriginString line) {
+            yellow_led_blinker->set_input(line);
+            concatenate_ydwg_strings->set_input(line);
+          }),
+      []() { return ydwg_raw_udp_server->is_enabled(); });
+  concatenate_ydwg_strings->connect_to(ydwg_raw_udp_server);
 
   // set up the NMEA 0183 TCP server
 
   debugD("Setting up NMEA 0183 TCP server");
   int nmea0183_tcp_port = port_config_nmea0183_tcp_tx->get_port();
   nmea0183_tcp_server = new StreamingTCPServer(nmea0183_tcp_port, networking);
-  nmea0183_tcp_server->set_enabled(port_config_nmea0183_tcp_tx->get_enabled());
+  ConfigureNMEA0183TCPServer();
+  nmea0183_tcp_server->connect_to(
+      router->get_input(RouteEndpoint::kNMEA0183TCP));
+  router->set_sink(RouteEndpoint::kNMEA0183TCP, nmea0183_tcp_server, []() {
+    return nmea0183_tcp_server->get_num_sessions() > 0;
+  });
+  // bring new clients up to date with AIS vessel names and voyage data
+  nmea0183_tcp_server->set_client_connected_callback([](TCPSession &session) {
+    if (router->has_route(RouteFormat::kNMEA0183,
+                          RouteEndpoint::kNMEA0183TCP)) {
+      n2k_to_0183_transform->replay_static_data(
+          [&session](const char *data) { session.queue_line(data); });
+    }
+  });
+
+  ConfigureTCPSessionIdleTimeout();
 
   // set up the NMEA 0183 UDP server
 
   debugD("Setting up NMEA 0183 UDP server");
   int nmea0183_udp_port = port_config_nmea0183_udp_tx->get_port();
   nmea0183_udp_server = new StreamingUDPServer(nmea0183_udp_port, networking);
-  nmea0183_udp_server->set_enabled(port_config_nmea0183_udp_tx->get_enabled());
+  ConfigureNMEA0183UDPServer();
+  nmea0183_udp_server->connect_to(
+      router->get_input(RouteEndpoint::kNMEA0183UDP));
+  router->set_sink(RouteEndpoint::kNMEA0183UDP, concatenate_n0183_strings,
+                   []() { return nmea0183_udp_server->is_enabled(); });
+  concatenate_n0183_strings->connect_to(nmea0183_udp_server);
+
+  // set up the TCP clients; a disabled client doesn't run its task until
+  // it is enabled
+
+  ydwg_raw_tcp_client =
+      new StreamingTCPClient(port_config_ydwg_raw_tcp_client->get_host(),
+                             port_config_ydwg_raw_tcp_client->get_port(),
+                             networking);
+  ConfigureTCPClient(ydwg_raw_tcp_client, port_config_ydwg_raw_tcp_client,
+                     "/spiffs/ydwg_raw_client.buf");
+  auto ydwg_raw_tcp_client_tokenizer = new StringTokenizer("\r\n");
+  ydwg_raw_tcp_client->connect_to(ydwg_raw_tcp_client_tokenizer);
+  ydwg_raw_tcp_client_tokenizer->connect_to(
+      router->get_input(RouteEndpoint::kYDWGRawClient));
+  router->set_sink(RouteEndpoint::kYDWGRawClient, ydwg_raw_tcp_client,
+                   []() { return ydwg_raw_tcp_client->is_enabled(); });
+
+  nmea0183_tcp_client =
+      new StreamingTCPClient(port_config_nmea0183_tcp_client->get_host(),
+                             port_config_nmea0183_tcp_client->get_port(),
+                             networking);
+  ConfigureTCPClient(nmea0183_tcp_client, port_config_nmea0183_tcp_client,
+                     "/spiffs/nmea0183_client.buf");
+  nmea0183_tcp_client->connect_to(
+      router->get_input(RouteEndpoint::kNMEA0183Client));
+  router->set_sink(RouteEndpoint::kNMEA0183Client, nmea0183_tcp_client,
+                   []() { return nmea0183_tcp_client->is_enabled(); });
 
-  // send the generated NMEA 0183 message
-  if (checkbox_config_translate_to_nmea0183->get_value()) {
-    debugD("Connecting NMEA 0183 to consumers");
-    n2k_to_0183_transform->connect_to(nmea0183_tcp_server);
-    n2k_to_0183_transform->connect_to(concatenate_n0183_strings);
-    concatenate_n0183_strings->connect_to(nmea0183_udp_server);
-  }
+  //////
+  // Routes
 
-  // send the generated SeaSmart message
-  if (checkbox_config_translate_to_seasmart->get_value()) {
-    debugD("Connecting Seasmart to consumers");
-    n2k_to_seasmart_transform->connect_to(nmea0183_tcp_server);
-    n2k_to_seasmart_transform->connect_to(concatenate_n0183_strings);
-  }
+  ApplyRoutingTable(routing_table_config->get_value());
 
-  // set up a YDWG RAW TCP client
-  if (port_config_ydwg_raw_tcp_client->get_enabled()) {
-    String ydwg_raw_tcp_client_host =
-        port_config_ydwg_raw_tcp_client->get_host();
-    int ydwg_raw_tcp_client_port = port_config_ydwg_raw_tcp_client->get_port();
-    ydwg_raw_tcp_client = new StreamingTCPClient(
-        ydwg_raw_tcp_client_host, ydwg_raw_tcp_client_port, networking);
-    can_to_ydwg_transform->connect_to(ydwg_raw_tcp_client);
-    ydwg_raw_tcp_client->connect_to(string_tokenizer);
-  }
+  //////
+  // CAN frame routing
 
-  // set up an NMEA 0183 TCP client
-  if (port_config_nmea0183_tcp_client->get_enabled()) {
-    String nmea0183_tcp_client_host =
-        port_config_nmea0183_tcp_client->get_host();
-    int nmea0183_tcp_client_port = port_config_nmea0183_tcp_client->get_port();
-    nmea0183_tcp_client = new StreamingTCPClient(
-        nmea0183_tcp_client_host, nmea0183_tcp_client_port, networking);
-    n2k_to_0183_transform->connect_to(nmea0183_tcp_client);
-  }
+#ifdef SH_WG_STATIC_CAN_PIPELINE
+  // the YDWG RAW outputs are wired at compile time and enabled by the
+  // "can > ydwg" routes
+  debugD("Setting up the static CAN frame pipeline");
+  static_can_pipeline = SetupStaticCANPipeline();
+  can_frame_router = static_can_pipeline;
+#else
+  can_frame_router = can_frame_clearinghouse;
 
-  // connect the CAN frame input to the YDWG raw transform
-  debugD("Connecting CAN input to YDWG raw transform");
-  can_frame_clearinghouse->connect_to(can_to_ydwg_transform);
+  can_frame_clearinghouse->connect_to(can_frame_sender);
 
-  if (port_config_ydwg_raw_tcp->get_tx_enabled()) {
-    debugD("Connecting YDWG RAW TX to TCP server");
-    can_to_ydwg_transform->connect_to(ydwg_raw_tcp_server);
-  }
+  // frames are encoded as YDWG RAW once, and only for the routes currently
+  // taking them
+  debugD("Connecting CAN input to the router");
+  can_frame_clearinghouse->connect_to(router->get_frame_input());
+#endif
 
-  if (port_config_ydwg_raw_tcp->get_rx_enabled()) {
-    debugD("Connecting TCP server to YDWG RAW RX");
-    ydwg_raw_tcp_server->connect_to(ydwg_raw_to_can_transform);
+  // drop frames echoed back by other gateways before routing; a disabled
+  // filter passes the frames through
+  echo_filter = new EchoFilter(kEchoFilterCapacity, kEchoFilterWindowMs);
+  echo_filter->set_enabled(checkbox_config_echo_suppression->get_value());
+  echo_filter->connect_to(can_frame_router);
+  can_frame_router = echo_filter;
+
+  // the router emits the frames decoded from the ports
+  can_frame_input.connect_to(can_frame_router);
+  router->connect_to(can_frame_router);
+
+  // record the same frames as the YDWG RAW output
+  SetupTripRecorder();
+  if (trip_recorder != nullptr) {
+    debugD("Connecting CAN frames to the trip recorder");
+    can_frame_input.connect_to(trip_recorder);
+    router->connect_to(trip_recorder);
   }
 
-  if (port_config_ydwg_raw_udp->get_tx_enabled()) {
-    debugD("Connecting YDWG RAW to UDP TX");
-    SetupYellowLEDBlinker(can_to_ydwg_transform);
+  // set up the binary CAN bridge to other gateways
+  ConfigureCANBridge(false);
 
-    concatenate_ydwg_strings->connect_to(ydwg_raw_udp_server);
-  }
+  // apply the changes saved in the web UI without a restart
+  SetConfigChangeCallback(ApplyConfigChange);
+}
+
+static void AddStoreAndForwardTelemetry(const char *name,
+                                        StreamingTCPClient *client) {
+  runtime_telemetry->add_queue(
+      name,
+      [client]() {
+        StoreAndForwardBuffer *buffer = client->get_store_and_forward();
+        return buffer != nullptr ? buffer->size() : 0;
+      },
+      [client]() {
+        StoreAndForwardBuffer *buffer = client->get_store_and_forward();
+        return buffer != nullptr ? buffer->get_dropped() : 0;
+      });
+}
 
-  if (port_config_ydwg_raw_udp->get_rx_enabled()) {
-    debugD("Connecting UDP RX to YDWG RAW");
-    ydwg_raw_udp_server->connect_to(string_tokenizer);
+static void SetupRuntimeTelemetry() {
+  runtime_telemetry->add_task("main", []() { return main_task_handle; });
+  runtime_telemetry->add_task("ota_update",
+                              []() { return ota_update_task_handle; });
+  runtime_telemetry->add_task(
+      "can_rx", []() { return nmea2000->GetRXTaskHandle(); });
+  if (trip_recorder != nullptr) {
+    runtime_telemetry->add_task(
+        "trip_recorder", []() { return trip_recorder->get_task_handle(); });
   }
+  runtime_telemetry->add_task("ydwg_raw_tcp_client", []() {
+    return ydwg_raw_tcp_client->get_task_handle();
+  });
+  runtime_telemetry->add_task("nmea0183_tcp_client", []() {
+    return nmea0183_tcp_client->get_task_handle();
+  });
+
+  runtime_telemetry->add_queue(
+      "can_rx", []() { return (uint32_t)nmea2000->GetRXRingFill(); },
+      []() { return nmea2000->GetRXRingOverflows(); });
+  runtime_telemetry->add_queue("deferred_log", DeferredLogPending,
+                               DeferredLogDropped);
+  runtime_telemetry->add_queue("ydwg_raw_udp_rx",
+                               &ydwg_raw_udp_server->get_rx_queue_stats());
+  runtime_telemetry->add_queue("nmea0183_udp_rx",
+                               &nmea0183_udp_server->get_rx_queue_stats());
+  runtime_telemetry->add_queue("ydwg_raw_tcp_client_tx",
+                               &ydwg_raw_tcp_client->get_tx_queue_stats());
+  runtime_telemetry->add_queue("ydwg_raw_tcp_client_rx",
+                               &ydwg_raw_tcp_client->get_rx_queue_stats());
+  runtime_telemetry->add_queue("nmea0183_tcp_client_tx",
+                               &nmea0183_tcp_client->get_tx_queue_stats());
+  runtime_telemetry->add_queue("nmea0183_tcp_client_rx",
+                               &nmea0183_tcp_client->get_rx_queue_stats());
+
+  // the store-and-forward buffers and the CAN bridge are created when they
+  // are first enabled; the web server reads the list, so it is complete at
+  // setup
+  AddStoreAndForwardTelemetry("ydwg_raw_tcp_client_buffer",
+                              ydwg_raw_tcp_client);
+  AddStoreAndForwardTelemetry("nmea0183_tcp_client_buffer",
+                              nmea0183_tcp_client);
+  runtime_telemetry->add_queue(
+      "can_bridge_rx",
+      []() {
+        return can_bridge != nullptr
+                   ? can_bridge->get_rx_queue_stats().depth()
+                   : 0;
+      },
+      []() {
+        return can_bridge != nullptr
+                   ? can_bridge->get_rx_queue_stats().dropped.load()
+                   : 0;
+      });
 }
 
 String MacAddrToString(uint8_t *mac, bool add_colons) {
@@ -494,7 +1238,8 @@ void SetupUIComponents() {
   checkbox_config_enable_firmware_updates = new CheckboxConfig(
       true, "Enable", "/System/Enable Firmware Updates",
       "If enabled, the device will periodically check online and "
-      "install any available firmware updates.",
+      "install any available firmware updates. Takes effect after a "
+      "restart.",
       1100);
 
   port_config_ydwg_raw_tcp = new BiDiPortConfig(
@@ -503,6 +1248,25 @@ void SetupUIComponents() {
       "Enable TCP server for transmitting and/or receiving YDWG RAW data.",
       1300);
 
+  checkbox_config_ydwg_raw_tcp_conflation = new CheckboxConfig(
+      false, "Enable", "/Network/YDWG RAW TCP Server Conflation",
+      "Send only the latest value of each message to TCP clients that "
+      "can't keep up, instead of letting them fall further and further "
+      "behind. Messages are identified by PGN and source address; AIS "
+      "messages are always sent in full.",
+      1310);
+
+  integer_config_tcp_session_idle_timeout = new IntegerConfig(
+      kDefaultTCPSessionIdleTimeoutS, "Idle timeout (s)",
+      "/Network/TCP Session Idle Timeout",
+      "Close TCP server connections on which nothing has been received or "
+      "delivered for this long, to free the sessions of clients that went "
+      "away without closing the connection. Each TCP server accepts up to "
+      "10 clients. Clients that only receive are idle while their outputs "
+      "deliver nothing. Set to 0 (the default) to keep idle connections "
+      "open.",
+      1320);
+
   port_config_ydwg_raw_tcp_client = new HostPortConfig(
       false, "", kDefaultYdwgRawTCPServerPort, "Enabled", "Server hostname",
       "Server port", "/Network/YDWG RAW TCP Client",
@@ -513,7 +1277,36 @@ void SetupUIComponents() {
   port_config_ydwg_raw_udp = new BiDiPortConfig(
       true, false, "Transmit to WiFi", "Receive from WiFi",
       kDefaultYdwgRawUDPServerPort, "/Network/YDWG RAW over UDP",
-      "Broadcast and/or receive NMEA 2000 traffic as YDWG RAW over UDP.", 1400);
+      "Broadcast and/or receive NMEA 2000 traffic as YDWG RAW over UDP. "
+      "Access points often limit broadcast traffic; send to a multicast "
+      "group or to a list of unicast peers instead if the data doesn't get "
+      "through. Each peer may have a pacing interval in milliseconds for "
+      "which its data is collected into larger datagrams.",
+      1400, true);
+
+  checkbox_config_echo_suppression = new CheckboxConfig(
+      true, "Enable", "/Network/Echo Suppression",
+      "Drop frames received over the network that this gateway sent out "
+      "within the last second. Prevents frames from circulating between "
+      "gateways that bridge YDWG RAW data in both directions.",
+      1420);
+
+  port_config_can_bridge = new HostPortConfig(
+      false, "", kDefaultCANBridgePort, "Enabled",
+      "Peer or multicast group address", "Port", "/Network/CAN Bridge",
+      "Link the NMEA 2000 networks of two or more SH-wg gateways with a "
+      "compact binary protocol over UDP. Enter the IP address of the other "
+      "gateway on both gateways, or the same multicast group address "
+      "(e.g. 239.255.0.12) on all of them. Frames received from other "
+      "gateways are transmitted on the local bus.",
+      1450);
+
+  integer_config_can_bridge_batching = new IntegerConfig(
+      10, "Batching latency (ms)", "/Network/CAN Bridge Batching",
+      "Maximum time a frame is held back to be sent together with later "
+      "frames. Longer latencies reduce the number of datagrams. Set to 0 "
+      "to send every frame immediately. At most 250 ms.",
+      1451);
 
   checkbox_config_translate_to_seasmart = new CheckboxConfig(
       false, "Enable", "/Network/Translate to SeaSmart",
@@ -529,6 +1322,21 @@ void SetupUIComponents() {
       "be transmitted.",
       1700);
 
+  checkbox_config_translate_from_nmea0183 = new CheckboxConfig(
+      false, "Enable", "/Network/Translate NMEA 0183 to NMEA 2000",
+      "Translate RMC, GGA, HDG, MWV, DPT and VTG sentences received by the "
+      "NMEA 0183 servers and client to NMEA 2000 messages and transmit them "
+      "on the bus. Each sentence type is limited to 10 messages per second.",
+      1720);
+
+  integer_config_ais_static_data_replay_period = new IntegerConfig(
+      60, "Replay period (s)", "/Network/AIS Static Data Replay",
+      "Period for re-emitting cached AIS static and voyage related data "
+      "(vessel names, dimensions and destinations) in NMEA 0183 output. "
+      "Set to 0 to disable. Newly connected NMEA 0183 TCP clients always "
+      "receive the cached data on connection. Takes effect after a restart.",
+      1750);
+
   port_config_nmea0183_tcp_tx = new PortConfig(
       true, kDefaultNMEA0183TCPServerPort, "/Network/NMEA 0183 TCP Server",
       "Enable a TCP server for transmitting NMEA 0183 and SeaSmart.Net data.",
@@ -543,7 +1351,66 @@ void SetupUIComponents() {
 
   port_config_nmea0183_udp_tx = new PortConfig(
       true, kDefaultNMEA0183UDPServerPort, "/Network/NMEA 0183 over UDP",
-      "Broadcast NMEA 0183 and SeaSmart.Net data over UDP.", 1900);
+      "Broadcast NMEA 0183 and SeaSmart.Net data over UDP, or send it to a "
+      "multicast group or a list of unicast peers.",
+      1900, true);
+
+  integer_config_store_and_forward_max_age = new IntegerConfig(
+      0, "Maximum age (min)", "/Network/TCP Client Store and Forward",
+      "Buffer data for the TCP clients while the connection is down and send "
+      "it on reconnection, ahead of live data. Data older than the maximum "
+      "age is discarded. Set to 0 to disable. Takes effect after a restart.",
+      1950);
+
+  integer_config_store_and_forward_replay_rate = new IntegerConfig(
+      200, "Replay rate (messages/s)",
+      "/Network/TCP Client Store and Forward Replay Rate",
+      "Rate at which buffered data is sent after reconnection, on top of "
+      "live data. Takes effect after a restart.",
+      1951);
+
+  routing_table_config = new RoutingTableConfig(
+      "", "Routes", "/Network/Routing",
+      "Routes between the NMEA 2000 bus, the formats and the ports, "
+      "separated by semicolons: SOURCE > FORMAT > SINK [FILTER], e.g. "
+      "'can > ydwg > ydwg-tcp; 0183-udp > 0183 > can; can > seasmart > "
+      "0183-udp [129025 127250/1000]'. Sources and sinks are can, "
+      "ydwg-tcp, ydwg-udp, ydwg-client, 0183-tcp, 0183-udp and 0183-client; "
+      "formats are ydwg, 0183, seasmart and raw (forwarding between ports). "
+      "The filter lists PGN[:SOURCE][/INTERVAL_MS] entries. Changes take "
+      "effect when saved. Leave empty to route by the port and translation "
+      "settings.",
+      1960);
+
+  integer_config_trip_recorder_size = new IntegerConfig(
+      0, "Storage (kB)", "/Recording/Trip Recorder",
+      "Record all CAN frames to flash in a compact binary format. The "
+      "recordings are listed at /trips and are converted to YDWG RAW with "
+      "the shwg_trip_convert host tool. The oldest recordings are removed "
+      "when the storage limit is reached. The flash storage is shared with "
+      "the configuration and the store-and-forward buffers. Set to 0 to "
+      "disable. Takes effect after a restart.",
+      2000);
+
+  string_config_replay_file = new StringConfig(
+      "", "Recording file", "/Recording/Replay",
+      "Replay a YDWG RAW recording from the flash file system as if it was "
+      "received from the NMEA 2000 bus, for testing without a bus "
+      "connection. Enter the file name, e.g. ydwg_recording_1.txt; files in "
+      "the data directory are uploaded with 'pio run -t uploadfs', which "
+      "also resets the configuration. Leave empty to disable. The replay "
+      "settings take effect after a restart.",
+      2100);
+
+  integer_config_replay_speed = new IntegerConfig(
+      1, "Speed (x)", "/Recording/Replay Speed",
+      "Replay speed relative to the recording. Set to 0 to replay as fast "
+      "as possible.",
+      2101);
+
+  checkbox_config_replay_loop = new CheckboxConfig(
+      true, "Loop", "/Recording/Replay Loop",
+      "Start over at the end of the recording.", 2102);
 }
 
 // The setup function performs one-time application initialization.
@@ -597,8 +1464,80 @@ void setup() {
 
   auto *http_server = new HTTPServer();
 
+  runtime_telemetry = new RuntimeTelemetry();
+  main_task_handle = xTaskGetCurrentTaskHandle();
+
+  // runtime telemetry as JSON and in the Prometheus text format
+  http_server->add_handler(new HTTPRequestHandler(
+      HTTP_GET, "/telemetry", [](AsyncWebServerRequest *request) {
+        request->send(200, "application/json", runtime_telemetry->to_json());
+      }));
+  http_server->add_handler(new HTTPRequestHandler(
+      HTTP_GET, "/metrics", [](AsyncWebServerRequest *request) {
+        request->send(200, "text/plain; version=0.0.4",
+                      runtime_telemetry->to_prometheus());
+      }));
+
+  // trip recordings: a JSON list, or ?file=NAME to download a recording
+  http_server->add_handler(new HTTPRequestHandler(
+      HTTP_GET, "/trips", [](AsyncWebServerRequest *request) {
+        if (request->hasParam("file")) {
+          String name = request->getParam("file")->value();
+          if (!TripRecorder::is_recording_name(name.c_str()) ||
+              !SPIFFS.exists(String("/") + name)) {
+            request->send(404, "text/plain", "Not found\n");
+            return;
+          }
+          // streamed from flash in chunks
+          request->send(SPIFFS, String("/") + name, "application/octet-stream",
+                        true);
+          return;
+        }
+        DynamicJsonDocument doc(1024);
+        JsonArray files = doc.to<JsonArray>();
+        if (trip_recorder != nullptr) {
+          for (auto &file : trip_recorder->get_files()) {
+            JsonObject entry = files.createNestedObject();
+            entry["name"] = file.name;
+            entry["size"] = file.size;
+          }
+        }
+        String json;
+        serializeJson(doc, json);
+        request->send(200, "application/json", json);
+      }));
+
+#ifdef SH_WG_REACTION_PROFILER
+  // reaction execution time profile; add ?reset to start over
+  http_server->add_handler(new HTTPRequestHandler(
+      HTTP_GET, "/profile", [](AsyncWebServerRequest *request) {
+        if (request->hasParam("reset")) {
+          ReactionProfiler::reset();
+          request->send(200, "text/plain", "Profile reset\n");
+          return;
+        }
+        request->send(200, "text/plain", ReactionProfiler::report());
+      }));
+
+  // on the serial console, 'p' prints the profile and 'r' resets it
+  app.onAvailable(Serial, []() {
+    while (Serial.available()) {
+      switch (Serial.read()) {
+        case 'p':
+          Serial.print(ReactionProfiler::report());
+          break;
+        case 'r':
+          ReactionProfiler::reset();
+          Serial.println("Profile reset");
+          break;
+      }
+    }
+  });
+#endif
+
   if (checkbox_config_enable_firmware_updates->get_value()) {
-    xTaskCreate(ExecuteOTAUpdateTask, "OTAUpdateTask", 8000, NULL, 1, NULL);
+    xTaskCreate(ExecuteOTAUpdateTask, "OTAUpdateTask", 8000, NULL, 1,
+                &ota_update_task_handle);
   } else {
     debugI("Firmware updates disabled.");
   }
@@ -638,13 +1577,23 @@ void setup() {
 
   SetupConnections();
 
-  app.onRepeat(1000, []() {
-    debugD("Uptime: %lu, CAN RX: %d CAN TX: %d", millis() / 1000,
-           can_frame_rx_counter, can_frame_tx_counter);
+  SetupReplay();
+
+  SetupRuntimeTelemetry();
+
+  ProfiledOnRepeat(&app, 1000, "Status debug output", []() {
+    debugD("Uptime: %lu, CAN RX: %d CAN TX: %d RX ring overflows: %d",
+           millis() / 1000, can_frame_rx_counter, can_frame_tx_counter,
+           nmea2000->GetRXRingOverflows());
   });
 
+  // Output messages logged on hot paths
+  ProfiledOnRepeat(&app, 100, "Deferred log output",
+                   []() { DeferredLogDrain(16); });
+
   // Handle incoming NMEA 2000 messages
-  app.onRepeatMicros(50, []() { nmea2000->ParseMessages(); });
+  ProfiledOnRepeatMicros(&app, 50, "NMEA 2000 ParseMessages",
+                         []() { nmea2000->ParseMessages(); });
 
   // app.onAvailable(Serial, []() {
   //   // Flush the incoming serial buffer
@@ -656,4 +1605,10 @@ void setup() {
   sensesp_app->start();
 }
 
-void loop() { app.tick(); }
+void loop() {
+  uint32_t start_us = micros();
+  app.tick();
+  if (runtime_telemetry != nullptr) {
+    runtime_telemetry->record_loop_time(micros() - start_us);
+  }
+}
@@ -1,6 +1,8 @@
 #include "n2k_nmea0183_transform.h"
 
+#include "ais_encoding.h"
 #include "shwg.h"
+#include "deferred_log.h"
 #include "origin_string.h"
 
 #include <N2kMessages.h>
@@ -214,6 +216,10 @@ void N2KTo0183Transform::handle_class_a_ais_position(const tN2kMsg& msg) {
   if (ParseN2kPGN129038(msg, message_id, repeat, user_id, latitude, longitude,
                         accuracy, raim, seconds, cog, sog, heading, rot,
                         nav_status, AISTransceiverInformation, sid)) {
+    if (!ais_target_table_.update(user_id, latitude, longitude, cog, sog,
+                                  latitude_, longitude_)) {
+      return;
+    }
     if (SetAISClassABMessage1(nmea_0183_ais_msg, message_type, repeat, user_id,
                               latitude, longitude, accuracy, raim, seconds, cog,
                               sog, heading, rot, nav_status)) {
@@ -244,6 +250,10 @@ void N2KTo0183Transform::handle_class_b_ais_position(const tN2kMsg& msg) {
                         accuracy, raim, seconds, cog, sog,
                         ais_transceiver_information, heading, unit, display,
                         dsc, band, msg22, mode, state, sid)) {
+    if (!ais_target_table_.update(user_id, latitude, longitude, cog, sog,
+                                  latitude_, longitude_)) {
+      return;
+    }
     tNMEA0183AISMsg nmea_0183_ais_msg;
 
     if (SetAISClassBMessage18(nmea_0183_ais_msg, message_id, repeat, user_id,
@@ -291,8 +301,12 @@ void N2KTo0183Transform::handle_class_a_ais_static_and_voyage_related_data(
                              imo_number, callsign, name, vessel_type, length,
                              beam, pos_ref_stbd, pos_ref_bow, eta_date,
                              eta_time, draught, destination, gnss_type, dte)) {
-      emit_0183_string(nmea_0183_ais_msg.BuildMsg5Part1(nmea_0183_ais_msg));
-      emit_0183_string(nmea_0183_ais_msg.BuildMsg5Part2(nmea_0183_ais_msg));
+      AISStaticSentenceTable::Entry* entry =
+          static_sentence_table_.begin(user_id, 5);
+      emit_static_0183_string(
+          entry, nmea_0183_ais_msg.BuildMsg5Part1(nmea_0183_ais_msg));
+      emit_static_0183_string(
+          entry, nmea_0183_ais_msg.BuildMsg5Part2(nmea_0183_ais_msg));
     }
   }
 }
@@ -303,16 +317,21 @@ void N2KTo0183Transform::handle_class_b_ais_cs_static_data_report_part_a(
   tN2kAISRepeat repeat;
   uint32_t user_id;  // MMSI
   char name[21];
-  size_t nameBufSize;
-  tN2kAISTransceiverInformation aisInfo; 
+  size_t nameBufSize = sizeof(name);
+  tN2kAISTransceiverInformation aisInfo;
   uint8_t sid;
 
-
-  if (ParseN2kPGN129809(msg, message_id, repeat, user_id, name, nameBufSize, aisInfo, sid)) {
-    tNMEA0183AISMsg nmea_0183_ais_msg;
-    // data is stored in a vector to be transmitted when part B arrives
-    if (SetAISClassBMessage24PartA(nmea_0183_ais_msg, message_id, repeat,
-                                   user_id, name)) {
+  if (ParseN2kPGN129809(msg, message_id, repeat, user_id, name, nameBufSize,
+                        aisInfo, sid)) {
+    // the name is stored until part B arrives
+    AISClassBStaticDataCache::Entry* entry =
+        class_b_static_cache_.get_or_create(user_id);
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    entry->name[sizeof(entry->name) - 1] = '\0';
+    entry->repeat = repeat;
+    entry->has_part_a = true;
+    if (entry->has_part_b) {
+      emit_class_b_static_data(*entry);
     }
   }
 }
@@ -323,9 +342,9 @@ void N2KTo0183Transform::handle_class_b_ais_cs_static_data_report_part_b(
   tN2kAISRepeat repeat;
   uint32_t user_id, mothership_id;  // MMSI
   char callsign[8];
-  size_t callsignBufSize;
+  size_t callsignBufSize = sizeof(callsign);
   char vendor[4];
-  size_t vendorBufSize;
+  size_t vendorBufSize = sizeof(vendor);
   uint8_t vessel_type;
   double length;
   double beam;
@@ -333,22 +352,69 @@ void N2KTo0183Transform::handle_class_b_ais_cs_static_data_report_part_b(
   double pos_ref_bow;
   tN2kAISTransceiverInformation aisInfo;
   uint8_t sid;
-  
 
-  if (ParseN2kPGN129810(msg, message_id, repeat, user_id, vessel_type, vendor, vendorBufSize,
-                        callsign, callsignBufSize, length, beam, pos_ref_stbd, pos_ref_bow,
-                        mothership_id, aisInfo, sid)) {
-    tNMEA0183AISMsg nmea_0183_ais_msg;
+  if (ParseN2kPGN129810(msg, message_id, repeat, user_id, vessel_type, vendor,
+                        vendorBufSize, callsign, callsignBufSize, length, beam,
+                        pos_ref_stbd, pos_ref_bow, mothership_id, aisInfo,
+                        sid)) {
+    // Encoded locally, like Part A: the AIS library's Message 24 encoder
+    // works from its own unbounded list of ships, which is no longer fed
+    // with Part A reports.
+    tNMEA0183Msg part_b_msg;
+    if (!SetAISMessage24PartB(part_b_msg, repeat, user_id, vessel_type,
+                              vendor, callsign, length, beam, pos_ref_stbd,
+                              pos_ref_bow, mothership_id)) {
+      return;
+    }
 
-    if (SetAISClassBMessage24(nmea_0183_ais_msg, message_id, repeat, user_id,
-                              vessel_type, vendor, callsign, length, beam,
-                              pos_ref_stbd, pos_ref_bow, mothership_id)) {
-      emit_0183_string(nmea_0183_ais_msg.BuildMsg24PartA(nmea_0183_ais_msg));
-      emit_0183_string(nmea_0183_ais_msg.BuildMsg24PartB(nmea_0183_ais_msg));
+    AISClassBStaticDataCache::Entry* entry =
+        class_b_static_cache_.find(user_id);
+    if (entry == nullptr) {
+      entry = class_b_static_cache_.get_or_create(user_id);
+      entry->repeat = repeat;
+    }
+    if (!part_b_msg.GetMessage(entry->part_b, sizeof(entry->part_b))) {
+      deferredW("Could not get AIS Message 24 Part B string");
+      return;
+    }
+    entry->has_part_b = true;
+    if (entry->has_part_a) {
+      emit_class_b_static_data(*entry);
     }
   }
 }
 
+void N2KTo0183Transform::emit_class_b_static_data(
+    const AISClassBStaticDataCache::Entry& entry) {
+  tNMEA0183Msg part_a_msg;
+  if (SetAISMessage24PartA(part_a_msg, entry.repeat, entry.mmsi, entry.name)) {
+    AISStaticSentenceTable::Entry* static_entry =
+        static_sentence_table_.begin(entry.mmsi, 24);
+    emit_static_0183_string(static_entry, part_a_msg);
+    static_sentence_table_.append(static_entry, entry.part_b);
+    emit_0183_string(entry.part_b);
+  }
+}
+
+void N2KTo0183Transform::emit_static_0183_string(
+    AISStaticSentenceTable::Entry* entry, const tNMEA0183Msg& msg) {
+  char buf[kMaxNMEA0183MessageSize_];
+  if (!msg.GetMessage(buf, kMaxNMEA0183MessageSize_)) {
+    deferredW("Could not get NMEA 0183 message string");
+    return;
+  }
+  static_sentence_table_.append(entry, buf);
+  emit_0183_string(buf);
+}
+
+void N2KTo0183Transform::replay_next_static_data() {
+  const AISStaticSentenceTable::Entry* entry = static_sentence_table_.next();
+  if (entry != nullptr) {
+    OriginString output = {origin_id(nmea2000_), entry->data};
+    emit(output);
+  }
+}
+
 void N2KTo0183Transform::invalidate_old_data() {
   if (last_heading_elapsed_ > 2000) {
     heading_ = NMEA0183DoubleNA;
@@ -380,9 +446,13 @@ void N2KTo0183Transform::send_rmc() {
 void N2KTo0183Transform::emit_0183_string(const tNMEA0183Msg& msg) {
   char buf[kMaxNMEA0183MessageSize_];
   if (!msg.GetMessage(buf, kMaxNMEA0183MessageSize_)) {
-    debugW("Could not get NMEA 0183 message string");
+    deferredW("Could not get NMEA 0183 message string");
     return;
   }
-  OriginString output = {origin_id(nmea2000_), String(buf) + "\r\n"};
+  emit_0183_string(buf);
+}
+
+void N2KTo0183Transform::emit_0183_string(const char* sentence) {
+  OriginString output = {origin_id(nmea2000_), String(sentence) + "\r\n"};
   emit(output);
 }
@@ -5,27 +5,95 @@
 #include <NMEA2000.h>
 
 #include "ReactESP.h"
+#include "ais_static_data_cache.h"
+#include "ais_static_sentence_table.h"
+#include "ais_target_table.h"
 #include "elapsedMillis.h"
 #include "origin_string.h"
+#include "reaction_profiler.h"
 #include "sensesp/transforms/transform.h"
 
 using namespace sensesp;
 
 class N2KTo0183Transform : public Transform<tN2kMsg, OriginString> {
  public:
-  N2KTo0183Transform(tNMEA2000* nmea2000, String config_path = "")
-      : Transform(config_path), nmea2000_{nmea2000} {
+  /**
+   * @brief Construct a new N2KTo0183Transform object.
+   *
+   * @param nmea2000 NMEA 2000 object, used as the origin of the output
+   * @param static_data_replay_period_ms Period for re-emitting all cached
+   * AIS static data sentences. Set to 0 to disable.
+   * @param config_path
+   */
+  N2KTo0183Transform(tNMEA2000* nmea2000,
+                     uint32_t static_data_replay_period_ms = 0,
+                     String config_path = "")
+      : Transform(config_path),
+        nmea2000_{nmea2000},
+        static_sentence_table_{kStaticSentenceTableSize_,
+                               kStaticSentenceTableMaxAge_},
+        class_b_static_cache_{kClassBStaticCacheSize_,
+                              kClassBStaticCacheMaxAge_},
+        ais_target_table_{kAISTargetTableSize_, kAISNearRange_,
+                          kAISThrottlePeriod_, kAISCOGChangeThreshold_,
+                          kAISSOGChangeThreshold_} {
     // invalidate old data
-    ReactESP::app->onRepeat(10, [this]() { this->invalidate_old_data(); });
+    ProfiledOnRepeat(ReactESP::app, 10, "N2KTo0183Transform invalidate",
+                     [this]() { this->invalidate_old_data(); });
+    // drop unpaired AIS static data reports
+    ProfiledOnRepeat(ReactESP::app, 1000, "N2KTo0183Transform AIS expiry",
+                     [this]() { this->class_b_static_cache_.expire(); });
+    // re-emit cached AIS static data, one table slot at a time
+    if (static_data_replay_period_ms > 0) {
+      uint32_t interval =
+          static_data_replay_period_ms / kStaticSentenceTableSize_;
+      ProfiledOnRepeat(ReactESP::app, interval > 0 ? interval : 1,
+                       "N2KTo0183Transform AIS replay",
+                       [this]() { this->replay_next_static_data(); });
+    }
     // send RMC periodically
-    ReactESP::app->onRepeat(kRMCPeriod_, [this]() { this->send_rmc(); });
+    ProfiledOnRepeat(ReactESP::app, kRMCPeriod_, "N2KTo0183Transform RMC",
+                     [this]() { this->send_rmc(); });
   }
   virtual void set_input(tN2kMsg new_value, uint8_t input_channel = 0) override;
 
+  /**
+   * @brief Write all cached AIS static data sentences using the provided
+   * function. Used for bringing newly connected clients up to date.
+   */
+  void replay_static_data(std::function<void(const char*)> write) const {
+    static_sentence_table_.for_each(
+        [&write](const AISStaticSentenceTable::Entry& entry) {
+          write(entry.data);
+        });
+  }
+
+  const AISStaticSentenceTable& get_static_sentence_table() const {
+    return static_sentence_table_;
+  }
+  const AISClassBStaticDataCache& get_class_b_static_cache() const {
+    return class_b_static_cache_;
+  }
+  const AISTargetTable& get_ais_target_table() const {
+    return ais_target_table_;
+  }
+
  protected:
   tNMEA2000* nmea2000_;  //< used to hardcode the origin
   static const unsigned long kRMCPeriod_ = 1000;  // ms
   static const unsigned int kMaxNMEA0183MessageSize_ = 164;
+  static const size_t kStaticSentenceTableSize_ = 64;
+  static const uint32_t kStaticSentenceTableMaxAge_ = 30 * 60 * 1000;  // ms
+  static const size_t kClassBStaticCacheSize_ = 64;
+  // Class B units send Part A and Part B within a minute of each other
+  static const uint32_t kClassBStaticCacheMaxAge_ = 6 * 60 * 1000;  // ms
+  // AIS position reports from targets further away than kAISNearRange_ that
+  // haven't changed course or speed are forwarded once per throttle period
+  static const size_t kAISTargetTableSize_ = 256;
+  static constexpr double kAISNearRange_ = 3.0;           // nm
+  static const uint32_t kAISThrottlePeriod_ = 30 * 1000;  // ms
+  static constexpr double kAISCOGChangeThreshold_ = 5.0;  // deg
+  static constexpr double kAISSOGChangeThreshold_ = 1.0;  // kn
 
   // containers for last known values
   double latitude_ = NMEA0183DoubleNA;
@@ -49,6 +117,13 @@ class N2KTo0183Transform : public Transform<tN2kMsg, OriginString> {
 
   tNMEA0183* nmea0183_;
 
+  // most recently encoded AIS Message 5 and 24 sentences
+  AISStaticSentenceTable static_sentence_table_;
+  // AIS Message 24 parts waiting for their counterpart
+  AISClassBStaticDataCache class_b_static_cache_;
+  // AIS targets seen, used for throttling position reports
+  AISTargetTable ais_target_table_;
+
   // N2K message handlers
 
   void handle_heading(const tN2kMsg& msg);     // 127250
@@ -74,7 +149,13 @@ class N2KTo0183Transform : public Transform<tN2kMsg, OriginString> {
   void invalidate_old_data();
   void send_rmc();
 
+  void emit_class_b_static_data(const AISClassBStaticDataCache::Entry& entry);
+  void emit_static_0183_string(AISStaticSentenceTable::Entry* entry,
+                               const tNMEA0183Msg& msg);
+  void replay_next_static_data();
+
   void emit_0183_string(const tNMEA0183Msg& msg);
+  void emit_0183_string(const char* sentence);
 };
 
 #endif  // SH_WG_FIRMWARE_N2K_NMEA0183_TRANSFORM_H_
@@ -0,0 +1,333 @@
+#include "nmea0183_n2k_transform.h"
+
+#include <N2kMessages.h>
+
+#include "shwg.h"
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kDegToRad = kPi / 180.0;
+static constexpr double kKnotsToMs = 1852.0 / 3600.0;
+static constexpr double kKmhToMs = 1000.0 / 3600.0;
+
+static constexpr int kMaxFramesPerMsg = 32;
+
+int N2kMsgToCANFrames(const tN2kMsg& msg, uint8_t& sequence,
+                      CANFrame* frames) {
+  uint32_t can_id = ((uint32_t)(msg.Priority & 0x7) << 26) | msg.Source;
+  if ((msg.PGN & 0xFF00) < 0xF000) {
+    // PDU1 format; the PS field holds the destination address
+    can_id |= ((msg.PGN & 0x3FF00) | msg.Destination) << 8;
+  } else {
+    can_id |= (msg.PGN & 0x3FFFF) << 8;
+  }
+
+  if (msg.DataLen <= 8) {
+    frames[0].id = can_id;
+    frames[0].len = msg.DataLen;
+    memcpy(frames[0].buf, msg.Data, msg.DataLen);
+    return 1;
+  }
+
+  uint8_t sequence_bits = (sequence++ & 0x7) << 5;
+  int num_frames = 0;
+  int data_pos = 0;
+  while (data_pos < msg.DataLen && num_frames < kMaxFramesPerMsg) {
+    CANFrame& frame = frames[num_frames];
+    int buf_pos = 0;
+    frame.id = can_id;
+    frame.len = 8;
+    frame.buf[buf_pos++] = sequence_bits | num_frames;
+    if (num_frames == 0) {
+      frame.buf[buf_pos++] = msg.DataLen;
+    }
+    while (buf_pos < 8) {
+      // pad the last frame with 0xFF
+      frame.buf[buf_pos++] =
+          data_pos < msg.DataLen ? msg.Data[data_pos] : 0xFF;
+      data_pos++;
+    }
+    num_frames++;
+  }
+  return num_frames;
+}
+
+void NMEA0183ToN2KTransform::set_input(OriginString new_value,
+                                       uint8_t input_channel) {
+  const char* data = new_value.data.c_str();
+  for (const char* p = data; *p != '\0'; p++) {
+    if (parser_.feed(*p)) {
+      handle_sentence(new_value.origin_id);
+    }
+  }
+  // inputs consist of whole lines; don't let a partial sentence linger
+  if (parser_.end()) {
+    handle_sentence(new_value.origin_id);
+  }
+}
+
+void NMEA0183ToN2KTransform::handle_sentence(uint32_t origin_id) {
+  static const char* const kFormatters[kNumSentenceTypes] = {
+      "RMC", "GGA", "HDG", "MWV", "DPT", "VTG"};
+
+  int type = 0;
+  while (type < kNumSentenceTypes &&
+         !parser_.is_formatter(kFormatters[type])) {
+    type++;
+  }
+  if (type == kNumSentenceTypes ||
+      !check_rate_limit(origin_id, (SentenceType)type)) {
+    return;
+  }
+
+  switch (type) {
+    case kRMC:
+      handle_rmc();
+      break;
+    case kGGA:
+      handle_gga();
+      break;
+    case kHDG:
+      handle_hdg();
+      break;
+    case kMWV:
+      handle_mwv();
+      break;
+    case kDPT:
+      handle_dpt();
+      break;
+    case kVTG:
+      handle_vtg();
+      break;
+  }
+}
+
+bool NMEA0183ToN2KTransform::check_rate_limit(uint32_t origin_id,
+                                              SentenceType type) {
+  const char* address = parser_.get_field(0);
+  uint16_t talker = ((uint8_t)address[0] << 8) | (uint8_t)address[1];
+  uint32_t now = millis();
+  RateLimit* oldest = &rate_limits_[0];
+  for (auto& limit : rate_limits_) {
+    if (limit.used && limit.type == type && limit.talker == talker &&
+        limit.origin_id == origin_id) {
+      if (now - limit.last_ms < min_interval_ms_) {
+        rate_limited_++;
+        return false;
+      }
+      limit.last_ms = now;
+      return true;
+    }
+    if (!oldest->used) {
+      continue;
+    }
+    if (!limit.used || now - limit.last_ms > now - oldest->last_ms) {
+      oldest = &limit;
+    }
+  }
+  // a new source replaces the one that has been quiet for the longest;
+  // if all were active within the interval, the table is being flooded
+  if (oldest->used && now - oldest->last_ms < min_interval_ms_) {
+    rate_limited_++;
+    return false;
+  }
+  oldest->used = true;
+  oldest->type = type;
+  oldest->talker = talker;
+  oldest->origin_id = origin_id;
+  oldest->last_ms = now;
+  return true;
+}
+
+// $GPRMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a*hh
+void NMEA0183ToN2KTransform::handle_rmc() {
+  if (parser_.get_field(2)[0] != 'A') {
+    // no valid fix
+    return;
+  }
+  uint16_t days_since_1970;
+  if (ParseNMEA0183Date(parser_.get_field(9), days_since_1970)) {
+    days_since_1970_ = days_since_1970;
+  }
+
+  double latitude;
+  double longitude;
+  if (ParseNMEA0183LatLon(parser_.get_field(3), parser_.get_field(4),
+                          latitude) &&
+      ParseNMEA0183LatLon(parser_.get_field(5), parser_.get_field(6),
+                          longitude)) {
+    tN2kMsg msg;
+    SetN2kLatLonRapid(msg, latitude, longitude);
+    emit_n2k_msg(msg);
+  }
+
+  double sog;
+  double cog;
+  if (ParseNMEA0183Double(parser_.get_field(7), sog)) {
+    if (!ParseNMEA0183Double(parser_.get_field(8), cog)) {
+      cog = N2kDoubleNA;
+    } else {
+      cog *= kDegToRad;
+    }
+    tN2kMsg msg;
+    SetN2kCOGSOGRapid(msg, 0xFF, N2khr_true, cog, sog * kKnotsToMs);
+    emit_n2k_msg(msg);
+  }
+}
+
+// $GPGGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh
+void NMEA0183ToN2KTransform::handle_gga() {
+  double seconds_since_midnight;
+  double latitude;
+  double longitude;
+  double quality;
+  if (!ParseNMEA0183Time(parser_.get_field(1), seconds_since_midnight) ||
+      !ParseNMEA0183LatLon(parser_.get_field(2), parser_.get_field(3),
+                           latitude) ||
+      !ParseNMEA0183LatLon(parser_.get_field(4), parser_.get_field(5),
+                           longitude) ||
+      !ParseNMEA0183Double(parser_.get_field(6), quality) || quality == 0) {
+    return;
+  }
+
+  // NMEA 0183 fix quality values 1-5 map directly to the N2K GNSS method
+  tN2kGNSSmethod method =
+      quality <= 5 ? (tN2kGNSSmethod)quality : N2kGNSSm_Unavailable;
+
+  double value;
+  unsigned char num_satellites =
+      ParseNMEA0183Double(parser_.get_field(7), value) ? (unsigned char)value
+                                                       : N2kUInt8NA;
+  double hdop = ParseNMEA0183Double(parser_.get_field(8), value)
+                    ? value
+                    : N2kDoubleNA;
+  double altitude = ParseNMEA0183Double(parser_.get_field(9), value)
+                        ? value
+                        : N2kDoubleNA;
+  double geoidal_separation =
+      ParseNMEA0183Double(parser_.get_field(11), value) ? value : N2kDoubleNA;
+  double age_of_correction =
+      ParseNMEA0183Double(parser_.get_field(13), value) ? value : N2kDoubleNA;
+
+  tN2kMsg msg;
+  SetN2kGNSS(msg, 0xFF, days_since_1970_, seconds_since_midnight, latitude,
+             longitude, altitude, N2kGNSSt_GPS, method, num_satellites, hdop,
+             N2kDoubleNA, geoidal_separation, 0, N2kGNSSt_GPS, 0,
+             age_of_correction);
+  emit_n2k_msg(msg);
+}
+
+// $HCHDG,x.x,x.x,a,x.x,a*hh
+void NMEA0183ToN2KTransform::handle_hdg() {
+  double heading;
+  if (!ParseNMEA0183Double(parser_.get_field(1), heading)) {
+    return;
+  }
+  double deviation = N2kDoubleNA;
+  double variation = N2kDoubleNA;
+  double value;
+  if (ParseNMEA0183Double(parser_.get_field(2), value)) {
+    deviation = (parser_.get_field(3)[0] == 'W' ? -value : value) * kDegToRad;
+  }
+  if (ParseNMEA0183Double(parser_.get_field(4), value)) {
+    variation = (parser_.get_field(5)[0] == 'W' ? -value : value) * kDegToRad;
+  }
+
+  tN2kMsg msg;
+  SetN2kPGN127250(msg, 0xFF, heading * kDegToRad, deviation, variation,
+                  N2khr_magnetic);
+  emit_n2k_msg(msg);
+}
+
+// $WIMWV,x.x,a,x.x,a,A*hh
+void NMEA0183ToN2KTransform::handle_mwv() {
+  double angle;
+  double speed;
+  if (parser_.get_field(5)[0] != 'A' ||
+      !ParseNMEA0183Double(parser_.get_field(1), angle) ||
+      !ParseNMEA0183Double(parser_.get_field(3), speed)) {
+    return;
+  }
+  switch (parser_.get_field(4)[0]) {
+    case 'N':
+      speed *= kKnotsToMs;
+      break;
+    case 'K':
+      speed *= kKmhToMs;
+      break;
+    case 'M':
+      break;
+    default:
+      return;
+  }
+  tN2kWindReference reference;
+  switch (parser_.get_field(2)[0]) {
+    case 'R':
+      reference = N2kWind_Apparent;
+      break;
+    case 'T':
+      reference = N2kWind_True_boat;
+      break;
+    default:
+      return;
+  }
+
+  tN2kMsg msg;
+  SetN2kWindSpeed(msg, 0xFF, speed, angle * kDegToRad, reference);
+  emit_n2k_msg(msg);
+}
+
+// $SDDPT,x.x,x.x,x.x*hh
+void NMEA0183ToN2KTransform::handle_dpt() {
+  double depth;
+  if (!ParseNMEA0183Double(parser_.get_field(1), depth)) {
+    return;
+  }
+  double offset;
+  if (!ParseNMEA0183Double(parser_.get_field(2), offset)) {
+    offset = N2kDoubleNA;
+  }
+
+  tN2kMsg msg;
+  SetN2kWaterDepth(msg, 0xFF, depth, offset);
+  emit_n2k_msg(msg);
+}
+
+// $GPVTG,x.x,T,x.x,M,x.x,N,x.x,K,a*hh
+void NMEA0183ToN2KTransform::handle_vtg() {
+  double sog;
+  if (ParseNMEA0183Double(parser_.get_field(5), sog)) {
+    sog *= kKnotsToMs;
+  } else if (ParseNMEA0183Double(parser_.get_field(7), sog)) {
+    sog *= kKmhToMs;
+  } else {
+    return;
+  }
+
+  double cog;
+  tN2kHeadingReference reference = N2khr_true;
+  if (!ParseNMEA0183Double(parser_.get_field(1), cog)) {
+    reference = N2khr_magnetic;
+    if (!ParseNMEA0183Double(parser_.get_field(3), cog)) {
+      cog = N2kDoubleNA;
+      reference = N2khr_true;
+    }
+  }
+  if (!N2kIsNA(cog)) {
+    cog *= kDegToRad;
+  }
+
+  tN2kMsg msg;
+  SetN2kCOGSOGRapid(msg, 0xFF, reference, cog, sog);
+  emit_n2k_msg(msg);
+}
+
+void NMEA0183ToN2KTransform::emit_n2k_msg(const tN2kMsg& msg) {
+  CANFrame frames[kMaxFramesPerMsg];
+  int num_frames = N2kMsgToCANFrames(msg, fast_packet_sequence_, frames);
+  converted_++;
+  for (int i = 0; i < num_frames; i++) {
+    frames[i].origin_id = origin_id(this);
+    frames[i].origin_type = CANFrameOriginType::kApp;
+    emit(frames[i]);
+  }
+}
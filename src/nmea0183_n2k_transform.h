@@ -0,0 +1,93 @@
+#ifndef SH_WG_FIRMWARE_NMEA0183_N2K_TRANSFORM_H_
+#define SH_WG_FIRMWARE_NMEA0183_N2K_TRANSFORM_H_
+
+#include <N2kMsg.h>
+
+#include "can_frame.h"
+#include "nmea0183_parser.h"
+#include "origin_string.h"
+#include "sensesp/transforms/transform.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Transform that converts NMEA 0183 sentences into NMEA 2000 CAN
+ * frames.
+ *
+ * Supported sentences are RMC, GGA, HDG, MWV, DPT and VTG. Each sentence type
+ * is rate limited separately for each input and talker, so that a
+ * misbehaving NMEA 0183 source can't flood the bus and two sources of the
+ * same sentence type, e.g. two GPS receivers, don't starve each other. Once
+ * kMaxRateLimits sources have been active within the interval, sentences of
+ * new sources are dropped.
+ *
+ * The output frames have the kApp origin type, so the CAN frame sender
+ * replaces their source address with our own before transmission.
+ */
+class NMEA0183ToN2KTransform : public Transform<OriginString, CANFrame> {
+ public:
+  NMEA0183ToN2KTransform(unsigned int min_interval_ms = 100)
+      : Transform<OriginString, CANFrame>(),
+        min_interval_ms_{min_interval_ms} {}
+
+  void set_input(OriginString new_value, uint8_t input_channel = 0) override;
+
+  uint32_t get_sentences() const { return parser_.get_sentences(); }
+  uint32_t get_checksum_errors() const {
+    return parser_.get_checksum_errors();
+  }
+  uint32_t get_rate_limited() const { return rate_limited_; }
+  uint32_t get_converted() const { return converted_; }
+
+ protected:
+  enum SentenceType { kRMC, kGGA, kHDG, kMWV, kDPT, kVTG, kNumSentenceTypes };
+
+  // rate limiting state of one sentence type from one talker on one input
+  struct RateLimit {
+    bool used;
+    uint8_t type;
+    uint16_t talker;  //< Two-letter talker id
+    uint32_t origin_id;
+    uint32_t last_ms;  //< Last sentence passed
+  };
+
+  static constexpr int kMaxRateLimits = 32;
+
+  const unsigned int min_interval_ms_;
+  NMEA0183SentenceParser parser_;
+
+  RateLimit rate_limits_[kMaxRateLimits] = {};
+
+  // date from the latest RMC sentence; GGA doesn't include one
+  uint16_t days_since_1970_ = N2kUInt16NA;
+  uint8_t fast_packet_sequence_ = 0;
+
+  uint32_t rate_limited_ = 0;
+  uint32_t converted_ = 0;
+
+  void handle_sentence(uint32_t origin_id);
+  bool check_rate_limit(uint32_t origin_id, SentenceType type);
+
+  void handle_rmc();
+  void handle_gga();
+  void handle_hdg();
+  void handle_mwv();
+  void handle_dpt();
+  void handle_vtg();
+
+  void emit_n2k_msg(const tN2kMsg& msg);
+};
+
+/**
+ * @brief Split an N2K message into CAN frames.
+ *
+ * Messages longer than 8 bytes are sent as fast packets.
+ *
+ * @param msg Source message
+ * @param sequence Fast packet sequence counter, incremented for fast packets
+ * @param frames Destination array, must hold at least 32 frames
+ * @return int Number of frames written
+ */
+int N2kMsgToCANFrames(const tN2kMsg& msg, uint8_t& sequence, CANFrame* frames);
+
+#endif  // SH_WG_FIRMWARE_NMEA0183_N2K_TRANSFORM_H_
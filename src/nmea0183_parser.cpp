@@ -0,0 +1,166 @@
+#include "nmea0183_parser.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+bool NMEA0183SentenceParser::feed(char c) {
+  if (c == '$' || c == '!') {
+    // start of a new sentence; discard anything received so far
+    pos_ = 0;
+    in_sentence_ = true;
+    return false;
+  }
+  if (!in_sentence_) {
+    return false;
+  }
+  if (c == '\r' || c == '\n') {
+    in_sentence_ = false;
+    return finish_sentence();
+  }
+  if (pos_ == kMaxSentenceLength) {
+    overflows_++;
+    in_sentence_ = false;
+    return false;
+  }
+  buf_[pos_++] = c;
+  return false;
+}
+
+bool NMEA0183SentenceParser::finish_sentence() {
+  buf_[pos_] = '\0';
+  num_fields_ = 0;
+
+  // the checksum is mandatory
+  char* star = (char*)memchr(buf_, '*', pos_);
+  if (star == nullptr || star + 3 != buf_ + pos_) {
+    checksum_errors_++;
+    return false;
+  }
+  int hi = HexDigitValue(star[1]);
+  int lo = HexDigitValue(star[2]);
+  uint8_t checksum = 0;
+  for (char* p = buf_; p < star; p++) {
+    checksum ^= *p;
+  }
+  if (hi < 0 || lo < 0 || checksum != ((hi << 4) | lo)) {
+    checksum_errors_++;
+    return false;
+  }
+  *star = '\0';
+
+  // split the fields in place
+  char* p = buf_;
+  fields_[num_fields_++] = p;
+  while ((p = strchr(p, ',')) != nullptr) {
+    *p++ = '\0';
+    if (num_fields_ == kMaxFields) {
+      overflows_++;
+      num_fields_ = 0;
+      return false;
+    }
+    fields_[num_fields_++] = p;
+  }
+
+  // the address field consists of a talker id and a formatter
+  if (strlen(fields_[0]) < 5) {
+    num_fields_ = 0;
+    return false;
+  }
+
+  sentences_++;
+  return true;
+}
+
+bool NMEA0183SentenceParser::is_formatter(const char* formatter) const {
+  if (num_fields_ == 0) {
+    return false;
+  }
+  // skip the two-letter talker id
+  return strcmp(fields_[0] + 2, formatter) == 0;
+}
+
+bool ParseNMEA0183Double(const char* field, double& value) {
+  if (field[0] == '\0') {
+    return false;
+  }
+  char* end;
+  value = strtod(field, &end);
+  return *end == '\0';
+}
+
+bool ParseNMEA0183LatLon(const char* field, const char* hemisphere_field,
+                         double& value) {
+  double raw;
+  if (!ParseNMEA0183Double(field, raw)) {
+    return false;
+  }
+  int degrees = (int)(raw / 100);
+  value = degrees + (raw - degrees * 100) / 60.0;
+  switch (hemisphere_field[0]) {
+    case 'N':
+    case 'E':
+      return true;
+    case 'S':
+    case 'W':
+      value = -value;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool ParseNMEA0183Time(const char* field, double& seconds_since_midnight) {
+  double raw;
+  if (strlen(field) < 6 || !ParseNMEA0183Double(field, raw)) {
+    return false;
+  }
+  int hhmm = (int)(raw / 100);
+  double seconds = raw - hhmm * 100;
+  int hours = hhmm / 100;
+  int minutes = hhmm % 100;
+  if (hours > 23 || minutes > 59 || seconds >= 61) {
+    return false;
+  }
+  seconds_since_midnight = hours * 3600 + minutes * 60 + seconds;
+  return true;
+}
+
+bool ParseNMEA0183Date(const char* field, uint16_t& days_since_1970) {
+  if (strlen(field) != 6) {
+    return false;
+  }
+  for (int i = 0; i < 6; i++) {
+    if (field[i] < '0' || field[i] > '9') {
+      return false;
+    }
+  }
+  int day = (field[0] - '0') * 10 + (field[1] - '0');
+  int month = (field[2] - '0') * 10 + (field[3] - '0');
+  int year = (field[4] - '0') * 10 + (field[5] - '0');
+  year += year < 80 ? 2000 : 1900;
+  if (day < 1 || day > 31 || month < 1 || month > 12) {
+    return false;
+  }
+  // days_from_civil() from
+  // http://howardhinnant.github.io/date_algorithms.html
+  year -= month <= 2;
+  int era = year / 400;
+  int yoe = year - era * 400;
+  int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  days_since_1970 = era * 146097 + doe - 719468;
+  return true;
+}
@@ -0,0 +1,97 @@
+#ifndef SH_WG_FIRMWARE_NMEA0183_PARSER_H_
+#define SH_WG_FIRMWARE_NMEA0183_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Streaming NMEA 0183 sentence parser.
+ *
+ * Characters are fed one at a time. When a line terminator is received, the
+ * checksum is validated and the sentence is split into fields in place: the
+ * field separators in the internal buffer are replaced with zeros and the
+ * field pointers refer to the buffer. No memory is allocated.
+ *
+ * Field 0 is the address field, e.g. "GPRMC". The checksum is not included
+ * in the fields.
+ */
+class NMEA0183SentenceParser {
+ public:
+  // NMEA 0183 sentences are at most 82 characters long; allow some slack
+  static constexpr size_t kMaxSentenceLength = 100;
+  static constexpr int kMaxFields = 24;
+
+  /**
+   * @brief Feed a character to the parser.
+   *
+   * @return true A complete and valid sentence is available.
+   */
+  bool feed(char c);
+
+  /**
+   * @brief Terminate the current sentence, if any.
+   *
+   * Used at the end of an input that is known to contain whole sentences.
+   *
+   * @return true A complete and valid sentence is available.
+   */
+  bool end() { return feed('\n'); }
+
+  int get_num_fields() const { return num_fields_; }
+  const char* get_field(int i) const {
+    return i < num_fields_ ? fields_[i] : "";
+  }
+
+  /**
+   * @brief Test whether the sentence formatter equals the given one.
+   *
+   * @param formatter Three-letter sentence formatter, e.g. "RMC"
+   */
+  bool is_formatter(const char* formatter) const;
+
+  uint32_t get_sentences() const { return sentences_; }
+  uint32_t get_checksum_errors() const { return checksum_errors_; }
+  uint32_t get_overflows() const { return overflows_; }
+
+ protected:
+  char buf_[kMaxSentenceLength + 1];
+  size_t pos_ = 0;
+  bool in_sentence_ = false;
+
+  const char* fields_[kMaxFields];
+  int num_fields_ = 0;
+
+  uint32_t sentences_ = 0;
+  uint32_t checksum_errors_ = 0;
+  uint32_t overflows_ = 0;
+
+  bool finish_sentence();
+};
+
+/**
+ * @brief Parse a numeric field.
+ *
+ * @return false The field is empty or not a number.
+ */
+bool ParseNMEA0183Double(const char* field, double& value);
+
+/**
+ * @brief Parse a latitude or longitude field pair into decimal degrees.
+ *
+ * @param field Value in (d)ddmm.mmmm format
+ * @param hemisphere_field One of N, S, E or W
+ */
+bool ParseNMEA0183LatLon(const char* field, const char* hemisphere_field,
+                         double& value);
+
+/**
+ * @brief Parse a hhmmss.ss time field into seconds since midnight.
+ */
+bool ParseNMEA0183Time(const char* field, double& seconds_since_midnight);
+
+/**
+ * @brief Parse a ddmmyy date field into days since 1970-01-01.
+ */
+bool ParseNMEA0183Date(const char* field, uint16_t& days_since_1970);
+
+#endif  // SH_WG_FIRMWARE_NMEA0183_PARSER_H_
@@ -0,0 +1,21 @@
+#ifndef SH_WG_FIRMWARE_QUEUE_STATS_H_
+#define SH_WG_FIRMWARE_QUEUE_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Counters for a queue between two tasks.
+ *
+ * The producer task counts enqueued and dropped items and the consumer task
+ * counts dequeued items; the difference is the current queue depth.
+ */
+struct QueueStats {
+  std::atomic<uint32_t> enqueued{0};
+  std::atomic<uint32_t> dequeued{0};
+  std::atomic<uint32_t> dropped{0};  //< Items dropped on a full queue
+
+  uint32_t depth() const { return enqueued.load() - dequeued.load(); }
+};
+
+#endif  // SH_WG_FIRMWARE_QUEUE_STATS_H_
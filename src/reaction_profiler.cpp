@@ -0,0 +1,93 @@
+#include "reaction_profiler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+// Reactions are registered from the main task and from the TCP client
+// tasks; the mutex protects the registry, not the statistics themselves.
+static std::mutex registry_mutex;
+static std::vector<ReactionStats*> registry;
+static unsigned long profiling_start_ms = 0;
+
+react_callback ReactionProfiler::wrap(const char* name, uint32_t interval_us,
+                                      react_callback callback) {
+  ReactionStats* stats = new ReactionStats();
+  stats->name = name;
+  stats->interval_us = interval_us;
+
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int same_name = 0;
+    for (auto existing : registry) {
+      if (existing->name == name ||
+          existing->name.startsWith(String(name) + " #")) {
+        same_name++;
+      }
+    }
+    if (same_name > 0) {
+      stats->name += " #" + String(same_name + 1);
+    }
+    registry.push_back(stats);
+  }
+
+  return [stats, callback]() {
+    uint32_t start_us = micros();
+    callback();
+    uint32_t elapsed_us = micros() - start_us;
+
+    stats->calls++;
+    stats->total_us += elapsed_us;
+    if (elapsed_us > stats->max_us) {
+      stats->max_us = elapsed_us;
+    }
+    if (elapsed_us > stats->interval_us) {
+      stats->overruns++;
+    }
+  };
+}
+
+String ReactionProfiler::report() {
+  std::vector<ReactionStats*> sorted;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    sorted = registry;
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const ReactionStats* a, const ReactionStats* b) {
+              return a->total_us > b->total_us;
+            });
+
+  unsigned long elapsed_ms = millis() - profiling_start_ms;
+
+  String report;
+  char line[160];
+  snprintf(line, sizeof(line), "Reaction profile over %lu ms\n", elapsed_ms);
+  report += line;
+  snprintf(line, sizeof(line), "%-40s %10s %10s %10s %6s %8s %8s %8s\n",
+           "reaction", "interval", "calls", "total ms", "cpu %", "avg us",
+           "max us", "overruns");
+  report += line;
+  for (auto stats : sorted) {
+    snprintf(line, sizeof(line),
+             "%-40s %10u %10u %10llu %6.2f %8u %8u %8u\n", stats->name.c_str(),
+             (unsigned)stats->interval_us, (unsigned)stats->calls,
+             (unsigned long long)(stats->total_us / 1000),
+             elapsed_ms > 0 ? stats->total_us / (10.0 * elapsed_ms) : 0.0,
+             stats->calls > 0 ? (unsigned)(stats->total_us / stats->calls) : 0,
+             (unsigned)stats->max_us, (unsigned)stats->overruns);
+    report += line;
+  }
+  return report;
+}
+
+void ReactionProfiler::reset() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (auto stats : registry) {
+    stats->calls = 0;
+    stats->total_us = 0;
+    stats->max_us = 0;
+    stats->overruns = 0;
+  }
+  profiling_start_ms = millis();
+}
@@ -0,0 +1,66 @@
+#ifndef SH_WG_FIRMWARE_REACTION_PROFILER_H_
+#define SH_WG_FIRMWARE_REACTION_PROFILER_H_
+
+#include <Arduino.h>
+
+#include "ReactESP.h"
+
+using namespace reactesp;
+
+/**
+ * @brief Execution time statistics of one profiled reaction.
+ */
+struct ReactionStats {
+  String name;
+  uint32_t interval_us;
+  uint32_t calls = 0;
+  uint64_t total_us = 0;
+  uint32_t max_us = 0;
+  uint32_t overruns = 0;  //< Calls that took longer than the interval
+};
+
+/**
+ * @brief Registry of profiled reactions.
+ *
+ * Reactions are only wrapped if the firmware is built with
+ * SH_WG_REACTION_PROFILER; otherwise ProfiledOnRepeat() and
+ * ProfiledOnRepeatMicros() register the callback as is.
+ */
+class ReactionProfiler {
+ public:
+  /**
+   * @brief Wrap a reaction callback with execution time measurement.
+   *
+   * Reactions with the same name get a running number appended.
+   */
+  static react_callback wrap(const char* name, uint32_t interval_us,
+                             react_callback callback);
+
+  /**
+   * @brief Text report of all reactions, sorted by total execution time.
+   */
+  static String report();
+
+  static void reset();
+};
+
+inline RepeatReaction* ProfiledOnRepeat(ReactESP* app, uint32_t interval_ms,
+                                        const char* name,
+                                        react_callback callback) {
+#ifdef SH_WG_REACTION_PROFILER
+  callback = ReactionProfiler::wrap(name, interval_ms * 1000, callback);
+#endif
+  return app->onRepeat(interval_ms, callback);
+}
+
+inline RepeatReaction* ProfiledOnRepeatMicros(ReactESP* app,
+                                              uint32_t interval_us,
+                                              const char* name,
+                                              react_callback callback) {
+#ifdef SH_WG_REACTION_PROFILER
+  callback = ReactionProfiler::wrap(name, interval_us, callback);
+#endif
+  return app->onRepeatMicros(interval_us, callback);
+}
+
+#endif  // SH_WG_FIRMWARE_REACTION_PROFILER_H_
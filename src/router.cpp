@@ -0,0 +1,303 @@
+#include "router.h"
+
+#include <sys/time.h>
+
+#include "reaction_profiler.h"
+#include "shwg.h"
+#include "ydwg_raw_output.h"
+#include "ydwg_raw_parser.h"
+
+Router::Router(std::function<bool(uint32_t pgn)> is_fast_packet_pgn)
+    : is_fast_packet_pgn_{is_fast_packet_pgn} {
+  frame_input_ = new LambdaConsumer<CANFrame>(
+      [this](CANFrame frame) { route_frame(frame); });
+  message_input_ = new LambdaConsumer<tN2kMsg>(
+      [this](tN2kMsg msg) { route_message(msg); });
+  for (int i = 0; i < (int)RouteEndpoint::kNumEndpoints; i++) {
+    RouteEndpoint source = (RouteEndpoint)i;
+    port_inputs_[i] = new LambdaConsumer<OriginString>(
+        [this, source](OriginString data) { route_port_data(source, data); });
+  }
+  seasmart_output_.origin_id = origin_id(this);
+
+  ProfiledOnRepeat(ReactESP::app, kSeasmartFlushIntervalMs,
+                   "Router SeaSmart flush", [this]() { flush_all(); });
+  ProfiledOnRepeat(ReactESP::app, 1000, "Router summary",
+                   [this]() { update_summary(); });
+  update_summary();
+}
+
+void Router::set_sink(RouteEndpoint endpoint,
+                      ValueConsumer<OriginString>* consumer,
+                      std::function<bool()> active) {
+  Sink& sink = sinks_[(int)endpoint];
+  sink.consumer = consumer;
+  sink.active = active;
+}
+
+void Router::set_nmea0183_encoder(Transform<tN2kMsg, OriginString>* encoder) {
+  nmea0183_encoder_ = encoder;
+  encoder->connect_to(new LambdaConsumer<OriginString>(
+      [this](OriginString sentence) { route_nmea0183(sentence); }));
+}
+
+void Router::set_nmea0183_decoder(Transform<OriginString, CANFrame>* decoder) {
+  nmea0183_decoder_ = decoder;
+  decoder->connect_to(new LambdaConsumer<CANFrame>(
+      [this](CANFrame frame) { route_decoded_frame(frame); }));
+}
+
+int Router::get_group(const Route& route) {
+  if (route.source != RouteEndpoint::kCAN) {
+    return (int)route.source + 1;
+  }
+  return route.format == RouteFormat::kYDWGRaw ? kFrameGroup : kMessageGroup;
+}
+
+void Router::set_routes(const std::vector<Route>& routes) {
+  // don't lose the pending SeaSmart.Net sentences of the replaced routes
+  flush_all();
+
+  std::vector<CompiledRoute> compiled;
+  compiled.reserve(routes.size());
+  for (int group = 0; group < kNumGroups; group++) {
+    group_begin_[group] = compiled.size();
+    for (const auto& route : routes) {
+      if (get_group(route) != group) {
+        continue;
+      }
+      if (route.sink != RouteEndpoint::kCAN &&
+          sinks_[(int)route.sink].consumer == nullptr) {
+        debugW("Route %s skipped: %s is disabled",
+               RouteToString(route).c_str(), RouteEndpointName(route.sink));
+        continue;
+      }
+      compiled.emplace_back();
+      CompiledRoute& entry = compiled.back();
+      entry.route = route;
+      entry.selected = false;
+      entry.passed = 0;
+      if (route.filter.length() > 0) {
+        entry.filter.reset(new YDWGRawSubscription(is_fast_packet_pgn_));
+        entry.filter->set(route.filter.c_str());
+      }
+      if (route.format == RouteFormat::kSeaSmart) {
+        entry.batch.reserve(kSeasmartBatchSize + sizeof(seasmart_buf_));
+      }
+    }
+  }
+  group_begin_[kNumGroups] = compiled.size();
+  routes_ = std::move(compiled);
+  memset(sink_formats_, 0, sizeof(sink_formats_));
+  for (const auto& entry : routes_) {
+    sink_formats_[(int)entry.route.sink] |= 1 << (int)entry.route.format;
+  }
+  debugI("Routing %d routes", (int)routes_.size());
+  update_summary();
+}
+
+String Router::get_summary() const {
+  std::lock_guard<std::mutex> lock(summary_mutex_);
+  return summary_;
+}
+
+void Router::update_summary() {
+  // the routes are only accessed from the main task; build the string
+  // here and hand over a copy to other tasks
+  String summary = routes_.empty() ? "No routes" : "";
+  for (const auto& entry : routes_) {
+    if (summary.length() > 0) {
+      summary += "; ";
+    }
+    summary += RouteToString(entry.route) + ": " + String(entry.passed);
+  }
+  std::lock_guard<std::mutex> lock(summary_mutex_);
+  summary_ = summary;
+}
+
+void Router::route_frame(const CANFrame& frame) {
+  bool encoded = false;
+  uint32_t now = millis();
+  for (size_t i = group_begin_[kFrameGroup]; i < group_begin_[kFrameGroup + 1];
+       i++) {
+    CompiledRoute& entry = routes_[i];
+    const Sink& sink = sinks_[(int)entry.route.sink];
+    if (!sink.takes_output()) {
+      continue;
+    }
+    if (entry.filter &&
+        !entry.filter->accept(frame.id, frame.len, frame.buf, now)) {
+      continue;
+    }
+    if (!encoded) {
+      if (!CANFrameToYDWGRaw(frame, output_)) {
+        return;
+      }
+      encoded = true;
+    }
+    entry.passed++;
+    sink.consumer->set_input(output_);
+  }
+  if (encoded) {
+    frames_encoded_++;
+  } else {
+    frames_skipped_++;
+  }
+}
+
+void Router::route_message(const tN2kMsg& msg) {
+  // the filters take the message as a single frame of its CAN id
+  uint32_t id = ((uint32_t)msg.Priority << 26) | (msg.PGN << 8) | msg.Source;
+  uint32_t now = millis();
+  bool encode_nmea0183 = false;
+  bool seasmart_encoded = false;
+  size_t seasmart_len = 0;
+  for (size_t i = group_begin_[kMessageGroup];
+       i < group_begin_[kMessageGroup + 1]; i++) {
+    CompiledRoute& entry = routes_[i];
+    const Sink& sink = sinks_[(int)entry.route.sink];
+    entry.selected = false;
+    if (entry.route.format == RouteFormat::kNMEA0183) {
+      // the encoder state, e.g. the AIS static data for new clients, is
+      // kept up to date even while the sink takes no output
+      if (!entry.filter || entry.filter->accept(id, 0, nullptr, now)) {
+        entry.selected = true;
+        encode_nmea0183 = true;
+      }
+      continue;
+    }
+
+    if (!sink.takes_output()) {
+      continue;
+    }
+    if (entry.filter && !entry.filter->accept(id, 0, nullptr, now)) {
+      continue;
+    }
+    if (!seasmart_encoded) {
+      seasmart_encoded = true;
+      if (encode_seasmart_) {
+        seasmart_len =
+            encode_seasmart_(msg, seasmart_buf_, sizeof(seasmart_buf_));
+      }
+    }
+    if (seasmart_len == 0) {
+      continue;
+    }
+    entry.passed++;
+    entry.batch.concat(seasmart_buf_, seasmart_len);
+    if (entry.batch.length() >= kSeasmartBatchSize) {
+      flush(entry);
+    }
+  }
+
+  if (encode_nmea0183 && nmea0183_encoder_ != nullptr) {
+    encoding_message_ = true;
+    nmea0183_encoder_->set_input(msg);
+    encoding_message_ = false;
+  }
+}
+
+void Router::route_nmea0183(const OriginString& sentence) {
+  for (size_t i = group_begin_[kMessageGroup];
+       i < group_begin_[kMessageGroup + 1]; i++) {
+    CompiledRoute& entry = routes_[i];
+    if (entry.route.format != RouteFormat::kNMEA0183 ||
+        (encoding_message_ && !entry.selected)) {
+      continue;
+    }
+    const Sink& sink = sinks_[(int)entry.route.sink];
+    if (!sink.takes_output()) {
+      continue;
+    }
+    entry.passed++;
+    sink.consumer->set_input(sentence);
+  }
+}
+
+void Router::route_decoded_frame(const CANFrame& frame) {
+  CompiledRoute* entry = decoding_route_;
+  if (entry == nullptr) {
+    return;
+  }
+  if (entry->filter &&
+      !entry->filter->accept(frame.id, frame.len, frame.buf, millis())) {
+    return;
+  }
+  entry->passed++;
+  this->emit(frame);
+}
+
+void Router::route_port_data(RouteEndpoint source, const OriginString& data) {
+  int group = (int)source + 1;
+  bool parsed = false;
+  bool parse_ok = false;
+  CANFrame frame;
+  for (size_t i = group_begin_[group]; i < group_begin_[group + 1]; i++) {
+    CompiledRoute& entry = routes_[i];
+    switch (entry.route.format) {
+      case RouteFormat::kYDWGRaw: {
+        if (!parsed) {
+          parsed = true;
+          struct timeval timestamp;
+          parse_ok = YDWGRawToCANFrame(frame, timestamp, data);
+        }
+        if (!parse_ok || (entry.filter && !entry.filter->accept(
+                                              frame.id, frame.len, frame.buf,
+                                              millis()))) {
+          continue;
+        }
+        entry.passed++;
+        this->emit(frame);
+        break;
+      }
+      case RouteFormat::kNMEA0183:
+        if (nmea0183_decoder_ == nullptr) {
+          continue;
+        }
+        decoding_route_ = &entry;
+        nmea0183_decoder_->set_input(data);
+        decoding_route_ = nullptr;
+        break;
+      default: {
+        const Sink& sink = sinks_[(int)entry.route.sink];
+        if (!sink.takes_output()) {
+          continue;
+        }
+        entry.passed++;
+        // tokenized lines have lost their terminator
+        if (data.data.length() > 0 &&
+            data.data[data.data.length() - 1] == '\n') {
+          sink.consumer->set_input(data);
+          break;
+        }
+        raw_output_.origin_id = data.origin_id;
+        raw_output_.data = data.data;
+        raw_output_.data += "\r\n";
+        sink.consumer->set_input(raw_output_);
+        break;
+      }
+    }
+  }
+}
+
+void Router::flush(CompiledRoute& entry) {
+  if (entry.batch.length() == 0) {
+    return;
+  }
+  const Sink& sink = sinks_[(int)entry.route.sink];
+  if (sink.consumer != nullptr) {
+    seasmart_output_.data = entry.batch;
+    sink.consumer->set_input(seasmart_output_);
+  }
+  // the batch keeps its reserved capacity
+  entry.batch = "";
+}
+
+void Router::flush_all() {
+  for (size_t i = group_begin_[kMessageGroup];
+       i < group_begin_[kMessageGroup + 1]; i++) {
+    if (routes_[i].route.format == RouteFormat::kSeaSmart) {
+      flush(routes_[i]);
+    }
+  }
+}
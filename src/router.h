@@ -0,0 +1,178 @@
+#ifndef SH_WG_FIRMWARE_ROUTER_H_
+#define SH_WG_FIRMWARE_ROUTER_H_
+
+#include <Arduino.h>
+#include <N2kMsg.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "can_frame.h"
+#include "config.h"
+#include "origin_string.h"
+#include "routing_table.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/transforms/transform.h"
+#include "ydwg_raw_subscription.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Dispatch data between the CAN bus and the ports according to a
+ * routing table.
+ *
+ * The routes are compiled into one flat array, grouped by source: CAN
+ * frames, NMEA 2000 messages, and the data received on each port. An input
+ * only walks the routes of its group. Each input is encoded at most once
+ * per format, and only if a route takes it: YDWG RAW and SeaSmart.Net
+ * routes skip sinks that currently take no output, e.g. a TCP server
+ * without clients.
+ *
+ * The NMEA 0183 encoder keeps state across messages and emits some
+ * sentences on its own schedule, such as RMC and the AIS static data
+ * replay. Messages are passed to it if any NMEA 0183 route takes them, and
+ * the sentences emitted for a message go to the routes that took it; the
+ * scheduled sentences go to all NMEA 0183 routes.
+ *
+ * Frames decoded from the ports are emitted to the CAN frame consumers
+ * connected to the router.
+ *
+ * The routes can be replaced at any time from the main task.
+ */
+class Router : public ValueProducer<CANFrame> {
+ public:
+  /**
+   * @param is_fast_packet_pgn Function telling whether a PGN is sent as
+   * fast packets, for the route filters
+   */
+  Router(std::function<bool(uint32_t pgn)> is_fast_packet_pgn);
+
+  /**
+   * @brief Set the consumer of the data routed to a port.
+   *
+   * @param active Function telling whether the consumer currently takes
+   * output; if empty, it always does
+   */
+  void set_sink(RouteEndpoint endpoint, ValueConsumer<OriginString>* consumer,
+                std::function<bool()> active = nullptr);
+
+  void set_nmea0183_encoder(Transform<tN2kMsg, OriginString>* encoder);
+  void set_nmea0183_decoder(Transform<OriginString, CANFrame>* decoder);
+
+  /**
+   * @param encode Function appending the SeaSmart.Net sentence of a message
+   * to a buffer; returns the length written, or 0
+   */
+  void set_seasmart_encoder(
+      std::function<size_t(const tN2kMsg& msg, char* buf, size_t size)>
+          encode) {
+    encode_seasmart_ = encode;
+  }
+
+  ValueConsumer<CANFrame>* get_frame_input() { return frame_input_; }
+  ValueConsumer<tN2kMsg>* get_message_input() { return message_input_; }
+
+  /**
+   * @brief Get the consumer of the data received on a port.
+   */
+  ValueConsumer<OriginString>* get_input(RouteEndpoint source) {
+    return port_inputs_[(int)source];
+  }
+
+  /**
+   * @brief Replace the routes. Routes to ports without a sink are skipped.
+   */
+  void set_routes(const std::vector<Route>& routes);
+
+  /**
+   * @brief Check whether a route encodes to a port in a format.
+   *
+   * Cheap enough to be called for every frame.
+   */
+  bool has_route(RouteFormat format, RouteEndpoint sink) const {
+    return (sink_formats_[(int)sink] >> (int)format) & 1;
+  }
+
+  size_t get_num_routes() const { return routes_.size(); }
+
+  /**
+   * @brief Get the routes with the number of lines or frames each passed.
+   *
+   * The summary is built in the main task every second and may be read
+   * from any task, e.g. by the web server.
+   */
+  String get_summary() const;
+
+  uint32_t get_frames_encoded() const { return frames_encoded_; }
+  uint32_t get_frames_skipped() const {  //< No route took them
+    return frames_skipped_;
+  }
+
+ protected:
+  struct Sink {
+    ValueConsumer<OriginString>* consumer = nullptr;
+    std::function<bool()> active;
+
+    bool takes_output() const {
+      return consumer != nullptr && (!active || active());
+    }
+  };
+
+  struct CompiledRoute {
+    Route route;
+    std::unique_ptr<YDWGRawSubscription> filter;  //< Null for all frames
+    bool selected;  //< Took the message being encoded as NMEA 0183
+    uint32_t passed;
+    String batch;  //< SeaSmart.Net sentences waiting to be sent
+  };
+
+  // dispatch groups: CAN frames, NMEA 2000 messages, then one per port
+  static constexpr int kFrameGroup = 0;
+  static constexpr int kMessageGroup = 1;
+  static constexpr int kNumGroups = (int)RouteEndpoint::kNumEndpoints + 1;
+
+  std::function<bool(uint32_t pgn)> is_fast_packet_pgn_;
+  std::function<size_t(const tN2kMsg& msg, char* buf, size_t size)>
+      encode_seasmart_;
+  Transform<tN2kMsg, OriginString>* nmea0183_encoder_ = nullptr;
+  Transform<OriginString, CANFrame>* nmea0183_decoder_ = nullptr;
+
+  Sink sinks_[(int)RouteEndpoint::kNumEndpoints];
+  ValueConsumer<CANFrame>* frame_input_;
+  ValueConsumer<tN2kMsg>* message_input_;
+  ValueConsumer<OriginString>* port_inputs_[(int)RouteEndpoint::kNumEndpoints];
+
+  std::vector<CompiledRoute> routes_;
+  // the routes of group i are routes_[group_begin_[i]:group_begin_[i + 1]]
+  size_t group_begin_[kNumGroups + 1] = {};
+  // bit i is set if a route encodes to the sink in RouteFormat i
+  uint8_t sink_formats_[(int)RouteEndpoint::kNumEndpoints] = {};
+
+  OriginString output_;
+  OriginString seasmart_output_;
+  OriginString raw_output_;
+  char seasmart_buf_[kMaxNMEA2000MessageSeasmartSize + 3];
+  bool encoding_message_ = false;
+  CompiledRoute* decoding_route_ = nullptr;
+
+  uint32_t frames_encoded_ = 0;
+  uint32_t frames_skipped_ = 0;
+
+  mutable std::mutex summary_mutex_;
+  String summary_;
+
+  static int get_group(const Route& route);
+
+  void route_frame(const CANFrame& frame);
+  void route_message(const tN2kMsg& msg);
+  void route_nmea0183(const OriginString& sentence);
+  void route_decoded_frame(const CANFrame& frame);
+  void route_port_data(RouteEndpoint source, const OriginString& data);
+  void flush(CompiledRoute& route);
+  void flush_all();
+  void update_summary();
+};
+
+#endif  // SH_WG_FIRMWARE_ROUTER_H_
@@ -0,0 +1,171 @@
+#include "routing_table.h"
+
+#include <strings.h>
+
+#include <memory>
+
+#include "ydwg_raw_subscription.h"
+
+static const char* const kEndpointNames[] = {
+    "can",      "ydwg-tcp", "ydwg-udp",    "ydwg-client",
+    "0183-tcp", "0183-udp", "0183-client",
+};
+
+static const char* const kFormatNames[] = {"ydwg", "0183", "seasmart", "raw"};
+
+const char* RouteEndpointName(RouteEndpoint endpoint) {
+  return kEndpointNames[(int)endpoint];
+}
+
+const char* RouteFormatName(RouteFormat format) {
+  return kFormatNames[(int)format];
+}
+
+String RouteToString(const Route& route) {
+  String text = String(RouteEndpointName(route.source)) + " > " +
+                RouteFormatName(route.format) + " > " +
+                RouteEndpointName(route.sink);
+  if (route.filter.length() > 0) {
+    text += String(" [") + route.filter + "]";
+  }
+  return text;
+}
+
+static bool ParseEndpoint(const String& name, RouteEndpoint& endpoint) {
+  for (int i = 0; i < (int)RouteEndpoint::kNumEndpoints; i++) {
+    if (strcasecmp(name.c_str(), kEndpointNames[i]) == 0) {
+      endpoint = (RouteEndpoint)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseFormat(const String& name, RouteFormat& format) {
+  for (int i = 0; i < (int)RouteFormat::kNumFormats; i++) {
+    if (strcasecmp(name.c_str(), kFormatNames[i]) == 0) {
+      format = (RouteFormat)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Check the combination of source, format and sink of a route.
+ *
+ * @return nullptr if the route is valid, the reason otherwise
+ */
+static const char* CheckRoute(const Route& route) {
+  if (route.source == route.sink) {
+    return "source and sink are the same";
+  }
+  if (route.source == RouteEndpoint::kCAN) {
+    if (route.format == RouteFormat::kRaw) {
+      return "CAN frames can't be forwarded raw";
+    }
+    return nullptr;
+  }
+  if (route.sink == RouteEndpoint::kCAN) {
+    if (route.format != RouteFormat::kYDWGRaw &&
+        route.format != RouteFormat::kNMEA0183) {
+      return "only ydwg and 0183 can be decoded";
+    }
+    return nullptr;
+  }
+  if (route.format != RouteFormat::kRaw) {
+    return "data is forwarded between ports raw";
+  }
+  if (route.filter.length() > 0) {
+    return "raw routes can't be filtered";
+  }
+  return nullptr;
+}
+
+bool ParseRoutingTable(const String& text, std::vector<Route>& routes,
+                       String& error) {
+  routes.clear();
+  // validates the filters; allocated for the first one
+  std::unique_ptr<YDWGRawSubscription> filter_check;
+  int number = 0;
+  unsigned int begin = 0;
+  while (begin < text.length()) {
+    unsigned int end = begin;
+    while (end < text.length() && text[end] != ';' && text[end] != '\n') {
+      end++;
+    }
+    String entry = text.substring(begin, end);
+    entry.trim();
+    begin = end + 1;
+    if (entry.length() == 0) {
+      continue;
+    }
+    number++;
+    String prefix = String("route ") + String(number) + ": ";
+
+    Route route;
+    int bracket = entry.indexOf('[');
+    if (bracket != -1) {
+      if (entry[entry.length() - 1] != ']') {
+        error = prefix + "filter not closed with ]";
+        return false;
+      }
+      route.filter = entry.substring(bracket + 1, entry.length() - 1);
+      route.filter.trim();
+      entry = entry.substring(0, bracket);
+    }
+
+    int first = entry.indexOf('>');
+    int second = first == -1 ? -1 : entry.indexOf('>', first + 1);
+    if (second == -1 || entry.indexOf('>', second + 1) != -1) {
+      error = prefix + "expected SOURCE > FORMAT > SINK";
+      return false;
+    }
+    String source = entry.substring(0, first);
+    String format = entry.substring(first + 1, second);
+    String sink = entry.substring(second + 1);
+    source.trim();
+    format.trim();
+    sink.trim();
+    if (!ParseEndpoint(source, route.source)) {
+      error = prefix + "unknown source '" + source + "'";
+      return false;
+    }
+    if (!ParseFormat(format, route.format)) {
+      error = prefix + "unknown format '" + format + "'";
+      return false;
+    }
+    if (!ParseEndpoint(sink, route.sink)) {
+      error = prefix + "unknown sink '" + sink + "'";
+      return false;
+    }
+    const char* reason = CheckRoute(route);
+    if (reason != nullptr) {
+      error = prefix + reason;
+      return false;
+    }
+    if (route.filter.length() > 0) {
+      if (!filter_check) {
+        filter_check.reset(
+            new YDWGRawSubscription([](uint32_t pgn) { return false; }));
+      }
+      if (!filter_check->set(route.filter.c_str())) {
+        error = prefix + "invalid filter";
+        return false;
+      }
+    }
+    for (const auto& other : routes) {
+      if (other.source == route.source && other.format == route.format &&
+          other.sink == route.sink) {
+        error = prefix + "duplicate route";
+        return false;
+      }
+    }
+    if (routes.size() == kMaxRoutes) {
+      error = prefix + "too many routes";
+      return false;
+    }
+    routes.push_back(route);
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef SH_WG_FIRMWARE_ROUTING_TABLE_H_
+#define SH_WG_FIRMWARE_ROUTING_TABLE_H_
+
+#include <Arduino.h>
+
+#include <vector>
+
+// Declarative routing between the CAN bus, the output formats and the
+// network ports.
+//
+// A routing table is a list of routes separated by semicolons or newlines:
+//
+//   SOURCE > FORMAT > SINK [FILTER]
+//
+// e.g. "can > ydwg > ydwg-tcp; can > 0183 > 0183-udp [129025 127250/1000]".
+// The optional filter selects the CAN frames or NMEA 2000 messages taken by
+// the route, in the YDWG RAW subscription syntax: PGN[:SOURCE][/INTERVAL_MS]
+// entries separated by spaces or commas.
+//
+// Routes from the CAN bus encode its frames or messages as YDWG RAW
+// ("ydwg"), NMEA 0183 ("0183") or SeaSmart.Net ("seasmart") for a port.
+// Routes from a port either decode what it receives ("ydwg" or "0183") and
+// send the result to the CAN bus, or forward it unchanged ("raw") to
+// another port.
+
+enum class RouteEndpoint : uint8_t {
+  kCAN,
+  kYDWGRawTCP,
+  kYDWGRawUDP,
+  kYDWGRawClient,
+  kNMEA0183TCP,
+  kNMEA0183UDP,
+  kNMEA0183Client,
+  kNumEndpoints,
+};
+
+enum class RouteFormat : uint8_t {
+  kYDWGRaw,
+  kNMEA0183,
+  kSeaSmart,
+  kRaw,  ///< Received data forwarded unchanged
+  kNumFormats,
+};
+
+struct Route {
+  RouteEndpoint source;
+  RouteFormat format;
+  RouteEndpoint sink;
+  String filter;  //< Empty for all frames
+};
+
+constexpr size_t kMaxRoutes = 32;
+
+const char* RouteEndpointName(RouteEndpoint endpoint);
+const char* RouteFormatName(RouteFormat format);
+
+/**
+ * @brief Get the text form of a route, as accepted by ParseRoutingTable().
+ */
+String RouteToString(const Route& route);
+
+/**
+ * @brief Parse a routing table.
+ *
+ * @param text Routes separated by semicolons or newlines
+ * @param routes Parsed routes
+ * @param error Reason and position of the first invalid route
+ * @return false if a route is invalid
+ */
+bool ParseRoutingTable(const String& text, std::vector<Route>& routes,
+                       String& error);
+
+#endif  // SH_WG_FIRMWARE_ROUTING_TABLE_H_
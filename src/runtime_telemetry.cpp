@@ -0,0 +1,210 @@
+#include "runtime_telemetry.h"
+
+#include <ArduinoJson.h>
+
+#include "ReactESP.h"
+#include "reaction_profiler.h"
+
+RuntimeTelemetry::RuntimeTelemetry(unsigned int sample_interval_ms) {
+  last_sample_ms_ = millis();
+  sample();
+  ProfiledOnRepeat(ReactESP::app, sample_interval_ms, "RuntimeTelemetry",
+                   [this]() { sample(); });
+}
+
+void RuntimeTelemetry::add_task(const char* name,
+                                std::function<TaskHandle_t()> get_handle) {
+  tasks_.push_back({name, get_handle, 0});
+}
+
+void RuntimeTelemetry::add_queue(const char* name, const QueueStats* stats) {
+  if (stats == nullptr) {
+    return;
+  }
+  add_queue(
+      name, [stats]() { return stats->depth(); },
+      [stats]() { return stats->dropped.load(); });
+}
+
+void RuntimeTelemetry::add_queue(const char* name,
+                                 std::function<uint32_t()> get_depth,
+                                 std::function<uint32_t()> get_dropped) {
+  queues_.push_back({name, get_depth, get_dropped, 0, 0});
+}
+
+void RuntimeTelemetry::sample() {
+  free_heap_ = ESP.getFreeHeap();
+  min_free_heap_ = ESP.getMinFreeHeap();
+  largest_free_block_ = ESP.getMaxAllocHeap();
+
+  // on ESP32, stack sizes and high-water marks are given in bytes
+  for (auto& task : tasks_) {
+    TaskHandle_t handle = task.get_handle();
+    task.stack_free =
+        handle != nullptr ? uxTaskGetStackHighWaterMark(handle) : 0;
+  }
+
+  for (auto& queue : queues_) {
+    queue.depth = queue.get_depth();
+    if (queue.depth > queue.max_depth) {
+      queue.max_depth = queue.depth;
+    }
+  }
+
+  unsigned long now = millis();
+  unsigned long elapsed = now - last_sample_ms_;
+  if (elapsed > 0) {
+    loops_per_second_ = (uint64_t)loop_count_ * 1000 / elapsed;
+  }
+  sampled_loop_time_max_us_ = loop_time_max_us_;
+  loop_count_ = 0;
+  loop_time_max_us_ = 0;
+  last_sample_ms_ = now;
+}
+
+String RuntimeTelemetry::get_task_summary() const {
+  String summary;
+  for (auto& task : tasks_) {
+    if (task.stack_free == 0) {
+      continue;
+    }
+    if (summary.length() > 0) {
+      summary += ", ";
+    }
+    summary += String(task.name) + ": " + String(task.stack_free);
+  }
+  return summary;
+}
+
+String RuntimeTelemetry::get_queue_summary() const {
+  String summary;
+  for (auto& queue : queues_) {
+    if (summary.length() > 0) {
+      summary += ", ";
+    }
+    summary += String(queue.name) + ": " + String(queue.depth) + " (max " +
+               String(queue.max_depth) + ", dropped " +
+               String(queue.get_dropped()) + ")";
+  }
+  return summary;
+}
+
+String RuntimeTelemetry::to_json() const {
+  DynamicJsonDocument doc(2048);
+
+  doc["uptime"] = millis() / 1000;
+
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["free"] = free_heap_;
+  heap["min_free"] = min_free_heap_;
+  heap["largest_free_block"] = largest_free_block_;
+  heap["fragmentation"] = get_fragmentation();
+
+  JsonObject loop = doc.createNestedObject("loop");
+  loop["loops_per_second"] = loops_per_second_;
+  loop["max_loop_time_us"] = sampled_loop_time_max_us_;
+
+  JsonObject tasks = doc.createNestedObject("tasks");
+  for (auto& task : tasks_) {
+    if (task.stack_free > 0) {
+      tasks[task.name]["stack_free"] = task.stack_free;
+    }
+  }
+
+  JsonObject queues = doc.createNestedObject("queues");
+  for (auto& queue : queues_) {
+    JsonObject entry = queues.createNestedObject(queue.name);
+    entry["depth"] = queue.depth;
+    entry["max_depth"] = queue.max_depth;
+    entry["dropped"] = queue.get_dropped();
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+static void AddMetric(String& out, const char* name, const char* type,
+                      const char* help) {
+  out += "# HELP ";
+  out += name;
+  out += " ";
+  out += help;
+  out += "\n# TYPE ";
+  out += name;
+  out += " ";
+  out += type;
+  out += "\n";
+}
+
+static void AddSample(String& out, const char* name, const char* label_name,
+                      const char* label_value, double value) {
+  out += name;
+  if (label_name != nullptr) {
+    out += "{";
+    out += label_name;
+    out += "=\"";
+    out += label_value;
+    out += "\"}";
+  }
+  out += " ";
+  out += String(value, 1);
+  out += "\n";
+}
+
+String RuntimeTelemetry::to_prometheus() const {
+  String out;
+  out.reserve(2048);
+
+  AddMetric(out, "shwg_uptime_seconds", "counter", "Time since boot");
+  AddSample(out, "shwg_uptime_seconds", nullptr, nullptr, millis() / 1000);
+
+  AddMetric(out, "shwg_heap_free_bytes", "gauge", "Free heap");
+  AddSample(out, "shwg_heap_free_bytes", nullptr, nullptr, free_heap_);
+  AddMetric(out, "shwg_heap_min_free_bytes", "gauge",
+            "Lowest free heap since boot");
+  AddSample(out, "shwg_heap_min_free_bytes", nullptr, nullptr,
+            min_free_heap_);
+  AddMetric(out, "shwg_heap_largest_free_block_bytes", "gauge",
+            "Largest allocatable heap block");
+  AddSample(out, "shwg_heap_largest_free_block_bytes", nullptr, nullptr,
+            largest_free_block_);
+
+  AddMetric(out, "shwg_loops_per_second", "gauge",
+            "Main loop iterations per second");
+  AddSample(out, "shwg_loops_per_second", nullptr, nullptr,
+            loops_per_second_);
+  AddMetric(out, "shwg_loop_time_max_microseconds", "gauge",
+            "Longest main loop iteration in the last sample interval");
+  AddSample(out, "shwg_loop_time_max_microseconds", nullptr, nullptr,
+            sampled_loop_time_max_us_);
+
+  AddMetric(out, "shwg_task_stack_free_bytes", "gauge",
+            "Task stack high-water mark");
+  for (auto& task : tasks_) {
+    if (task.stack_free == 0) {
+      continue;
+    }
+    AddSample(out, "shwg_task_stack_free_bytes", "task", task.name,
+              task.stack_free);
+  }
+
+  AddMetric(out, "shwg_queue_depth", "gauge", "Items waiting in queue");
+  for (auto& queue : queues_) {
+    AddSample(out, "shwg_queue_depth", "queue", queue.name, queue.depth);
+  }
+  AddMetric(out, "shwg_queue_max_depth", "gauge",
+            "Deepest sampled queue since boot");
+  for (auto& queue : queues_) {
+    AddSample(out, "shwg_queue_max_depth", "queue", queue.name,
+              queue.max_depth);
+  }
+  AddMetric(out, "shwg_queue_dropped_total", "counter",
+            "Items dropped on a full queue");
+  for (auto& queue : queues_) {
+    AddSample(out, "shwg_queue_dropped_total", "queue", queue.name,
+              queue.get_dropped());
+  }
+
+  return out;
+}
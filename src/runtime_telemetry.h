@@ -0,0 +1,110 @@
+#ifndef SH_WG_FIRMWARE_RUNTIME_TELEMETRY_H_
+#define SH_WG_FIRMWARE_RUNTIME_TELEMETRY_H_
+
+#include <Arduino.h>
+
+#include <functional>
+#include <vector>
+
+#include "queue_stats.h"
+
+/**
+ * @brief Periodic sampler of heap, task stack and queue statistics.
+ *
+ * Sampling is cheap enough to run every few seconds on a live system. The
+ * latest samples are available for the web UI and as a JSON or
+ * Prometheus text format document.
+ */
+class RuntimeTelemetry {
+ public:
+  struct TaskEntry {
+    const char* name;
+    std::function<TaskHandle_t()> get_handle;
+    uint32_t stack_free;  //< Stack high-water mark in bytes
+  };
+
+  struct QueueEntry {
+    const char* name;
+    std::function<uint32_t()> get_depth;
+    std::function<uint32_t()> get_dropped;
+    uint32_t depth;
+    uint32_t max_depth;  //< Deepest sampled queue since boot
+  };
+
+  RuntimeTelemetry(unsigned int sample_interval_ms = 5000);
+
+  /**
+   * @brief Add a task whose stack high-water mark is sampled.
+   *
+   * The handle is looked up on every sample, so tasks can be added before
+   * they are started. Tasks without a handle are skipped.
+   */
+  void add_task(const char* name, std::function<TaskHandle_t()> get_handle);
+
+  /**
+   * @brief Add a queue whose depth is sampled.
+   *
+   * Add all queues during setup: the web server task reads the list without
+   * a lock. Queues created later are added beforehand with getters that
+   * return 0 until they exist.
+   */
+  void add_queue(const char* name, const QueueStats* stats);
+  void add_queue(const char* name, std::function<uint32_t()> get_depth,
+                 std::function<uint32_t()> get_dropped);
+
+  /**
+   * @brief Record the duration of one main loop iteration.
+   *
+   * Call from loop() with the time spent in the event loop tick.
+   */
+  void record_loop_time(uint32_t loop_time_us) {
+    loop_count_++;
+    if (loop_time_us > loop_time_max_us_) {
+      loop_time_max_us_ = loop_time_us;
+    }
+  }
+
+  void sample();
+
+  uint32_t get_free_heap() const { return free_heap_; }
+  uint32_t get_min_free_heap() const { return min_free_heap_; }
+  uint32_t get_largest_free_block() const { return largest_free_block_; }
+  /**
+   * @brief Share of free heap not usable for the largest allocation, in %.
+   */
+  float get_fragmentation() const {
+    return free_heap_ > 0 ? 100.0 * (free_heap_ - largest_free_block_) /
+                                free_heap_
+                          : 0;
+  }
+  uint32_t get_loops_per_second() const { return loops_per_second_; }
+  uint32_t get_loop_time_max_us() const { return sampled_loop_time_max_us_; }
+
+  const std::vector<TaskEntry>& get_tasks() const { return tasks_; }
+  const std::vector<QueueEntry>& get_queues() const { return queues_; }
+
+  /**
+   * @brief Summaries for the web UI status page.
+   */
+  String get_task_summary() const;
+  String get_queue_summary() const;
+
+  String to_json() const;
+  String to_prometheus() const;
+
+ protected:
+  std::vector<TaskEntry> tasks_;
+  std::vector<QueueEntry> queues_;
+
+  uint32_t free_heap_ = 0;
+  uint32_t min_free_heap_ = 0;
+  uint32_t largest_free_block_ = 0;
+
+  uint32_t loop_count_ = 0;
+  uint32_t loop_time_max_us_ = 0;
+  uint32_t loops_per_second_ = 0;
+  uint32_t sampled_loop_time_max_us_ = 0;  //< Longest loop in last interval
+  unsigned long last_sample_ms_ = 0;
+};
+
+#endif  // SH_WG_FIRMWARE_RUNTIME_TELEMETRY_H_
@@ -1,45 +1,39 @@
 #ifndef SH_WG_FIRMWARE_SEASMART_TRANSFORM_H_
 #define SH_WG_FIRMWARE_SEASMART_TRANSFORM_H_
 
-#include <NMEA0183.h>
-#include <NMEA2000.h>
+#include <Arduino.h>
+#include <N2kMsg.h>
 
-#include "ReactESP.h"
 #include "Seasmart.h"
-#include "config.h"
-#include "elapsedMillis.h"
-#include "origin_string.h"
-#include "sensesp/transforms/transform.h"
-#include "shwg.h"
 
-using namespace sensesp;
-
-String GetSeaSmartString(const tN2kMsg& n2k_msg) {
-  char buf[kMaxNMEA2000MessageSeasmartSize];
-  if (N2kToSeasmart(n2k_msg, millis(), buf, kMaxNMEA2000MessageSeasmartSize) ==
-      0) {
-    return "";
-  } else {
-    return String(buf) + "\r\n";
+/**
+ * @brief Append a SeaSmart.Net $PCDIN sentence to a buffer.
+ *
+ * The sentence is timestamped with the time the message was received from
+ * the bus instead of the time of encoding.
+ *
+ * @param n2k_msg Source message
+ * @param buf Destination buffer
+ * @param size Space available in the destination buffer
+ * @return size_t Number of characters written, including the CRLF, or 0 if
+ * the message could not be encoded.
+ */
+inline size_t AppendSeaSmartString(const tN2kMsg& n2k_msg, char* buf,
+                                   size_t size) {
+  unsigned long timestamp = n2k_msg.MsgTime != 0 ? n2k_msg.MsgTime : millis();
+  if (N2kToSeasmart(n2k_msg, timestamp, buf, size) == 0) {
+    buf[0] = '\0';
+    return 0;
   }
-}
-
-class SeasmartTransform : public Transform<tN2kMsg, OriginString> {
- public:
-  SeasmartTransform(tNMEA2000* nmea2000)
-      : Transform<tN2kMsg, OriginString>(), nmea2000_{nmea2000} {}
-
-  void set_input(tN2kMsg input, uint8_t input_channel = 0) override {
-    String seasmart_str = GetSeaSmartString(input);
-    // we're assuming that all tN2KMsg objects originate from nmea2000
-    if (seasmart_str.length() > 0) {
-      OriginString origin_str = {origin_id(nmea2000_), seasmart_str};
-      this->emit(origin_str);
-    }
+  size_t len = strlen(buf);
+  if (len + 3 > size) {
+    buf[0] = '\0';
+    return 0;
   }
+  buf[len++] = '\r';
+  buf[len++] = '\n';
+  buf[len] = '\0';
+  return len;
+}
 
- protected:
-  tNMEA2000* nmea2000_;  //< used to hardcode the origin
-};
-
-#endif  // SH_WG_FIRMWARE_N2K_NMEA0183_TRANSFORM_H_
+#endif  // SH_WG_FIRMWARE_SEASMART_TRANSFORM_H_
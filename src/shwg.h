@@ -10,9 +10,10 @@ String MacAddrToString(uint8_t *mac, bool add_colons = false);
 void PrintProductInfo();
 
 // template function that returns a pointer cast to uint32_t
+// (truncated on 64-bit hosts; the ids only need to differ between objects)
 template <typename T>
 uint32_t origin_id(T *ptr) {
-  return reinterpret_cast<uint32_t>(ptr);
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
 }
 
 #endif
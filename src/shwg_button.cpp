@@ -1,6 +1,7 @@
 #include "AceButton.h"
 #include "config.h"
 #include "elapsedMillis.h"
+#include "reaction_profiler.h"
 #include "sensesp.h"
 #include "shwg.h"
 
@@ -49,5 +50,5 @@ void SetupButton() {
   button_config->setFeature(ButtonConfig::kFeatureLongPress);
   button_config->setFeature(ButtonConfig::kFeatureSuppressAfterLongPress);
 
-  app.onRepeat(4, []() { hall_button->check(); });
+  ProfiledOnRepeat(&app, 4, "Button", []() { hall_button->check(); });
 }
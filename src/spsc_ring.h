@@ -0,0 +1,97 @@
+#ifndef SH_WG_FIRMWARE_SPSC_RING_H_
+#define SH_WG_FIRMWARE_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer.
+ *
+ * One task may call push() and another task, possibly on the other core,
+ * may call pop() without any further locking. The capacity is rounded up
+ * to a power of two.
+ */
+template <typename T>
+class SPSCRing {
+ public:
+  SPSCRing(size_t capacity) {
+    capacity_ = 1;
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+    }
+    mask_ = capacity_ - 1;
+    items_ = new T[capacity_];
+  }
+
+  ~SPSCRing() { delete[] items_; }
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  /**
+   * @brief Add an item to the ring. Call from the producer task only.
+   *
+   * @return false if the ring was full and the item was dropped
+   */
+  bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    uint32_t fill = head - tail;
+    if (fill >= capacity_) {
+      overflows_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    items_[head & mask_] = item;
+    head_.store(head + 1, std::memory_order_release);
+    if (fill + 1 > high_watermark_.load(std::memory_order_relaxed)) {
+      high_watermark_.store(fill + 1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Remove the oldest item from the ring. Call from the consumer task
+   * only.
+   *
+   * @return false if the ring was empty
+   */
+  bool pop(T& item) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) {
+      return false;
+    }
+    item = items_[tail & mask_];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+  size_t capacity() const { return capacity_; }
+
+  uint32_t get_overflows() const {
+    return overflows_.load(std::memory_order_relaxed);
+  }
+  uint32_t get_high_watermark() const {
+    return high_watermark_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  T* items_;
+  uint32_t capacity_;
+  uint32_t mask_;
+
+  // head_ is only written by the producer and tail_ only by the consumer.
+  // Keep them on separate cache lines to avoid false sharing.
+  alignas(32) std::atomic<uint32_t> head_{0};
+  alignas(32) std::atomic<uint32_t> tail_{0};
+
+  std::atomic<uint32_t> overflows_{0};       //< Items dropped on a full ring
+  std::atomic<uint32_t> high_watermark_{0};  //< Largest fill level seen
+};
+
+#endif  // SH_WG_FIRMWARE_SPSC_RING_H_
@@ -0,0 +1,328 @@
+#ifndef SH_WG_FIRMWARE_STATIC_CAN_PIPELINE_H_
+#define SH_WG_FIRMWARE_STATIC_CAN_PIPELINE_H_
+
+#include <sys/time.h>
+
+#include <utility>
+
+#include "ReactESP.h"
+#include "can_frame.h"
+#include "deferred_log.h"
+#include "elapsedMillis.h"
+#include "origin_string.h"
+#include "reaction_profiler.h"
+#include "sensesp/system/valueconsumer.h"
+#include "streaming_tcp_server.h"
+#include "streaming_udp_server.h"
+#include "ydwg_raw_output.h"
+
+using namespace sensesp;
+
+// Building blocks for a CAN frame pipeline wired at compile time.
+//
+// Each stage is a plain object whose downstream stages are template
+// parameters held by value, so the compiler can inline the whole routing
+// graph. Frames are passed by reference and YDWG RAW output is encoded into
+// buffers allocated once. Stages that take strings are called with
+// (const char* data, size_t length, uint32_t origin_id).
+//
+// Every stage provides:
+//   bool enabled() const  - whether any downstream sink is enabled
+//   void begin()          - called once the pipeline is in its final place
+
+/**
+ * @brief Sink calling a function object.
+ */
+template <typename F>
+class FunctionSink {
+ public:
+  FunctionSink(F function, bool enabled = true)
+      : function_{function}, enabled_{enabled} {}
+
+  template <typename... Args>
+  void operator()(const Args&... args) {
+    function_(args...);
+  }
+
+  bool enabled() const { return enabled_; }
+  void begin() {}
+
+ protected:
+  F function_;
+  const bool enabled_;
+};
+
+template <typename F>
+FunctionSink<F> MakeFunctionSink(F function, bool enabled = true) {
+  return FunctionSink<F>(function, enabled);
+}
+
+/**
+ * @brief Pass the input to two stages in sequence.
+ */
+template <typename A, typename B>
+class Fanout {
+ public:
+  Fanout(A a, B b) : a_{a}, b_{b} {}
+
+  template <typename... Args>
+  void operator()(const Args&... args) {
+    if (a_.enabled()) {
+      a_(args...);
+    }
+    if (b_.enabled()) {
+      b_(args...);
+    }
+  }
+
+  bool enabled() const { return a_.enabled() || b_.enabled(); }
+
+  void begin() {
+    a_.begin();
+    b_.begin();
+  }
+
+ protected:
+  A a_;
+  B b_;
+};
+
+template <typename A, typename B>
+Fanout<A, B> MakeFanout(A a, B b) {
+  return Fanout<A, B>(a, b);
+}
+
+// Fanouts of more than two stages are nested pairs
+template <typename A, typename B, typename... Rest>
+struct FanoutType {
+  typedef Fanout<A, typename FanoutType<B, Rest...>::type> type;
+};
+
+template <typename A, typename B>
+struct FanoutType<A, B> {
+  typedef Fanout<A, B> type;
+};
+
+template <typename A, typename B, typename C, typename... Rest>
+typename FanoutType<A, B, C, Rest...>::type MakeFanout(A a, B b, C c,
+                                                       Rest... rest) {
+  return MakeFanout(a, MakeFanout(b, c, rest...));
+}
+
+/**
+ * @brief Pass the input on while a condition holds.
+ *
+ * The condition is checked whenever the enables are, so it can follow
+ * settings changed at runtime.
+ */
+template <typename F, typename Next>
+class Gate {
+ public:
+  Gate(F is_open, Next next) : is_open_{is_open}, next_{next} {}
+
+  template <typename... Args>
+  void operator()(const Args&... args) {
+    next_(args...);
+  }
+
+  bool enabled() const { return is_open_() && next_.enabled(); }
+  void begin() { next_.begin(); }
+
+ protected:
+  F is_open_;
+  Next next_;
+};
+
+template <typename F, typename Next>
+Gate<F, Next> MakeGate(F is_open, Next next) {
+  return Gate<F, Next>(is_open, next);
+}
+
+/**
+ * @brief Encode CAN frames as YDWG RAW messages.
+ *
+ * Encoding is skipped altogether if no downstream sink is enabled.
+ */
+template <typename Next>
+class YDWGRawEncoder {
+ public:
+  YDWGRawEncoder(Next next) : next_{next} {}
+
+  void operator()(const CANFrame& frame) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    size_t len = CANFrameToYDWGRaw(frame, tv, buf_, sizeof(buf_));
+    if (len > 0) {
+      next_(buf_, len, frame.origin_id);
+    }
+  }
+
+  bool enabled() const { return next_.enabled(); }
+  void begin() { next_.begin(); }
+
+ protected:
+  Next next_;
+  char buf_[kMaxYDWGRawMessageSize];
+};
+
+template <typename Next>
+YDWGRawEncoder<Next> MakeYDWGRawEncoder(Next next) {
+  return YDWGRawEncoder<Next>(next);
+}
+
+/**
+ * @brief Pack consecutive strings into batches.
+ *
+ * Allocation-free equivalent of ConcatenateStrings: a batch is emitted when
+ * the next string would not fit or when the oldest string in the batch is
+ * older than the maximum delay.
+ */
+template <typename Next>
+class StringBatcher {
+ public:
+  StringBatcher(Next next, size_t max_length, unsigned int max_delay_ms)
+      : next_{next}, max_length_{max_length}, max_delay_ms_{max_delay_ms} {}
+
+  void operator()(const char* data, size_t len, uint32_t origin_id) {
+    if (len > max_length_) {
+      deferredW("Input string longer than max length: %s", data);
+      return;
+    }
+    if (len_ + len > max_length_) {
+      flush();
+    }
+    if (len_ == 0) {
+      origin_id_ = origin_id;
+      age_ = 0;
+    }
+    memcpy(buf_ + len_, data, len);
+    len_ += len;
+    buf_[len_] = '\0';
+  }
+
+  void flush() {
+    if (len_ > 0) {
+      next_(buf_, len_, origin_id_);
+      len_ = 0;
+    }
+  }
+
+  bool enabled() const { return next_.enabled(); }
+
+  void begin() {
+    buf_ = new char[max_length_ + 1];
+    next_.begin();
+    ProfiledOnRepeat(ReactESP::app, 1, "StringBatcher timeout", [this]() {
+      if (len_ > 0 && age_ > max_delay_ms_) {
+        flush();
+      }
+    });
+  }
+
+ protected:
+  Next next_;
+  const size_t max_length_;
+  const unsigned int max_delay_ms_;
+  char* buf_ = nullptr;
+  size_t len_ = 0;
+  uint32_t origin_id_ = 0;
+  elapsedMillis age_;  //< Time since first input to the batch
+};
+
+template <typename Next>
+StringBatcher<Next> MakeStringBatcher(Next next, size_t max_length,
+                                      unsigned int max_delay_ms) {
+  return StringBatcher<Next>(next, max_length, max_delay_ms);
+}
+
+/**
+ * @brief Send strings to the clients of a StreamingTCPServer.
+ *
+ * Enabled only while clients are connected.
+ */
+class TCPServerSink {
+ public:
+  TCPServerSink(StreamingTCPServer* server) : server_{server} {}
+
+  void operator()(const char* data, size_t len, uint32_t origin_id) {
+    server_->send_buf(data, origin_id);
+  }
+
+  bool enabled() const {
+    return server_ != nullptr && server_->get_num_sessions() > 0;
+  }
+  void begin() {}
+
+ protected:
+  StreamingTCPServer* server_;
+};
+
+/**
+ * @brief Broadcast strings using a StreamingUDPServer.
+ *
+ * Enabled while the server is.
+ */
+class UDPServerSink {
+ public:
+  UDPServerSink(StreamingUDPServer* server) : server_{server} {}
+
+  void operator()(const char* data, size_t len, uint32_t origin_id) {
+    server_->send(data, origin_id);
+  }
+
+  bool enabled() const { return server_ != nullptr && server_->is_enabled(); }
+  void begin() {}
+
+ protected:
+  StreamingUDPServer* server_;
+};
+
+/**
+ * @brief Pass strings to a dynamic OriginString consumer.
+ *
+ * Allocates a String for every call; intended for optional outputs such as
+ * the TCP client. Disabled if the consumer is null.
+ */
+class OriginStringConsumerSink {
+ public:
+  OriginStringConsumerSink(ValueConsumer<OriginString>* consumer)
+      : consumer_{consumer} {}
+
+  void operator()(const char* data, size_t len, uint32_t origin_id) {
+    consumer_->set_input(OriginString{origin_id, data});
+  }
+
+  bool enabled() const { return consumer_ != nullptr; }
+  void begin() {}
+
+ protected:
+  ValueConsumer<OriginString>* consumer_;
+};
+
+/**
+ * @brief Entry point of a statically wired CAN frame pipeline.
+ *
+ * Dynamic CAN frame producers connect to this consumer as they would to
+ * can_frame_clearinghouse. Only the entry call is virtual.
+ */
+template <typename Pipeline>
+class StaticCANPipeline : public ValueConsumer<CANFrame> {
+ public:
+  StaticCANPipeline(Pipeline pipeline) : pipeline_{pipeline} {
+    pipeline_.begin();
+  }
+
+  void set_input(CANFrame frame, uint8_t input_channel = 0) override {
+    pipeline_(frame);
+  }
+
+ protected:
+  Pipeline pipeline_;
+};
+
+template <typename Pipeline>
+StaticCANPipeline<Pipeline>* NewStaticCANPipeline(Pipeline pipeline) {
+  return new StaticCANPipeline<Pipeline>(pipeline);
+}
+
+#endif  // SH_WG_FIRMWARE_STATIC_CAN_PIPELINE_H_
@@ -0,0 +1,191 @@
+#include "store_and_forward_buffer.h"
+
+#include "deferred_log.h"
+
+StoreAndForwardBuffer::StoreAndForwardBuffer(size_t ram_size,
+                                             const char* spill_path,
+                                             size_t spill_size,
+                                             uint32_t max_age_ms)
+    : ram_size_{ram_size},
+      spill_path_{spill_path != nullptr ? spill_path : ""},
+      spill_size_{spill_path != nullptr ? spill_size : 0},
+      max_age_ms_{max_age_ms} {
+  ram_ = new char[ram_size_];
+  if (spill_path_.length() > 0) {
+    // timestamps don't survive a reboot; discard any earlier contents
+    remove(spill_path_.c_str());
+  }
+}
+
+StoreAndForwardBuffer::~StoreAndForwardBuffer() {
+  if (spill_file_ != nullptr) {
+    fclose(spill_file_);
+    remove(spill_path_.c_str());
+  }
+  delete[] ram_;
+}
+
+bool StoreAndForwardBuffer::push(const char* data, size_t len) {
+  if (len == 0 || len > kMaxEntrySize) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  size_t entry_size = sizeof(EntryHeader) + len;
+  if (ram_write_pos_ + entry_size > ram_size_ && !spilling_) {
+    // reclaim the space of strings already read
+    memmove(ram_, ram_ + ram_read_pos_, ram_write_pos_ - ram_read_pos_);
+    ram_write_pos_ -= ram_read_pos_;
+    ram_read_pos_ = 0;
+  }
+  if (ram_write_pos_ + entry_size > ram_size_) {
+    dropped_++;
+    return false;
+  }
+
+  EntryHeader header = {(uint32_t)millis(), (uint16_t)len};
+  memcpy(ram_ + ram_write_pos_, &header, sizeof(header));
+  memcpy(ram_ + ram_write_pos_ + sizeof(header), data, len);
+  ram_write_pos_ += entry_size;
+  entries_++;
+  return true;
+}
+
+void StoreAndForwardBuffer::spill() {
+  size_t begin;
+  size_t end;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    end = ram_write_pos_;
+    begin = ram_read_pos_;
+    if (spill_size_ == 0 || end - begin < ram_size_ / 2 ||
+        spill_write_pos_ + end - begin > spill_size_) {
+      return;
+    }
+    spilling_ = true;
+  }
+
+  // push() only appends after the end while spilling_ is set, so the file
+  // is written without holding the lock
+  bool ok = true;
+  if (spill_file_ == nullptr) {
+    spill_file_ = fopen(spill_path_.c_str(), "w+b");
+    if (spill_file_ == nullptr) {
+      deferredE("Unable to open the store-and-forward spill file");
+      ok = false;
+    }
+  }
+  if (ok) {
+    fseek(spill_file_, spill_write_pos_, SEEK_SET);
+    if (fwrite(ram_ + begin, 1, end - begin, spill_file_) != end - begin) {
+      deferredE("Store-and-forward spill file write failed");
+      ok = false;
+    } else {
+      fflush(spill_file_);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  spilling_ = false;
+  if (!ok) {
+    return;
+  }
+  spill_write_pos_ += end - begin;
+  ram_read_pos_ = end;
+  if (ram_read_pos_ == ram_write_pos_) {
+    ram_read_pos_ = 0;
+    ram_write_pos_ = 0;
+  }
+}
+
+size_t StoreAndForwardBuffer::read_spilled_entry(size_t pos, size_t end,
+                                                 EntryHeader& header,
+                                                 char* buf, size_t size) {
+  fseek(spill_file_, pos, SEEK_SET);
+  if (fread(&header, sizeof(header), 1, spill_file_) != 1 ||
+      header.len >= size ||
+      fread(buf, 1, header.len, spill_file_) != header.len) {
+    deferredE("Store-and-forward spill file read failed");
+    header.len = 0;
+    return end;
+  }
+  return pos + sizeof(header) + header.len;
+}
+
+bool StoreAndForwardBuffer::read_ram_entry(EntryHeader& header, char* buf) {
+  if (ram_read_pos_ == ram_write_pos_) {
+    return false;
+  }
+  memcpy(&header, ram_ + ram_read_pos_, sizeof(header));
+  memcpy(buf, ram_ + ram_read_pos_ + sizeof(header), header.len);
+  ram_read_pos_ += sizeof(header) + header.len;
+  if (ram_read_pos_ == ram_write_pos_) {
+    ram_read_pos_ = 0;
+    ram_write_pos_ = 0;
+  }
+  return true;
+}
+
+size_t StoreAndForwardBuffer::pop(char* buf, size_t size) {
+  uint32_t now = millis();
+  for (int i = 0; i < kMaxEntriesPerPop; i++) {
+    EntryHeader header;
+    size_t spill_begin;
+    size_t spill_end;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      spill_begin = spill_read_pos_;
+      spill_end = spill_write_pos_;
+      if (spill_begin == spill_end) {
+        if (!read_ram_entry(header, buf)) {
+          entries_ = 0;
+          return 0;
+        }
+        entries_--;
+      }
+    }
+
+    if (spill_begin < spill_end) {
+      // The spill file holds the oldest strings. Only this task moves the
+      // spill file positions, so the entry is read without holding the
+      // lock and the new read position committed afterwards.
+      size_t pos =
+          read_spilled_entry(spill_begin, spill_end, header, buf, size);
+      if (pos >= spill_end) {
+        fclose(spill_file_);
+        spill_file_ = nullptr;
+        remove(spill_path_.c_str());
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (pos >= spill_end) {
+        spill_read_pos_ = 0;
+        spill_write_pos_ = 0;
+      } else {
+        spill_read_pos_ = pos;
+      }
+      entries_--;
+    }
+
+    if (header.len == 0) {
+      continue;
+    }
+    if (now - header.timestamp_ms > max_age_ms_) {
+      expired_++;
+      continue;
+    }
+    buf[header.len] = '\0';
+    return header.len;
+  }
+  // the rest of the expired strings are skipped on the next calls
+  return 0;
+}
+
+bool StoreAndForwardBuffer::empty() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_ == 0;
+}
+
+uint32_t StoreAndForwardBuffer::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_;
+}
@@ -0,0 +1,110 @@
+#ifndef SH_WG_FIRMWARE_STORE_AND_FORWARD_BUFFER_H_
+#define SH_WG_FIRMWARE_STORE_AND_FORWARD_BUFFER_H_
+
+#include <Arduino.h>
+
+#include <cstdio>
+#include <mutex>
+
+/**
+ * @brief Bounded FIFO of timestamped strings, spilling from RAM to a file.
+ *
+ * New strings are appended to a RAM buffer. Once the RAM buffer is half
+ * full, spill() appends its contents to the spill file, which is read back
+ * before the RAM buffer. Strings older than the maximum age are discarded
+ * when they are read. If both the RAM buffer and the spill file are full,
+ * new strings are dropped.
+ *
+ * push(), empty() and size() may be called from any task. The file is only
+ * accessed by pop() and spill(), which must be called from one task, the
+ * consumer of the strings. Neither holds the lock during file operations,
+ * so push() never waits for one.
+ */
+class StoreAndForwardBuffer {
+ public:
+  /**
+   * @param ram_size RAM buffer size in bytes
+   * @param spill_path Spill file path, or nullptr to use RAM only. On
+   * ESP32, the SPIFFS partition is mounted at /spiffs.
+   * @param spill_size Maximum spill file size in bytes
+   * @param max_age_ms Strings older than this are discarded
+   */
+  StoreAndForwardBuffer(size_t ram_size, const char* spill_path,
+                        size_t spill_size, uint32_t max_age_ms);
+  ~StoreAndForwardBuffer();
+
+  /**
+   * @brief Append a string.
+   *
+   * @return false if the string was dropped
+   */
+  bool push(const char* data, size_t len);
+
+  /**
+   * @brief Remove the oldest string that is not too old.
+   *
+   * At most kMaxEntriesPerPop strings are read per call, so that a long run
+   * of expired strings is skipped over several calls.
+   *
+   * @param buf Output buffer; the string is zero-terminated
+   * @param size Output buffer size; must be larger than kMaxEntrySize
+   * @return String length, or 0 if the buffer is empty or only expired
+   * strings were read
+   */
+  size_t pop(char* buf, size_t size);
+
+  /**
+   * @brief Move the RAM buffer contents to the spill file if the RAM buffer
+   * is half full.
+   *
+   * Called periodically from the task calling pop().
+   */
+  void spill();
+
+  bool empty();
+  uint32_t size();  //< Number of buffered strings
+
+  uint32_t get_dropped() const { return dropped_; }
+  uint32_t get_expired() const { return expired_; }
+
+  static constexpr size_t kMaxEntrySize = 1024;
+  static constexpr int kMaxEntriesPerPop = 32;
+
+ protected:
+  struct EntryHeader {
+    uint32_t timestamp_ms;
+    uint16_t len;
+  } __attribute__((packed));
+
+  std::mutex mutex_;
+
+  char* ram_;
+  const size_t ram_size_;
+  size_t ram_read_pos_ = 0;
+  size_t ram_write_pos_ = 0;
+  // set while spill() writes from the RAM buffer; the data isn't moved
+  bool spilling_ = false;
+
+  String spill_path_;
+  const size_t spill_size_;
+  FILE* spill_file_ = nullptr;
+  size_t spill_read_pos_ = 0;
+  size_t spill_write_pos_ = 0;
+
+  const uint32_t max_age_ms_;
+
+  uint32_t entries_ = 0;
+  uint32_t dropped_ = 0;  //< Strings dropped on a full buffer
+  uint32_t expired_ = 0;  //< Strings discarded for being too old
+
+  /**
+   * @brief Read the spilled entry at pos, without holding the lock.
+   *
+   * @return Position of the next entry; end if the file can't be read
+   */
+  size_t read_spilled_entry(size_t pos, size_t end, EntryHeader& header,
+                            char* buf, size_t size);
+  bool read_ram_entry(EntryHeader& header, char* buf);  //< Under the lock
+};
+
+#endif  // SH_WG_FIRMWARE_STORE_AND_FORWARD_BUFFER_H_
@@ -10,14 +10,22 @@ void ExecuteTCPClientTask(void* this_ptr) {
 }
 
 void StreamingTCPClient::start() {
-  if (enabled_) {
-    xTaskCreate(ExecuteTCPClientTask, "tcp_client_task", 4096, this, 1, NULL);
+  started_ = true;
+
+  // emit received OriginStrings in the main task
+  rx_queue_producer_->connect_to(
+      new LambdaConsumer<OriginString*>([this](OriginString* origin_str) {
+        rx_queue_stats_.dequeued++;
+        this->emit(*origin_str);
+        delete origin_str;
+      }));
 
-    // emit received OriginStrings in the main task
-    rx_queue_producer_->connect_to(
-        new LambdaConsumer<OriginString*>([this](OriginString* origin_str) {
-          this->emit(*origin_str);
-          delete origin_str;
-        }));
+  if (enabled_) {
+    start_task();
   }
 }
+
+void StreamingTCPClient::start_task() {
+  xTaskCreate(ExecuteTCPClientTask, "tcp_client_task", 4096, this, 1,
+              &task_handle_);
+}
@@ -4,18 +4,35 @@
 #include <Arduino.h>
 #include <WiFi.h>
 
+#include <atomic>
+
 #include "buffered_tcp_client.h"
+#include "deferred_log.h"
 #include "origin_string.h"
+#include "queue_stats.h"
+#include "reaction_profiler.h"
 #include "sensesp/net/networking.h"
 #include "sensesp/system/lambda_consumer.h"
 #include "sensesp/system/task_queue_producer.h"
 #include "shwg.h"
+#include "store_and_forward_buffer.h"
 
 using namespace sensesp;
 
+/**
+ * @brief Server a StreamingTCPClient connects to.
+ */
+struct TCPClientTarget {
+  String host;
+  uint16_t port;
+};
+
 /**
  * @brief TCP client that is able to receive and transmit continuous data
  * streams.
+ *
+ * The client runs in a task of its own, created when the client is first
+ * enabled. It can be disabled and moved to another server at any time.
  */
 class StreamingTCPClient : public ValueProducer<OriginString>,
                            public ValueConsumer<OriginString>,
@@ -30,36 +47,137 @@ class StreamingTCPClient : public ValueProducer<OriginString>,
         new TaskQueueProducer<OriginString*>(NULL, task_app_, 200, 491);
     rx_queue_producer_ =
         new TaskQueueProducer<OriginString*>(NULL, ReactESP::app, 200, 492);
+    target_queue_producer_ =
+        new TaskQueueProducer<TCPClientTarget*>(NULL, task_app_, 4, 493);
   }
 
   void set_input(OriginString new_value, uint8_t input_channel = 0) override {
+    if (!enabled_) {
+      return;
+    }
+    if (store_and_forward_ != nullptr) {
+      if (new_value.origin_id == origin_id(&client_->client_)) {
+        return;
+      }
+      // keep the order: live data waits behind any buffered data
+      if (!connected_ || !store_and_forward_->empty()) {
+        if (store_and_forward_->push(new_value.data.c_str(),
+                                     new_value.data.length()) &&
+            connected_) {
+          // sent on top of the replay budget
+          live_buffered_++;
+        }
+        return;
+      }
+    }
     OriginString* value_ptr = new OriginString(new_value);
     bool retval = tx_queue_producer_->set(value_ptr);
     if (retval == false) {
-      debugW("StreamingTCPClient: tx_queue_producer_ full, dropping value");
+      tx_queue_stats_.dropped++;
       delete value_ptr;
+      if (store_and_forward_ != nullptr) {
+        store_and_forward_->push(new_value.data.c_str(),
+                                 new_value.data.length());
+      } else {
+        deferredW(
+            "StreamingTCPClient: tx_queue_producer_ full, dropping value");
+      }
+    } else {
+      tx_queue_stats_.enqueued++;
+    }
+  }
+
+  /**
+   * @brief Connect to the server or disconnect from it.
+   */
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+    if (enabled && started_ && task_handle_ == nullptr) {
+      start_task();
+    }
+  }
+
+  bool is_enabled() const { return enabled_; }
+
+  /**
+   * @brief Connect to another server. Any current connection is closed.
+   */
+  void set_target(const String& host, uint16_t port) {
+    if (task_handle_ == nullptr) {
+      host_ = host;
+      port_ = port;
+      return;
+    }
+    // the connection is owned by the client task
+    TCPClientTarget* target = new TCPClientTarget{host, port};
+    if (!target_queue_producer_->set(target)) {
+      debugW("StreamingTCPClient: target change not applied, queue full");
+      delete target;
     }
   }
 
-  void set_enabled(bool enabled) { enabled_ = enabled; }
+  /**
+   * @brief Buffer outgoing data while the connection is down.
+   *
+   * Buffered data is sent on reconnection, ahead of live data. Live data
+   * arriving while the backlog is sent is queued behind it and sent at its
+   * incoming rate, so the backlog drains at the replay rate on top of it.
+   * Call before the client is first enabled.
+   *
+   * @param buffer Store-and-forward buffer
+   * @param replay_rate Number of backlog strings sent per second
+   */
+  void set_store_and_forward(StoreAndForwardBuffer* buffer,
+                             uint32_t replay_rate) {
+    store_and_forward_ = buffer;
+    replay_rate_ = replay_rate > 0 ? replay_rate : 1;
+  }
+
+  StoreAndForwardBuffer* get_store_and_forward() const {
+    return store_and_forward_;
+  }
+
+  TaskHandle_t get_task_handle() const { return task_handle_; }
+  const QueueStats& get_tx_queue_stats() const { return tx_queue_stats_; }
+  const QueueStats& get_rx_queue_stats() const { return rx_queue_stats_; }
 
  protected:
   Networking* networking_;
-  const String host_;
-  const uint16_t port_;
+  // accessed from the client task only, once it has been created
+  String host_;
+  uint16_t port_;
 
   BufferedTCPClient* client_;
 
   TaskQueueProducer<OriginString*>* tx_queue_producer_;
   TaskQueueProducer<OriginString*>* rx_queue_producer_;
+  TaskQueueProducer<TCPClientTarget*>* target_queue_producer_;
+  QueueStats tx_queue_stats_;
+  QueueStats rx_queue_stats_;
+
+  TaskHandle_t task_handle_ = nullptr;
+
+  StoreAndForwardBuffer* store_and_forward_ = nullptr;
+  uint32_t replay_rate_ = 0;
+  // live strings buffered while connected, not yet sent
+  std::atomic<uint32_t> live_buffered_{0};
+  std::atomic<bool> connected_{false};
 
   ObservableValue<OriginString> tx_string_;
 
   ReactESP* task_app_ = nullptr;
 
-  bool enabled_ = true;
+  std::atomic<bool> enabled_{true};
+  bool started_ = false;
 
   void start() override;
+  void start_task();
+
+  void disconnect() {
+    client_->client_->stop();
+    client_->clear_buf();
+    connected_ = false;
+  }
 
   void execute_client_task() {
     // Receive strings to be transmitted in the tcp client task.
@@ -67,19 +185,39 @@ class StreamingTCPClient : public ValueProducer<OriginString>,
     // we're responsible for deleting the received string objects.
     this->tx_queue_producer_->connect_to(
         new LambdaConsumer<OriginString*>([this](OriginString* origin_str) {
+          tx_queue_stats_.dequeued++;
           this->tx_string_ = *origin_str;
           delete origin_str;
         }));
 
+    // the connect reaction below reconnects to the new server
+    this->target_queue_producer_->connect_to(
+        new LambdaConsumer<TCPClientTarget*>([this](TCPClientTarget* target) {
+          if (target->host != host_ || target->port != port_) {
+            debugI("Moving TCP client from %s:%d to %s:%d", host_.c_str(),
+                   port_, target->host.c_str(), target->port);
+            host_ = target->host;
+            port_ = target->port;
+            disconnect();
+          }
+          delete target;
+        }));
+
     auto send_data =
         new LambdaConsumer<OriginString>([this](OriginString origin_str) {
-          if (client_->client_->connected() &&
-              origin_str.origin_id != origin_id(&client_->client_)) {
+          if (origin_str.origin_id == origin_id(&client_->client_)) {
+            return;
+          }
+          if (client_->client_->connected()) {
             client_->client_->write(origin_str.data.c_str());
+          } else if (store_and_forward_ != nullptr) {
+            // the connection was lost after the string was queued
+            store_and_forward_->push(origin_str.data.c_str(),
+                                     origin_str.data.length());
           }
         });
 
-    task_app_->onRepeat(2000, [this]() {
+    ProfiledOnRepeat(task_app_, 2000, "StreamingTCPClient keepalive", [this]() {
       if (client_->client_->connected()) {
         // Send an empty line as a keepalive message. Without this,
         // disconnection detection takes just about forever.
@@ -87,7 +225,7 @@ class StreamingTCPClient : public ValueProducer<OriginString>,
       }
     });
 
-    task_app_->onRepeat(100, [this]() {
+    ProfiledOnRepeat(task_app_, 100, "StreamingTCPClient flush", [this]() {
       // flush the TCP client TX buffer
       if (client_->client_->connected()) {
         client_->client_->flush();
@@ -97,8 +235,9 @@ class StreamingTCPClient : public ValueProducer<OriginString>,
     tx_string_.connect_to(send_data);
 
     // receive any data sent to the client
-    task_app_->onRepeat(1, [this]() {
-      if (client_->available() || client_->client_->connected()) {
+    ProfiledOnRepeat(task_app_, 1, "StreamingTCPClient receive", [this]() {
+      connected_ = client_->client_->connected();
+      if (client_->available() || connected_) {
         String line;
         int retval;
         while (this->client_->read_line(line)) {
@@ -106,17 +245,48 @@ class StreamingTCPClient : public ValueProducer<OriginString>,
               new OriginString{origin_id(&client_->client_), line};
           retval = this->rx_queue_producer_->set(value);
           if (retval == false) {
-            debugW(
+            deferredW(
                 "StreamingTCPClient: rx_queue_producer_ full, dropping value");
+            rx_queue_stats_.dropped++;
             delete value;
+          } else {
+            rx_queue_stats_.enqueued++;
           }
         }
       }
     });
 
+    // send buffered data at a limited rate, in 10 ms slices, and write
+    // the buffer to flash in this task rather than in the main task
+    if (store_and_forward_ != nullptr) {
+      ProfiledOnRepeat(task_app_, 10, "StreamingTCPClient replay", [this]() {
+        store_and_forward_->spill();
+        if (!connected_) {
+          return;
+        }
+        char buf[StoreAndForwardBuffer::kMaxEntrySize + 1];
+        uint32_t budget = replay_rate_ / 100 > 0 ? replay_rate_ / 100 : 1;
+        budget += live_buffered_.exchange(0);
+        for (uint32_t i = 0; i < budget; i++) {
+          if (store_and_forward_->pop(buf, sizeof(buf)) == 0) {
+            break;
+          }
+          client_->client_->write(buf);
+        }
+      });
+    }
+
     // try to establish a connection to the server
-    task_app_->onRepeat(1000, [this]() {
-      if (!client_->client_->connected()) {
+    ProfiledOnRepeat(task_app_, 1000, "StreamingTCPClient connect", [this]() {
+      connected_ = client_->client_->connected();
+      if (!enabled_) {
+        if (connected_) {
+          debugI("Disconnecting from %s:%d", host_.c_str(), port_);
+          disconnect();
+        }
+        return;
+      }
+      if (!connected_) {
         client_->client_->stop();
         client_->clear_buf();
         debugD("Connecting to %s:%d...", host_.c_str(), port_);
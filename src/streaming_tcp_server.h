@@ -4,24 +4,84 @@
 #include <Arduino.h>
 #include <WiFi.h>
 
-#include <list>
 #include <memory>
 
 #include "buffered_tcp_client.h"
 #include "origin_string.h"
+#include "reaction_profiler.h"
 #include "sensesp/net/networking.h"
 #include "sensesp/system/lambda_consumer.h"
 #include "sensesp/system/valueconsumer.h"
 #include "shwg.h"
+#include "ydwg_raw_subscription.h"
 
 using namespace sensesp;
 
 constexpr size_t kMaxClients = 10;
 
+// Pending connections are accepted, and closed or idle sessions removed,
+// at this interval
+constexpr unsigned int kSessionCheckIntervalMs = 50;
+
+// Lines starting with this prefix are subscription commands, if enabled
+constexpr char kSubscriptionCommandPrefix[] = "$SHWG ";
+
+/**
+ * @brief Traffic counters of a client session.
+ */
+struct TCPSessionStats {
+  uint32_t bytes_in = 0;
+  uint32_t lines_in = 0;
+  uint32_t bytes_out = 0;
+  uint32_t lines_out = 0;     //< Written or queued for the client
+  uint32_t drops = 0;         //< Lines that couldn't be written
+  uint32_t filtered = 0;      //< Lines not subscribed to
+  uint32_t max_write_us = 0;  //< Slowest direct write
+};
+
+/**
+ * @brief Slot of a StreamingTCPServer session table.
+ *
+ * Sessions are allocated together with the server and reused for new
+ * connections, so that connecting clients don't allocate buffers.
+ */
+class TCPSession : public BufferedTCPClient {
+ public:
+  TCPSession() : BufferedTCPClient(std::make_shared<WiFiClient>()) {}
+
+  bool active_ = false;
+  IPAddress remote_ip_;
+  uint32_t connected_ms_ = 0;
+  uint32_t last_activity_ms_ = 0;  //< Last data received or delivered
+  TCPSessionStats stats_;
+  // allocated on the first subscription command and kept for reuse
+  std::unique_ptr<YDWGRawSubscription> subscription_;
+
+  bool has_subscription() const {
+    return subscription_ != nullptr && subscription_->size() > 0;
+  }
+
+  /**
+   * @brief Queue a line for the client, behind the output already queued.
+   */
+  void queue_line(const char* data) {
+    stats_.lines_out++;
+    if (!queue(data)) {
+      stats_.drops++;
+    }
+  }
+};
+
 /**
  * @brief TCP server that is able to receive and transmit continuous data
  * streams.
  *
+ * Clients are served from a table of kMaxClients sessions. Connections
+ * beyond that are refused, and sessions in which nothing has been received
+ * or delivered for the idle timeout are closed.
+ *
+ * A YDWG RAW server can let each client select the frames it receives with
+ * subscription commands; see set_subscriptions().
  */
 class StreamingTCPServer : public ValueProducer<OriginString>,
                            public ValueConsumer<OriginString>,
@@ -31,18 +91,67 @@ class StreamingTCPServer : public ValueProducer<OriginString>,
       : Startable(50), networking_{networking}, port_{port} {
     server_ = new WiFiServer(port);
 
-    ReactESP::app->onRepeatMicros(100, [this]() {
-      this->check_connections();
-      this->check_client_input();
+    ProfiledOnRepeatMicros(ReactESP::app, 100, "StreamingTCPServer", [this]() {
+      if (num_sessions_ > 0) {
+        this->check_client_input();
+        this->send_queued();
+      }
     });
+
+    ProfiledOnRepeat(ReactESP::app, kSessionCheckIntervalMs,
+                     "StreamingTCPServer sessions",
+                     [this]() { this->check_connections(); });
+  }
+
+  void send_buf(const OriginString& value) {
+    send_buf(value.data.c_str(), value.origin_id);
   }
 
-  void send_buf(OriginString value) {
-    // debugD("Sending: %s", buf);
-    for (auto it = clients_.begin(); it != clients_.end(); it++) {
-      if ((*it).client_ != NULL && (*it).client_->connected() &&
-          value.origin_id != origin_id(&((*it).client_))) {
-        (*it).client_->write(value.data.c_str());
+  /**
+   * @brief Send a string to all clients except the one it originated from.
+   */
+  void send_buf(const char* data, uint32_t data_origin_id) {
+    if (num_sessions_ == 0) {
+      return;
+    }
+    size_t len = strlen(data);
+    uint32_t now = millis();
+    // the frame header is parsed once, for the first subscribed session
+    int frame_len = kNotParsed;
+    uint32_t frame_id;
+    uint8_t frame_data[2];
+    for (auto& session : sessions_) {
+      if (!session.active_ || data_origin_id == origin_id(&session.client_)) {
+        continue;
+      }
+      if (session.has_subscription()) {
+        if (frame_len == kNotParsed) {
+          frame_len = ParseYDWGRawLine(data, frame_id, frame_data);
+        }
+        if (frame_len >= 0 && !session.subscription_->accept(
+                                  frame_id, frame_len, frame_data, now)) {
+          session.stats_.filtered++;
+          continue;
+        }
+      }
+      // lines written directly would overtake the pending output
+      if (session.has_pending()) {
+        session.queue_line(data);
+        continue;
+      }
+      session.stats_.lines_out++;
+      uint32_t start_us = micros();
+      size_t written = session.client_->write((const uint8_t*)data, len);
+      uint32_t write_us = micros() - start_us;
+      if (write_us > session.stats_.max_write_us) {
+        session.stats_.max_write_us = write_us;
+      }
+      session.stats_.bytes_out += written;
+      if (written > 0) {
+        session.last_activity_ms_ = now;
+      }
+      if (written < len) {
+        session.stats_.drops++;
       }
     }
   }
@@ -51,72 +160,359 @@ class StreamingTCPServer : public ValueProducer<OriginString>,
     send_buf(new_value);
   }
 
-  void set_enabled(bool enabled) { enabled_ = enabled; }
+  /**
+   * @brief Start or stop listening. Stopping closes the open sessions.
+   */
+  void set_enabled(bool enabled) {
+    if (enabled == enabled_) {
+      return;
+    }
+    enabled_ = enabled;
+    if (!enabled) {
+      stop_listening();
+    } else if (network_up_) {
+      begin_listening();
+    }
+  }
+
+  /**
+   * @brief Move the server to another port. The open sessions are closed.
+   */
+  void set_port(uint16_t port) {
+    if (port == port_) {
+      return;
+    }
+    stop_listening();
+    delete server_;
+    port_ = port;
+    server_ = new WiFiServer(port);
+    if (enabled_ && network_up_) {
+      begin_listening();
+    }
+  }
+
+  uint16_t get_port() const { return port_; }
+
+  /**
+   * @brief Close sessions in which nothing has been received or delivered
+   * for the given time.
+   *
+   * @param timeout_ms Idle timeout; 0 keeps idle sessions open
+   */
+  void set_idle_timeout(uint32_t timeout_ms) { idle_timeout_ms_ = timeout_ms; }
+
+  /**
+   * @brief Send YDWG RAW data to each client through a conflating queue.
+   *
+   * Clients that can't keep up receive the latest value of each message
+   * instead of blocking the main loop. Sessions open at the time are
+   * closed, since a queue may hold a partially sent message.
+   *
+   * @param capacity Maximum number of queued messages per client; 0 writes
+   * to the clients directly
+   * @param is_fast_packet_pgn Function telling whether a PGN is sent as
+   * fast packets
+   */
+  void set_conflation(size_t capacity,
+                      std::function<bool(uint32_t pgn)> is_fast_packet_pgn) {
+    if (capacity == conflation_capacity_) {
+      return;
+    }
+    conflation_capacity_ = capacity;
+    close_sessions();
+    for (auto& session : sessions_) {
+      if (capacity == 0) {
+        session.tx_queue_.reset();
+      } else {
+        session.tx_queue_ =
+            std::make_shared<ConflatingQueue>(capacity, is_fast_packet_pgn);
+      }
+    }
+  }
+
+  /**
+   * @brief Number of queued messages replaced by newer ones, over all
+   * clients.
+   */
+  uint32_t get_conflated() const {
+    uint32_t conflated = conflated_by_closed_clients_;
+    for (auto& session : sessions_) {
+      if (session.active_ && session.tx_queue_ != nullptr) {
+        conflated += session.tx_queue_->get_replaced();
+      }
+    }
+    return conflated;
+  }
+
+  /**
+   * @brief Accept subscription commands from YDWG RAW clients.
+   *
+   * A client sends "$SHWG SUB " followed by a list of entries
+   * "PGN[:SOURCE][/INTERVAL_MS]" to receive only those PGNs, optionally
+   * only from one source address and at most once per interval and
+   * source. "$SHWG SUB *" restores the full stream. The server replies
+   * with "$SHWG OK <number of entries>" or "$SHWG ERR <reason>". Command
+   * lines are not emitted.
+   *
+   * @param is_fast_packet_pgn Function telling whether a PGN is sent as
+   * fast packets
+   */
+  void set_subscriptions(
+      std::function<bool(uint32_t pgn)> is_fast_packet_pgn) {
+    subscriptions_enabled_ = true;
+    is_fast_packet_pgn_ = is_fast_packet_pgn;
+  }
+
+  int get_num_sessions() const { return num_sessions_; }
+  uint32_t get_refused() const { return refused_; }  //< Table was full
+  uint32_t get_evicted() const { return evicted_; }  //< Idle timeouts
+
+  /**
+   * @brief Describe the open sessions and their traffic.
+   */
+  String get_session_summary() const {
+    String summary;
+    uint32_t now = millis();
+    for (auto& session : sessions_) {
+      if (!session.active_) {
+        continue;
+      }
+      if (summary.length() > 0) {
+        summary += "; ";
+      }
+      const TCPSessionStats& stats = session.stats_;
+      uint32_t drops = stats.drops;
+      summary += session.remote_ip_.toString() + " (" +
+                 String((now - session.connected_ms_) / 1000) + " s): in " +
+                 String(stats.bytes_in) + " B/" + String(stats.lines_in) +
+                 " lines, out " + String(stats.bytes_out) + " B/" +
+                 String(stats.lines_out) + " lines, ";
+      if (session.has_subscription()) {
+        summary += String(session.subscription_->size()) + " PGNs (" +
+                   String(stats.filtered) + " lines filtered), ";
+      }
+      if (session.tx_queue_ != nullptr) {
+        drops += session.tx_queue_->get_dropped();
+        summary += String(drops) + " dropped, lag " +
+                   String(session.tx_queue_->get_lag_ms(now)) + " ms";
+      } else {
+        summary += String(drops) + " dropped, slowest write " +
+                   String(stats.max_write_us / 1000) + " ms";
+      }
+    }
+    return summary.length() > 0 ? summary : String("No clients");
+  }
+
+  /**
+   * @brief Set a function to be called when a new client connects.
+   *
+   * Can be used to send initial data to the client with
+   * TCPSession::queue_line(). The queued lines are sent without blocking,
+   * ahead of the lines the server is given after them.
+   */
+  void set_client_connected_callback(
+      std::function<void(TCPSession &)> callback) {
+    client_connected_callback_ = callback;
+  }
 
  protected:
   Networking *networking_;
   WiFiServer *server_;
-  const uint16_t port_;
+  uint16_t port_;
 
   bool enabled_ = true;
+  bool network_up_ = false;
+  bool listening_ = false;
+  uint32_t idle_timeout_ms_ = 0;
+
+  std::function<void(TCPSession &)> client_connected_callback_;
+
+  TCPSession sessions_[kMaxClients];
+  int num_sessions_ = 0;
+  uint32_t refused_ = 0;
+  uint32_t evicted_ = 0;
+
+  size_t conflation_capacity_ = 0;
+  uint32_t conflated_by_closed_clients_ = 0;
+
+  bool subscriptions_enabled_ = false;
+  std::function<bool(uint32_t pgn)> is_fast_packet_pgn_;
+
+  static constexpr int kNotParsed = -2;
 
-  std::list<BufferedTCPClient> clients_;
+  void open_session(TCPSession& session, WiFiClient& client, uint32_t now) {
+    *session.client_ = client;
+    session.reset();
+    session.active_ = true;
+    session.remote_ip_ = client.remoteIP();
+    session.connected_ms_ = now;
+    session.last_activity_ms_ = now;
+    session.stats_ = TCPSessionStats();
+    if (session.subscription_ != nullptr) {
+      session.subscription_->clear();
+    }
+    num_sessions_++;
+    debugD("Client %s connected to port %d",
+           session.remote_ip_.toString().c_str(), port_);
+    if (client_connected_callback_) {
+      client_connected_callback_(session);
+    }
+  }
 
-  void add_client(WiFiClient &client) {
-    debugD("New client connected");
-    clients_.push_back(
-        BufferedTCPClient(WiFiClientPtr(new WiFiClient(client))));
+  void close_session(TCPSession& session) {
+    if (session.tx_queue_ != nullptr) {
+      conflated_by_closed_clients_ += session.tx_queue_->get_replaced();
+    }
+    session.client_->stop();
+    session.reset();
+    session.active_ = false;
+    num_sessions_--;
   }
 
-  void stop_client(std::list<BufferedTCPClient>::iterator &it) {
-    debugD("Client disconnected");
-    (*it).client_->stop();
-    it = clients_.erase(it);
+  void close_sessions() {
+    for (auto& session : sessions_) {
+      if (session.active_) {
+        close_session(session);
+      }
+    }
+  }
+
+  void begin_listening() {
+    debugI("Starting Streaming TCP server on port %d", port_);
+    server_->begin();
+    listening_ = true;
+  }
+
+  void stop_listening() {
+    if (!listening_) {
+      return;
+    }
+    debugI("Stopping Streaming TCP server on port %d", port_);
+    close_sessions();
+    server_->end();
+    listening_ = false;
   }
 
   void check_connections() {
-    // listen for incoming clients
-    WiFiClient client = server_->available();
+    uint32_t now = millis();
+    for (auto& session : sessions_) {
+      if (!session.active_) {
+        continue;
+      }
+      if (!session.client_->connected()) {
+        debugD("Client %s disconnected", session.remote_ip_.toString().c_str());
+        close_session(session);
+      } else if (idle_timeout_ms_ > 0 &&
+                 now - session.last_activity_ms_ > idle_timeout_ms_) {
+        debugI("Closing idle session of %s",
+               session.remote_ip_.toString().c_str());
+        evicted_++;
+        close_session(session);
+      }
+    }
 
-    if (client) {
-      add_client(client);
+    if (!listening_) {
+      return;
+    }
+    // accept the connections that arrived since the last check; the
+    // bound keeps a connection flood from stalling the main loop
+    for (size_t i = 0; i < kMaxClients; i++) {
+      WiFiClient client = server_->available();
+      if (!client) {
+        break;
+      }
+      TCPSession* free_session = nullptr;
+      for (auto& session : sessions_) {
+        if (!session.active_) {
+          free_session = &session;
+          break;
+        }
+      }
+      if (free_session == nullptr) {
+        debugW("Refusing client %s: %d sessions on port %d",
+               client.remoteIP().toString().c_str(), num_sessions_, port_);
+        refused_++;
+        client.stop();
+        continue;
+      }
+      open_session(*free_session, client, now);
     }
+  }
 
-    for (auto it = clients_.begin(); it != clients_.end(); it++) {
-      if ((*it).client_ != NULL) {
-        if (!(*it).client_->connected()) {
-          stop_client(it);
+  void check_client_input() {
+    String line;
+    for (auto& session : sessions_) {
+      if (!session.active_) {
+        continue;
+      }
+      int received;
+      while ((received = session.read_line(line)) > 0) {
+        session.stats_.bytes_in += received;
+        session.stats_.lines_in++;
+        session.last_activity_ms_ = millis();
+        if (subscriptions_enabled_ &&
+            strncmp(line.c_str(), kSubscriptionCommandPrefix,
+                    strlen(kSubscriptionCommandPrefix)) == 0) {
+          handle_command(session, line);
+          continue;
         }
+        OriginString value{origin_id(&session.client_), line};
+        this->emit(value);
+      }
+    }
+  }
+
+  void handle_command(TCPSession& session, String& line) {
+    line.trim();
+    String args = line.substring(strlen(kSubscriptionCommandPrefix));
+    String reply;
+    if (args.startsWith("SUB ")) {
+      if (session.subscription_ == nullptr) {
+        session.subscription_.reset(
+            new YDWGRawSubscription(is_fast_packet_pgn_));
+      }
+      if (session.subscription_->set(args.c_str() + 4)) {
+        reply = "$SHWG OK " + String(session.subscription_->size()) + "\r\n";
+        debugD("Client %s subscribed to %d PGNs",
+               session.remote_ip_.toString().c_str(),
+               session.subscription_->size());
       } else {
-        debugW("Client did not get automatically erased");
-        it = clients_.erase(it);  // Should have been erased by StopClient
+        reply = "$SHWG ERR invalid subscription\r\n";
       }
+    } else {
+      reply = "$SHWG ERR unknown command\r\n";
+    }
+    // queued sessions may be in the middle of a message
+    if (session.has_pending()) {
+      session.queue(reply.c_str());
+    } else {
+      session.client_->write(reply.c_str());
     }
   }
 
-  void check_client_input() {
-    for (auto it = clients_.begin(); it != clients_.end(); it++) {
-      if ((*it).client_ != NULL && (*it).client_->connected()) {
-        String line;
-        while ((*it).read_line(line)) {
-          OriginString value{origin_id(&((*it).client_)), line};
-          this->emit(value);
+  void send_queued() {
+    for (auto& session : sessions_) {
+      if (session.active_ && session.has_pending()) {
+        size_t sent = session.send_queued();
+        if (sent > 0) {
+          session.stats_.bytes_out += sent;
+          session.last_activity_ms_ = millis();
         }
       }
     }
   }
 
   void start() override {
-    if (enabled_) {
-      networking_->connect_to(
-          new LambdaConsumer<WifiState>([this](WifiState state) {
-            if ((state == WiFiState::kWifiConnectedToAP) ||
-                (state == WiFiState::kWifiAPModeActivated)) {
-              debugI("Starting Streaming TCP server on port %d", port_);
-              server_->begin();
-            }
-          }));
-    }
+    // follow the network state even while disabled, so that the server
+    // can be enabled at runtime
+    networking_->connect_to(
+        new LambdaConsumer<WifiState>([this](WifiState state) {
+          network_up_ = (state == WiFiState::kWifiConnectedToAP) ||
+                        (state == WiFiState::kWifiAPModeActivated);
+          if (network_up_ && enabled_) {
+            begin_listening();
+          }
+        }));
   }
 };
 
@@ -5,13 +5,43 @@
 #include <AsyncUDP.h>
 #include <WiFi.h>
 
+#include <vector>
+
+#include "deferred_log.h"
 #include "sensesp/net/networking.h"
 #include "sensesp/system/task_queue_producer.h"
 #include "sensesp/system/valueconsumer.h"
 #include "origin_string.h"
+#include "queue_stats.h"
+#include "reaction_profiler.h"
 
 using namespace sensesp;
 
+enum class UDPOutputMode {
+  kBroadcast,
+  kMulticast,  ///< Send to a multicast group and receive from it
+  kUnicast,    ///< Send to a list of peers
+};
+
+/**
+ * @brief Unicast destination of a StreamingUDPServer.
+ *
+ * With a pacing interval, the data for the peer is collected for up to
+ * the interval and sent in datagrams of up to kMaxUDPPeerDatagramSize
+ * bytes; a full datagram is sent right away. Fewer, larger datagrams take
+ * less airtime and wake up power-saving clients less often.
+ */
+struct UDPPeer {
+  IPAddress address;
+  uint16_t port;
+  uint32_t pacing_ms;  //< 0 sends the data immediately
+  String pending = "";
+  uint32_t last_sent_ms = 0;
+};
+
+// stay below the path MTU to avoid IP fragmentation
+constexpr size_t kMaxUDPPeerDatagramSize = 1400;
+
 class StreamingUDPServer : public ValueProducer<OriginString>,
                            public ValueConsumer<OriginString>,
                            public Startable {
@@ -22,59 +52,285 @@ class StreamingUDPServer : public ValueProducer<OriginString>,
   }
 
   void set_input(OriginString new_value, uint8_t input_channel = 0) override {
-    if (connected_ && new_value.origin_id != origin_id(&async_udp_)) {
-      size_t len_sent = async_udp_.broadcast(new_value.data.c_str());
-      if (len_sent == 0) {
-        debugW("UDP broadcast failed: %s", new_value.data.c_str());
+    send(new_value.data.c_str(), new_value.origin_id);
+  }
+
+  /**
+   * @brief Send a string unless it was received by this server.
+   */
+  void send(const char* data, uint32_t data_origin_id) {
+    if (!connected_ || data_origin_id == origin_id(&async_udp_)) {
+      return;
+    }
+    size_t len = strlen(data);
+    switch (mode_) {
+      case UDPOutputMode::kBroadcast:
+        if (async_udp_.broadcast(data) == 0) {
+          deferredW("UDP broadcast failed: %s", data);
+        }
+        break;
+      case UDPOutputMode::kMulticast:
+        if (async_udp_.writeTo((const uint8_t*)data, len, multicast_group_,
+                               port_) == 0) {
+          deferredW("UDP multicast failed: %s", data);
+        }
+        break;
+      case UDPOutputMode::kUnicast:
+        for (auto& peer : peers_) {
+          if (peer.pacing_ms == 0) {
+            send_to(peer, data, len);
+            continue;
+          }
+          if (peer.pending.length() + len > kMaxUDPPeerDatagramSize) {
+            flush(peer);
+          }
+          peer.pending += data;
+        }
+        break;
+    }
+  }
+
+  /**
+   * @brief Start or stop sending and receiving.
+   */
+  void set_enabled(bool enabled) {
+    if (enabled == enabled_) {
+      return;
+    }
+    enabled_ = enabled;
+    relisten();
+  }
+
+  /**
+   * @brief Move the server to another port.
+   */
+  void set_port(uint16_t port) {
+    if (port == port_) {
+      return;
+    }
+    port_ = port;
+    relisten();
+  }
+
+  uint16_t get_port() const { return port_; }
+  bool is_enabled() const { return enabled_; }
+
+  /**
+   * @brief Broadcast the data; the default.
+   */
+  void set_broadcast() {
+    bool was_multicast = mode_ == UDPOutputMode::kMulticast;
+    mode_ = UDPOutputMode::kBroadcast;
+    peers_.clear();
+    if (was_multicast) {
+      relisten();
+    }
+  }
+
+  /**
+   * @brief Send to a multicast group instead of broadcasting. The group is
+   * also joined for reception.
+   */
+  void set_multicast_group(IPAddress group) {
+    bool rejoin =
+        mode_ != UDPOutputMode::kMulticast || group != multicast_group_;
+    mode_ = UDPOutputMode::kMulticast;
+    multicast_group_ = group;
+    peers_.clear();
+    if (rejoin) {
+      relisten();
+    }
+  }
+
+  /**
+   * @brief Send to a list of peers instead of broadcasting.
+   *
+   * @param peers Comma-separated list of ADDRESS[:PORT][/PACING_MS]
+   * entries, e.g. "192.168.4.2, 192.168.4.3:10110/500". The port defaults
+   * to the server port and the pacing interval to 0.
+   * @return false if an entry is invalid; the valid entries are used
+   */
+  bool set_unicast_peers(const String& peers) {
+    bool was_multicast = mode_ == UDPOutputMode::kMulticast;
+    mode_ = UDPOutputMode::kUnicast;
+    // pending paced data of the replaced peers is discarded
+    peers_.clear();
+    bool valid = true;
+    unsigned int begin = 0;
+    while (begin < peers.length()) {
+      int end = peers.indexOf(',', begin);
+      if (end == -1) {
+        end = peers.length();
+      }
+      String entry = peers.substring(begin, end);
+      entry.trim();
+      begin = end + 1;
+      if (entry.length() == 0) {
+        continue;
+      }
+
+      UDPPeer peer;
+      peer.port = port_;
+      peer.pacing_ms = 0;
+      int slash = entry.indexOf('/');
+      if (slash != -1) {
+        peer.pacing_ms = entry.substring(slash + 1).toInt();
+        entry = entry.substring(0, slash);
       }
+      int colon = entry.indexOf(':');
+      if (colon != -1) {
+        peer.port = entry.substring(colon + 1).toInt();
+        entry = entry.substring(0, colon);
+      }
+      if (!peer.address.fromString(entry) || peer.port == 0) {
+        debugW("Invalid UDP peer: %s", entry.c_str());
+        valid = false;
+        continue;
+      }
+      peers_.push_back(peer);
+    }
+    if (was_multicast) {
+      relisten();
     }
+    if (started_) {
+      start_pacing();
+    }
+    return valid;
   }
 
-  void set_enabled(bool enabled) { enabled_ = enabled; }
+  UDPOutputMode get_mode() const { return mode_; }
+  const std::vector<UDPPeer>& get_peers() const { return peers_; }
+
+  const QueueStats& get_rx_queue_stats() const { return rx_queue_stats_; }
 
  protected:
   Networking* networking_;
-  const uint16_t port_;
+  uint16_t port_;
   AsyncUDP async_udp_;
   bool connected_ = false;
+  bool started_ = false;
+  bool network_up_ = false;
+  bool pacing_ = false;  //< The peer pacing reaction exists
   TaskQueueProducer<OriginString*>* task_queue_producer_;
+  QueueStats rx_queue_stats_;
 
   bool enabled_ = true;
 
+  UDPOutputMode mode_ = UDPOutputMode::kBroadcast;
+  IPAddress multicast_group_;
+  std::vector<UDPPeer> peers_;
+
+  void send_to(UDPPeer& peer, const char* data, size_t len) {
+    if (async_udp_.writeTo((const uint8_t*)data, len, peer.address,
+                           peer.port) == 0) {
+      deferredW("UDP send to %s failed", peer.address.toString().c_str());
+    }
+    peer.last_sent_ms = millis();
+  }
+
+  void flush(UDPPeer& peer) {
+    if (peer.pending.length() > 0) {
+      send_to(peer, peer.pending.c_str(), peer.pending.length());
+      peer.pending = "";
+    }
+  }
+
+  bool listen() {
+    if (mode_ == UDPOutputMode::kMulticast) {
+      return async_udp_.listenMulticast(multicast_group_, port_);
+    }
+    return async_udp_.listen(port_);
+  }
+
+  void begin_listening() {
+    debugI("Starting Streaming UDP server on port %d", port_);
+    if (!listen()) {
+      debugE("UDP Server startup failed - port reserved?");
+      return;
+    }
+    connected_ = true;
+    async_udp_.onPacket([this](AsyncUDPPacket packet) {
+      // ignore our own broadcasts
+      if (packet.remoteIP() == WiFi.localIP()) {
+        return;
+      }
+      // ensure that the received packet is zero-terminated
+      char buf[packet.length() + 1];
+      memcpy(buf, packet.data(), packet.length());
+      buf[packet.length()] = '\0';
+
+      OriginString* ydwg_string =
+          new OriginString{origin_id(&async_udp_), buf};
+      //  Handle the received packet in the main task
+      int retval = task_queue_producer_->set(ydwg_string);
+      if (retval == false) {
+        deferredW(
+            "StreamingUDPServer: task_queue_producer_ full, dropping value");
+        rx_queue_stats_.dropped++;
+        delete ydwg_string;
+      } else {
+        rx_queue_stats_.enqueued++;
+      }
+    });
+  }
+
+  /**
+   * @brief Close the socket and open it again with the current settings.
+   */
+  void relisten() {
+    if (connected_) {
+      debugI("Stopping Streaming UDP server");
+      async_udp_.close();
+      connected_ = false;
+    }
+    if (enabled_ && network_up_) {
+      begin_listening();
+    }
+  }
+
+  void start_pacing() {
+    if (pacing_) {
+      return;
+    }
+    for (auto& peer : peers_) {
+      if (peer.pacing_ms > 0) {
+        ProfiledOnRepeat(ReactESP::app, kPeerPacingTickMs, "UDP peer pacing",
+                         [this]() { flush_paced_peers(); });
+        pacing_ = true;
+        break;
+      }
+    }
+  }
+
   void start() override {
-    if (enabled_) {
-      networking_->connect_to(
-          new LambdaConsumer<WifiState>([this](WifiState state) {
-            if ((state == WiFiState::kWifiConnectedToAP) ||
-                (state == WiFiState::kWifiAPModeActivated)) {
-              debugI("Starting Streaming UDP server on port %d", port_);
-              if (async_udp_.listen(port_)) {
-                connected_ = true;
-                async_udp_.onPacket([this](AsyncUDPPacket packet) {
-                  // ensure that the received packet is zero-terminated
-                  char buf[packet.length() + 1];
-                  memcpy(buf, packet.data(), packet.length());
-                  buf[packet.length()] = '\0';
-
-                  OriginString* ydwg_string = new OriginString{
-                      origin_id(&async_udp_), buf};
-                  //  Handle the received packet in the main task
-                  int retval = task_queue_producer_->set(ydwg_string);
-                  if (retval == false) {
-                    debugW("StreamingUDPServer: task_queue_producer_ full, dropping value");
-                    delete ydwg_string;
-                  }
-                });
-              } else {
-                debugE("UDP Server startup failed - port reserved?");
-              }
-            }
-          }));
-      task_queue_producer_->connect_to(
-          new LambdaConsumer<OriginString*>([this](OriginString* ydwg_str) {
-            this->emit(*ydwg_str);
-            delete ydwg_str;
-          }));
+    started_ = true;
+    // follow the network state even while disabled, so that the server
+    // can be enabled at runtime
+    networking_->connect_to(
+        new LambdaConsumer<WifiState>([this](WifiState state) {
+          network_up_ = (state == WiFiState::kWifiConnectedToAP) ||
+                        (state == WiFiState::kWifiAPModeActivated);
+          if (network_up_ && enabled_) {
+            begin_listening();
+          }
+        }));
+    task_queue_producer_->connect_to(
+        new LambdaConsumer<OriginString*>([this](OriginString* ydwg_str) {
+          rx_queue_stats_.dequeued++;
+          this->emit(*ydwg_str);
+          delete ydwg_str;
+        }));
+    start_pacing();
+  }
+
+  static constexpr uint32_t kPeerPacingTickMs = 10;
+
+  void flush_paced_peers() {
+    uint32_t now = millis();
+    for (auto& peer : peers_) {
+      if (peer.pacing_ms > 0 && now - peer.last_sent_ms >= peer.pacing_ms) {
+        flush(peer);
+      }
     }
   }
 };
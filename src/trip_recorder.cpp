@@ -0,0 +1,194 @@
+#include "trip_recorder.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <algorithm>
+
+#include "deferred_log.h"
+
+void ExecuteTripRecorderTask(void* this_ptr) {
+  TripRecorder* this_ = (TripRecorder*)this_ptr;
+
+  this_->execute_writer_task();
+}
+
+TripRecorder::TripRecorder(const char* directory, size_t file_size,
+                           size_t total_size)
+    : Startable(50),
+      directory_{directory},
+      file_size_{file_size},
+      max_files_{(uint32_t)std::max(total_size / file_size, (size_t)2)},
+      // start a new recording with the first frame
+      file_bytes_{file_size} {}
+
+bool TripRecorder::is_recording_name(const char* name) {
+  unsigned int number;
+  int len = 0;
+  return sscanf(name, "trip_%5u.bin%n", &number, &len) == 1 &&
+         len == (int)strlen(name) && len == 14;
+}
+
+String TripRecorder::get_path(uint32_t number) const {
+  char name[16];
+  snprintf(name, sizeof(name), "trip_%05u.bin", (unsigned)number);
+  return directory_ + "/" + name;
+}
+
+void TripRecorder::start() {
+  // continue the numbering of the existing recordings
+  DIR* dir = opendir(directory_.c_str());
+  if (dir != nullptr) {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (!is_recording_name(entry->d_name)) {
+        continue;
+      }
+      uint32_t number = atoi(entry->d_name + 5);
+      if (first_number_ == 0 || number < first_number_) {
+        first_number_ = number;
+      }
+      if (number > last_number_) {
+        last_number_ = number;
+      }
+    }
+    closedir(dir);
+  }
+  if (first_number_ == 0) {
+    first_number_ = 1;
+  }
+
+  xTaskCreate(ExecuteTripRecorderTask, "trip_recorder_task", 4096, this, 1,
+              &task_handle_);
+}
+
+void TripRecorder::set_input(CANFrame frame, uint8_t input_channel) {
+  uint32_t start_cycles = ESP.getCycleCount();
+  if (!record(frame)) {
+    dropped_++;
+    return;
+  }
+  uint32_t cycles = ESP.getCycleCount() - start_cycles;
+  frames_++;
+  total_cycles_ += cycles;
+  if (cycles > max_cycles_) {
+    max_cycles_ = cycles;
+  }
+  if (cycles > kCycleBudget) {
+    budget_overruns_++;
+  }
+}
+
+bool TripRecorder::record(const CANFrame& frame) {
+  if (fill_ + kMaxTripRecordSize > kBufferSize && !hand_over()) {
+    return false;
+  }
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  uint64_t time_ms = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+
+  if (file_bytes_ + kMaxTripRecordSize > file_size_) {
+    // each recording starts in a buffer of its own
+    if (fill_ > 0 && !hand_over()) {
+      return false;
+    }
+    fill_ = encoder_.begin(time_ms, buffers_[active_]);
+    file_bytes_ = fill_;
+    active_starts_file_ = true;
+  }
+
+  size_t len = encoder_.encode(frame, time_ms, buffers_[active_] + fill_);
+  fill_ += len;
+  file_bytes_ += len;
+  return true;
+}
+
+/**
+ * @brief Hand over the active buffer to the writer task.
+ *
+ * @return false if the writer task is still busy with the other buffer
+ */
+bool TripRecorder::hand_over() {
+  if (pending_.load(std::memory_order_acquire) >= 0) {
+    return false;
+  }
+  pending_len_ = fill_;
+  pending_starts_file_ = active_starts_file_;
+  pending_.store(active_, std::memory_order_release);
+
+  active_ ^= 1;
+  fill_ = 0;
+  active_starts_file_ = false;
+  return true;
+}
+
+void TripRecorder::flush() {
+  if (fill_ > 0) {
+    hand_over();
+  }
+}
+
+void TripRecorder::open_next_file() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+  last_number_++;
+  while (last_number_ - first_number_ + 1 > max_files_) {
+    remove(get_path(first_number_).c_str());
+    first_number_++;
+  }
+  file_ = fopen(get_path(last_number_).c_str(), "wb");
+  if (file_ == nullptr) {
+    deferredE("Unable to create a trip recording");
+  }
+}
+
+void TripRecorder::execute_writer_task() {
+  while (true) {
+    int index = pending_.load(std::memory_order_acquire);
+    if (index < 0) {
+      delay(10);
+      continue;
+    }
+
+    if (pending_starts_file_) {
+      open_next_file();
+    }
+    if (file_ == nullptr ||
+        fwrite(buffers_[index], 1, pending_len_, file_) != pending_len_ ||
+        fflush(file_) != 0) {
+      write_errors_++;
+    }
+
+    pending_.store(-1, std::memory_order_release);
+  }
+}
+
+std::vector<TripRecorder::FileInfo> TripRecorder::get_files() const {
+  std::vector<FileInfo> files;
+  DIR* dir = opendir(directory_.c_str());
+  if (dir == nullptr) {
+    return files;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (!is_recording_name(entry->d_name)) {
+      continue;
+    }
+    struct stat st;
+    String path = directory_ + "/" + entry->d_name;
+    if (stat(path.c_str(), &st) == 0) {
+      files.push_back({entry->d_name, (size_t)st.st_size});
+    }
+  }
+  closedir(dir);
+
+  // the numbers are zero-padded
+  std::sort(files.begin(), files.end(),
+            [](const FileInfo& a, const FileInfo& b) {
+              return a.name < b.name;
+            });
+  return files;
+}
@@ -0,0 +1,124 @@
+#ifndef SH_WG_FIRMWARE_TRIP_RECORDER_H_
+#define SH_WG_FIRMWARE_TRIP_RECORDER_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <vector>
+
+#include "can_frame.h"
+#include "sensesp/system/startable.h"
+#include "sensesp/system/valueconsumer.h"
+#include "trip_recording.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Record CAN frames to rotating files in the compact binary format
+ * of trip_recording.h.
+ *
+ * Frames are encoded into one of two RAM buffers in the calling task. A
+ * full buffer is handed over to a low-priority writer task, so that flash
+ * writes never block frame processing. If the writer task hasn't finished
+ * with the previous buffer, frames are dropped and counted.
+ *
+ * Recordings are named trip_NNNNN.bin with an increasing number; a new
+ * recording is started on every boot and whenever the current one reaches
+ * the file size limit. The oldest recordings are removed to stay within the
+ * total size limit.
+ */
+class TripRecorder : public ValueConsumer<CANFrame>, public Startable {
+ public:
+  struct FileInfo {
+    String name;
+    size_t size;
+  };
+
+  /**
+   * @param directory Directory for the recordings. On ESP32, the SPIFFS
+   * partition is mounted at /spiffs.
+   * @param file_size Maximum size of a single recording in bytes
+   * @param total_size Maximum size of all recordings in bytes
+   */
+  TripRecorder(const char* directory, size_t file_size, size_t total_size);
+
+  void set_input(CANFrame frame, uint8_t input_channel = 0) override;
+
+  void start() override;
+
+  /**
+   * @brief Hand over any buffered frames to the writer task.
+   *
+   * Called periodically so that the recording on flash stays current.
+   */
+  void flush();
+
+  /**
+   * @brief List the recordings, oldest first.
+   */
+  std::vector<FileInfo> get_files() const;
+
+  /**
+   * @brief Check whether a file name is a valid recording name.
+   */
+  static bool is_recording_name(const char* name);
+
+  uint32_t get_frames() const { return frames_; }
+  uint32_t get_dropped() const { return dropped_; }
+  uint32_t get_write_errors() const { return write_errors_; }
+  uint32_t get_cycles_per_frame() const {
+    return frames_ > 0 ? (uint32_t)(total_cycles_ / frames_) : 0;
+  }
+  uint32_t get_max_cycles() const { return max_cycles_; }
+  // frames whose recording took longer than kCycleBudget
+  uint32_t get_budget_overruns() const { return budget_overruns_; }
+  TaskHandle_t get_task_handle() const { return task_handle_; }
+
+  static constexpr size_t kBufferSize = 4096;
+  // CPU cycles allowed for recording a frame; 10 us at 240 MHz
+  static constexpr uint32_t kCycleBudget = 2400;
+
+ protected:
+  const String directory_;
+  const size_t file_size_;
+  const uint32_t max_files_;
+
+  TripRecordingEncoder encoder_;
+
+  // accessed by the recording task only
+  uint8_t buffers_[2][kBufferSize];
+  int active_ = 0;
+  size_t fill_ = 0;
+  bool active_starts_file_ = false;
+  size_t file_bytes_;
+
+  // Buffer handed over to the writer task, or -1. The length and the new
+  // file flag are set before the index is stored.
+  std::atomic<int> pending_{-1};
+  size_t pending_len_ = 0;
+  bool pending_starts_file_ = false;
+
+  // accessed by the writer task only, after start()
+  FILE* file_ = nullptr;
+  uint32_t first_number_ = 0;
+  uint32_t last_number_ = 0;
+
+  uint32_t frames_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t write_errors_ = 0;
+  uint64_t total_cycles_ = 0;
+  uint32_t max_cycles_ = 0;
+  uint32_t budget_overruns_ = 0;
+
+  TaskHandle_t task_handle_ = nullptr;
+
+  bool hand_over();
+  bool record(const CANFrame& frame);
+  String get_path(uint32_t number) const;
+  void open_next_file();
+  void execute_writer_task();
+
+  friend void ExecuteTripRecorderTask(void* this_ptr);
+};
+
+#endif  // SH_WG_FIRMWARE_TRIP_RECORDER_H_
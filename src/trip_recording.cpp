@@ -0,0 +1,215 @@
+#include "trip_recording.h"
+
+#include <cstring>
+
+static const uint8_t kMagic[4] = {'S', 'H', 'T', 'R'};
+
+constexpr uint8_t kSyncRecord = 0x0F;
+constexpr uint8_t kTransmittedFlag = 0x40;
+constexpr uint8_t kNewIdFlag = 0x80;
+constexpr int kDeltaSizes[4] = {0, 1, 2, 4};
+
+static inline uint8_t* PutLE(uint8_t* pos, uint64_t value, int size) {
+  for (int i = 0; i < size; i++) {
+    *pos++ = value >> (8 * i);
+  }
+  return pos;
+}
+
+static inline uint64_t GetLE(const uint8_t* pos, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; i++) {
+    value |= (uint64_t)pos[i] << (8 * i);
+  }
+  return value;
+}
+
+size_t TripRecordingEncoder::begin(uint64_t start_ms, uint8_t* buf) {
+  previous_ms_ = start_ms;
+  num_ids_ = 0;
+  next_evicted_ = 0;
+  memset(hash_table_, 0, sizeof(hash_table_));
+
+  if (buf == nullptr) {
+    return 0;
+  }
+  memcpy(buf, kMagic, sizeof(kMagic));
+  buf[4] = kTripRecordingVersion;
+  buf[5] = buf[6] = buf[7] = 0;
+  PutLE(buf + 8, start_ms, 8);
+  return kTripRecordingHeaderSize;
+}
+
+int TripRecordingEncoder::find_slot(uint32_t id) const {
+  for (int i = hash(id);; i = (i + 1) % kHashTableSize) {
+    int entry = hash_table_[i];
+    if (entry == 0) {
+      return -1;
+    }
+    if (ids_[entry - 1] == id) {
+      return entry - 1;
+    }
+  }
+}
+
+void TripRecordingEncoder::insert_hash(uint32_t id, int slot) {
+  int i = hash(id);
+  while (hash_table_[i] != 0) {
+    i = (i + 1) % kHashTableSize;
+  }
+  hash_table_[i] = slot + 1;
+}
+
+int TripRecordingEncoder::add_id(uint32_t id) {
+  int slot;
+  if (num_ids_ < kTripRecordingDictionarySize) {
+    slot = num_ids_++;
+    ids_[slot] = id;
+    insert_hash(id, slot);
+    return slot;
+  }
+
+  // The dictionary is full; reuse the slots in turn. Rebuilding the hash
+  // table is simpler than deleting from it, and evictions are rare on a
+  // real bus.
+  slot = next_evicted_;
+  next_evicted_ = (next_evicted_ + 1) % kTripRecordingDictionarySize;
+  ids_[slot] = id;
+  memset(hash_table_, 0, sizeof(hash_table_));
+  for (int i = 0; i < num_ids_; i++) {
+    insert_hash(ids_[i], i);
+  }
+  return slot;
+}
+
+size_t TripRecordingEncoder::encode(const CANFrame& frame, uint64_t time_ms,
+                                    uint8_t* buf) {
+  uint8_t* pos = buf;
+
+  if (time_ms < previous_ms_ || time_ms - previous_ms_ > 0xFFFFFFFF) {
+    *pos++ = kSyncRecord;
+    pos = PutLE(pos, time_ms, 8);
+    previous_ms_ = time_ms;
+  }
+  uint32_t delta = time_ms - previous_ms_;
+  previous_ms_ = time_ms;
+  int delta_code = delta == 0 ? 0 : delta <= 0xFF ? 1 : delta <= 0xFFFF ? 2 : 3;
+
+  int len = frame.len > 8 ? 8 : frame.len;
+  uint8_t header = len | delta_code << 4;
+  if (frame.origin_type == CANFrameOriginType::kApp) {
+    header |= kTransmittedFlag;
+  }
+
+  uint8_t* header_pos = pos++;
+  pos = PutLE(pos, delta, kDeltaSizes[delta_code]);
+
+  int slot = find_slot(frame.id);
+  if (slot < 0) {
+    slot = add_id(frame.id);
+    header |= kNewIdFlag;
+    *pos++ = slot;
+    pos = PutLE(pos, frame.id, 4);
+    memcpy(pos, frame.buf, len);
+    pos += len;
+    // bytes past the length of the first frame compare against zero
+    memset(data_[slot], 0, 8);
+    memcpy(data_[slot], frame.buf, len);
+  } else {
+    *pos++ = slot;
+    if (len > 0) {
+      uint8_t* mask_pos = pos++;
+      uint8_t mask = 0;
+      uint8_t* previous = data_[slot];
+      for (int i = 0; i < len; i++) {
+        if (frame.buf[i] != previous[i]) {
+          mask |= 1 << i;
+          *pos++ = frame.buf[i];
+          previous[i] = frame.buf[i];
+        }
+      }
+      *mask_pos = mask;
+    }
+  }
+
+  *header_pos = header;
+  return pos - buf;
+}
+
+size_t TripRecordingDecoder::begin(const uint8_t* buf, size_t len) {
+  if (len < kTripRecordingHeaderSize ||
+      memcmp(buf, kMagic, sizeof(kMagic)) != 0 ||
+      buf[4] != kTripRecordingVersion) {
+    return 0;
+  }
+  start_ms_ = GetLE(buf + 8, 8);
+  previous_ms_ = start_ms_;
+  memset(ids_, 0, sizeof(ids_));
+  memset(data_, 0, sizeof(data_));
+  return kTripRecordingHeaderSize;
+}
+
+int TripRecordingDecoder::decode(const uint8_t* buf, size_t len,
+                                 CANFrame& frame, uint64_t& time_ms) {
+  const uint8_t* pos = buf;
+  const uint8_t* end = buf + len;
+
+  while (pos < end && *pos == kSyncRecord) {
+    if (end - pos < 9) {
+      return 0;
+    }
+    previous_ms_ = GetLE(pos + 1, 8);
+    pos += 9;
+  }
+  if (pos == end) {
+    return 0;
+  }
+
+  uint8_t header = *pos++;
+  int data_len = header & 0x0F;
+  if (data_len > 8) {
+    return -1;
+  }
+  int delta_size = kDeltaSizes[(header >> 4) & 0x03];
+  if (end - pos < delta_size + 1) {
+    return 0;
+  }
+  uint32_t delta = GetLE(pos, delta_size);
+  pos += delta_size;
+  int slot = *pos++;
+
+  uint8_t* data = data_[slot];
+  if (header & kNewIdFlag) {
+    if (end - pos < 4 + data_len) {
+      return 0;
+    }
+    ids_[slot] = GetLE(pos, 4);
+    pos += 4;
+    memset(data, 0, 8);
+    memcpy(data, pos, data_len);
+    pos += data_len;
+  } else if (data_len > 0) {
+    if (pos == end) {
+      return 0;
+    }
+    uint8_t mask = *pos++;
+    if (end - pos < __builtin_popcount(mask)) {
+      return 0;
+    }
+    for (int i = 0; i < data_len; i++) {
+      if (mask & (1 << i)) {
+        data[i] = *pos++;
+      }
+    }
+  }
+
+  previous_ms_ += delta;
+  time_ms = previous_ms_;
+  frame.id = ids_[slot];
+  frame.len = data_len;
+  memcpy(frame.buf, data, data_len);
+  frame.origin_id = 0;
+  frame.origin_type = (header & kTransmittedFlag) ? CANFrameOriginType::kApp
+                                                   : CANFrameOriginType::kCAN;
+  return pos - buf;
+}
@@ -0,0 +1,129 @@
+#ifndef SH_WG_FIRMWARE_TRIP_RECORDING_H_
+#define SH_WG_FIRMWARE_TRIP_RECORDING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "can_frame.h"
+
+// Compact binary CAN frame recording format.
+//
+// A recording starts with a 16 byte file header: the magic "SHTR", a
+// format version byte, three reserved bytes and the start time as a
+// little-endian uint64 in milliseconds since the epoch.
+//
+// Each frame record starts with a record header byte:
+//
+//   bits 0-3  data length (0-8), or 0xF for a time sync record
+//   bits 4-5  timestamp delta size: 0, 1, 2 or 4 bytes
+//   bit 6     transmitted by an application ('T' in YDWG RAW)
+//   bit 7     new dictionary entry
+//
+// followed by the little-endian millisecond delta to the previous record
+// and a one byte dictionary slot. A new dictionary entry is followed by the
+// little-endian 32-bit CAN id and the raw data bytes. Otherwise, the slot
+// refers to an earlier id and the data is encoded against the previous data
+// of the same id: a mask byte with a bit set for each changed byte,
+// followed by the changed bytes.
+//
+// A time sync record (header 0x0F) is followed by an absolute little-endian
+// uint64 timestamp. It is emitted when the clock steps backwards or too far
+// forwards.
+//
+// Every recording is self-contained; the dictionary starts empty.
+
+constexpr uint8_t kTripRecordingVersion = 1;
+constexpr size_t kTripRecordingHeaderSize = 16;
+// header, delta, slot, id and data
+constexpr size_t kMaxTripFrameRecordSize = 1 + 4 + 1 + 4 + 8;
+// a frame record may be preceded by a time sync record
+constexpr size_t kMaxTripRecordSize = 1 + 8 + kMaxTripFrameRecordSize;
+constexpr int kTripRecordingDictionarySize = 256;
+
+/**
+ * @brief Encode CAN frames in the compact binary recording format.
+ *
+ * Encoding doesn't allocate memory and takes constant time, except when
+ * an id is evicted from a full dictionary.
+ */
+class TripRecordingEncoder {
+ public:
+  TripRecordingEncoder() { begin(0, nullptr); }
+
+  /**
+   * @brief Start a new recording.
+   *
+   * @param start_ms Recording start time in milliseconds since the epoch
+   * @param buf Buffer for the file header of kTripRecordingHeaderSize
+   * bytes, or nullptr to only reset the encoder state
+   * @return Number of bytes written
+   */
+  size_t begin(uint64_t start_ms, uint8_t* buf);
+
+  /**
+   * @brief Encode a frame.
+   *
+   * @param frame Frame to encode
+   * @param time_ms Frame time in milliseconds since the epoch
+   * @param buf Buffer of at least kMaxTripRecordSize bytes
+   * @return Number of bytes written
+   */
+  size_t encode(const CANFrame& frame, uint64_t time_ms, uint8_t* buf);
+
+ protected:
+  static constexpr int kHashTableSize = 2 * kTripRecordingDictionarySize;
+
+  uint64_t previous_ms_;
+  uint32_t ids_[kTripRecordingDictionarySize];
+  uint8_t data_[kTripRecordingDictionarySize][8];
+  int num_ids_;
+  int next_evicted_;  //< Slot to reuse when the dictionary is full
+  // open addressing hash table of slot + 1; 0 marks an empty entry
+  uint16_t hash_table_[kHashTableSize];
+
+  static int hash(uint32_t id) {
+    return (id * 2654435761u) >> 23;  // 9 bits
+  }
+  int find_slot(uint32_t id) const;
+  int add_id(uint32_t id);
+  void insert_hash(uint32_t id, int slot);
+};
+
+/**
+ * @brief Decode a recording made by TripRecordingEncoder.
+ */
+class TripRecordingDecoder {
+ public:
+  /**
+   * @brief Parse the file header.
+   *
+   * @return Number of bytes consumed, or 0 if the header is invalid
+   */
+  size_t begin(const uint8_t* buf, size_t len);
+
+  /**
+   * @brief Decode the next frame.
+   *
+   * Transmitted frames have the origin type kApp and received frames the
+   * origin type kCAN.
+   *
+   * @param buf Record data
+   * @param len Number of bytes available
+   * @param frame Decoded frame
+   * @param time_ms Frame time in milliseconds since the epoch
+   * @return Number of bytes consumed, 0 if the data ends in the middle of a
+   * record, or -1 if the data is invalid
+   */
+  int decode(const uint8_t* buf, size_t len, CANFrame& frame,
+             uint64_t& time_ms);
+
+  uint64_t get_start_ms() const { return start_ms_; }
+
+ protected:
+  uint64_t previous_ms_ = 0;
+  uint64_t start_ms_ = 0;
+  uint32_t ids_[kTripRecordingDictionarySize] = {};
+  uint8_t data_[kTripRecordingDictionarySize][8] = {};
+};
+
+#endif  // SH_WG_FIRMWARE_TRIP_RECORDING_H_
@@ -1,18 +1,78 @@
 #include "ui_controls.h"
 
-static const char kPortConfigSchema[] = R"({
+#include <vector>
+
+#include "routing_table.h"
+#include "sensesp/system/lambda_consumer.h"
+
+// configurations saved in the web UI, handed over to the main task
+static TaskQueueProducer<Configurable*>* config_changes = nullptr;
+
+void SetConfigChangeCallback(
+    std::function<void(Configurable* config)> callback) {
+  config_changes =
+      new TaskQueueProducer<Configurable*>(nullptr, ReactESP::app, 16, 990);
+  config_changes->connect_to(new LambdaConsumer<Configurable*>(callback));
+}
+
+static void ReportConfigChange(Configurable* config) {
+  if (config_changes != nullptr && !config_changes->set(config)) {
+    debugW("Configuration change queue full; restart to apply the change");
+  }
+}
+
+static const char kUDPOutputSchemaProperties[] = R"(,
+        "output_mode": { "title": "Output mode", "type": "string",
+                         "enum": ["Broadcast", "Multicast", "Unicast"] },
+        "multicast_group": { "title": "Multicast group", "type": "string" },
+        "peers": { "title": "Unicast peers (address[:port][/pacing ms], ...)",
+                   "type": "string" })";
+
+String UDPOutputConfig::get_schema_properties() {
+  return enabled ? kUDPOutputSchemaProperties : "";
+}
+
+void UDPOutputConfig::get_configuration(JsonObject& root) {
+  if (!enabled) {
+    return;
+  }
+  root["output_mode"] = mode;
+  root["multicast_group"] = multicast_group;
+  root["peers"] = peers;
+}
+
+void UDPOutputConfig::set_configuration(const JsonObject& config) {
+  // optional, for compatibility with configurations saved before the
+  // output modes were added
+  if (config.containsKey("output_mode")) {
+    mode = config["output_mode"].as<String>();
+  }
+  if (config.containsKey("multicast_group")) {
+    multicast_group = config["multicast_group"].as<String>();
+  }
+  if (config.containsKey("peers")) {
+    peers = config["peers"].as<String>();
+  }
+}
+
+static const char kPortConfigSchemaTemplate[] = R"({
     "type": "object",
     "properties": {
         "enable": { "title": "Enable", "type": "boolean" },
-        "port": { "title": "Port", "type": "integer" }
+        "port": { "title": "Port", "type": "integer" }{{udp_output}}
     }
   })";
 
-String PortConfig::get_config_schema() { return kPortConfigSchema; }
+String PortConfig::get_config_schema() {
+  String schema = kPortConfigSchemaTemplate;
+  schema.replace("{{udp_output}}", udp_output_.get_schema_properties());
+  return schema;
+}
 
 void PortConfig::get_configuration(JsonObject& root) {
   root["enable"] = enabled_;
   root["port"] = port_;
+  udp_output_.get_configuration(root);
 }
 
 bool PortConfig::set_configuration(const JsonObject& config) {
@@ -28,6 +88,8 @@ bool PortConfig::set_configuration(const JsonObject& config) {
     port_ = config["port"];
   }
 
+  udp_output_.set_configuration(config);
+  ReportConfigChange(this);
   return true;
 }
 
@@ -37,7 +99,7 @@ static const char kBiDiPortConfigSchemaTemplate[] = R"({
     "properties": {
         "enable_tx": { "title": "{{tx_title}}", "type": "boolean" },
         "enable_rx": { "title": "{{rx_title}}", "type": "boolean" },
-        "port": { "title": "Port", "type": "integer" }
+        "port": { "title": "Port", "type": "integer" }{{udp_output}}
     }
   })";
 
@@ -45,12 +107,14 @@ String BiDiPortConfig::get_config_schema() {
   String schema = kBiDiPortConfigSchemaTemplate;
   schema.replace("{{tx_title}}", tx_title_);
   schema.replace("{{rx_title}}", rx_title_);
+  schema.replace("{{udp_output}}", udp_output_.get_schema_properties());
   return schema; }
 
 void BiDiPortConfig::get_configuration(JsonObject& root) {
   root["enable_tx"] = tx_enabled_;
   root["enable_rx"] = rx_enabled_;
   root["port"] = port_;
+  udp_output_.get_configuration(root);
 }
 
 bool BiDiPortConfig::set_configuration(const JsonObject& config) {
@@ -72,6 +136,8 @@ bool BiDiPortConfig::set_configuration(const JsonObject& config) {
     port_ = config["port"];
   }
 
+  udp_output_.set_configuration(config);
+  ReportConfigChange(this);
   return true;
 }
 
@@ -117,6 +183,7 @@ bool HostPortConfig::set_configuration(const JsonObject& config) {
     port_ = config["port"];
   }
 
+  ReportConfigChange(this);
   return true;
 }
 
@@ -144,6 +211,35 @@ bool CheckboxConfig::set_configuration(const JsonObject& config) {
     value_ = config["value"];
   }
 
+  ReportConfigChange(this);
+  return true;
+}
+
+static const char kIntegerConfigSchemaTemplate[] = R"({
+    "type": "object",
+    "properties": {
+        "value": { "title": "{{title}}", "type": "integer" }
+    }
+  })";
+
+String IntegerConfig::get_config_schema() {
+  String schema = kIntegerConfigSchemaTemplate;
+  schema.replace("{{title}}", title_);
+  return schema;
+}
+
+void IntegerConfig::get_configuration(JsonObject& root) {
+  root["value"] = value_;
+}
+
+bool IntegerConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("value")) {
+    return false;
+  } else {
+    value_ = config["value"];
+  }
+
+  ReportConfigChange(this);
   return true;
 }
 
@@ -171,7 +267,22 @@ bool StringConfig::set_configuration(const JsonObject& config) {
     value_ = config["value"].as<String>();
   }
 
+  ReportConfigChange(this);
   return true;
 }
 
-
+bool RoutingTableConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("value")) {
+    return false;
+  }
+  String routes = config["value"].as<String>();
+  std::vector<Route> parsed;
+  String error;
+  if (!ParseRoutingTable(routes, parsed, error)) {
+    debugW("Routing table not saved: %s", error.c_str());
+    return false;
+  }
+  value_ = routes;
+  ReportConfigChange(this);
+  return true;
+}
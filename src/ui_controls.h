@@ -1,11 +1,41 @@
 #ifndef SH_WG_SRC_UI_CONTROLS_H_
 #define SH_WG_SRC_UI_CONTROLS_H_
 
+#include <functional>
+
 #include "sensesp.h"
 #include "sensesp/system/configurable.h"
+#include "sensesp/system/task_queue_producer.h"
 
 using namespace sensesp;
 
+/**
+ * @brief Call a function in the main task whenever a configuration below is
+ * saved in the web UI.
+ *
+ * The configurations are saved in the web server task. The configurations
+ * loaded at startup are not reported.
+ */
+void SetConfigChangeCallback(
+    std::function<void(Configurable* config)> callback);
+
+/**
+ * @brief UDP output addressing fields of the port configs.
+ *
+ * The mode is "Broadcast", "Multicast" or "Unicast". The peers are a
+ * comma-separated list of ADDRESS[:PORT][/PACING_MS] entries.
+ */
+struct UDPOutputConfig {
+  bool enabled = false;  //< Show the fields in the web UI
+  String mode = "Broadcast";
+  String multicast_group = "239.255.0.1";
+  String peers = "";
+
+  void get_configuration(JsonObject& root);
+  void set_configuration(const JsonObject& config);
+  String get_schema_properties();
+};
+
 /**
  * @brief Configurable with Enable checkbox and a Port input field.
  *
@@ -13,10 +43,12 @@ using namespace sensesp;
 class PortConfig : public Configurable {
  public:
   PortConfig(bool enabled, uint16_t port, String config_path,
-             String description, int sort_order = 1000)
+             String description, int sort_order = 1000,
+             bool udp_output = false)
       : enabled_(enabled),
         port_(port),
         Configurable(config_path, description, sort_order) {
+    udp_output_.enabled = udp_output;
     load_configuration();
   }
 
@@ -26,23 +58,27 @@ class PortConfig : public Configurable {
 
   bool get_enabled() { return enabled_; }
   uint16_t get_port() { return port_; }
+  const UDPOutputConfig& get_udp_output() { return udp_output_; }
 
  protected:
   bool enabled_ = false;
   int port_ = 0;
+  UDPOutputConfig udp_output_;
 };
 
 class BiDiPortConfig : public Configurable {
  public:
   BiDiPortConfig(bool tx_enabled, bool rx_enabled, String tx_title,
                  String rx_title, uint16_t port, String config_path,
-                 String description, int sort_order = 1000)
+                 String description, int sort_order = 1000,
+                 bool udp_output = false)
       : tx_enabled_(tx_enabled),
         rx_enabled_(rx_enabled),
         tx_title_(tx_title),
         rx_title_(rx_title),
         port_(port),
         Configurable(config_path, description, sort_order) {
+    udp_output_.enabled = udp_output;
     load_configuration();
   }
 
@@ -53,6 +89,7 @@ class BiDiPortConfig : public Configurable {
   bool get_tx_enabled() { return tx_enabled_; }
   bool get_rx_enabled() { return rx_enabled_; }
   uint16_t get_port() { return port_; }
+  const UDPOutputConfig& get_udp_output() { return udp_output_; }
 
  protected:
   bool tx_enabled_ = false;
@@ -62,6 +99,7 @@ class BiDiPortConfig : public Configurable {
   String rx_title_ = "Receive";
 
   int port_ = 0;
+  UDPOutputConfig udp_output_;
 };
 
 class HostPortConfig : public Configurable {
@@ -117,11 +155,34 @@ class CheckboxConfig : public Configurable {
   String title_ = "Enable";
 };
 
+class IntegerConfig : public Configurable {
+ public:
+  IntegerConfig(int value, String title, String config_path,
+                String description, int sort_order = 1000)
+      : value_(value),
+        title_(title),
+        Configurable(config_path, description, sort_order) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  int get_value() { return value_; }
+
+ protected:
+  int value_ = 0;
+  String title_ = "Value";
+};
+
 class StringConfig : public Configurable {
  public:
-  StringConfig(String& value, String& config_path, String& description,
-               int sort_order = 1000)
-      : value_(value), Configurable(config_path, description, sort_order) {
+  StringConfig(String value, String title, String config_path,
+               String description, int sort_order = 1000)
+      : value_(value),
+        title_(title),
+        Configurable(config_path, description, sort_order) {
     load_configuration();
   }
 
@@ -136,4 +197,18 @@ class StringConfig : public Configurable {
   String title_ = "Value";
 };
 
+/**
+ * @brief StringConfig holding a routing table.
+ *
+ * Invalid tables are rejected when saved.
+ */
+class RoutingTableConfig : public StringConfig {
+ public:
+  RoutingTableConfig(String value, String title, String config_path,
+                     String description, int sort_order = 1000)
+      : StringConfig(value, title, config_path, description, sort_order) {}
+
+  virtual bool set_configuration(const JsonObject& config) override;
+};
+
 #endif  // SH_WG_SRC_UI_CONTROLS_H_
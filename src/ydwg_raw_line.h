@@ -0,0 +1,64 @@
+#ifndef SH_WG_FIRMWARE_YDWG_RAW_LINE_H_
+#define SH_WG_FIRMWARE_YDWG_RAW_LINE_H_
+
+#include <Arduino.h>
+
+// Lightweight inspection of encoded YDWG RAW lines, for code that only
+// needs the CAN id of a line it passes on.
+
+/**
+ * @brief Get the PGN of a 29-bit NMEA 2000 CAN id.
+ *
+ * For addressed (PDU1) PGNs, the destination address in the low byte is
+ * cleared.
+ */
+inline uint32_t CANIdToPGN(uint32_t id) {
+  uint32_t pgn = (id >> 8) & 0x1FFFF;
+  if (((pgn >> 8) & 0xFF) < 240) {
+    pgn &= 0x1FF00;
+  }
+  return pgn;
+}
+
+inline int YDWGRawHexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/**
+ * @brief Get the id and the first two data bytes of a YDWG RAW line,
+ * "hh:mm:ss.mmm D IIIIIIII DD DD ...".
+ *
+ * @return Number of data bytes, or -1 if the line is not a frame
+ */
+inline int ParseYDWGRawLine(const char* line, uint32_t& id, uint8_t* data) {
+  const char* pos = line + 15;
+  if (strnlen(line, 15) < 15 || line[12] != ' ' || line[14] != ' ') {
+    return -1;
+  }
+  id = 0;
+  int digits = 0;
+  int digit;
+  while ((digit = YDWGRawHexDigit(*pos)) >= 0) {
+    id = (id << 4) | digit;
+    digits++;
+    pos++;
+  }
+  if (digits == 0 || digits > 8) {
+    return -1;
+  }
+  int len = 0;
+  while (pos[0] == ' ' && YDWGRawHexDigit(pos[1]) >= 0 &&
+         YDWGRawHexDigit(pos[2]) >= 0) {
+    if (len < 2) {
+      data[len] = (YDWGRawHexDigit(pos[1]) << 4) | YDWGRawHexDigit(pos[2]);
+    }
+    len++;
+    pos += 3;
+  }
+  return len;
+}
+
+#endif  // SH_WG_FIRMWARE_YDWG_RAW_LINE_H_
@@ -1,29 +1,97 @@
 #include "ydwg_raw_output.h"
+
+#include <sys/time.h>
+
 #include "time_string.h"
 #include "origin_string.h"
 
-OriginString CANFrameToYDWGRaw(const CANFrame& frame, struct timeval& timestamp) {
-  constexpr int kBufferSize = 32;
-  char buffer[kBufferSize];
+static const char kHexDigits[] = "0123456789ABCDEF";
 
-  String time_str = GetUTCTimeString(timestamp);
+static inline char* AppendDecimal(char* pos, unsigned int value, int digits) {
+  for (int i = digits - 1; i >= 0; i--) {
+    pos[i] = '0' + value % 10;
+    value /= 10;
+  }
+  return pos + digits;
+}
 
-  // get the CAN id as a hex string
-  snprintf(buffer, kBufferSize, "%08X ", frame.id);
-  String can_id_str = String(buffer);
+/**
+ * @brief Encode a CAN frame as a YDWG RAW device message.
+ *
+ * Writes into the provided buffer without allocating memory.
+ *
+ * @param frame Source frame
+ * @param timestamp Frame reception time
+ * @param buf Destination buffer
+ * @param size Destination buffer size; at least kMaxYDWGRawMessageSize
+ * @return size_t Message length including the CRLF, or 0 if the buffer is
+ * too small.
+ */
+size_t CANFrameToYDWGRaw(const CANFrame& frame,
+                         const struct timeval& timestamp, char* buf,
+                         size_t size) {
+  if (size < kMaxYDWGRawMessageSize) {
+    return 0;
+  }
+  char* pos = buf;
+
+  // UTC time of day; time_t has no leap seconds
+  unsigned int seconds_of_day = timestamp.tv_sec % 86400;
+  pos = AppendDecimal(pos, seconds_of_day / 3600, 2);
+  *pos++ = ':';
+  pos = AppendDecimal(pos, seconds_of_day / 60 % 60, 2);
+  *pos++ = ':';
+  pos = AppendDecimal(pos, seconds_of_day % 60, 2);
+  *pos++ = '.';
+  pos = AppendDecimal(pos, timestamp.tv_usec / 1000, 3);
+  *pos++ = ' ';
 
-  // get the CAN data as a hex bytes
-  for (int i = 0; i < frame.len; i++) {
-    snprintf(buffer + 3*i, kBufferSize - 3*i, "%02X ", frame.buf[i]);
+  *pos++ = frame.origin_type == CANFrameOriginType::kApp ? 'T' : 'R';
+  *pos++ = ' ';
+
+  for (int shift = 28; shift >= 0; shift -= 4) {
+    *pos++ = kHexDigits[(frame.id >> shift) & 0xF];
   }
-  // replace the final space with a zero
-  buffer[3*frame.len - 1] = '\0';
 
-  char direction = frame.origin_type == CANFrameOriginType::kApp ? 'T' : 'R';
+  int len = frame.len > 8 ? 8 : frame.len;
+  for (int i = 0; i < len; i++) {
+    *pos++ = ' ';
+    *pos++ = kHexDigits[frame.buf[i] >> 4];
+    *pos++ = kHexDigits[frame.buf[i] & 0xF];
+  }
 
-  String out = time_str + direction + " " + can_id_str + buffer + "\r\n";
+  *pos++ = '\r';
+  *pos++ = '\n';
+  *pos = '\0';
 
-  OriginString origin_string = {frame.origin_id, out};
+  return pos - buf;
+}
+
+OriginString CANFrameToYDWGRaw(const CANFrame& frame, struct timeval& timestamp) {
+  char buffer[kMaxYDWGRawMessageSize];
+
+  CANFrameToYDWGRaw(frame, timestamp, buffer, kMaxYDWGRawMessageSize);
+
+  OriginString origin_string = {frame.origin_id, buffer};
 
   return origin_string;
 }
+
+/**
+ * @brief Encode a CAN frame received now into an existing string.
+ *
+ * The string's allocation is reused if it is large enough.
+ *
+ * @return false if the frame could not be encoded
+ */
+bool CANFrameToYDWGRaw(const CANFrame& frame, OriginString& output) {
+  struct timeval timestamp;
+  gettimeofday(&timestamp, NULL);
+  char buffer[kMaxYDWGRawMessageSize];
+  if (CANFrameToYDWGRaw(frame, timestamp, buffer, sizeof(buffer)) == 0) {
+    return false;
+  }
+  output.origin_id = frame.origin_id;
+  output.data = buffer;
+  return true;
+}
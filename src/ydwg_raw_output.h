@@ -7,6 +7,13 @@
 #include "can_frame.h"
 #include "origin_string.h"
 
+// "hh:mm:ss.mmm D IIIIIIII" + 8 data bytes + CRLF + terminator
+constexpr size_t kMaxYDWGRawMessageSize = 23 + 8 * 3 + 3;
+
+size_t CANFrameToYDWGRaw(const CANFrame& frame,
+                         const struct timeval& timestamp, char* buf,
+                         size_t size);
 OriginString CANFrameToYDWGRaw(const CANFrame& frame, struct timeval& timestamp);
+bool CANFrameToYDWGRaw(const CANFrame& frame, OriginString& output);
 
 #endif  // SH_WG_FIRMWARE_YDWG_RAW_OUTPUT_H_
@@ -3,12 +3,15 @@
 #include <sys/time.h>
 
 #include "can_frame.h"
+#include "deferred_log.h"
 #include "origin_string.h"
 #include "shwg.h"
 
+#ifdef ARDUINO
 // Workaround for getting strptime to work with the Arduino framework
 extern "C" char* strptime(const char* __restrict, const char* __restrict,
                           struct tm* __restrict);
+#endif
 
 using namespace sensesp;
 
@@ -47,14 +50,14 @@ bool YDWGRawAppStringToCANFrame(CANFrame& frame,
   // verify the token string length
   int can_id_token_length = can_id_token.length();
   if (can_id_token_length == 0 || can_id_token_length > 8) {
-    debugD("CAN id token length incorrect: %s", can_id_token.c_str());
+    deferredD("CAN id token length incorrect: %s", can_id_token.c_str());
     return false;
   }
 
   // convert the can_id_token to a uint32_t
   uint32_t can_id = 0;
   if (sscanf(can_id_token.c_str(), "%x", &can_id) != 1) {
-    debugD("CAN id token parsing failed: %s", can_id_token.c_str());
+    deferredD("CAN id token parsing failed: %s", can_id_token.c_str());
     return false;
   }
 
@@ -72,14 +75,15 @@ bool YDWGRawAppStringToCANFrame(CANFrame& frame,
 
     // verify the token string length
     if (data_token.length() != 2) {
-      debugD("Data token length incorrect: %s (%d)", data_token.c_str(), pos);
+      deferredD("Data token length incorrect: %s (%d)", data_token.c_str(),
+                pos);
       return false;
     }
 
     // convert the data_token to a uint8_t
     unsigned int data_byte;
     if (sscanf(data_token.c_str(), "%02x", &data_byte) != 1) {
-      debugD("Data token parsing failed: %s", data_token.c_str());
+      deferredD("Data token parsing failed: %s", data_token.c_str());
       return false;
     }
 
@@ -115,7 +119,7 @@ bool YDWGRawDeviceStringToCANFrame(CANFrame& frame, struct timeval& timestamp,
   String time_str = next_token(ydwg_raw_str, pos);
 
   if (time_str == "") {
-    debugD("Timestamp token parsing failed: %s", ydwg_raw_str.c_str());
+    deferredD("Timestamp token parsing failed: %s", ydwg_raw_str.c_str());
     return false;
   }
 
@@ -131,32 +135,33 @@ bool YDWGRawDeviceStringToCANFrame(CANFrame& frame, struct timeval& timestamp,
   int minute;
   float second;
   if (sscanf(time_str.c_str(), "%d:%d:%f", &hour, &minute, &second) != 3) {
-    debugD("Timestamp string parsing failed: %s", time_str.c_str());
+    deferredD("Timestamp string parsing failed: %s", time_str.c_str());
     return false;
   }
 
   if (hour < 0 || hour > 23) {
-    debugD("Hour out of range: %d", hour);
+    deferredD("Hour out of range: %d", hour);
     return false;
   }
   if (minute < 0 || minute > 59) {
-    debugD("Minute out of range: %d", minute);
+    deferredD("Minute out of range: %d", minute);
     return false;
   }
   if (second < 0.0 || second >= 60.0) {
-    debugD("Second out of range: %f", second);
+    deferredD("Second out of range: %d", (int)second);
     return false;
   }
 
   timestamp.tv_sec = hour * 3600 + minute * 60 + (int)second;
-  timestamp.tv_usec = (int)((second - (int)second) * 1000000);
+  // the timestamps have millisecond resolution; round off the float error
+  timestamp.tv_usec = (int)((second - (int)second) * 1000 + 0.5) * 1000;
 
   // get the direction token
   String dir_token = next_token(ydwg_raw_str, pos);
 
   // verify the token string length
   if (dir_token.length() != 1 || (dir_token[0] != 'R' && dir_token[0] != 'T')) {
-    debugD("Direction token length incorrect: %s", dir_token.c_str());
+    deferredD("Direction token length incorrect: %s", dir_token.c_str());
     return false;
   }
 
@@ -206,7 +211,7 @@ bool YDWGRawToCANFrame(CANFrame& frame, struct timeval& timestamp,
 
   // Check if the string is too long.
   if (ydwg_raw.data.length() > kMaxLength) {
-    debugD("YDWG raw string too long: %d", ydwg_raw.data.length());
+    deferredD("YDWG raw string too long: %d", (int)ydwg_raw.data.length());
     return false;
   }
 
@@ -0,0 +1,105 @@
+#include "ydwg_raw_replay.h"
+
+#include <sys/time.h>
+
+#include "origin_string.h"
+#include "reaction_profiler.h"
+#include "sensesp.h"
+#include "ydwg_raw_parser.h"
+
+constexpr uint64_t kMillisecondsPerDay = 86400000;
+
+void YDWGRawReplay::start() {
+  file_ = fopen(path_.c_str(), "r");
+  if (file_ == nullptr) {
+    debugE("Unable to open the replay recording %s", path_.c_str());
+    finished_ = true;
+    return;
+  }
+  debugI("Replaying %s at %dx speed", path_.c_str(), speed_);
+  rewind();
+
+  ProfiledOnRepeat(ReactESP::app, 1, "YDWG RAW replay", [this]() { tick(); });
+}
+
+void YDWGRawReplay::rewind() {
+  fseek(file_, 0, SEEK_SET);
+  has_pending_ = false;
+  first_frame_ = true;
+  day_offset_ms_ = 0;
+  frames_in_pass_ = 0;
+  pass_start_ms_ = millis();
+}
+
+/**
+ * @brief Read the next timestamped frame from the recording.
+ *
+ * @return false at the end of the recording
+ */
+bool YDWGRawReplay::read_next() {
+  // longer lines are not valid YDWG RAW messages
+  char line[64];
+  while (fgets(line, sizeof(line), file_) != nullptr) {
+    OriginString ydwg_raw = {0, line};
+    struct timeval timestamp;
+    if (!YDWGRawToCANFrame(pending_, timestamp, ydwg_raw) ||
+        pending_.origin_type == CANFrameOriginType::kApp) {
+      // application format messages have no timestamp
+      continue;
+    }
+
+    uint64_t time_ms = timestamp.tv_sec * 1000ULL + timestamp.tv_usec / 1000 +
+                       day_offset_ms_;
+    if (first_frame_) {
+      first_ms_ = time_ms;
+      previous_ms_ = time_ms;
+      first_frame_ = false;
+    } else if (time_ms + kMillisecondsPerDay / 2 < previous_ms_) {
+      // past midnight
+      day_offset_ms_ += kMillisecondsPerDay;
+      time_ms += kMillisecondsPerDay;
+    }
+    // replay slightly out of order frames immediately
+    if (time_ms < previous_ms_) {
+      time_ms = previous_ms_;
+    }
+    previous_ms_ = time_ms;
+
+    pending_offset_ms_ = time_ms - first_ms_;
+    has_pending_ = true;
+    return true;
+  }
+  return false;
+}
+
+void YDWGRawReplay::tick() {
+  if (finished_) {
+    return;
+  }
+  uint32_t elapsed_ms = millis() - pass_start_ms_;
+  for (int i = 0; i < kMaxFramesPerTick; i++) {
+    if (!has_pending_ && !read_next()) {
+      passes_++;
+      if (!loop_ || frames_in_pass_ == 0) {
+        debugI("Replay of %s finished after %u frames", path_.c_str(),
+               (unsigned)frames_);
+        fclose(file_);
+        file_ = nullptr;
+        finished_ = true;
+        return;
+      }
+      // the next pass starts on the next tick
+      rewind();
+      return;
+    }
+    if (speed_ > 0 && elapsed_ms < pending_offset_ms_ / speed_) {
+      return;
+    }
+    if (!sink_(pending_)) {
+      return;
+    }
+    has_pending_ = false;
+    frames_++;
+    frames_in_pass_++;
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef SH_WG_FIRMWARE_YDWG_RAW_REPLAY_H_
+#define SH_WG_FIRMWARE_YDWG_RAW_REPLAY_H_
+
+#include <Arduino.h>
+
+#include <cstdio>
+#include <functional>
+
+#include "can_frame.h"
+#include "sensesp/system/startable.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Replay a YDWG RAW recording from a file with its original timing.
+ *
+ * The frames are passed to a sink function in the main task. The sink
+ * returns false if it can't take a frame right now; the frame is then
+ * offered again on the next tick, so a slow sink delays the replay instead
+ * of losing frames.
+ *
+ * Only timestamped (device format) messages are replayed. Timestamps only
+ * contain the time of day; a recording may span midnight.
+ */
+class YDWGRawReplay : public Startable {
+ public:
+  /**
+   * @param path Recording file path. On ESP32, the SPIFFS partition is
+   * mounted at /spiffs.
+   * @param speed Replay speed relative to the recording, or 0 to replay as
+   * fast as the sink accepts the frames
+   * @param loop Start over at the end of the recording
+   * @param sink Function receiving the frames
+   */
+  YDWGRawReplay(const String& path, int speed, bool loop,
+                std::function<bool(const CANFrame&)> sink)
+      : Startable(0), path_{path}, speed_{speed}, loop_{loop}, sink_{sink} {}
+
+  void start() override;
+
+  uint32_t get_frames() const { return frames_; }
+  uint32_t get_passes() const { return passes_; }  //< Completed passes
+  bool is_finished() const { return finished_; }
+
+  // frames offered to the sink per tick when replaying as fast as possible
+  static constexpr int kMaxFramesPerTick = 64;
+
+ protected:
+  const String path_;
+  const int speed_;
+  const bool loop_;
+  std::function<bool(const CANFrame&)> sink_;
+
+  FILE* file_ = nullptr;
+  bool finished_ = false;
+
+  // the next frame to replay and its offset from the start of the recording
+  bool has_pending_ = false;
+  CANFrame pending_;
+  uint64_t pending_offset_ms_;
+
+  uint32_t pass_start_ms_;
+  bool first_frame_;
+  uint64_t first_ms_;
+  uint64_t previous_ms_;
+  uint64_t day_offset_ms_;
+
+  uint32_t frames_ = 0;
+  uint32_t frames_in_pass_ = 0;
+  uint32_t passes_ = 0;
+
+  void tick();
+  bool read_next();
+  void rewind();
+};
+
+#endif  // SH_WG_FIRMWARE_YDWG_RAW_REPLAY_H_
@@ -0,0 +1,253 @@
+#ifndef SH_WG_FIRMWARE_YDWG_RAW_SUBSCRIPTION_H_
+#define SH_WG_FIRMWARE_YDWG_RAW_SUBSCRIPTION_H_
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "ydwg_raw_line.h"
+
+/**
+ * @brief Selection of the YDWG RAW frames sent to one client.
+ *
+ * A subscription is a list of PGNs, each optionally restricted to one
+ * source address and limited to one message per interval and source. The
+ * entries are kept in an open-addressed hash table keyed by PGN, so a
+ * frame is checked with a few probes. An empty subscription passes all
+ * frames.
+ *
+ * Rate-limited fast-packet messages are passed or dropped as a whole,
+ * based on their first frame.
+ */
+class YDWGRawSubscription {
+ public:
+  static constexpr int kMaxEntries = 32;
+
+  /**
+   * @param is_fast_packet_pgn Function telling whether a PGN is sent as
+   * fast packets
+   */
+  YDWGRawSubscription(std::function<bool(uint32_t pgn)> is_fast_packet_pgn)
+      : is_fast_packet_pgn_{is_fast_packet_pgn} {
+    clear();
+  }
+
+  /**
+   * @brief Replace the subscription.
+   *
+   * @param list Entries "PGN[:SOURCE][/INTERVAL_MS]" separated by spaces
+   * or commas, or "*" for all frames
+   * @return false if the list is invalid; the subscription is then
+   * unchanged
+   */
+  bool set(const char* list) {
+    Entry parsed[kMaxEntries];
+    int num_parsed = 0;
+    const char* pos = list;
+    while (true) {
+      while (*pos == ' ' || *pos == ',') {
+        pos++;
+      }
+      if (*pos == '\0') {
+        break;
+      }
+      if (*pos == '*' && num_parsed == 0) {
+        pos++;
+        while (*pos == ' ') {
+          pos++;
+        }
+        if (*pos != '\0') {
+          return false;
+        }
+        clear();
+        return true;
+      }
+      if (num_parsed == kMaxEntries) {
+        return false;
+      }
+      Entry& entry = parsed[num_parsed++];
+      if (!parse_number(pos, 0x1FFFF, entry.pgn)) {
+        return false;
+      }
+      // clear a destination address given as part of an addressed PGN
+      entry.pgn = CANIdToPGN(entry.pgn << 8);
+      entry.source = kAnySource;
+      entry.interval_ms = 0;
+      if (*pos == ':') {
+        pos++;
+        if (!parse_number(pos, 0xFF, entry.source)) {
+          return false;
+        }
+      }
+      if (*pos == '/') {
+        pos++;
+        if (!parse_number(pos, 3600000, entry.interval_ms)) {
+          return false;
+        }
+      }
+      if (*pos != ' ' && *pos != ',' && *pos != '\0') {
+        return false;
+      }
+    }
+    if (num_parsed == 0) {
+      return false;
+    }
+
+    clear();
+    for (int i = 0; i < num_parsed; i++) {
+      size_t slot = hash(parsed[i].pgn) & kTableMask;
+      while (entries_[slot].pgn != kEmpty) {
+        slot = (slot + 1) & kTableMask;
+      }
+      entries_[slot] = parsed[i];
+    }
+    num_entries_ = num_parsed;
+    return true;
+  }
+
+  /**
+   * @brief Remove all entries; all frames pass.
+   */
+  void clear() {
+    for (auto& entry : entries_) {
+      entry.pgn = kEmpty;
+    }
+    for (auto& state : rate_states_) {
+      state.key = kEmpty;
+    }
+    num_entries_ = 0;
+  }
+
+  int size() const { return num_entries_; }
+
+  /**
+   * @brief Check whether a frame is sent to the client.
+   *
+   * Frames passed by a rate-limited entry start its next interval.
+   *
+   * @param id CAN id
+   * @param len Number of data bytes
+   * @param data First data byte, if len > 0
+   * @param now_ms Current time
+   */
+  bool accept(uint32_t id, int len, const uint8_t* data, uint32_t now_ms) {
+    if (num_entries_ == 0) {
+      return true;
+    }
+    uint32_t pgn = CANIdToPGN(id);
+    uint32_t source = id & 0xFF;
+    const Entry* entry = find(pgn, source);
+    if (entry == nullptr) {
+      return false;
+    }
+    if (entry->interval_ms == 0) {
+      return true;
+    }
+
+    RateState& state = get_rate_state((pgn << 8) | source, now_ms);
+    if (len > 0 && is_fast_packet_pgn_(pgn)) {
+      uint8_t sequence = data[0] >> 5;
+      if ((data[0] & 0x1F) != 0) {
+        // later frames follow the decision made for the first one
+        return state.sequence == sequence;
+      }
+      if (state.started && now_ms - state.last_ms < entry->interval_ms) {
+        state.sequence = kNoSequence;
+        return false;
+      }
+      state.sequence = sequence;
+    } else if (state.started && now_ms - state.last_ms < entry->interval_ms) {
+      return false;
+    }
+    state.started = true;
+    state.last_ms = now_ms;
+    return true;
+  }
+
+ protected:
+  static constexpr uint32_t kEmpty = 0xFFFFFFFF;
+  static constexpr uint32_t kAnySource = 0xFFFFFFFF;
+  static constexpr uint8_t kNoSequence = 0xFF;
+  // twice the maximum number of entries keeps the probe sequences short
+  static constexpr size_t kTableSize = 2 * kMaxEntries;
+  static constexpr size_t kTableMask = kTableSize - 1;
+  // rate limit states are replaced after this many probes
+  static constexpr size_t kMaxRateProbes = 4;
+
+  struct Entry {
+    uint32_t pgn;
+    uint32_t source;       //< kAnySource for all sources
+    uint32_t interval_ms;  //< 0 if not rate limited
+  };
+
+  struct RateState {
+    uint32_t key;  //< PGN and source address
+    uint32_t last_ms;
+    bool started;
+    uint8_t sequence;  //< Fast-packet message being passed
+  };
+
+  std::function<bool(uint32_t pgn)> is_fast_packet_pgn_;
+  Entry entries_[kTableSize];
+  RateState rate_states_[kTableSize];
+  int num_entries_ = 0;
+
+  static size_t hash(uint32_t key) { return (key * 2654435761u) >> 26; }
+
+  const Entry* find(uint32_t pgn, uint32_t source) const {
+    size_t slot = hash(pgn) & kTableMask;
+    while (entries_[slot].pgn != kEmpty) {
+      const Entry& entry = entries_[slot];
+      if (entry.pgn == pgn &&
+          (entry.source == kAnySource || entry.source == source)) {
+        return &entry;
+      }
+      slot = (slot + 1) & kTableMask;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Get the rate limit state of a PGN and source, replacing the
+   * least recently passed of the probed states if it isn't tracked.
+   */
+  RateState& get_rate_state(uint32_t key, uint32_t now_ms) {
+    size_t slot = hash(key) & kTableMask;
+    RateState* replaced = &rate_states_[slot];
+    for (size_t i = 0; i < kMaxRateProbes; i++) {
+      RateState& state = rate_states_[(slot + i) & kTableMask];
+      if (state.key == key) {
+        return state;
+      }
+      if (state.key == kEmpty) {
+        replaced = &state;
+        break;
+      }
+      if (now_ms - state.last_ms > now_ms - replaced->last_ms) {
+        replaced = &state;
+      }
+    }
+    replaced->key = key;
+    replaced->last_ms = now_ms;
+    replaced->started = false;
+    replaced->sequence = kNoSequence;
+    return *replaced;
+  }
+
+  static bool parse_number(const char*& pos, uint32_t max, uint32_t& value) {
+    if (*pos < '0' || *pos > '9') {
+      return false;
+    }
+    value = 0;
+    while (*pos >= '0' && *pos <= '9') {
+      value = value * 10 + (*pos - '0');
+      if (value > max) {
+        return false;
+      }
+      pos++;
+    }
+    return true;
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_YDWG_RAW_SUBSCRIPTION_H_
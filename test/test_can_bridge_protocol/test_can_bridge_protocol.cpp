@@ -0,0 +1,234 @@
+// Native unit tests of the CAN bridge datagram format and the receive
+// sequence tracking. Run with "pio test -e native".
+
+#include <unity.h>
+
+#include <cstring>
+
+#include "can_bridge_protocol.h"
+
+static CANFrame MakeFrame(uint32_t id, uint8_t len, uint8_t first,
+                          CANFrameOriginType origin_type) {
+  CANFrame frame = {};
+  frame.id = id;
+  frame.len = len;
+  for (int i = 0; i < len; i++) {
+    frame.buf[i] = first + i;
+  }
+  frame.origin_type = origin_type;
+  return frame;
+}
+
+// three frames: 8 bytes received from CAN, empty, and 3 bytes from an app
+static size_t WriteDatagram(CANBridgeDatagramWriter& writer) {
+  TEST_ASSERT_TRUE(writer.add(
+      MakeFrame(0x09F80101, 8, 0x10, CANFrameOriginType::kCAN), 1000));
+  TEST_ASSERT_TRUE(writer.add(
+      MakeFrame(0x1DEFFF02, 0, 0, CANFrameOriginType::kRemoteCAN), 1000));
+  TEST_ASSERT_TRUE(writer.add(
+      MakeFrame(0x0DF11903, 3, 0xF0, CANFrameOriginType::kApp), 1255));
+  return writer.finish();
+}
+
+void test_round_trip() {
+  CANBridgeDatagramWriter writer(0x12345678);
+  size_t len = WriteDatagram(writer);
+  TEST_ASSERT_EQUAL(kCANBridgeHeaderSize + 14 + 6 + 9, len);
+  TEST_ASSERT_EQUAL_UINT32(1, writer.get_sequence());
+
+  CANBridgeDatagramReader reader;
+  TEST_ASSERT_TRUE(reader.begin(writer.data(), len));
+  TEST_ASSERT_EQUAL_UINT32(0x12345678, reader.get_sender_id());
+  TEST_ASSERT_EQUAL_UINT32(0, reader.get_sequence());
+  TEST_ASSERT_EQUAL(3, reader.get_num_frames());
+
+  CANFrame frame;
+  uint32_t time_ms;
+  TEST_ASSERT_TRUE(reader.next(frame, time_ms));
+  TEST_ASSERT_EQUAL_UINT32(0x09F80101, frame.id);
+  TEST_ASSERT_EQUAL(8, frame.len);
+  TEST_ASSERT_EQUAL_HEX8(0x17, frame.buf[7]);
+  TEST_ASSERT_EQUAL_UINT32(1000, time_ms);
+  TEST_ASSERT_TRUE(frame.origin_type == CANFrameOriginType::kRemoteCAN);
+
+  TEST_ASSERT_TRUE(reader.next(frame, time_ms));
+  TEST_ASSERT_EQUAL_UINT32(0x1DEFFF02, frame.id);
+  TEST_ASSERT_EQUAL(0, frame.len);
+  TEST_ASSERT_TRUE(frame.origin_type == CANFrameOriginType::kRemoteCAN);
+
+  TEST_ASSERT_TRUE(reader.next(frame, time_ms));
+  TEST_ASSERT_EQUAL_UINT32(0x0DF11903, frame.id);
+  TEST_ASSERT_EQUAL(3, frame.len);
+  const uint8_t data[] = {0xF0, 0xF1, 0xF2};
+  TEST_ASSERT_EQUAL_MEMORY(data, frame.buf, 3);
+  TEST_ASSERT_EQUAL_UINT32(1255, time_ms);
+  TEST_ASSERT_TRUE(frame.origin_type == CANFrameOriginType::kRemoteApp);
+
+  TEST_ASSERT_FALSE(reader.next(frame, time_ms));
+}
+
+void test_writer_limits() {
+  CANBridgeDatagramWriter writer(1);
+  CANFrame frame = MakeFrame(0x09F80101, 8, 0, CANFrameOriginType::kCAN);
+
+  // the time offset is a single byte
+  TEST_ASSERT_TRUE(writer.add(frame, 5000));
+  TEST_ASSERT_FALSE(writer.add(frame, 5256));
+  TEST_ASSERT_EQUAL(kCANBridgeHeaderSize + 14, writer.finish());
+  TEST_ASSERT_TRUE(writer.add(frame, 5256));
+  TEST_ASSERT_EQUAL_UINT32(5256, writer.get_base_ms());
+  writer.finish();
+
+  // the datagram size is limited
+  int num_frames = 0;
+  while (writer.add(frame, 6000)) {
+    num_frames++;
+  }
+  TEST_ASSERT_EQUAL((kCANBridgeMaxDatagramSize - kCANBridgeHeaderSize) / 14,
+                    num_frames);
+  size_t len = writer.finish();
+  TEST_ASSERT_TRUE(len <= kCANBridgeMaxDatagramSize);
+  TEST_ASSERT_EQUAL_UINT32(3, writer.get_sequence());
+
+  CANBridgeDatagramReader reader;
+  TEST_ASSERT_TRUE(reader.begin(writer.data(), len));
+  TEST_ASSERT_EQUAL_UINT32(2, reader.get_sequence());
+  TEST_ASSERT_EQUAL(num_frames, reader.get_num_frames());
+}
+
+void test_truncated() {
+  CANBridgeDatagramWriter writer(1);
+  size_t len = WriteDatagram(writer);
+  CANBridgeDatagramReader reader;
+  for (size_t i = 0; i < len; i++) {
+    TEST_ASSERT_FALSE(reader.begin(writer.data(), i));
+  }
+  CANFrame frame;
+  uint32_t time_ms;
+  TEST_ASSERT_FALSE(reader.next(frame, time_ms));
+}
+
+void test_invalid() {
+  CANBridgeDatagramWriter writer(1);
+  size_t len = WriteDatagram(writer);
+  uint8_t buf[kCANBridgeMaxDatagramSize + 1];
+  CANBridgeDatagramReader reader;
+
+  memcpy(buf, writer.data(), len);
+  buf[0] = 'Y';
+  TEST_ASSERT_FALSE(reader.begin(buf, len));
+
+  memcpy(buf, writer.data(), len);
+  buf[2] = kCANBridgeVersion + 1;
+  TEST_ASSERT_FALSE(reader.begin(buf, len));
+
+  // data length of the first frame above 8
+  memcpy(buf, writer.data(), len);
+  buf[kCANBridgeHeaderSize] = 9;
+  TEST_ASSERT_FALSE(reader.begin(buf, len));
+
+  // more frames announced than present
+  memcpy(buf, writer.data(), len);
+  buf[3] = 4;
+  TEST_ASSERT_FALSE(reader.begin(buf, len));
+
+  // trailing garbage
+  memcpy(buf, writer.data(), len);
+  buf[len] = 0;
+  TEST_ASSERT_FALSE(reader.begin(buf, len + 1));
+
+  memcpy(buf, writer.data(), len);
+  TEST_ASSERT_TRUE(reader.begin(buf, len));
+}
+
+void test_sequence_in_order_and_lost() {
+  CANBridgeSequenceTracker tracker;
+  CANBridgeStats stats;
+  TEST_ASSERT_TRUE(tracker.update(100, stats));
+  TEST_ASSERT_TRUE(tracker.update(101, stats));
+  TEST_ASSERT_TRUE(tracker.update(104, stats));
+  TEST_ASSERT_EQUAL_UINT32(3, stats.received);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.reordered);
+
+  // a gap wider than the reorder window
+  TEST_ASSERT_TRUE(tracker.update(1000, stats));
+  TEST_ASSERT_EQUAL_UINT32(2 + 895, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.late);
+}
+
+void test_sequence_reorder() {
+  CANBridgeSequenceTracker tracker;
+  CANBridgeStats stats;
+  tracker.update(10, stats);
+  tracker.update(13, stats);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.lost);
+
+  TEST_ASSERT_TRUE(tracker.update(12, stats));
+  TEST_ASSERT_TRUE(tracker.update(11, stats));
+  TEST_ASSERT_EQUAL_UINT32(0, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.reordered);
+  TEST_ASSERT_EQUAL_UINT32(4, stats.received);
+
+  // the oldest datagram still within the window
+  TEST_ASSERT_TRUE(tracker.update(
+      13 + CANBridgeSequenceTracker::kReorderWindow + 1, stats));
+  TEST_ASSERT_TRUE(tracker.update(15, stats));
+  TEST_ASSERT_EQUAL_UINT32(3, stats.reordered);
+
+  // beyond the window: already counted as lost
+  uint32_t lost = stats.lost;
+  TEST_ASSERT_FALSE(tracker.update(14, stats));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.late);
+  TEST_ASSERT_EQUAL_UINT32(lost, stats.lost);
+}
+
+void test_sequence_duplicates() {
+  CANBridgeSequenceTracker tracker;
+  CANBridgeStats stats;
+  tracker.update(7, stats);
+  TEST_ASSERT_FALSE(tracker.update(7, stats));
+  tracker.update(9, stats);
+  TEST_ASSERT_FALSE(tracker.update(7, stats));
+  TEST_ASSERT_TRUE(tracker.update(8, stats));
+  TEST_ASSERT_FALSE(tracker.update(8, stats));
+  TEST_ASSERT_FALSE(tracker.update(9, stats));
+  TEST_ASSERT_EQUAL_UINT32(4, stats.duplicates);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.reordered);
+}
+
+void test_sequence_wrap() {
+  CANBridgeSequenceTracker tracker;
+  CANBridgeStats stats;
+  TEST_ASSERT_TRUE(tracker.update(0xFFFFFFFE, stats));
+  TEST_ASSERT_TRUE(tracker.update(0xFFFFFFFF, stats));
+  TEST_ASSERT_TRUE(tracker.update(0, stats));
+  TEST_ASSERT_TRUE(tracker.update(2, stats));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.lost);
+
+  // reordered and duplicated across the wrap
+  TEST_ASSERT_TRUE(tracker.update(1, stats));
+  TEST_ASSERT_FALSE(tracker.update(0xFFFFFFFF, stats));
+  TEST_ASSERT_EQUAL_UINT32(0, stats.lost);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.reordered);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.duplicates);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.late);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_writer_limits);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_invalid);
+  RUN_TEST(test_sequence_in_order_and_lost);
+  RUN_TEST(test_sequence_reorder);
+  RUN_TEST(test_sequence_duplicates);
+  RUN_TEST(test_sequence_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,132 @@
+// Native unit tests of the AIS Class B static data pairing of the NMEA 2000
+// to NMEA 0183 transform. Run with "pio test -e native".
+
+#include <N2kMessages.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "n2k_nmea0183_transform.h"
+
+static std::vector<String> sentences;
+
+static N2KTo0183Transform* MakeTransform() {
+  auto transform = new N2KTo0183Transform(nullptr);
+  transform->connect_to(new LambdaConsumer<OriginString>(
+      [](OriginString output) { sentences.push_back(output.data); }));
+  return transform;
+}
+
+/**
+ * @brief Get the armored payload field of an !AIVDM sentence.
+ */
+static String Payload(const String& sentence) {
+  // !AIVDM,1,1,,B,PAYLOAD,FILL*CS
+  int begin = sentence.indexOf(",B,") + 3;
+  return sentence.substring(begin, sentence.indexOf(',', begin));
+}
+
+/**
+ * @brief Extract an unsigned field from an armored AIS payload.
+ */
+static uint32_t PayloadBits(const String& payload, int start, int num_bits) {
+  uint32_t value = 0;
+  for (int bit = start; bit < start + num_bits; bit++) {
+    int sixbit = payload[bit / 6] - 48;
+    if (sixbit > 40) {
+      sixbit -= 8;
+    }
+    value = (value << 1) | ((sixbit >> (5 - bit % 6)) & 1);
+  }
+  return value;
+}
+
+static void SetPartA(tN2kMsg& msg, uint32_t mmsi) {
+  SetN2kPGN129809(msg, 24, N2kaisr_Initial, mmsi, "TEST VESSEL");
+}
+
+static void SetPartB(tN2kMsg& msg, uint32_t mmsi) {
+  SetN2kPGN129810(msg, 24, N2kaisr_Initial, mmsi, 36, "ABC", "OH1234", 12.0,
+                  4.0, 1.0, 3.0, 0);
+}
+
+static void CheckPair(uint32_t mmsi) {
+  TEST_ASSERT_EQUAL(2, sentences.size());
+  for (int part = 0; part < 2; part++) {
+    TEST_ASSERT_TRUE(sentences[part].startsWith("!AIVDM,1,1,,B,"));
+    TEST_ASSERT_TRUE(sentences[part].endsWith("\r\n"));
+    String payload = Payload(sentences[part]);
+    TEST_ASSERT_EQUAL_UINT32(24, PayloadBits(payload, 0, 6));
+    TEST_ASSERT_EQUAL_UINT32(mmsi, PayloadBits(payload, 8, 30));
+    TEST_ASSERT_EQUAL_UINT32(part, PayloadBits(payload, 38, 2));
+  }
+  // first character of the name and of the call sign, in 6-bit ASCII
+  String part_a = Payload(sentences[0]);
+  TEST_ASSERT_EQUAL_UINT32('T' - 64, PayloadBits(part_a, 40, 6));
+  String part_b = Payload(sentences[1]);
+  TEST_ASSERT_EQUAL_UINT32(36, PayloadBits(part_b, 40, 8));
+  TEST_ASSERT_EQUAL_UINT32('O' - 64, PayloadBits(part_b, 90, 6));
+  TEST_ASSERT_EQUAL_UINT32(3, PayloadBits(part_b, 132, 9));  // to bow
+  TEST_ASSERT_EQUAL_UINT32(9, PayloadBits(part_b, 141, 9));  // to stern
+}
+
+void test_part_a_then_part_b() {
+  N2KTo0183Transform* transform = MakeTransform();
+  tN2kMsg msg;
+  SetPartA(msg, 230123456);
+  transform->set_input(msg);
+  TEST_ASSERT_EQUAL(0, sentences.size());
+  SetPartB(msg, 230123456);
+  transform->set_input(msg);
+  CheckPair(230123456);
+}
+
+void test_part_b_then_part_a() {
+  N2KTo0183Transform* transform = MakeTransform();
+  tN2kMsg msg;
+  SetPartB(msg, 230654321);
+  transform->set_input(msg);
+  TEST_ASSERT_EQUAL(0, sentences.size());
+  SetPartA(msg, 230654321);
+  transform->set_input(msg);
+  CheckPair(230654321);
+}
+
+void test_parts_of_different_vessels() {
+  N2KTo0183Transform* transform = MakeTransform();
+  tN2kMsg msg;
+  SetPartA(msg, 230000001);
+  transform->set_input(msg);
+  SetPartB(msg, 230000002);
+  transform->set_input(msg);
+  TEST_ASSERT_EQUAL(0, sentences.size());
+}
+
+void test_static_data_cached_for_replay() {
+  N2KTo0183Transform* transform = MakeTransform();
+  tN2kMsg msg;
+  SetPartA(msg, 230777777);
+  transform->set_input(msg);
+  SetPartB(msg, 230777777);
+  transform->set_input(msg);
+  std::vector<String> replayed;
+  transform->replay_static_data(
+      [&replayed](const char* sentence) { replayed.push_back(sentence); });
+  // both parts in one table entry, in order
+  TEST_ASSERT_EQUAL(1, replayed.size());
+  TEST_ASSERT_EQUAL_STRING((sentences[0] + sentences[1]).c_str(),
+                           replayed[0].c_str());
+}
+
+void setUp() { sentences.clear(); }
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_part_a_then_part_b);
+  RUN_TEST(test_part_b_then_part_a);
+  RUN_TEST(test_parts_of_different_vessels);
+  RUN_TEST(test_static_data_cached_for_replay);
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+// Native unit tests of the SeaSmart.Net routes of the router: sentences are
+// batched per route and timestamped with the bus receive time. Run with
+// "pio test -e native".
+
+#include <unity.h>
+
+#include <cstring>
+#include <vector>
+
+#include "ReactESP.h"
+#include "router.h"
+#include "seasmart_transform.h"
+
+static std::vector<String> batches;
+static std::vector<String> other_batches;
+
+static Router* MakeRouter(const char* table) {
+  Router* router = new Router([](uint32_t pgn) { return false; });
+  router->set_sink(RouteEndpoint::kNMEA0183UDP,
+                   new LambdaConsumer<OriginString>([](OriginString batch) {
+                     batches.push_back(batch.data);
+                   }));
+  router->set_sink(RouteEndpoint::kYDWGRawUDP,
+                   new LambdaConsumer<OriginString>([](OriginString batch) {
+                     other_batches.push_back(batch.data);
+                   }));
+  router->set_seasmart_encoder(AppendSeaSmartString);
+  std::vector<Route> routes;
+  String error;
+  TEST_ASSERT_TRUE(ParseRoutingTable(table, routes, error));
+  router->set_routes(routes);
+  return router;
+}
+
+static tN2kMsg MakeMessage(unsigned long pgn, unsigned long msg_time) {
+  tN2kMsg msg;
+  msg.Priority = 2;
+  msg.PGN = pgn;
+  msg.Source = 0x23;
+  msg.DataLen = 8;
+  for (int i = 0; i < msg.DataLen; i++) {
+    msg.Data[i] = i;
+  }
+  msg.MsgTime = msg_time;
+  return msg;
+}
+
+static void RunFor(uint32_t ms) {
+  uint32_t start = millis();
+  while (millis() - start < ms) {
+    ReactESP::app->tick();
+    delay(1);
+  }
+}
+
+void test_batched_until_flush_interval() {
+  Router* router = MakeRouter("can > seasmart > 0183-udp");
+  // let a flush that is already due pass
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  batches.clear();
+
+  router->get_message_input()->set_input(MakeMessage(127250, 1000));
+  router->get_message_input()->set_input(MakeMessage(129025, 1001));
+  TEST_ASSERT_EQUAL(0, batches.size());
+
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  TEST_ASSERT_EQUAL(1, batches.size());
+  const char* batch = batches[0].c_str();
+  const char* second = strstr(batch, "\r\n$PCDIN,");
+  TEST_ASSERT_NOT_NULL(second);
+  TEST_ASSERT_EQUAL(0, strncmp(batch, "$PCDIN,01F112,", 14));
+  TEST_ASSERT_EQUAL(0, strncmp(second + 2, "$PCDIN,01F801,", 14));
+  TEST_ASSERT_EQUAL(0, strcmp(batch + batches[0].length() - 2, "\r\n"));
+}
+
+void test_batch_size_flushes() {
+  Router* router = MakeRouter("can > seasmart > 0183-udp");
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  batches.clear();
+
+  // flushed without waiting once a batch reaches the batch size
+  int num_messages = 0;
+  while (batches.empty()) {
+    router->get_message_input()->set_input(MakeMessage(127250, num_messages));
+    num_messages++;
+    TEST_ASSERT_TRUE(num_messages < 1000);
+  }
+  TEST_ASSERT_EQUAL(1, batches.size());
+  TEST_ASSERT_TRUE(batches[0].length() >= kSeasmartBatchSize);
+  TEST_ASSERT_TRUE(batches[0].length() <
+                   kSeasmartBatchSize + kMaxNMEA2000MessageSeasmartSize);
+
+  // the sentences are never split between batches
+  int num_sentences = 0;
+  for (const char* pos = batches[0].c_str(); (pos = strstr(pos, "$PCDIN,"));
+       pos++) {
+    num_sentences++;
+  }
+  TEST_ASSERT_EQUAL(num_messages, num_sentences);
+}
+
+void test_bus_receive_timestamp() {
+  Router* router = MakeRouter("can > seasmart > 0183-udp");
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  batches.clear();
+
+  // the receive time, not the time of encoding
+  router->get_message_input()->set_input(MakeMessage(127250, 0x1E240));
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  TEST_ASSERT_EQUAL(1, batches.size());
+  TEST_ASSERT_EQUAL(0, strncmp(batches[0].c_str(),
+                               "$PCDIN,01F112,0001E240,23,", 26));
+}
+
+void test_batches_per_route() {
+  Router* router = MakeRouter(
+      "can > seasmart > 0183-udp [127250]; can > seasmart > ydwg-udp");
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  batches.clear();
+  other_batches.clear();
+
+  router->get_message_input()->set_input(MakeMessage(127250, 1000));
+  router->get_message_input()->set_input(MakeMessage(129025, 1001));
+  RunFor(kSeasmartFlushIntervalMs + 10);
+  TEST_ASSERT_EQUAL(1, batches.size());
+  TEST_ASSERT_NULL(strstr(batches[0].c_str(), "01F801"));
+  TEST_ASSERT_EQUAL(1, other_batches.size());
+  TEST_ASSERT_NOT_NULL(strstr(other_batches[0].c_str(), "01F112"));
+  TEST_ASSERT_NOT_NULL(strstr(other_batches[0].c_str(), "01F801"));
+}
+
+void setUp() {
+  batches.clear();
+  other_batches.clear();
+}
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_batched_until_flush_interval);
+  RUN_TEST(test_batch_size_flushes);
+  RUN_TEST(test_bus_receive_timestamp);
+  RUN_TEST(test_batches_per_route);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// Native unit tests of the routing table parser. Run with
+// "pio test -e native".
+
+#include <unity.h>
+
+#include "routing_table.h"
+
+static String ParseError(const char* text) {
+  std::vector<Route> routes;
+  String error;
+  TEST_ASSERT_FALSE(ParseRoutingTable(text, routes, error));
+  return error;
+}
+
+void test_parse() {
+  std::vector<Route> routes;
+  String error;
+  TEST_ASSERT_TRUE(ParseRoutingTable(
+      "can > ydwg > ydwg-tcp; can > 0183 > 0183-udp [129025 127250/1000]\n"
+      " ; \n YDWG-UDP>Raw>0183-Client\n0183-tcp > 0183 > can",
+      routes, error));
+  TEST_ASSERT_EQUAL(4, routes.size());
+
+  TEST_ASSERT_TRUE(routes[0].source == RouteEndpoint::kCAN);
+  TEST_ASSERT_TRUE(routes[0].format == RouteFormat::kYDWGRaw);
+  TEST_ASSERT_TRUE(routes[0].sink == RouteEndpoint::kYDWGRawTCP);
+  TEST_ASSERT_EQUAL_STRING("", routes[0].filter.c_str());
+
+  TEST_ASSERT_TRUE(routes[1].format == RouteFormat::kNMEA0183);
+  TEST_ASSERT_TRUE(routes[1].sink == RouteEndpoint::kNMEA0183UDP);
+  TEST_ASSERT_EQUAL_STRING("129025 127250/1000", routes[1].filter.c_str());
+
+  TEST_ASSERT_TRUE(routes[2].source == RouteEndpoint::kYDWGRawUDP);
+  TEST_ASSERT_TRUE(routes[2].format == RouteFormat::kRaw);
+  TEST_ASSERT_TRUE(routes[2].sink == RouteEndpoint::kNMEA0183Client);
+
+  TEST_ASSERT_TRUE(routes[3].source == RouteEndpoint::kNMEA0183TCP);
+  TEST_ASSERT_TRUE(routes[3].sink == RouteEndpoint::kCAN);
+
+  TEST_ASSERT_TRUE(ParseRoutingTable("", routes, error));
+  TEST_ASSERT_EQUAL(0, routes.size());
+}
+
+void test_to_string_round_trip() {
+  const char* text =
+      "can > seasmart > ydwg-client [129025:3/500, 127250]; "
+      "ydwg-tcp > ydwg > can; 0183-udp > raw > ydwg-udp";
+  std::vector<Route> routes;
+  String error;
+  TEST_ASSERT_TRUE(ParseRoutingTable(text, routes, error));
+  TEST_ASSERT_EQUAL(3, routes.size());
+  TEST_ASSERT_EQUAL_STRING("can > seasmart > ydwg-client [129025:3/500, 127250]",
+                           RouteToString(routes[0]).c_str());
+
+  String printed;
+  for (const auto& route : routes) {
+    printed += RouteToString(route) + "\n";
+  }
+  std::vector<Route> reparsed;
+  TEST_ASSERT_TRUE(ParseRoutingTable(printed, reparsed, error));
+  TEST_ASSERT_EQUAL(routes.size(), reparsed.size());
+  for (size_t i = 0; i < routes.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(RouteToString(routes[i]).c_str(),
+                             RouteToString(reparsed[i]).c_str());
+  }
+}
+
+void test_syntax_errors() {
+  TEST_ASSERT_EQUAL_STRING("route 1: expected SOURCE > FORMAT > SINK",
+                           ParseError("can > ydwg").c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      "route 2: expected SOURCE > FORMAT > SINK",
+      ParseError("can > ydwg > ydwg-tcp; can > ydwg > ydwg-udp > can")
+          .c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: filter not closed with ]",
+                           ParseError("can > ydwg > ydwg-tcp [129025").c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: unknown source 'bus'",
+                           ParseError("bus > ydwg > ydwg-tcp").c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: unknown format 'json'",
+                           ParseError("can > json > ydwg-tcp").c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: unknown sink 'ydwg'",
+                           ParseError("can > ydwg > ydwg").c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      "route 1: invalid filter",
+      ParseError("can > ydwg > ydwg-tcp [129025/fast]").c_str());
+}
+
+void test_invalid_routes() {
+  TEST_ASSERT_EQUAL_STRING("route 1: source and sink are the same",
+                           ParseError("ydwg-tcp > raw > ydwg-tcp").c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: CAN frames can't be forwarded raw",
+                           ParseError("can > raw > ydwg-tcp").c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: only ydwg and 0183 can be decoded",
+                           ParseError("ydwg-tcp > seasmart > can").c_str());
+  TEST_ASSERT_EQUAL_STRING("route 1: data is forwarded between ports raw",
+                           ParseError("ydwg-tcp > ydwg > ydwg-udp").c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      "route 1: raw routes can't be filtered",
+      ParseError("ydwg-tcp > raw > ydwg-udp [129025]").c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      "route 2: duplicate route",
+      ParseError("can > ydwg > ydwg-tcp; can > ydwg > ydwg-tcp [129025]")
+          .c_str());
+}
+
+void test_too_many_routes() {
+  // all valid combinations of source, format and sink
+  String text;
+  int num_routes = 0;
+  for (int source = 0; source < (int)RouteEndpoint::kNumEndpoints; source++) {
+    for (int format = 0; format < (int)RouteFormat::kNumFormats; format++) {
+      for (int sink = 0; sink < (int)RouteEndpoint::kNumEndpoints; sink++) {
+        Route route = {(RouteEndpoint)source, (RouteFormat)format,
+                       (RouteEndpoint)sink, ""};
+        std::vector<Route> routes;
+        String error;
+        if (ParseRoutingTable(RouteToString(route), routes, error)) {
+          text += RouteToString(route) + ";";
+          num_routes++;
+        }
+      }
+    }
+  }
+  TEST_ASSERT_TRUE(num_routes > (int)kMaxRoutes);
+  TEST_ASSERT_EQUAL_STRING(
+      (String("route ") + String((int)kMaxRoutes + 1) + ": too many routes")
+          .c_str(),
+      ParseError(text.c_str()).c_str());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse);
+  RUN_TEST(test_to_string_round_trip);
+  RUN_TEST(test_syntax_errors);
+  RUN_TEST(test_invalid_routes);
+  RUN_TEST(test_too_many_routes);
+  return UNITY_END();
+}
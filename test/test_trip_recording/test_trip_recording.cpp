@@ -0,0 +1,158 @@
+// Native unit tests of the binary trip recording format. Run with
+// "pio test -e native".
+
+#include <unity.h>
+
+#include <cstring>
+#include <vector>
+
+#include "trip_recording.h"
+
+struct TimedFrame {
+  CANFrame frame;
+  uint64_t time_ms;
+};
+
+static const uint64_t kStartMs = 1700000000000ULL;
+
+// frames exercising all delta sizes, time syncs, data changes and the
+// dictionary eviction
+static std::vector<TimedFrame> MakeFrames() {
+  std::vector<TimedFrame> frames;
+  uint64_t time_ms = kStartMs;
+  const uint64_t kSteps[] = {0, 0, 1, 200, 300, 70000, 5000000000ULL};
+  for (int i = 0; i < 400; i++) {
+    TimedFrame timed = {};
+    CANFrame& frame = timed.frame;
+    // a few ids repeat often, the others fill the dictionary
+    frame.id = i % 3 == 0 ? 0x09F80100 + i % 4 : 0x0DF00000 + i;
+    frame.len = i % 9;
+    for (int j = 0; j < frame.len; j++) {
+      frame.buf[j] = j == i % 8 ? i : j;
+    }
+    frame.origin_type =
+        i % 5 == 0 ? CANFrameOriginType::kApp : CANFrameOriginType::kCAN;
+    if (i == 150) {
+      time_ms -= 1000;  // the clock steps backwards
+    } else {
+      time_ms += kSteps[i % 7];
+    }
+    timed.time_ms = time_ms;
+    frames.push_back(timed);
+  }
+  return frames;
+}
+
+static std::vector<uint8_t> Encode(const std::vector<TimedFrame>& frames) {
+  TripRecordingEncoder encoder;
+  std::vector<uint8_t> recording(kTripRecordingHeaderSize);
+  encoder.begin(kStartMs, recording.data());
+  uint8_t buf[kMaxTripRecordSize];
+  for (const auto& timed : frames) {
+    size_t len = encoder.encode(timed.frame, timed.time_ms, buf);
+    TEST_ASSERT_TRUE(len > 0 && len <= kMaxTripRecordSize);
+    recording.insert(recording.end(), buf, buf + len);
+  }
+  return recording;
+}
+
+static std::vector<TimedFrame> Decode(const std::vector<uint8_t>& recording) {
+  TripRecordingDecoder decoder;
+  std::vector<TimedFrame> frames;
+  size_t pos = decoder.begin(recording.data(), recording.size());
+  TEST_ASSERT_EQUAL(kTripRecordingHeaderSize, pos);
+  TEST_ASSERT_EQUAL_UINT64(kStartMs, decoder.get_start_ms());
+  while (pos < recording.size()) {
+    TimedFrame timed;
+    int len = decoder.decode(recording.data() + pos, recording.size() - pos,
+                             timed.frame, timed.time_ms);
+    TEST_ASSERT_TRUE(len > 0);
+    pos += len;
+    frames.push_back(timed);
+  }
+  return frames;
+}
+
+void test_round_trip() {
+  std::vector<TimedFrame> frames = MakeFrames();
+  std::vector<TimedFrame> decoded = Decode(Encode(frames));
+  TEST_ASSERT_EQUAL(frames.size(), decoded.size());
+  for (size_t i = 0; i < frames.size(); i++) {
+    const CANFrame& expected = frames[i].frame;
+    const CANFrame& frame = decoded[i].frame;
+    TEST_ASSERT_EQUAL_UINT32(expected.id, frame.id);
+    TEST_ASSERT_EQUAL(expected.len, frame.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected.buf, frame.buf, expected.len);
+    TEST_ASSERT_EQUAL_UINT64(frames[i].time_ms, decoded[i].time_ms);
+    TEST_ASSERT_TRUE(frame.origin_type == expected.origin_type);
+  }
+}
+
+void test_reencode_is_identical() {
+  std::vector<uint8_t> recording = Encode(MakeFrames());
+  std::vector<uint8_t> reencoded = Encode(Decode(recording));
+  TEST_ASSERT_EQUAL(recording.size(), reencoded.size());
+  TEST_ASSERT_EQUAL_MEMORY(recording.data(), reencoded.data(),
+                           recording.size());
+}
+
+void test_truncated() {
+  std::vector<uint8_t> recording = Encode(MakeFrames());
+  TripRecordingDecoder decoder;
+  for (size_t len = 0; len < kTripRecordingHeaderSize; len++) {
+    TEST_ASSERT_EQUAL(0, decoder.begin(recording.data(), len));
+  }
+
+  // every proper prefix of a record asks for more data
+  size_t pos = decoder.begin(recording.data(), recording.size());
+  while (pos < recording.size()) {
+    TripRecordingDecoder truncated = decoder;
+    CANFrame frame;
+    uint64_t time_ms;
+    int len = decoder.decode(recording.data() + pos, recording.size() - pos,
+                             frame, time_ms);
+    TEST_ASSERT_TRUE(len > 0);
+    for (int i = 0; i < len; i++) {
+      TripRecordingDecoder copy = truncated;
+      TEST_ASSERT_EQUAL(0, copy.decode(recording.data() + pos, i, frame,
+                                       time_ms));
+    }
+    pos += len;
+  }
+}
+
+void test_invalid() {
+  std::vector<uint8_t> recording = Encode(MakeFrames());
+  TripRecordingDecoder decoder;
+
+  std::vector<uint8_t> bad = recording;
+  bad[0] = 'X';
+  TEST_ASSERT_EQUAL(0, decoder.begin(bad.data(), bad.size()));
+  bad = recording;
+  bad[4] = kTripRecordingVersion + 1;
+  TEST_ASSERT_EQUAL(0, decoder.begin(bad.data(), bad.size()));
+
+  // data lengths 9 to 14 are invalid; 15 marks a time sync record
+  TEST_ASSERT_EQUAL(kTripRecordingHeaderSize,
+                    decoder.begin(recording.data(), recording.size()));
+  CANFrame frame;
+  uint64_t time_ms;
+  for (uint8_t header = 9; header < 0x0F; header++) {
+    const uint8_t record[] = {header, 0, 0, 0, 0, 0};
+    TEST_ASSERT_EQUAL(-1, decoder.decode(record, sizeof(record), frame,
+                                         time_ms));
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_reencode_is_identical);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_invalid);
+  return UNITY_END();
+}